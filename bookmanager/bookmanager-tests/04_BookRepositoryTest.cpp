@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include "../src/Book.h"
+#include "../src/BookPatch.h"
 #include "../src/BookRepository.h"
 #include <iostream>
 #include <string>
@@ -138,6 +139,37 @@ TEST_CASE("Test BookRepository class. Test updating book information.")
 }
 
 
+TEST_CASE("Test BookRepository class. Test patching book information.")
+{
+   BookRepository repository;
+   
+   BookPatch ratingPatch(R"({"rating": 5})");
+   REQUIRE(repository.patch(NEW_USER_ID, NEW_BOOK_ID, ratingPatch) == true);
+   
+   Book patchedBook = repository.getById(NEW_USER_ID, NEW_BOOK_ID);
+   REQUIRE (patchedBook.title() == "Updated Title");
+   REQUIRE (patchedBook.author() == "Updated Author");
+   REQUIRE (patchedBook.year() == "2000");
+   REQUIRE (patchedBook.read() == false);
+   REQUIRE (patchedBook.rating() == 5);
+   
+   BookPatch readPatch(R"({"read": true, "title": "Patched Title"})");
+   REQUIRE(repository.patch(NEW_USER_ID, NEW_BOOK_ID, readPatch) == true);
+   
+   patchedBook = repository.getById(NEW_USER_ID, NEW_BOOK_ID);
+   REQUIRE (patchedBook.title() == "Patched Title");
+   REQUIRE (patchedBook.read() == true);
+   REQUIRE (patchedBook.rating() == 5);
+   
+   // The book does not belong to this user.
+   REQUIRE(repository.patch(BOOK_1_USER_ID, NEW_BOOK_ID, ratingPatch) == false);
+   
+   REQUIRE_THROWS_AS(BookPatch(R"({"rating": 6})"), std::runtime_error);
+   REQUIRE_THROWS_AS(BookPatch(R"({"title": null})"), std::runtime_error);
+   REQUIRE_THROWS_AS(BookPatch(R"({"unknown": 1})"), std::runtime_error);
+}
+
+
 TEST_CASE("BookRepository class. Test removing a user from the database.")
 {
    BookRepository repository;
@@ -150,3 +182,19 @@ TEST_CASE("BookRepository class. Test removing a user from the database.")
    REQUIRE_THROWS_WITH(repository.getById(NEW_USER_ID, NEW_BOOK_ID), "Book with that id does not exist for user.");
 }
 
+
+TEST_CASE("Test BookRepository class. Get a batch of books by ID.")
+{
+   BookRepository repository;
+   
+   std::vector<int> bookIds = {3, 1, 99};
+   std::vector<Book> books = repository.getByIds(BOOK_1_USER_ID, bookIds);
+   REQUIRE(books.size() == 2);
+   
+   // Books belonging to another user are not returned.
+   std::vector<Book> otherUserBooks = repository.getByIds(NEW_USER_ID, bookIds);
+   REQUIRE(otherUserBooks.size() == 0);
+   
+   std::vector<int> tooManyIds(BookRepository::MAX_BATCH_IDS + 1, 1);
+   REQUIRE_THROWS_AS(repository.getByIds(BOOK_1_USER_ID, tooManyIds), std::out_of_range);
+}
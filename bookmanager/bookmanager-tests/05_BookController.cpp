@@ -127,3 +127,48 @@ TEST_CASE("Test BookController::search")
    
    Logger::instance().log(Logger::LogLevel::INFO, "TEST 05_BookController", "Test search - LEAVE");
 }
+
+TEST_CASE("Test BookController::getByIds")
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 05_BookController", "Test getByIds - ENTER");
+   
+   BookController bookController;
+   JsonResponse jsonResponse = bookController.getByIds(token, "2,15,1");
+   
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Ok);
+   REQUIRE(jsonResponse.message() == R"({"message":"OK", "books":[{"author":"James S.A. Corey","id":2,"rating":5,"read":true,"title":"The Expanse","userId":1,"year":"2014"},{"id":15,"message":"Not found"},{"author":"Terry Brooks","id":1,"rating":4,"read":true,"title":"Sorcerer's Daughter","userId":1,"year":"2009"}]})");
+   
+   jsonResponse = bookController.getByIds(token, "2,abc");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Bad_Request);
+   
+   jsonResponse = bookController.getByIds("invalid token", "2");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Unauthorized);
+   
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 05_BookController", "Test getByIds - LEAVE");
+}
+
+TEST_CASE("Test BookController::patch")
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 05_BookController", "Test patch - ENTER");
+   
+   BookController bookController;
+   JsonResponse jsonResponse = bookController.patch(token, BOOK_ID, R"({"rating":3})");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Ok);
+   REQUIRE(jsonResponse.message() == R"({"message":"Book updated."})");
+   
+   jsonResponse = bookController.getById(token, BOOK_ID);
+   REQUIRE(jsonResponse.message() ==
+      R"({"message":"OK", "book":{"author":"James S.A. Corey","id":2,"rating":3,"read":true,"title":"The Expanse","userId":1,"year":"2014"}})");
+   
+   jsonResponse = bookController.patch(token, BOOK_ID, R"({"rating":"five"})");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Bad_Request);
+   
+   jsonResponse = bookController.patch(token, NEW_BOOK_ID, R"({"rating":3})");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Not_Found);
+   
+   // Restore the original rating.
+   jsonResponse = bookController.patch(token, BOOK_ID, R"({"rating":5})");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Ok);
+   
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 05_BookController", "Test patch - LEAVE");
+}
@@ -0,0 +1,98 @@
+#include "catch.hpp"
+
+#include "JsonResponse.h"
+#include "Logger.h"
+#include "../src/BatchController.h"
+#include "../src/BookRepository.h"
+#include "../src/TokenRepository.h"
+
+#include <iostream>
+#include <string>
+#include "json.hpp"
+
+using namespace dw;
+using namespace std;
+
+const int BATCH_USER_ID = 1;
+const size_t BATCH_NUM_BOOKS = 13;
+
+TEST_CASE("Test BatchController::process.")
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 08_BatchController", "Test process - ENTER");
+
+   TokenRepository tokenRepository;
+   string batchToken = tokenRepository.create(BATCH_USER_ID);
+
+   std::string jsonRequest = R"({"requests":[
+      {"method":"GET","path":"/api/v1/books/2"},
+      {"method":"GET","path":"/api/v1/books?ids=1,2"},
+      {"method":"GET","path":"/api/v1/books/search/Jack?searchType=author"},
+      {"method":"GET","path":"/api/v1/unknown"}]})";
+
+   BatchController batchController;
+   JsonResponse jsonResponse = batchController.process(batchToken, jsonRequest);
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Ok);
+
+   auto data = nlohmann::json::parse(jsonResponse.message());
+   REQUIRE(data["responses"].size() == 4);
+   REQUIRE(data["responses"][0]["status"] == 200);
+   REQUIRE(data["responses"][0]["body"]["book"]["title"] == "The Expanse");
+   REQUIRE(data["responses"][1]["status"] == 200);
+   REQUIRE(data["responses"][1]["body"]["books"].size() == 2);
+   REQUIRE(data["responses"][2]["status"] == 200);
+   REQUIRE(data["responses"][2]["body"]["books"].size() == 2);
+   REQUIRE(data["responses"][3]["status"] == 404);
+
+   // Paths are matched by segment, and their parameters are decoded.
+   jsonResponse = batchController.process(batchToken, R"({"requests":[
+      {"method":"GET","path":"/api/v1/books/searchJack"},
+      {"method":"GET","path":"/api/v1/books/search/%4Aack?searchType=auth%6Fr"},
+      {"method":"GET","path":"/api/v1/books?ids=1%2C2"},
+      {"method":"GET","path":"/api/v1/booksearch/Jack"}]})");
+   data = nlohmann::json::parse(jsonResponse.message());
+   REQUIRE(data["responses"][0]["status"] == 404);
+   REQUIRE(data["responses"][1]["body"]["books"].size() == 2);
+   REQUIRE(data["responses"][2]["body"]["books"].size() == 2);
+   REQUIRE(data["responses"][3]["status"] == 404);
+
+   jsonResponse = batchController.process("invalid token", jsonRequest);
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Unauthorized);
+
+   jsonResponse = batchController.process(batchToken, R"({"requests":"not an array"})");
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Bad_Request);
+
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 08_BatchController", "Test process - LEAVE");
+}
+
+TEST_CASE("Test BatchController::process in a transaction.")
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 08_BatchController", "Test transaction - ENTER");
+
+   TokenRepository tokenRepository;
+   string batchToken = tokenRepository.create(BATCH_USER_ID);
+
+   // The second request fails, so the new book must be rolled back.
+   std::string jsonRequest = R"({"transaction":true, "requests":[
+      {"method":"POST","path":"/api/v1/books","body":{"title":"Batch Title","author":"Batch Author","year":"2018","read":true,"rating":5}},
+      {"method":"PUT","path":"/api/v1/books/9999","body":{"title":"Batch Title","author":"Batch Author","year":"2018","read":true,"rating":5}},
+      {"method":"GET","path":"/api/v1/books/1"}]})";
+
+   BatchController batchController;
+   JsonResponse jsonResponse = batchController.process(batchToken, jsonRequest);
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Conflict);
+
+   auto data = nlohmann::json::parse(jsonResponse.message());
+   REQUIRE(data["responses"].size() == 2);
+   REQUIRE(data["responses"][0]["status"] == 201);
+   REQUIRE(data["responses"][1]["status"] == 401);
+   REQUIRE(data["failed"] == 1);
+
+   BookRepository repository;
+   REQUIRE(repository.getAll(BATCH_USER_ID).size() == BATCH_NUM_BOOKS);
+
+   // No transaction is started for a token that is not authorized.
+   jsonResponse = batchController.process("invalid token", jsonRequest);
+   REQUIRE(jsonResponse.code() == Pistache::Http::Code::Unauthorized);
+
+   Logger::instance().log(Logger::LogLevel::INFO, "TEST 08_BatchController", "Test transaction - LEAVE");
+}
@@ -0,0 +1,124 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "../src/BatchController.h"
+#include "../src/Book.h"
+#include "../src/BookPatch.h"
+#include "../src/BookRepository.h"
+#include "../src/TokenRepository.h"
+#include "../src/WriteBehindBuffer.h"
+
+#include <chrono>
+#include <string>
+#include "SQLiteCpp/SQLiteCpp.h"
+#include "json.hpp"
+
+using namespace dw;
+using namespace std;
+
+const int BUFFER_USER_ID = 1;
+const int BUFFER_BOOK_ID = 3;
+const int BUFFER_BOOK_RATING = 4;
+
+static int storedRating(int bookId)
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+   SQLite::Database db(dbPath, SQLite::OPEN_READONLY);
+   SQLite::Statement query(db, "SELECT rating FROM books WHERE id = ?");
+   query.bind(1, bookId);
+   query.executeStep();
+   
+   return query.getColumn(0).getInt();
+}
+
+TEST_CASE("Test WriteBehindBuffer. Changes are coalesced and flushed.")
+{
+   WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+   buffer.setWindow(std::chrono::milliseconds(500));
+   REQUIRE(buffer.isEnabled());
+   
+   REQUIRE(buffer.canBuffer(BookPatch(R"({"rating": 1})")));
+   REQUIRE(buffer.canBuffer(BookPatch(R"({"rating": 1, "read": false})")));
+   REQUIRE_FALSE(buffer.canBuffer(BookPatch(R"({"rating": 1, "title": "Title"})")));
+   
+   buffer.queue(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"rating": 1})"));
+   buffer.queue(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"rating": 2})"));
+   REQUIRE(buffer.numPending() == 1);
+   
+   // Reads see the pending value before it is written.
+   BookRepository repository;
+   REQUIRE(repository.getById(BUFFER_USER_ID, BUFFER_BOOK_ID).rating() == 2);
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == BUFFER_BOOK_RATING);
+   
+   REQUIRE(buffer.flush() == 1);
+   REQUIRE(buffer.numPending() == 0);
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == 2);
+   
+   // A patch to the same book writes the pending value with it.
+   buffer.queue(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"rating": 3})"));
+   REQUIRE(repository.patch(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"year": "1978"})")));
+   REQUIRE(buffer.numPending() == 0);
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == 3);
+   
+   // Restore the original data.
+   REQUIRE(repository.patch(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"year": "1985", "rating": 4})")));
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == BUFFER_BOOK_RATING);
+   
+   buffer.setWindow(std::chrono::milliseconds(0));
+   REQUIRE_FALSE(buffer.isEnabled());
+}
+
+TEST_CASE("Test WriteBehindBuffer. A batch transaction is not buffered.")
+{
+   WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+   buffer.setWindow(std::chrono::milliseconds(500));
+   
+   TokenRepository tokenRepository;
+   string token = tokenRepository.create(BUFFER_USER_ID);
+   
+   // The patch is seen by the next request, then rolled back with the batch.
+   BatchController batchController;
+   JsonResponse jsonResponse = batchController.process(token, R"({"transaction":true, "requests":[
+      {"method":"PATCH","path":"/api/v1/books/3","body":{"rating":1}},
+      {"method":"GET","path":"/api/v1/books/3"},
+      {"method":"PUT","path":"/api/v1/books/9999","body":{"title":"Title","author":"Author","year":"2018","read":true,"rating":5}}]})");
+   
+   auto data = nlohmann::json::parse(jsonResponse.message());
+   REQUIRE(data["responses"][0]["status"] == 200);
+   REQUIRE(data["responses"][1]["body"]["book"]["rating"] == 1);
+   REQUIRE(buffer.numPending() == 0);
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == BUFFER_BOOK_RATING);
+   
+   buffer.setWindow(std::chrono::milliseconds(0));
+}
+
+TEST_CASE("Test WriteBehindBuffer. Pending values are kept if the batch that wrote them rolls back.")
+{
+   WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+   buffer.setWindow(std::chrono::milliseconds(500));
+   
+   TokenRepository tokenRepository;
+   string token = tokenRepository.create(BUFFER_USER_ID);
+   
+   // The patch writes the pending rating with it, then the batch is rolled back.
+   buffer.queue(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"rating": 1})"));
+   BatchController batchController;
+   JsonResponse jsonResponse = batchController.process(token, R"({"transaction":true, "requests":[
+      {"method":"PATCH","path":"/api/v1/books/3","body":{"year":"1990"}},
+      {"method":"PUT","path":"/api/v1/books/9999","body":{"title":"Title","author":"Author","year":"2018","read":true,"rating":5}}]})");
+   
+   auto data = nlohmann::json::parse(jsonResponse.message());
+   REQUIRE(data["responses"][0]["status"] == 200);
+   REQUIRE(buffer.numPending() == 1);
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == BUFFER_BOOK_RATING);
+   
+   REQUIRE(buffer.flush() == 1);
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == 1);
+   
+   // Restore the original data.
+   BookRepository repository;
+   REQUIRE(repository.patch(BUFFER_USER_ID, BUFFER_BOOK_ID, BookPatch(R"({"rating": 4})")));
+   REQUIRE(storedRating(BUFFER_BOOK_ID) == BUFFER_BOOK_RATING);
+   
+   buffer.setWindow(std::chrono::milliseconds(0));
+}
@@ -0,0 +1,45 @@
+#include "catch.hpp"
+
+#include "../src/Book.h"
+#include "../src/BookLayout.h"
+#include "../src/BookRepository.h"
+#include "TestDatabase.h"
+
+#include <string>
+#include <vector>
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+TEST_CASE("Test BookLayout. Migrate books to the clustered layout.")
+{
+   // Use a private in-memory database so the shared test database is unchanged.
+   SQLite::Database db(":memory:", SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   testDb_createBooks(db);
+   testDb_addBook(db, 1, 2, "The Expanse", "James S.A. Corey", 2014, true, 5);
+   testDb_addBook(db, 2, 1, "Sorcerer's Daughter", "Terry Brooks", 2009, true, 4);
+   testDb_addBook(db, 3, 2, "Omega", "Jack McDevitt", 2005, false, 4);
+   
+   REQUIRE_FALSE(books_isClustered(db));
+   books_clusterByUser(db);
+   REQUIRE(books_isClustered(db));
+   
+   // Running the migration again does nothing.
+   books_clusterByUser(db);
+   REQUIRE(books_isClustered(db));
+   
+   BookRepository repository(&db);
+   std::vector<Book> books = repository.getAll(2);
+   REQUIRE(books.size() == 2);
+   REQUIRE(books[0].id() == 1);
+   REQUIRE(books[1].id() == 3);
+   
+   Book book(0, 1, "Redshirts", "John Scalzi", "2015", false, 3);
+   long newId = repository.store(book);
+   REQUIRE(newId == 4);
+   
+   Book storedBook = repository.getById(1, newId);
+   REQUIRE(storedBook.title() == "Redshirts");
+   REQUIRE(repository.getAll(1).size() == 2);
+}
@@ -0,0 +1,94 @@
+#include "catch.hpp"
+
+#include "../src/Book.h"
+#include "../src/BookArchive.h"
+#include "../src/BookLayout.h"
+#include "../src/BookRepository.h"
+#include "TestDatabase.h"
+
+#include <string>
+#include <vector>
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+TEST_CASE("Test BookArchive. Archive old read books and restore them on update.")
+{
+   // Use a private in-memory database so the shared test database is unchanged.
+   SQLite::Database db(":memory:", SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   testDb_createBooks(db);
+   testDb_addBook(db, 1, 1, "The Expanse", "James S.A. Corey", 2014, true, 5, "datetime('now','-2 years')");
+   testDb_addBook(db, 2, 1, "Sorcerer's Daughter", "Terry Brooks", 2009, true, 4, "datetime('now')");
+   testDb_addBook(db, 3, 1, "Omega", "Jack McDevitt", 2005, false, 4, "datetime('now','-2 years')");
+   testDb_addBook(db, 4, 1, "Redshirts", "John Scalzi", 2012, true, 3, "datetime('now','-1 years')");
+   
+   BookArchive& archive = BookArchive::instance();
+   archive.configure(":memory:", 6);
+   REQUIRE(archive.isEnabled());
+   
+   // Only read books older than 6 months are moved.
+   REQUIRE(archive.archiveBatch(db) == 2);
+   REQUIRE(archive.archiveBatch(db) == 0);
+   
+   BookRepository repository(&db);
+   REQUIRE(repository.getAll(1).size() == 2);
+   REQUIRE(repository.getAll(1, true).size() == 4);
+   REQUIRE(repository.search(1, BookRepository::SEARCH_TYPE::AUTHOR, "Corey").size() == 0);
+   REQUIRE(repository.search(1, BookRepository::SEARCH_TYPE::AUTHOR, "Corey", true).size() == 1);
+   
+   // Archived books can still be fetched by id.
+   Book archivedBook = repository.getById(1, 1);
+   REQUIRE(archivedBook.title() == "The Expanse");
+   REQUIRE(repository.exists(1, 1));
+   REQUIRE_FALSE(repository.exists(1, 1, false));
+   REQUIRE_FALSE(repository.exists(2, 1));
+   
+   // Updating an archived book moves it back to the main table.
+   Book book(1, 1, "The Expanse", "James S.A. Corey", "2014", true, 4);
+   REQUIRE(repository.update(book));
+   REQUIRE(repository.getAll(1).size() == 3);
+   REQUIRE(repository.getById(1, 1).rating() == 4);
+   
+   // The update made the book recent, so it is not archived again.
+   REQUIRE(archive.archiveBatch(db) == 0);
+   
+   // Removing an archived book removes it from the archive.
+   REQUIRE(repository.remove(1, 4));
+   REQUIRE(repository.getAll(1, true).size() == 3);
+   REQUIRE_FALSE(repository.remove(1, 4));
+   
+   archive.configure("", 0);
+   REQUIRE_FALSE(archive.isEnabled());
+   REQUIRE(repository.getAll(1, true).size() == 3);
+}
+
+TEST_CASE("Test BookArchive. Archived ids are not given to new books.")
+{
+   SQLite::Database db(":memory:", SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   testDb_createBooks(db);
+   testDb_addBook(db, 1, 1, "The Expanse", "James S.A. Corey", 2014, true, 5, "datetime('now')");
+   testDb_addBook(db, 2, 1, "Omega", "Jack McDevitt", 2005, true, 4);
+   books_clusterByUser(db);
+   
+   // Never updated, so its age is the time it was added.
+   db.exec("UPDATE books SET created_at = datetime('now','-2 years') WHERE id = 2");
+   
+   BookArchive& archive = BookArchive::instance();
+   archive.configure(":memory:", 6);
+   REQUIRE(archive.archiveBatch(db) == 1);
+   
+   // The largest id was archived, so the next id is above it.
+   BookRepository repository(&db);
+   long newId = repository.store(Book(0, 1, "Redshirts", "John Scalzi", "2012", false, 3));
+   REQUIRE(newId == 3);
+   REQUIRE(repository.getById(1, 2).title() == "Omega");
+   
+   // The archived book is restored with its own id.
+   REQUIRE(repository.update(Book(2, 1, "Omega", "Jack McDevitt", "2005", true, 5)));
+   REQUIRE(repository.getAll(1).size() == 3);
+   REQUIRE(repository.getById(1, 2).rating() == 5);
+   REQUIRE(repository.getById(1, 3).title() == "Redshirts");
+   
+   archive.configure("", 0);
+}
@@ -0,0 +1,195 @@
+#include "catch.hpp"
+
+#include "../src/Book.h"
+#include "../src/BookPatch.h"
+#include "../src/BookRepository.h"
+#include "../src/MemoryBookStore.h"
+#include "../src/MemoryTokenStore.h"
+#include "../src/MemoryUserStore.h"
+#include "../src/Storage.h"
+#include "../src/TokenRepository.h"
+#include "../src/User.h"
+#include "../src/UserRepository.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dw;
+using namespace std;
+
+// Ids that are not used by the other tests, so the SQLite database is left unchanged.
+const int CONFORMANCE_USER_ID = 50;
+const int CONFORMANCE_OTHER_USER_ID = 51;
+const int CONFORMANCE_TOKEN_USER_ID = 60;
+const int CONFORMANCE_NUM_THREADS = 4;
+const int CONFORMANCE_BOOKS_PER_THREAD = 50;
+
+/*
+ * The same checks are run against every backend.
+ */
+static void checkBookStore(BookStore& store)
+{
+   REQUIRE(store.getAll(CONFORMANCE_USER_ID).size() == 0);
+
+   int firstId = static_cast<int>(store.store(Book(0, CONFORMANCE_USER_ID, "Old Man's War", "John Scalzi", "2005", false, 4)));
+   int secondId = static_cast<int>(store.store(Book(0, CONFORMANCE_USER_ID, "Leviathan Wakes", "James S.A. Corey", "2011", true, 5)));
+   int otherId = static_cast<int>(store.store(Book(0, CONFORMANCE_OTHER_USER_ID, "Lock In", "John Scalzi", "2014", true, 3)));
+   REQUIRE(firstId > 0);
+   REQUIRE(secondId > firstId);
+   REQUIRE(otherId > secondId);
+
+   vector<Book> books = store.getAll(CONFORMANCE_USER_ID);
+   REQUIRE(books.size() == 2);
+
+   Book book = store.getById(CONFORMANCE_USER_ID, firstId);
+   REQUIRE(book.id() == firstId);
+   REQUIRE(book.userId() == CONFORMANCE_USER_ID);
+   REQUIRE(book.title() == "Old Man's War");
+   REQUIRE(book.author() == "John Scalzi");
+   REQUIRE(book.year() == "2005");
+   REQUIRE(book.read() == false);
+   REQUIRE(book.rating() == 4);
+
+   // Books belonging to another user are not visible.
+   REQUIRE_THROWS_AS(store.getById(CONFORMANCE_USER_ID, otherId), std::out_of_range);
+   REQUIRE(store.exists(CONFORMANCE_USER_ID, firstId));
+   REQUIRE_FALSE(store.exists(CONFORMANCE_USER_ID, otherId));
+
+   vector<int> ids = {secondId, otherId, firstId};
+   REQUIRE(store.getByIds(CONFORMANCE_USER_ID, ids).size() == 2);
+   REQUIRE_THROWS_AS(store.getByIds(CONFORMANCE_USER_ID, vector<int>(BookStore::MAX_BATCH_IDS + 1, firstId)), std::out_of_range);
+
+   // Searches ignore case.
+   REQUIRE(store.search(CONFORMANCE_USER_ID, BookStore::SEARCH_TYPE::AUTHOR, "scalzi").size() == 1);
+   REQUIRE(store.search(CONFORMANCE_USER_ID, BookStore::SEARCH_TYPE::TITLE, "scalzi").size() == 0);
+   REQUIRE(store.search(CONFORMANCE_USER_ID, BookStore::SEARCH_TYPE::BOTH, "WAKES").size() == 1);
+   REQUIRE(store.search(CONFORMANCE_USER_ID, BookStore::SEARCH_TYPE::BOTH, "o").size() == 2);
+
+   REQUIRE(store.update(Book(firstId, CONFORMANCE_USER_ID, "Old Man's War", "John Scalzi", "2006", true, 5)));
+   book = store.getById(CONFORMANCE_USER_ID, firstId);
+   REQUIRE(book.year() == "2006");
+   REQUIRE(book.read() == true);
+   REQUIRE(book.rating() == 5);
+   REQUIRE_FALSE(store.update(Book(otherId, CONFORMANCE_USER_ID, "Lock In", "John Scalzi", "2014", true, 1)));
+
+   REQUIRE(store.patch(CONFORMANCE_USER_ID, firstId, BookPatch(R"({"rating": 2})")));
+   book = store.getById(CONFORMANCE_USER_ID, firstId);
+   REQUIRE(book.rating() == 2);
+   REQUIRE(book.year() == "2006");
+   REQUIRE_FALSE(store.patch(CONFORMANCE_USER_ID, otherId, BookPatch(R"({"rating": 2})")));
+
+   REQUIRE_FALSE(store.remove(CONFORMANCE_USER_ID, otherId));
+   REQUIRE(store.remove(CONFORMANCE_USER_ID, firstId));
+   REQUIRE(store.remove(CONFORMANCE_USER_ID, secondId));
+   REQUIRE(store.remove(CONFORMANCE_OTHER_USER_ID, otherId));
+   REQUIRE_FALSE(store.remove(CONFORMANCE_USER_ID, firstId));
+   REQUIRE(store.getAll(CONFORMANCE_USER_ID).size() == 0);
+}
+
+static void checkUserStore(UserStore& store)
+{
+   long numUsers = store.count();
+
+   long newId = store.store(User(0, "Conformance", "conformance@tester.com", "Password"));
+   REQUIRE(newId > 0);
+   REQUIRE(store.count() == numUsers + 1);
+
+   User user = store.getById(newId);
+   REQUIRE(user.id() == newId);
+   REQUIRE(user.name() == "Conformance");
+   REQUIRE(user.email() == "conformance@tester.com");
+
+   REQUIRE(store.getUserId("conformance@tester.com", "Password") == newId);
+   REQUIRE(store.getUserId("conformance@tester.com", "Invalid") == 0);
+
+   REQUIRE(store.updatePassword(newId, "NewPassword"));
+   REQUIRE(store.getUserId("conformance@tester.com", "NewPassword") == newId);
+
+   store.remove(newId);
+   REQUIRE(store.count() == numUsers);
+   REQUIRE(store.getById(newId).id() == 0);
+}
+
+static void checkTokenStore(TokenStore& store)
+{
+   REQUIRE(store.getTokenForUserId(CONFORMANCE_TOKEN_USER_ID) == "");
+
+   string token = store.create(CONFORMANCE_TOKEN_USER_ID);
+   REQUIRE(token.length() > 10);
+   REQUIRE(store.create(CONFORMANCE_TOKEN_USER_ID) == token);
+
+   REQUIRE(store.exists(token));
+   REQUIRE(store.getTokenForUserId(CONFORMANCE_TOKEN_USER_ID) == token);
+   REQUIRE(store.getUserIdForToken(token) == CONFORMANCE_TOKEN_USER_ID);
+
+   REQUIRE(store.remove(token));
+   REQUIRE_FALSE(store.remove(token));
+   REQUIRE_FALSE(store.exists(token));
+   REQUIRE(store.getUserIdForToken(token) == 0);
+}
+
+TEST_CASE("Test storage conformance. SQLite backend.")
+{
+   BookRepository bookStore;
+   checkBookStore(bookStore);
+
+   UserRepository userStore;
+   checkUserStore(userStore);
+
+   TokenRepository tokenStore;
+   checkTokenStore(tokenStore);
+}
+
+TEST_CASE("Test storage conformance. Memory backend.")
+{
+   MemoryBookStore bookStore;
+   checkBookStore(bookStore);
+
+   MemoryUserStore userStore;
+   checkUserStore(userStore);
+
+   MemoryTokenStore tokenStore;
+   checkTokenStore(tokenStore);
+}
+
+TEST_CASE("Test storage. Memory backend is shared by all threads.")
+{
+   vector<thread> threads;
+   for(int i = 0; i < CONFORMANCE_NUM_THREADS; ++i) {
+      threads.emplace_back([]() {
+         MemoryBookStore store;
+         for(int j = 0; j < CONFORMANCE_BOOKS_PER_THREAD; ++j) {
+            store.store(Book(0, CONFORMANCE_USER_ID, "Title", "Author", "2000", false, 1));
+            store.getAll(CONFORMANCE_USER_ID);
+         }
+      });
+   }
+   for(thread& t : threads) {
+      t.join();
+   }
+
+   MemoryBookStore store;
+   vector<Book> books = store.getAll(CONFORMANCE_USER_ID);
+   REQUIRE(books.size() == CONFORMANCE_NUM_THREADS * CONFORMANCE_BOOKS_PER_THREAD);
+
+   for(Book& book : books) {
+      REQUIRE(store.remove(CONFORMANCE_USER_ID, book.id()));
+   }
+}
+
+TEST_CASE("Test storage. The factory creates stores for the selected backend.")
+{
+   REQUIRE(storage_backend() == StorageBackend::SQLITE);
+   REQUIRE(dynamic_cast<BookRepository*>(storage_bookStore().get()) != nullptr);
+
+   storage_setBackend(StorageBackend::MEMORY);
+   REQUIRE(dynamic_cast<MemoryBookStore*>(storage_bookStore().get()) != nullptr);
+   REQUIRE(dynamic_cast<MemoryUserStore*>(storage_userStore().get()) != nullptr);
+   REQUIRE(dynamic_cast<MemoryTokenStore*>(storage_tokenStore().get()) != nullptr);
+
+   storage_setBackend(StorageBackend::SQLITE);
+   REQUIRE(dynamic_cast<TokenRepository*>(storage_tokenStore().get()) != nullptr);
+}
@@ -0,0 +1,107 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "dbConnect.h"
+#include "../src/Book.h"
+#include "../src/BookLayout.h"
+#include "../src/BookRepository.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+static long numBooksInShard(unsigned int shard, int userId)
+{
+   SQLite::Database db(db_shardPath(shard), SQLite::OPEN_READONLY);
+   SQLite::Statement query(db, "SELECT COUNT(1) FROM books WHERE user_id = ?");
+   query.bind(1, userId);
+   query.executeStep();
+   
+   return query.getColumn(0).getInt64();
+}
+
+TEST_CASE("Test sharding. Shard paths are derived from the database path.")
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+   REQUIRE(db_shardPath(0) == dbPath);
+   REQUIRE(db_shardPath(2) == dbPath.substr(0, dbPath.find_last_of('.')) + ".2.sqlite");
+   
+   REQUIRE(db_numShards() == 1);
+   REQUIRE(db_shardForUser(1) == 0);
+   
+   db_setNumShards(2);
+   REQUIRE(db_shardForUser(1) == 1);
+   REQUIRE(db_shardForUser(2) == 0);
+   db_setNumShards(1);
+}
+
+TEST_CASE("Test sharding. Books are moved to and stored in the user's shard.")
+{
+   const int SHARD_ZERO_USER_ID = 2;
+   const int SHARD_ONE_USER_ID = 1;
+   
+   size_t numBooks = BookRepository().getAll(SHARD_ONE_USER_ID).size();
+   REQUIRE(numBooks > 0);
+   
+   REQUIRE(books_reshard(1, 2) == (long)numBooks);
+   db_setNumShards(2);
+   REQUIRE(numBooksInShard(0, SHARD_ONE_USER_ID) == 0);
+   REQUIRE(numBooksInShard(1, SHARD_ONE_USER_ID) == (long)numBooks);
+   
+   {
+      BookRepository repository;
+      REQUIRE(repository.getAll(SHARD_ONE_USER_ID).size() == numBooks);
+      REQUIRE(repository.getById(SHARD_ONE_USER_ID, 1).title() == "Sorcerer's Daughter");
+      
+      // Each shard assigns its own ids, which never overlap.
+      long zeroId = repository.store(Book(0, SHARD_ZERO_USER_ID, "Lock In", "John Scalzi", "2014", true, 3));
+      long oneId = repository.store(Book(0, SHARD_ONE_USER_ID, "Head On", "John Scalzi", "2018", false, 4));
+      REQUIRE(zeroId % 2 == 0);
+      REQUIRE(oneId % 2 == 1);
+      REQUIRE(numBooksInShard(0, SHARD_ZERO_USER_ID) == 1);
+      REQUIRE(numBooksInShard(1, SHARD_ONE_USER_ID) == (long)numBooks + 1);
+      
+      REQUIRE(repository.remove(SHARD_ZERO_USER_ID, zeroId));
+      REQUIRE(repository.remove(SHARD_ONE_USER_ID, oneId));
+   }
+   
+   // Move everything back to one shard.
+   REQUIRE(books_reshard(2, 1) == (long)numBooks);
+   db_setNumShards(1);
+   REQUIRE(numBooksInShard(0, SHARD_ONE_USER_ID) == (long)numBooks);
+   REQUIRE(BookRepository().getAll(SHARD_ONE_USER_ID).size() == numBooks);
+}
+
+TEST_CASE("Test sharding. New shards are given the books table.")
+{
+   const int SHARD_THREE_USER_ID = 3;
+   
+   remove(db_shardPath(3).c_str());
+   books_createShards(4);
+   
+   long maxId = 0;
+   {
+      SQLite::Database shard(db_shardPath(3), SQLite::OPEN_READONLY);
+      REQUIRE(shard.tableExists("books"));
+      REQUIRE(shard.tableExists("book_id_floor"));
+      
+      SQLite::Database shardZero(db_shardPath(0), SQLite::OPEN_READONLY);
+      maxId = shardZero.execAndGet("SELECT MAX(id) FROM books").getInt64();
+   }
+   
+   // The new shard's ids are above the ids already used in shard 0.
+   db_setNumShards(4);
+   {
+      BookRepository repository;
+      long bookId = repository.store(Book(0, SHARD_THREE_USER_ID, "Old Man's War", "John Scalzi", "2005", true, 5));
+      REQUIRE(bookId % 4 == 3);
+      REQUIRE(bookId > maxId);
+      REQUIRE(numBooksInShard(3, SHARD_THREE_USER_ID) == 1);
+      REQUIRE(repository.remove(SHARD_THREE_USER_ID, bookId));
+   }
+   db_setNumShards(1);
+}
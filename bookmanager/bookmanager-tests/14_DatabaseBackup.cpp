@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "dbConnect.h"
+#include "../src/AdminController.h"
+#include "../src/DatabaseBackup.h"
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+static string backupTestDirectory()
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+   
+   return dbPath.substr(0, dbPath.find_last_of('/')) + "/backup-test";
+}
+
+static long numBooks(const string& path)
+{
+   SQLite::Database db(path, SQLite::OPEN_READONLY);
+   
+   return db.execAndGet("SELECT COUNT(1) FROM books").getInt64();
+}
+
+TEST_CASE("Test DatabaseBackup. Write a snapshot of the database.")
+{
+   DatabaseBackup& backup = DatabaseBackup::instance();
+   
+   backup.configure("", 0);
+   REQUIRE_FALSE(backup.isEnabled());
+   REQUIRE_THROWS_AS(backup.backupNow(), std::runtime_error);
+   
+   backup.configure(backupTestDirectory(), 0);
+   REQUIRE(backup.isEnabled());
+   
+   string snapshot = backup.backupNow();
+   REQUIRE_FALSE(backup.isBackingUp());
+   
+   string dbPath = db_shardPath(0);
+   string copyPath = snapshot + dbPath.substr(dbPath.find_last_of('/'));
+   REQUIRE(numBooks(copyPath) == numBooks(dbPath));
+   
+   // Only the finished file is left in the snapshot.
+   REQUIRE(access((copyPath + ".tmp").c_str(), F_OK) != 0);
+   
+   // Snapshots written in the same second each have their own directory.
+   string nextSnapshot = backup.backupNow();
+   REQUIRE(nextSnapshot != snapshot);
+   string nextCopyPath = nextSnapshot + dbPath.substr(dbPath.find_last_of('/'));
+   REQUIRE(numBooks(nextCopyPath) == numBooks(dbPath));
+   
+   remove(copyPath.c_str());
+   rmdir(snapshot.c_str());
+   remove(nextCopyPath.c_str());
+   rmdir(nextSnapshot.c_str());
+   backup.configure("", 0);
+}
+
+TEST_CASE("Test AdminController. Backups are requested with the admin token.")
+{
+   DatabaseBackup& backup = DatabaseBackup::instance();
+   backup.configure(backupTestDirectory(), 0);
+   
+   // Admin requests are refused when no admin token is configured.
+   AdminController noAdmin("");
+   REQUIRE_FALSE(noAdmin.isAuthorized(""));
+   REQUIRE(noAdmin.backup("").code() == Pistache::Http::Code::Unauthorized);
+   
+   AdminController controller("AdminSecret");
+   REQUIRE_FALSE(controller.isAuthorized("AdminSecreT"));
+   REQUIRE_FALSE(controller.isAuthorized("AdminSecret2"));
+   REQUIRE(controller.isAuthorized("AdminSecret"));
+   REQUIRE(controller.backup("Invalid").code() == Pistache::Http::Code::Unauthorized);
+   
+   // The backup thread has not been started.
+   REQUIRE(controller.backup("AdminSecret").code() == Pistache::Http::Code::Service_Unavailable);
+   
+   backup.start();
+   REQUIRE(controller.backup("AdminSecret").code() == Pistache::Http::Code::Accepted);
+   backup.stop();
+   REQUIRE_FALSE(backup.isRunning());
+   
+   backup.configure("", 0);
+}
@@ -0,0 +1,183 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "dbConnect.h"
+#include "../src/Book.h"
+#include "../src/BookRepository.h"
+#include "../src/ChangeJournal.h"
+#include "../src/JournalReplica.h"
+#include "TestDatabase.h"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+// A user id that is not used by the other tests.
+const int JOURNAL_USER_ID = 70;
+
+static string journalTestPath()
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+   
+   return dbPath.substr(0, dbPath.find_last_of('/')) + "/journal-test.log";
+}
+
+static vector<nlohmann::json> readJournal()
+{
+   vector<nlohmann::json> entries;
+   ifstream journal(journalTestPath());
+   string line;
+   
+   while(getline(journal, line)) {
+      entries.push_back(nlohmann::json::parse(line));
+   }
+   
+   return entries;
+}
+
+TEST_CASE("Test ChangeJournal. Book changes are appended to the journal.")
+{
+   remove(journalTestPath().c_str());
+   ChangeJournal& journal = ChangeJournal::instance();
+   journal.configure(journalTestPath());
+   REQUIRE(journal.isEnabled());
+   REQUIRE(journal.lastSequence() == 0);
+   
+   BookRepository repo;
+   long bookId = repo.store(Book(0, JOURNAL_USER_ID, "Agent to the Stars", "John Scalzi", "2005", false, 3));
+   REQUIRE(repo.update(Book(bookId, JOURNAL_USER_ID, "Agent to the Stars", "John Scalzi", "2005", true, 4)));
+   REQUIRE(repo.remove(JOURNAL_USER_ID, bookId));
+   
+   // Nothing is written for a book that is not found.
+   REQUIRE_FALSE(repo.remove(JOURNAL_USER_ID, bookId));
+   REQUIRE(journal.lastSequence() == 3);
+   
+   vector<nlohmann::json> entries = readJournal();
+   REQUIRE(entries.size() == 3);
+   
+   REQUIRE(entries[0]["seq"] == 1);
+   REQUIRE(entries[0]["table"] == "books");
+   REQUIRE(entries[0]["op"] == "upsert");
+   REQUIRE(entries[0]["row"]["id"] == bookId);
+   REQUIRE(entries[0]["row"]["read"] == 0);
+   
+   REQUIRE(entries[1]["seq"] == 2);
+   REQUIRE(entries[1]["row"]["read"] == 1);
+   REQUIRE(entries[1]["row"]["rating"] == 4);
+   REQUIRE(entries[1]["row"]["title"] == "Agent to the Stars");
+   
+   REQUIRE(entries[2]["seq"] == 3);
+   REQUIRE(entries[2]["op"] == "delete");
+   REQUIRE(entries[2]["key"]["id"] == bookId);
+   REQUIRE(entries[2]["key"]["user_id"] == JOURNAL_USER_ID);
+}
+
+TEST_CASE("Test ChangeJournal. Only committed changes are appended.")
+{
+   ChangeJournal& journal = ChangeJournal::instance();
+   long sequence = journal.lastSequence();
+   
+   SQLite::Database* db = db_getConnection();
+   long bookId = 0;
+   
+   {
+      SQLite::Transaction transaction(*db);
+      BookRepository repo(db);
+      repo.store(Book(0, JOURNAL_USER_ID, "The Android's Dream", "John Scalzi", "2006", false, 3));
+   }
+   REQUIRE(journal.lastSequence() == sequence);
+   
+   {
+      SQLite::Transaction transaction(*db);
+      BookRepository repo(db);
+      bookId = repo.store(Book(0, JOURNAL_USER_ID, "The Android's Dream", "John Scalzi", "2006", false, 3));
+      REQUIRE(journal.lastSequence() == sequence);
+      
+      // The entry is only written once COMMIT has returned.
+      transaction.commit();
+      REQUIRE(journal.lastSequence() == sequence);
+      journal.writeCommitted(*db);
+   }
+   REQUIRE(journal.lastSequence() == sequence + 1);
+   
+   db_returnConnection(db);
+   
+   BookRepository repo;
+   REQUIRE(repo.remove(JOURNAL_USER_ID, bookId));
+   REQUIRE(journal.lastSequence() == sequence + 2);
+}
+
+TEST_CASE("Test ChangeJournal. Entries are applied to another database.")
+{
+   SQLite::Database db(":memory:", SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   testDb_createBooks(db);
+   
+   vector<nlohmann::json> entries = readJournal();
+   REQUIRE(entries.size() == 5);
+   
+   // Applying an entry twice gives the same result.
+   ChangeJournal::apply(db, entries[0]);
+   ChangeJournal::apply(db, entries[1]);
+   ChangeJournal::apply(db, entries[1]);
+   REQUIRE(db.execAndGet("SELECT COUNT(1) FROM books").getInt() == 1);
+   REQUIRE(db.execAndGet("SELECT rating FROM books").getInt() == 4);
+   
+   for(auto& entry : entries) {
+      ChangeJournal::apply(db, entry);
+   }
+   REQUIRE(db.execAndGet("SELECT COUNT(1) FROM books").getInt() == 0);
+   
+   nlohmann::json invalid = entries[0];
+   invalid["table"] = "password_resets";
+   REQUIRE_THROWS_AS(ChangeJournal::apply(db, invalid), std::invalid_argument);
+   
+   invalid = entries[0];
+   invalid["row"]["title; DROP TABLE books"] = "";
+   REQUIRE_THROWS_AS(ChangeJournal::apply(db, invalid), std::invalid_argument);
+}
+
+TEST_CASE("Test JournalReplica. Catch up with the journal.")
+{
+   JournalReplica& replica = JournalReplica::instance();
+   replica.configure(journalTestPath());
+   REQUIRE(replica.isEnabled());
+   
+   // The replica and the primary are the same database here, so applying the
+   // journal leaves it unchanged.
+   REQUIRE(replica.catchUp() == 5);
+   REQUIRE(replica.catchUp() == 0);
+   REQUIRE(replica.lastApplied() == ChangeJournal::instance().lastSequence());
+   
+   BookRepository repo;
+   long bookId = repo.store(Book(0, JOURNAL_USER_ID, "Zoe's Tale", "John Scalzi", "2008", false, 3));
+   REQUIRE(replica.catchUp() == 1);
+   REQUIRE(repo.getById(JOURNAL_USER_ID, bookId).title() == "Zoe's Tale");
+   
+   REQUIRE(repo.remove(JOURNAL_USER_ID, bookId));
+   REQUIRE(replica.catchUp() == 1);
+   REQUIRE(replica.lastApplied() == ChangeJournal::instance().lastSequence());
+   
+   // A new journal numbers its entries from 1 again, and all of them are applied.
+   ChangeJournal::instance().configure("");
+   remove(journalTestPath().c_str());
+   ChangeJournal::instance().configure(journalTestPath());
+   bookId = repo.store(Book(0, JOURNAL_USER_ID, "The Human Division", "John Scalzi", "2013", false, 4));
+   REQUIRE(ChangeJournal::instance().lastSequence() == 1);
+   REQUIRE(replica.catchUp() == 1);
+   REQUIRE(replica.lastApplied() == 1);
+   
+   REQUIRE(repo.remove(JOURNAL_USER_ID, bookId));
+   REQUIRE(replica.catchUp() == 1);
+   REQUIRE(replica.lastApplied() == 2);
+   
+   replica.configure("");
+   ChangeJournal::instance().configure("");
+   remove(journalTestPath().c_str());
+}
@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "../src/DatabaseMaintenance.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+static string maintenanceTestPath()
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+   
+   return dbPath.substr(0, dbPath.find_last_of('/')) + "/maintenance-test.sqlite";
+}
+
+static void fillNotes(SQLite::Database& db, int numNotes)
+{
+   SQLite::Transaction transaction(db);
+   SQLite::Statement insert(db, "INSERT INTO notes (text) VALUES (?)");
+   for(int i = 0; i < numNotes; ++i) {
+      insert.bind(1, string(200, 'a' + i % 26));
+      insert.exec();
+      insert.reset();
+   }
+   transaction.commit();
+}
+
+TEST_CASE("Test DatabaseMaintenance. Run each operation.")
+{
+   remove(maintenanceTestPath().c_str());
+   
+   {
+      SQLite::Database db(maintenanceTestPath(), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+      db.exec("CREATE TABLE notes (id integer primary key, text varchar not null)");
+      db.exec("CREATE INDEX notes_text ON notes (text)");
+      
+      DatabaseMaintenance::enableIncrementalVacuum(db);
+      REQUIRE(db.execAndGet("PRAGMA auto_vacuum").getInt() == 2);
+      
+      DatabaseMaintenance& maintenance = DatabaseMaintenance::instance();
+      size_t numRuns = maintenance.history().size();
+      
+      fillNotes(db, 2000);
+      
+      DatabaseMaintenance::Run run = maintenance.runOperation(db, 0, DatabaseMaintenance::Operation::ANALYZE);
+      REQUIRE(run.isComplete);
+      REQUIRE(db.tableExists("sqlite_stat1"));
+      
+      REQUIRE(maintenance.runOperation(db, 0, DatabaseMaintenance::Operation::OPTIMIZE).isComplete);
+      
+      // Deleted rows leave free pages until they are vacuumed.
+      db.exec("DELETE FROM notes");
+      long numFreePages = db.execAndGet("PRAGMA freelist_count").getInt64();
+      REQUIRE(numFreePages > 0);
+      
+      run = maintenance.runOperation(db, 0, DatabaseMaintenance::Operation::INCREMENTAL_VACUUM);
+      REQUIRE(run.isComplete);
+      REQUIRE(run.pagesReclaimed == numFreePages);
+      REQUIRE(db.execAndGet("PRAGMA freelist_count").getInt64() == 0);
+      
+      // Nothing to checkpoint until the database uses WAL.
+      run = maintenance.runOperation(db, 0, DatabaseMaintenance::Operation::CHECKPOINT);
+      REQUIRE(run.isComplete);
+      REQUIRE(run.pagesReclaimed == 0);
+      
+      db.exec("PRAGMA journal_mode = WAL");
+      fillNotes(db, 100);
+      run = maintenance.runOperation(db, 0, DatabaseMaintenance::Operation::CHECKPOINT);
+      REQUIRE(run.isComplete);
+      REQUIRE(run.pagesReclaimed > 0);
+      
+      vector<DatabaseMaintenance::Run> history = maintenance.history();
+      REQUIRE(history.size() == min(numRuns + 5, DatabaseMaintenance::HISTORY_SIZE));
+      REQUIRE(history.back().operation == DatabaseMaintenance::Operation::CHECKPOINT);
+      REQUIRE(DatabaseMaintenance::operationName(history.back().operation) == "checkpoint");
+   }
+   
+   remove(maintenanceTestPath().c_str());
+   remove((maintenanceTestPath() + "-wal").c_str());
+   remove((maintenanceTestPath() + "-shm").c_str());
+}
+
+TEST_CASE("Test DatabaseMaintenance. Interrupted operations wait longer each time.")
+{
+   typedef DatabaseMaintenance::Operation Operation;
+   
+   REQUIRE(DatabaseMaintenance::retryDelay(Operation::ANALYZE, 1) == std::chrono::minutes(1));
+   REQUIRE(DatabaseMaintenance::retryDelay(Operation::ANALYZE, 2) == std::chrono::minutes(2));
+   REQUIRE(DatabaseMaintenance::retryDelay(Operation::ANALYZE, 5) == std::chrono::minutes(16));
+   
+   // Never longer than the operation's interval.
+   REQUIRE(DatabaseMaintenance::retryDelay(Operation::ANALYZE, 100) == std::chrono::minutes(24 * 60));
+   REQUIRE(DatabaseMaintenance::retryDelay(Operation::CHECKPOINT, 5) == std::chrono::minutes(10));
+}
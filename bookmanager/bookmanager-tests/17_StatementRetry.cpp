@@ -0,0 +1,151 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "../src/StatementRetry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SQLiteCpp/SQLiteCpp.h"
+#include <sqlite3.h>
+
+using namespace dw;
+using namespace std;
+
+static string retryTestPath()
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+
+   return dbPath.substr(0, dbPath.find_last_of('/')) + "/retry-test.sqlite";
+}
+
+static StatementRetry::LockWaits findLockWaits(const string& name)
+{
+   for(const StatementRetry::LockWaits& waits : StatementRetry::instance().lockWaits()) {
+      if(waits.statement == name) {
+         return waits;
+      }
+   }
+
+   return StatementRetry::LockWaits{name, 0, 0, 0, 0, {}};
+}
+
+TEST_CASE("Test StatementRetry. Retry while the database is locked.")
+{
+   remove(retryTestPath().c_str());
+
+   StatementRetry& retry = StatementRetry::instance();
+   StatementRetry::Policy defaultPolicy = retry.policy();
+   retry.configure({10, 100, 5, 20});
+   retry.clear();
+
+   {
+      SQLite::Database locker(retryTestPath(), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+      locker.exec("CREATE TABLE notes (id integer primary key, text varchar not null)");
+
+      SQLite::Database db(retryTestPath(), SQLite::OPEN_READWRITE);
+      SQLite::Statement insert(db, "INSERT INTO notes (text) VALUES (?)");
+      insert.bind(1, "note");
+
+      // No contention.
+      REQUIRE(retry.exec(db, insert, "notes.insert") == 1);
+      StatementRetry::LockWaits waits = findLockWaits("notes.insert");
+      REQUIRE(waits.numExecutions == 1);
+      REQUIRE(waits.numRetries == 0);
+      REQUIRE(waits.buckets.size() == StatementRetry::BUCKET_LIMITS_MS.size() + 1);
+      REQUIRE(waits.buckets[0] == 1);
+
+      // Locked for longer than the deadline.
+      locker.exec("BEGIN EXCLUSIVE");
+      insert.reset();
+      REQUIRE_THROWS_AS(retry.exec(db, insert, "notes.insert"), SQLite::Exception);
+      waits = findLockWaits("notes.insert");
+      REQUIRE(waits.numExecutions == 2);
+      REQUIRE(waits.numFailures == 1);
+      REQUIRE(waits.numRetries > 0);
+      REQUIRE(waits.maxWaitMs >= 50);
+
+      // The lock is released before the deadline.
+      thread unlocker([&locker]() {
+         this_thread::sleep_for(chrono::milliseconds(40));
+         locker.exec("COMMIT");
+      });
+      StatementRetry::resetStatement(insert);
+      REQUIRE(retry.exec(db, insert, "notes.insert") == 1);
+      unlocker.join();
+
+      waits = findLockWaits("notes.insert");
+      REQUIRE(waits.numExecutions == 3);
+      REQUIRE(waits.numFailures == 1);
+      REQUIRE(db.execAndGet("SELECT COUNT(1) FROM notes").getInt() == 2);
+
+      unsigned long numWaited = 0;
+      for(size_t i = 1; i < waits.buckets.size(); ++i) {
+         numWaited += waits.buckets[i];
+      }
+      REQUIRE(numWaited == 2);
+   }
+
+   retry.configure(defaultPolicy);
+   remove(retryTestPath().c_str());
+}
+
+TEST_CASE("Test StatementRetry. Statements in a transaction are not retried.")
+{
+   remove(retryTestPath().c_str());
+
+   StatementRetry& retry = StatementRetry::instance();
+   StatementRetry::Policy defaultPolicy = retry.policy();
+   retry.configure({10, 1000, 5, 20});
+   retry.clear();
+
+   {
+      SQLite::Database locker(retryTestPath(), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+      locker.exec("CREATE TABLE notes (id integer primary key, text varchar not null)");
+
+      SQLite::Database db(retryTestPath(), SQLite::OPEN_READWRITE);
+      locker.exec("BEGIN EXCLUSIVE");
+
+      db.exec("BEGIN");
+      SQLite::Statement insert(db, "INSERT INTO notes (text) VALUES ('note')");
+
+      auto start = chrono::steady_clock::now();
+      REQUIRE_THROWS_AS(retry.exec(db, insert, "notes.insert"), SQLite::Exception);
+      REQUIRE(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+      REQUIRE(findLockWaits("notes.insert").numRetries == 0);
+
+      db.exec("ROLLBACK");
+      locker.exec("COMMIT");
+   }
+
+   retry.configure(defaultPolicy);
+   remove(retryTestPath().c_str());
+}
+
+TEST_CASE("Test StatementRetry. Undo a savepoint after an error.")
+{
+   SQLite::Database db(":memory:", SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   db.exec("CREATE TABLE test (id INTEGER)");
+
+   // A savepoint in a transaction is undone and the transaction kept.
+   db.exec("BEGIN");
+   db.exec("SAVEPOINT inner");
+   db.exec("INSERT INTO test VALUES (1)");
+   StatementRetry::rollbackSavepoint(db, "inner", false);
+   REQUIRE(sqlite3_get_autocommit(db.getHandle()) == 0);
+   REQUIRE(db.execAndGet("SELECT COUNT(*) FROM test").getInt() == 0);
+   db.exec("ROLLBACK");
+
+   // An outermost savepoint that cannot be undone rolls back the transaction.
+   db.exec("SAVEPOINT outer");
+   db.exec("INSERT INTO test VALUES (2)");
+   StatementRetry::rollbackSavepoint(db, "missing", true);
+   REQUIRE(sqlite3_get_autocommit(db.getHandle()) != 0);
+   REQUIRE(db.execAndGet("SELECT COUNT(*) FROM test").getInt() == 0);
+
+   // Nothing to undo.
+   StatementRetry::rollbackSavepoint(db, "outer", true);
+   REQUIRE(sqlite3_get_autocommit(db.getHandle()) != 0);
+}
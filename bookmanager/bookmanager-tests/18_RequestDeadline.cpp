@@ -0,0 +1,74 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "../src/RequestDeadline.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace dw;
+using namespace std;
+
+static string deadlineTestPath()
+{
+   string dbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH);
+
+   return dbPath.substr(0, dbPath.find_last_of('/')) + "/deadline-test.sqlite";
+}
+
+// Counts to a billion, which takes far longer than any deadline in these tests.
+const string SLOW_QUERY = "WITH RECURSIVE counter(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM counter WHERE n < 1000000000) "
+                          "SELECT COUNT(1) FROM counter";
+
+TEST_CASE("Test RequestDeadline. Interrupt a query that runs past the deadline.")
+{
+   remove(deadlineTestPath().c_str());
+
+   {
+      SQLite::Database db(deadlineTestPath(), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+      RequestDeadline::watch(db);
+
+      // No deadline, so nothing is interrupted.
+      REQUIRE_FALSE(RequestDeadline::isExpired());
+      REQUIRE(db.execAndGet("WITH RECURSIVE counter(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM counter WHERE n < 100000) "
+                            "SELECT COUNT(1) FROM counter").getInt() == 100000);
+
+      {
+         RequestDeadline deadline(chrono::milliseconds(50));
+
+         auto start = chrono::steady_clock::now();
+         REQUIRE_THROWS_AS(db.execAndGet(SLOW_QUERY), SQLite::Exception);
+         REQUIRE(chrono::steady_clock::now() - start < chrono::milliseconds(1000));
+         REQUIRE(RequestDeadline::isExpired());
+
+         JsonResponse response = deadline.check(JsonResponse("{\"message\":\"ERROR\"}", Pistache::Http::Code::Internal_Server_Error));
+         REQUIRE(response.code() == Pistache::Http::Code::Service_Unavailable);
+         REQUIRE(deadline.errorCode() == Pistache::Http::Code::Service_Unavailable);
+
+         // A request that succeeded keeps its response.
+         response = deadline.check(JsonResponse("{\"message\":\"OK\"}", Pistache::Http::Code::Ok));
+         REQUIRE(response.code() == Pistache::Http::Code::Ok);
+      }
+
+      // The deadline ends with the request.
+      REQUIRE_FALSE(RequestDeadline::isExpired());
+      REQUIRE(db.execAndGet("SELECT 1").getInt() == 1);
+
+      RequestDeadline unlimited(chrono::milliseconds(0));
+      REQUIRE_FALSE(RequestDeadline::isExpired());
+      REQUIRE(unlimited.errorCode() == Pistache::Http::Code::Internal_Server_Error);
+   }
+
+   remove(deadlineTestPath().c_str());
+}
+
+TEST_CASE("Test RequestDeadline. Route budgets.")
+{
+   REQUIRE(RequestDeadline::routeBudget("unknown route") == RequestDeadline::routeBudget(""));
+   REQUIRE(RequestDeadline::routeBudget("search").count() >= 0);
+
+   RequestDeadline deadline("search");
+   REQUIRE(deadline.errorCode() == Pistache::Http::Code::Internal_Server_Error);
+}
@@ -0,0 +1,92 @@
+#include "catch.hpp"
+
+#include "../src/BookRepository.h"
+#include "../src/SearchTerm.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace dw;
+using namespace std;
+
+TEST_CASE("Test SearchTerm. Decode URL parameters.")
+{
+   REQUIRE(SearchTerm::percentDecode("Terry%20Brooks") == "Terry Brooks");
+   REQUIRE(SearchTerm::percentDecode("%22Omega%22") == "\"Omega\"");
+   REQUIRE(SearchTerm::percentDecode("100%25") == "100%");
+   REQUIRE(SearchTerm::percentDecode("%2a%2A") == "**");
+
+   // Invalid escapes are kept.
+   REQUIRE(SearchTerm::percentDecode("50%") == "50%");
+   REQUIRE(SearchTerm::percentDecode("%2") == "%2");
+   REQUIRE(SearchTerm::percentDecode("%zz1") == "%zz1");
+   REQUIRE(SearchTerm::percentDecode("") == "");
+}
+
+TEST_CASE("Test SearchTerm. Choose the plan.")
+{
+   SearchTerm contains("  Jack   McDevitt ");
+   REQUIRE(contains.plan() == SearchTerm::Plan::CONTAINS);
+   REQUIRE(contains.tokens() == vector<string>({"McDevitt", "Jack"}));
+   REQUIRE(contains.parameters() == vector<string>({"%McDevitt%", "%Jack%"}));
+   REQUIRE(contains.condition({"title", "author"}) ==
+           "((title LIKE :term0 ESCAPE '\\' OR author LIKE :term0 ESCAPE '\\') AND (title LIKE :term1 ESCAPE '\\' OR author LIKE :term1 ESCAPE '\\'))");
+
+   // Words inside other words are left out.
+   REQUIRE(SearchTerm("jack JACK ja").tokens() == vector<string>({"jack"}));
+
+   SearchTerm exact("\"The Sword of Shannara\"");
+   REQUIRE(exact.plan() == SearchTerm::Plan::EXACT);
+   REQUIRE(exact.parameters() == vector<string>({"The Sword of Shannara"}));
+   REQUIRE(exact.condition({"title"}) == "((title = :term0 COLLATE NOCASE))");
+
+   SearchTerm prefix("The Sw**");
+   REQUIRE(prefix.plan() == SearchTerm::Plan::PREFIX);
+   REQUIRE(prefix.parameters() == vector<string>({"The Sw%"}));
+
+   SearchTerm empty("  ");
+   REQUIRE(empty.tokens().empty());
+   REQUIRE(empty.condition({"title"}) == "(1)");
+   REQUIRE(empty.matches({"anything"}));
+}
+
+TEST_CASE("Test SearchTerm. Wildcards are matched literally.")
+{
+   REQUIRE(SearchTerm::escapeLike("100%_a\\b") == "100\\%\\_a\\\\b");
+
+   SearchTerm percent("%");
+   REQUIRE(percent.parameters() == vector<string>({"%\\%%"}));
+   REQUIRE_FALSE(percent.matches({"Omega"}));
+   REQUIRE(percent.matches({"100% Done"}));
+
+   REQUIRE(SearchTerm("\"omega\"").matches({"Starhawk", "OMEGA"}));
+   REQUIRE_FALSE(SearchTerm("\"omeg\"").matches({"Omega"}));
+   REQUIRE(SearchTerm("ome*").matches({"Omega"}));
+   REQUIRE_FALSE(SearchTerm("meg*").matches({"Omega"}));
+   REQUIRE(SearchTerm("jack omega").matches({"Omega", "Jack McDevitt"}));
+   REQUIRE_FALSE(SearchTerm("jack starhawk").matches({"Omega", "Jack McDevitt"}));
+
+   BookRepository repository;
+   REQUIRE(repository.search(1, BookStore::SEARCH_TYPE::BOTH, "%").size() == 0);
+   REQUIRE(repository.search(1, BookStore::SEARCH_TYPE::BOTH, "_").size() == 0);
+   REQUIRE(repository.search(1, BookStore::SEARCH_TYPE::TITLE, "\"omega\"").size() ==
+           repository.search(1, BookStore::SEARCH_TYPE::TITLE, "omega").size());
+   REQUIRE(repository.search(1, BookStore::SEARCH_TYPE::AUTHOR, "jack mcdev*").size() ==
+           repository.search(1, BookStore::SEARCH_TYPE::AUTHOR, "McDevitt").size());
+}
+
+TEST_CASE("Test SearchTerm. Limit the term.")
+{
+   REQUIRE_NOTHROW(SearchTerm(string(SearchTerm::MAX_LENGTH, 'a')));
+   REQUIRE_THROWS_AS(SearchTerm(string(SearchTerm::MAX_LENGTH + 1, 'a')), std::invalid_argument);
+
+   REQUIRE_NOTHROW(SearchTerm("a b c d e"));
+   REQUIRE_THROWS_AS(SearchTerm("a b c d e f"), std::invalid_argument);
+
+   // A quoted phrase is a single word.
+   REQUIRE_NOTHROW(SearchTerm("\"a b c d e f\""));
+
+   BookRepository repository;
+   REQUIRE_THROWS_AS(repository.search(1, BookStore::SEARCH_TYPE::BOTH, "a b c d e f"), std::invalid_argument);
+}
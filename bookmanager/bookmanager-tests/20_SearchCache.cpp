@@ -0,0 +1,128 @@
+#include "catch.hpp"
+
+#include "../src/SearchCache.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dw;
+using namespace std;
+
+const vector<Book> CACHED_BOOKS = {
+   Book(1, 1, "Terry's Journey", "Jack McDevitt", "2001", true, 4),
+   Book(2, 1, "Shannara", "Terry Brooks", "1977", true, 5),
+   Book(3, 1, "Starhawk", "Terrance Dicks", "2013", false, 3)
+};
+
+TEST_CASE("Test SearchCache. Narrow the last search.")
+{
+   SearchCache& cache = SearchCache::instance();
+   cache.configure(chrono::milliseconds(60000), 10);
+   unsigned long numHits = cache.numHits();
+
+   vector<Book> books;
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terr"), books));
+
+   cache.store("token", 1, cache.generation(1), BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+
+   REQUIRE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+   REQUIRE(books.size() == 2);
+   REQUIRE(books[0].id() == 1);
+   REQUIRE(books[1].id() == 2);
+
+   // The narrowed search is now the last search.
+   REQUIRE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry brooks"), books));
+   REQUIRE(books.size() == 1);
+   REQUIRE(books[0].id() == 2);
+   REQUIRE(cache.numHits() == numHits + 2);
+
+   // A shorter term may match books the last search did not.
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   // Only the same session, user and kind of search.
+   cache.store("token", 1, cache.generation(1), BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   REQUIRE_FALSE(cache.narrow("other token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+   REQUIRE_FALSE(cache.narrow("token", 2, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::TITLE, false, SearchTerm("terry"), books));
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, true, SearchTerm("terry"), books));
+
+   cache.invalidate(1);
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   cache.configure(chrono::milliseconds(0), 10);
+   REQUIRE_FALSE(cache.isEnabled());
+}
+
+TEST_CASE("Test SearchCache. Entries expire and the oldest session is removed.")
+{
+   SearchCache& cache = SearchCache::instance();
+   vector<Book> books;
+
+   cache.configure(chrono::milliseconds(20), 10);
+   cache.store("token", 1, cache.generation(1), BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   this_thread::sleep_for(chrono::milliseconds(40));
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   cache.configure(chrono::milliseconds(60000), 2);
+   cache.store("first", 1, cache.generation(1), BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   this_thread::sleep_for(chrono::milliseconds(2));
+   cache.store("second", 1, cache.generation(1), BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   this_thread::sleep_for(chrono::milliseconds(2));
+   cache.store("third", 1, cache.generation(1), BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   REQUIRE_FALSE(cache.narrow("first", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+   REQUIRE(cache.narrow("second", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+   REQUIRE(cache.narrow("third", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   cache.configure(chrono::milliseconds(0), 10);
+}
+
+TEST_CASE("Test SearchCache. A search is not kept if the books changed while it ran.")
+{
+   SearchCache& cache = SearchCache::instance();
+   cache.configure(chrono::milliseconds(60000), 10);
+   vector<Book> books;
+
+   unsigned long generation = cache.generation(1);
+   unsigned long otherGeneration = cache.generation(2);
+   cache.invalidate(1);
+   REQUIRE(cache.generation(1) != generation);
+   REQUIRE(cache.generation(2) == otherGeneration);
+
+   cache.store("token", 1, generation, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   // Another user's change does not matter.
+   generation = cache.generation(1);
+   cache.invalidate(2);
+   cache.store("token", 1, generation, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   REQUIRE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   // Clearing the cache changes every user's generation.
+   generation = cache.generation(1);
+   cache.clear();
+   cache.store("token", 1, generation, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("ter"), CACHED_BOOKS);
+   REQUIRE_FALSE(cache.narrow("token", 1, BookStore::SEARCH_TYPE::BOTH, false, SearchTerm("terry"), books));
+
+   cache.configure(chrono::milliseconds(0), 10);
+}
+
+TEST_CASE("Test SearchCache. Which terms narrow a search.")
+{
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter"), SearchTerm("Terry")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter"), SearchTerm("brooks terry")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter bro"), SearchTerm("terry brooks")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter"), SearchTerm("\"terry brooks\"")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter"), SearchTerm("terry*")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter*"), SearchTerm("terry*")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("ter*"), SearchTerm("\"terry\"")));
+   REQUIRE(SearchCache::isNarrowing(SearchTerm("\"Terry\""), SearchTerm("\"terry\"")));
+
+   REQUIRE_FALSE(SearchCache::isNarrowing(SearchTerm("terry"), SearchTerm("ter")));
+   REQUIRE_FALSE(SearchCache::isNarrowing(SearchTerm("ter bro"), SearchTerm("terry")));
+   REQUIRE_FALSE(SearchCache::isNarrowing(SearchTerm("ter*"), SearchTerm("terry")));
+   REQUIRE_FALSE(SearchCache::isNarrowing(SearchTerm("ter*"), SearchTerm("the ter*")));
+   REQUIRE_FALSE(SearchCache::isNarrowing(SearchTerm("\"terry\""), SearchTerm("\"terry brooks\"")));
+   REQUIRE_FALSE(SearchCache::isNarrowing(SearchTerm("\"terry\""), SearchTerm("terry")));
+}
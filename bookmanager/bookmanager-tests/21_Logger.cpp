@@ -0,0 +1,264 @@
+#include "catch.hpp"
+
+#include "BinaryLog.h"
+#include "LogFile.h"
+#include "LogSampler.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+using namespace dw;
+using namespace std;
+
+static int countLines(const string& text)
+{
+   ifstream log("logfile.log");
+   string line;
+   int count = 0;
+
+   while(getline(log, line)) {
+      if(line.find(text) != string::npos) {
+         count++;
+      }
+   }
+
+   return count;
+}
+
+static string readFile(const string& path)
+{
+   ifstream file(path, ios::binary);
+   return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+static string readCompressed(const string& path)
+{
+   gzFile file = gzopen(path.c_str(), "rb");
+   string text;
+   char buffer[256];
+   int numRead = 0;
+
+   while(file != nullptr && (numRead = gzread(file, buffer, sizeof(buffer))) > 0) {
+      text.append(buffer, numRead);
+   }
+   if(file != nullptr) gzclose(file);
+
+   return text;
+}
+
+static void removeLogFiles(const string& path)
+{
+   LogFile::Rotation rotation = {0, chrono::seconds(0), 0, false};
+   for(const string& retired : LogFile(path, rotation).retiredFiles()) {
+      remove(retired.c_str());
+   }
+   remove(path.c_str());
+}
+
+// Counts how often it is formatted.
+struct FormatCounter
+{
+   int* count;
+};
+
+static ostream& operator<<(ostream& out, const FormatCounter& counter)
+{
+   (*counter.count)++;
+   return out << "counted";
+}
+
+TEST_CASE("Test Logger. Parameters are only formatted if the message is written.")
+{
+   Logger& logger = Logger::instance();
+   int count = 0;
+   string run = to_string(chrono::steady_clock::now().time_since_epoch().count());
+
+   logger.setLogLevel(Logger::LogLevel::ERROR);
+   REQUIRE(logger.isEnabled(Logger::LogLevel::ERROR));
+   REQUIRE_FALSE(logger.isEnabled(Logger::LogLevel::INFO));
+   REQUIRE_FALSE(logger.isEnabled(Logger::LogLevel::DEBUG));
+   REQUIRE_FALSE(logger.isEnabled(Logger::LogLevel::NONE));
+
+   logger.log(Logger::LogLevel::DEBUG, "21_Logger", "Run & not formatted &.", run, FormatCounter{&count});
+   REQUIRE(count == 0);
+
+   // Parameters of different types.
+   logger.log(Logger::LogLevel::ERROR, "21_Logger", "Run & formatted & & &.", run, FormatCounter{&count}, 42, 2.5);
+   REQUIRE(count == 1);
+
+   logger.setLogLevel(Logger::LogLevel::DEBUG);
+   logger.flush();
+   REQUIRE(countLines("[21_Logger] Run " + run + " not formatted") == 0);
+   REQUIRE(countLines("[21_Logger] Run " + run + " formatted counted 42 2.5.") == 1);
+}
+
+TEST_CASE("Test Logger. Messages from many threads are all written by flush.")
+{
+   Logger& logger = Logger::instance();
+   logger.setOverflowPolicy(Logger::OverflowPolicy::BLOCK);
+
+   // The log file is appended to, so the messages are marked with the time of this run.
+   string run = to_string(chrono::steady_clock::now().time_since_epoch().count());
+
+   const int NUM_THREADS = 4;
+   const int NUM_MESSAGES = 2000;
+   vector<thread> threads;
+   for(int t = 0; t < NUM_THREADS; t++) {
+      threads.push_back(thread([t, &logger, &run]() {
+         for(int i = 0; i < NUM_MESSAGES; i++) {
+            logger.log(Logger::LogLevel::ERROR, "21_Logger", "Run & queued message & of thread &.", run, to_string(i), to_string(t));
+         }
+      }));
+   }
+   for(thread& loggingThread : threads) {
+      loggingThread.join();
+   }
+
+   logger.flush();
+   REQUIRE(countLines("[21_Logger] Run " + run + " queued message") == NUM_THREADS * NUM_MESSAGES);
+
+   logger.setOverflowPolicy(Logger::OverflowPolicy::COUNT);
+}
+
+TEST_CASE("Test Logger. Decode a binary log.")
+{
+   string log(BinaryLog::MAGIC, BinaryLog::MAGIC_SIZE);
+   BinaryLog::appendFormat(log, 0, "Book & of user & rated & read & in & by &.");
+   BinaryLog::appendFormat(log, 1, "Started.");
+
+   // Recorded out of order, as records from two threads can be.
+   int64_t second = 1000000000;
+   BinaryLog::appendLogStart(log, 0, 2 * second, "BookRepository", 6);
+   BinaryLog::appendParam(log, 12);
+   BinaryLog::appendParam(log, 3UL);
+   BinaryLog::appendParam(log, 4.5);
+   BinaryLog::appendParam(log, true);
+   BinaryLog::appendParam(log, string("Omega"));
+   BinaryLog::appendParam(log, "Jack");
+   BinaryLog::appendLogStart(log, 1, second, "WebServer", 0);
+
+   istringstream in(log);
+   ostringstream out;
+   REQUIRE(BinaryLog::decode(in, out));
+
+   string text = out.str();
+   REQUIRE(text.find("[WebServer] Started.\n") != string::npos);
+   REQUIRE(text.find("[BookRepository] Book 12 of user 3 rated 4.5 read 1 in Omega by Jack.\n") != string::npos);
+   REQUIRE(text.find("[WebServer]") < text.find("[BookRepository]"));
+
+   // Ids are only valid until the logger starts again.
+   string restarted = log + string(BinaryLog::MAGIC, BinaryLog::MAGIC_SIZE);
+   BinaryLog::appendLogStart(restarted, 1, second, "WebServer", 0);
+   istringstream restartedIn(restarted);
+   REQUIRE_FALSE(BinaryLog::decode(restartedIn, out));
+
+   // A record cut short.
+   istringstream truncated(log.substr(0, log.size() - 3));
+   REQUIRE_FALSE(BinaryLog::decode(truncated, out));
+
+   istringstream textLog("2026-10-19 10:00:00 [Logger] Logger initialized.");
+   REQUIRE_FALSE(BinaryLog::decode(textLog, out));
+}
+
+TEST_CASE("Test LogFile. Files are rotated by size, compressed and the oldest removed.")
+{
+   const string PATH = "21_LogFile.log";
+   removeLogFiles(PATH);
+
+   string line(59, 'x');
+   line += "\n";
+   {
+      LogFile::Rotation rotation = {100, chrono::seconds(0), 2, true};
+      LogFile file(PATH, rotation);
+      REQUIRE(file.isOpen());
+
+      // Two lines do not fit, so each line after the first starts a new file.
+      for(int i = 0; i < 5; i++) {
+         file.write(to_string(i) + line.substr(1));
+      }
+      file.waitForRetired();
+
+      vector<string> retired = file.retiredFiles();
+      REQUIRE(retired.size() == 2);
+      REQUIRE(retired[0].find(".gz") == retired[0].size() - 3);
+      REQUIRE(retired[1].find(".gz") == retired[1].size() - 3);
+      REQUIRE(readCompressed(retired[0]) == "2" + line.substr(1));
+      REQUIRE(readCompressed(retired[1]) == "3" + line.substr(1));
+      REQUIRE(readFile(PATH) == "4" + line.substr(1));
+   }
+
+   removeLogFiles(PATH);
+}
+
+TEST_CASE("Test LogFile. Every new file starts with the header.")
+{
+   const string PATH = "21_LogFile.bin";
+   removeLogFiles(PATH);
+   {
+      LogFile::Rotation rotation = {1, chrono::seconds(0), 0, false};
+      LogFile file(PATH, rotation, []() { return string("header\n"); });
+
+      // A file holding only its header is not rotated.
+      file.write("first\n");
+      file.write("second\n");
+      file.waitForRetired();
+
+      vector<string> retired = file.retiredFiles();
+      REQUIRE(retired.size() == 1);
+      REQUIRE(readFile(retired[0]) == "header\nfirst\n");
+      REQUIRE(readFile(PATH) == "header\nsecond\n");
+   }
+
+   removeLogFiles(PATH);
+}
+
+TEST_CASE("Test LogSampler. Messages over a module's limits are suppressed and counted.")
+{
+   LogSampler sampler;
+   vector<string> invalid = sampler.configure("Sampled=0,Full=100", "Limited=3,Bad,=5");
+   REQUIRE(invalid.size() == 2);
+
+   unsigned long numLimited = 0;
+   for(int i = 0; i < 10; i++) {
+      REQUIRE_FALSE(sampler.isSampled("Sampled"));
+      REQUIRE(sampler.isSampled("Full"));
+      REQUIRE(sampler.isSampled("Unknown"));
+      numLimited += sampler.isSampled("Limited") ? 1 : 0;
+   }
+
+   // The second may change part way through.
+   REQUIRE(numLimited >= 3);
+   REQUIRE(numLimited <= 6);
+
+   vector<pair<string, unsigned long>> suppressed = sampler.takeSuppressed();
+   unsigned long numSampled = 0;
+   unsigned long numRateLimited = 0;
+   for(const pair<string, unsigned long>& module : suppressed) {
+      if(module.first == "Sampled") numSampled = module.second;
+      if(module.first == "Limited") numRateLimited = module.second;
+   }
+   REQUIRE(suppressed.size() == 2);
+   REQUIRE(numSampled == 10);
+   REQUIRE(numRateLimited == 10 - numLimited);
+   REQUIRE(sampler.takeSuppressed().empty());
+}
+
+TEST_CASE("Test Logger. Request bodies are cut to the maximum size.")
+{
+   string body = "{\"title\": \"Omega\"}";
+
+   ostringstream whole;
+   whole << Logger::Body{body, body.size()};
+   REQUIRE(whole.str() == body);
+
+   ostringstream cut;
+   cut << Logger::Body{body, 5};
+   REQUIRE(cut.str() == "{\"tit... (" + to_string(body.size()) + " bytes)");
+}
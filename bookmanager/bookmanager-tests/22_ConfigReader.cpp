@@ -0,0 +1,155 @@
+#include "catch.hpp"
+
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "ResourceLimits.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace dw;
+using namespace std;
+
+static string readConfigFile()
+{
+   ifstream file("config.cfg");
+   stringstream text;
+   text << file.rdbuf();
+
+   return text.str();
+}
+
+// Written to another file and renamed over config.cfg, as editors do.
+static void writeConfigFile(const string& text)
+{
+   {
+      ofstream file("config.cfg.new");
+      file << text;
+   }
+   rename("config.cfg.new", "config.cfg");
+}
+
+// Puts config.cfg back when a test ends, even if it failed, so the real
+// configuration is never left changed.
+class ConfigFileGuard
+{
+public:
+   ConfigFileGuard() : mOriginal(readConfigFile()) {}
+
+   ~ConfigFileGuard()
+   {
+      ConfigReader::getInstance().stopWatching();
+      writeConfigFile(mOriginal);
+      ConfigReader::getInstance().reload();
+   }
+
+   const std::string& original() const { return mOriginal; }
+
+private:
+   std::string mOriginal;
+};
+
+TEST_CASE("Test ConfigReader. Reloading publishes the changed values.")
+{
+   ConfigReader& config = ConfigReader::getInstance();
+   ConfigFileGuard guard;
+   const string& original = guard.original();
+   unsigned long version = config.version();
+
+   // Nothing changed.
+   REQUIRE_FALSE(config.reload());
+   REQUIRE(config.version() == version);
+
+   writeConfigFile(original + "\nLOG_BODY_BYTES=7\n");
+   REQUIRE(config.reload());
+   REQUIRE(config.version() == version + 1);
+   REQUIRE(config.getConfig(ConfigReader::Config::LOG_BODY_BYTES) == "7");
+
+   // The logger's listener applied the new size.
+   REQUIRE(Logger::instance().body("0123456789").maxSize == 7);
+
+   writeConfigFile(original);
+   REQUIRE(config.reload());
+   REQUIRE(config.version() == version + 2);
+}
+
+TEST_CASE("Test ConfigReader. The watcher reloads the file when it is replaced.")
+{
+   ConfigReader& config = ConfigReader::getInstance();
+   ConfigFileGuard guard;
+   const string& original = guard.original();
+   unsigned long version = config.version();
+
+   config.startWatching();
+   writeConfigFile(original + "\nLOG_BODY_BYTES=9\n");
+
+   for(int i = 0; i < 100 && config.version() == version; i++) {
+      this_thread::sleep_for(chrono::milliseconds(20));
+   }
+   REQUIRE(config.version() == version + 1);
+   REQUIRE(config.getConfig(ConfigReader::Config::LOG_BODY_BYTES) == "9");
+
+   config.stopWatching();
+   writeConfigFile(original);
+   REQUIRE(config.reload());
+}
+
+TEST_CASE("Test ConfigReader. Command line flags replace the file's values.")
+{
+   ConfigReader& config = ConfigReader::getInstance();
+   ConfigFileGuard guard;
+   long original = config.getInt(ConfigReader::Config::LOG_BODY_BYTES);
+
+   REQUIRE_FALSE(config.setOverride("--no-such-setting=1"));
+   REQUIRE_FALSE(config.setOverride("--log-body-bytes"));
+   REQUIRE_FALSE(config.setOverride("8080"));
+
+   REQUIRE(config.setOverride("--log-body-bytes=11"));
+   REQUIRE(config.getConfig(ConfigReader::Config::LOG_BODY_BYTES) == "11");
+
+   // Still set after a reload.
+   writeConfigFile(readConfigFile() + "\n");
+   config.reload();
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_BODY_BYTES) == 11);
+
+   // Limits and defaults.
+   REQUIRE(config.setOverride("--log-body-bytes=100000"));
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_BODY_BYTES) == 65536);
+   REQUIRE(config.setOverride("--log-body-bytes=-5"));
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_BODY_BYTES) == 0);
+   REQUIRE(config.setOverride("--LOG_BODY_BYTES=many"));
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_BODY_BYTES) == 256);
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_BODY_BYTES, 42) == 42);
+   REQUIRE(config.setOverride("--log-queue-size=-1"));
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_QUEUE_SIZE) == 64);
+   REQUIRE(config.setOverride("--log-queue-size="));
+
+   // Only whole number configurations have limits.
+   REQUIRE_THROWS_AS(config.getInt(ConfigReader::Config::LOG_FORMAT), std::invalid_argument);
+
+   // The file's value is back.
+   REQUIRE(config.setOverride("--log-body-bytes="));
+   REQUIRE(config.getInt(ConfigReader::Config::LOG_BODY_BYTES) == original);
+}
+
+TEST_CASE("Test ResourceLimits. Read cgroup CPU quotas and memory limits.")
+{
+   REQUIRE(ResourceLimits::cpusInQuota("max 100000") == 0);
+   REQUIRE(ResourceLimits::cpusInQuota("200000 100000") == 2);
+   REQUIRE(ResourceLimits::cpusInQuota("150000 100000") == 2);
+   REQUIRE(ResourceLimits::cpusInQuota("50000 100000") == 1);
+   REQUIRE(ResourceLimits::cpusInQuota("-1 100000") == 0);
+   REQUIRE(ResourceLimits::cpusInQuota(" ") == 0);
+
+   REQUIRE(ResourceLimits::bytesInLimit("max") == 0);
+   REQUIRE(ResourceLimits::bytesInLimit("") == 0);
+   REQUIRE(ResourceLimits::bytesInLimit("536870912") == 536870912);
+
+   REQUIRE(ResourceLimits::numCpus() >= 1);
+   REQUIRE(ResourceLimits::memoryBytes() > 0);
+}
@@ -0,0 +1,223 @@
+#include "catch.hpp"
+
+#include "../src/StaticAssets.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace dw;
+using namespace std;
+
+const string ASSETS_PATH = "static-assets-test";
+
+static void writeFile(const string& path, const string& text)
+{
+   ofstream file(ASSETS_PATH + "/" + path);
+   file << text;
+}
+
+static void makeAssets()
+{
+   mkdir(ASSETS_PATH.c_str(), 0755);
+   mkdir((ASSETS_PATH + "/css").c_str(), 0755);
+   mkdir((ASSETS_PATH + "/js").c_str(), 0755);
+   mkdir((ASSETS_PATH + "/js/lib").c_str(), 0755);
+
+   writeFile("css/site.css", "body {}");
+   writeFile("js/app.js", "var app;");
+   writeFile("js/lib/vue.min.js", "var Vue;");
+   writeFile("js/large.js", string(2000, 'x'));
+}
+
+static void removeAssets()
+{
+   remove((ASSETS_PATH + "/css/site.css").c_str());
+   remove((ASSETS_PATH + "/js/app.js").c_str());
+   remove((ASSETS_PATH + "/js/new.js").c_str());
+   remove((ASSETS_PATH + "/js/lib/vue.min.js").c_str());
+   remove((ASSETS_PATH + "/js/large.js").c_str());
+   rmdir((ASSETS_PATH + "/js/lib").c_str());
+   rmdir((ASSETS_PATH + "/css").c_str());
+   rmdir((ASSETS_PATH + "/js").c_str());
+   rmdir(ASSETS_PATH.c_str());
+}
+
+TEST_CASE("Test StaticAssets. Load the files into memory.")
+{
+   makeAssets();
+
+   StaticAssets assets(ASSETS_PATH, {"css", "js", "fonts"}, 1000);
+   REQUIRE(assets.find("css/site.css") == nullptr);
+
+   assets.load();
+   REQUIRE(assets.numAssets() == 3);
+   REQUIRE(assets.numBytes() == 23);
+
+   auto css = assets.find("css/site.css");
+   REQUIRE(css != nullptr);
+   REQUIRE(css->body == "body {}");
+   REQUIRE(css->contentType == "text/css");
+
+   REQUIRE(assets.find("js/lib/vue.min.js")->body == "var Vue;");
+
+   // Too large, so served from the disk.
+   REQUIRE(assets.find("js/large.js") == nullptr);
+   REQUIRE(assets.find("js/../css/site.css") == nullptr);
+
+   // A file held by a request is not changed by a refresh.
+   writeFile("css/site.css", "body { margin: 0; }");
+   REQUIRE(assets.refresh("css/site.css"));
+   REQUIRE(css->body == "body {}");
+   REQUIRE(assets.find("css/site.css")->body == "body { margin: 0; }");
+
+   remove((ASSETS_PATH + "/css/site.css").c_str());
+   REQUIRE_FALSE(assets.refresh("css/site.css"));
+   REQUIRE(assets.find("css/site.css") == nullptr);
+
+   removeAssets();
+}
+
+TEST_CASE("Test StaticAssets. The watcher refreshes changed files.")
+{
+   makeAssets();
+
+   StaticAssets assets(ASSETS_PATH, {"css", "js"}, 1000);
+   assets.load();
+   assets.startWatching();
+
+   // Give the watcher time to watch the directories.
+   this_thread::sleep_for(chrono::milliseconds(100));
+
+   writeFile("js/new.js", "var added;");
+   writeFile("js/lib/vue.min.js", "var Vue = {};");
+   remove((ASSETS_PATH + "/js/app.js").c_str());
+
+   for(int i = 0; i < 100 && (assets.find("js/new.js") == nullptr || assets.find("js/app.js") != nullptr ||
+                              assets.find("js/lib/vue.min.js")->body != "var Vue = {};"); i++) {
+      this_thread::sleep_for(chrono::milliseconds(20));
+   }
+
+   REQUIRE(assets.find("js/new.js")->body == "var added;");
+   REQUIRE(assets.find("js/lib/vue.min.js")->body == "var Vue = {};");
+   REQUIRE(assets.find("js/app.js") == nullptr);
+
+   assets.stopWatching();
+   removeAssets();
+}
+
+TEST_CASE("Test StaticAssets. Content types.")
+{
+   REQUIRE(StaticAssets::contentType("js/vue.min.js") == "text/javascript");
+   REQUIRE(StaticAssets::contentType("fonts/glyphicons.WOFF2") == "font/woff2");
+   REQUIRE(StaticAssets::contentType("img/logo.png") == "image/png");
+   REQUIRE(StaticAssets::contentType("img/logo") == "application/octet-stream");
+   REQUIRE(StaticAssets::contentType("img.d/logo") == "application/octet-stream");
+}
+
+TEST_CASE("Test StaticAssets. Text is kept compressed with gzip and brotli.")
+{
+   makeAssets();
+   writeFile("js/app.js", string(500, 'a'));
+
+   StaticAssets assets(ASSETS_PATH, {"css", "js"}, 1000);
+   assets.load();
+
+   auto js = assets.find("js/app.js");
+   REQUIRE(js->isCompressed());
+   REQUIRE(js->gzipBody.substr(0, 2) == "\x1f\x8b");
+   REQUIRE(js->gzipBody.size() < js->body.size());
+   REQUIRE(js->brotliBody.size() < js->gzipBody.size());
+   REQUIRE(&js->encoded(StaticAssets::Encoding::BROTLI) == &js->brotliBody);
+
+   // Compressing made it larger, so only the file is kept.
+   auto css = assets.find("css/site.css");
+   REQUIRE_FALSE(css->isCompressed());
+   REQUIRE(&css->encoded(StaticAssets::Encoding::GZIP) == &css->body);
+
+   StaticAssets uncompressed(ASSETS_PATH, {"js"}, 1000, false);
+   uncompressed.load();
+   REQUIRE_FALSE(uncompressed.find("js/app.js")->isCompressed());
+
+   removeAssets();
+}
+
+TEST_CASE("Test StaticAssets. Choose the encoding the client accepts.")
+{
+   StaticAssets::Asset asset;
+   asset.body = "body";
+   asset.gzipBody = "gzip";
+   asset.brotliBody = "br";
+
+   REQUIRE(StaticAssets::chooseEncoding("", asset) == StaticAssets::Encoding::IDENTITY);
+   REQUIRE(StaticAssets::chooseEncoding("gzip, deflate", asset) == StaticAssets::Encoding::GZIP);
+   REQUIRE(StaticAssets::chooseEncoding("gzip, deflate, br", asset) == StaticAssets::Encoding::BROTLI);
+   REQUIRE(StaticAssets::chooseEncoding("br;q=0.5, GZIP", asset) == StaticAssets::Encoding::GZIP);
+   REQUIRE(StaticAssets::chooseEncoding("br;q=0, gzip;q=0", asset) == StaticAssets::Encoding::IDENTITY);
+   REQUIRE(StaticAssets::chooseEncoding("*", asset) == StaticAssets::Encoding::BROTLI);
+   REQUIRE(StaticAssets::chooseEncoding("gzip;q=0.5, identity", asset) == StaticAssets::Encoding::IDENTITY);
+   REQUIRE(StaticAssets::chooseEncoding("x-gzip", asset) == StaticAssets::Encoding::GZIP);
+
+   // Only the variants the asset has are chosen.
+   asset.brotliBody.clear();
+   REQUIRE(StaticAssets::chooseEncoding("br", asset) == StaticAssets::Encoding::IDENTITY);
+   REQUIRE(StaticAssets::chooseEncoding("br, gzip", asset) == StaticAssets::Encoding::GZIP);
+}
+
+TEST_CASE("Test StaticAssets. Entity tags and conditional requests.")
+{
+   makeAssets();
+   writeFile("js/app.js", string(500, 'a'));
+
+   StaticAssets assets(ASSETS_PATH, {"js"}, 1000);
+   assets.load();
+
+   auto js = assets.find("js/app.js");
+   string etag = js->entityTag(StaticAssets::Encoding::IDENTITY);
+   REQUIRE(etag.front() == '"');
+   REQUIRE(etag.back() == '"');
+   REQUIRE(js->entityTag(StaticAssets::Encoding::GZIP) == etag.substr(0, etag.size() - 1) + "-gzip\"");
+   REQUIRE(js->entityTag(StaticAssets::Encoding::BROTLI) == etag.substr(0, etag.size() - 1) + "-br\"");
+   REQUIRE(js->lastModified == StaticAssets::httpDate(js->modified));
+
+   // The tag only changes when the contents do.
+   REQUIRE(assets.refresh("js/app.js"));
+   REQUIRE(assets.find("js/app.js")->etag == etag);
+   writeFile("js/app.js", string(500, 'b'));
+   REQUIRE(assets.refresh("js/app.js"));
+   REQUIRE(assets.find("js/app.js")->etag != etag);
+
+   // Not compressed, so every encoding has the same tag.
+   auto vue = assets.find("js/lib/vue.min.js");
+   REQUIRE(vue->entityTag(StaticAssets::Encoding::BROTLI) == vue->etag);
+
+   removeAssets();
+}
+
+TEST_CASE("Test StaticAssets. Decide if the client's copy is current.")
+{
+   REQUIRE(StaticAssets::httpDate(0) == "Thu, 01 Jan 1970 00:00:00 GMT");
+   REQUIRE(StaticAssets::httpDate(1792413000) == "Mon, 19 Oct 2026 12:30:00 GMT");
+   REQUIRE(StaticAssets::fileEntityTag(255, 16) == "W/\"ff-10\"");
+
+   const string etag = "\"1a2b\"";
+   const time_t modified = 1792413000;
+
+   REQUIRE_FALSE(StaticAssets::isNotModified("", "", etag, modified));
+   REQUIRE(StaticAssets::isNotModified("\"1a2b\"", "", etag, modified));
+   REQUIRE(StaticAssets::isNotModified("\"ffff\", W/\"1a2b\"", "", etag, modified));
+   REQUIRE(StaticAssets::isNotModified("*", "", etag, modified));
+   REQUIRE_FALSE(StaticAssets::isNotModified("\"1a2b-gzip\"", "", etag, modified));
+
+   REQUIRE(StaticAssets::isNotModified("", "Mon, 19 Oct 2026 12:30:00 GMT", etag, modified));
+   REQUIRE(StaticAssets::isNotModified("", "Tue, 20 Oct 2026 08:00:00 GMT", etag, modified));
+   REQUIRE_FALSE(StaticAssets::isNotModified("", "Mon, 19 Oct 2026 12:29:59 GMT", etag, modified));
+   REQUIRE_FALSE(StaticAssets::isNotModified("", "yesterday", etag, modified));
+
+   // If-None-Match wins over If-Modified-Since.
+   REQUIRE_FALSE(StaticAssets::isNotModified("\"ffff\"", "Tue, 20 Oct 2026 08:00:00 GMT", etag, modified));
+}
@@ -0,0 +1,60 @@
+/**
+ * The books table used by the tests, so the shared test database and the private
+ * in-memory databases some tests use have the same schema.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef TESTDATABASE_H
+#define TESTDATABASE_H
+
+#include "SQLiteCpp/SQLiteCpp.h"
+
+#include <string>
+
+namespace dw {
+   
+   const std::string TEST_BOOKS_TABLE_SQL = R"(CREATE TABLE IF NOT EXISTS books 
+      (
+         id integer not null primary key autoincrement,
+         user_id integer not null,
+         title varchar not null, 
+         author varchar not null, 
+         year integer null, 
+         read tinyint(1) not null, 
+         rating integer null, 
+         created_at datetime null, 
+         updated_at datetime null,
+         foreign key(user_id) references users(id)
+      );)";
+   
+   /**
+    * Create an empty books table.
+    */
+   inline void testDb_createBooks(SQLite::Database& db)
+   {
+      db.exec(TEST_BOOKS_TABLE_SQL);
+   }
+   
+   /**
+    * Add a book to the books table.
+    * 
+    * @param updatedAt an SQL expression for the time the book was last changed.
+    */
+   inline void testDb_addBook(SQLite::Database& db, long id, long userId, const std::string& title,
+                              const std::string& author, int year, bool isRead, int rating,
+                              const std::string& updatedAt = "NULL")
+   {
+      SQLite::Statement query(db, "INSERT INTO books VALUES(?, ?, ?, ?, ?, ?, ?, NULL, " + updatedAt + ")");
+      query.bind(1, static_cast<long long>(id));
+      query.bind(2, static_cast<long long>(userId));
+      query.bind(3, title);
+      query.bind(4, author);
+      query.bind(5, year);
+      query.bind(6, isRead ? 1 : 0);
+      query.bind(7, rating);
+      query.exec();
+   }
+}
+#endif
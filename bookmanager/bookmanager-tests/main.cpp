@@ -19,6 +19,7 @@ int main( int argc, char* argv[] ) {
 
 #include "SQLiteCpp/Database.h"
 #include "ConfigReader.h"
+#include "TestDatabase.h"
 
 // Set up the database
 TEST_CASE( "1: All test cases reside in other .cpp files (empty)", "[multi-file:1]" ) 
@@ -55,20 +56,7 @@ TEST_CASE( "1: All test cases reside in other .cpp files (empty)", "[multi-file:
       );
       
       db.exec("DROP TABLE IF EXISTS books");
-      db.exec(R"(CREATE TABLE IF NOT EXISTS books 
-      (
-         id integer not null primary key autoincrement,
-         user_id integer not null,
-         title varchar not null, 
-         author varchar not null, 
-         year integer null, 
-         read tinyint(1) not null, 
-         rating integer null, 
-         created_at datetime null, 
-         updated_at datetime null,
-         foreign key(user_id) references users(id)
-      );)"
-      );
+      dw::testDb_createBooks(db);
       
       db.exec(R"(INSERT INTO books VALUES(1, 1,'Sorcerer''s Daughter','Terry Brooks',2009,1,4,'03-06-17 20:25:18','03-06-17 20:25:18');)");
       db.exec(R"(INSERT INTO books VALUES(2, 1,'The Expanse','James S.A. Corey',2014,1,5,'03-07-17 00:13:13','03-07-17 00:13:13');)");
@@ -83,6 +71,9 @@ TEST_CASE( "1: All test cases reside in other .cpp files (empty)", "[multi-file:
       db.exec(R"(INSERT INTO books VALUES(11, 1,'It','Steven King',1984,1,4,NULL,NULL);)");
       db.exec(R"(INSERT INTO books VALUES(12, 1,'The Churn','James S.A. Corey',2007,0,4,NULL,NULL);)");
       db.exec(R"(INSERT INTO books VALUES(13, 1,'Starhawk','Jack McDevitt',2015,1,4,NULL,NULL);)");
+      
+      // Position of a replica in the change journal.
+      db.exec("DROP TABLE IF EXISTS journal_position");
    }
    catch (std::exception& e)
    {
@@ -0,0 +1,170 @@
+/*---------  Program Includes  ----------------*/
+#include "AdminController.h"
+#include "ConfigReader.h"
+#include "DatabaseBackup.h"
+#include "DatabaseMaintenance.h"
+#include "Logger.h"
+#include "StatementRetry.h"
+
+/*---------  System Includes  -----------------*/
+#include <string>
+#include "json.hpp"
+
+using namespace std;
+
+namespace dw {
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+AdminController::AdminController()
+               : mAdminToken("")
+{
+   try {
+      mAdminToken = ConfigReader::getInstance().getConfig(ConfigReader::Config::ADMIN_TOKEN);
+   }
+   catch(exception& e) {
+      mAdminToken = "";
+   }
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+AdminController::AdminController(const std::string& adminToken)
+               : mAdminToken(adminToken)
+{
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+AdminController::~AdminController()
+{
+}
+
+/******************************************************************************
+ * Name: isAuthorized
+ * Desc: Check if the token is the admin token. Every character is compared so
+ *       the time taken does not depend on how much of the token matches.
+ ******************************************************************************
+ */
+bool AdminController::isAuthorized(const std::string& token) const
+{
+   if(mAdminToken.empty() || token.size() != mAdminToken.size()) {
+      return false;
+   }
+
+   unsigned char difference = 0;
+   for(size_t i = 0; i < token.size(); ++i) {
+      difference |= token[i] ^ mAdminToken[i];
+   }
+
+   return difference == 0;
+}
+
+/******************************************************************************
+ * Name: backup
+ * Desc: Ask the backup thread to write a snapshot.
+ ******************************************************************************
+ */
+JsonResponse AdminController::backup(const std::string& token)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "AdminController", "backup().");
+
+   if(!isAuthorized(token)) {
+      return JsonResponse(R"({"message":"Not authorized"})", Pistache::Http::Code::Unauthorized);
+   }
+
+   DatabaseBackup& databaseBackup = DatabaseBackup::instance();
+
+   if(!databaseBackup.isEnabled() || !databaseBackup.isRunning()) {
+      return JsonResponse(R"({"message":"Backups are not enabled"})", Pistache::Http::Code::Service_Unavailable);
+   }
+
+   if(!databaseBackup.requestBackup()) {
+      return JsonResponse(R"({"message":"A backup is already running"})", Pistache::Http::Code::Conflict);
+   }
+
+   return JsonResponse(R"({"message":"Backup started"})", Pistache::Http::Code::Accepted);
+}
+
+/******************************************************************************
+ * Name: maintenanceHistory
+ * Desc: Return the most recent database maintenance runs.
+ ******************************************************************************
+ */
+JsonResponse AdminController::maintenanceHistory(const std::string& token)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "AdminController", "maintenanceHistory().");
+
+   if(!isAuthorized(token)) {
+      return JsonResponse(R"({"message":"Not authorized"})", Pistache::Http::Code::Unauthorized);
+   }
+
+   nlohmann::json runs = nlohmann::json::array();
+   for(const DatabaseMaintenance::Run& run : DatabaseMaintenance::instance().history()) {
+      nlohmann::json jsonRun;
+      jsonRun["operation"] = DatabaseMaintenance::operationName(run.operation);
+      jsonRun["shard"] = run.shard;
+      jsonRun["durationMs"] = run.durationMs;
+      jsonRun["pagesReclaimed"] = run.pagesReclaimed;
+      jsonRun["complete"] = run.isComplete;
+      runs.push_back(jsonRun);
+   }
+
+   nlohmann::json json;
+   json["message"] = "OK";
+   json["runs"] = runs;
+
+   return JsonResponse(json.dump(), Pistache::Http::Code::Ok);
+}
+
+/******************************************************************************
+ * Name: lockWaits
+ * Desc: Return the lock wait histogram of each repository statement.
+ ******************************************************************************
+ */
+JsonResponse AdminController::lockWaits(const std::string& token)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "AdminController", "lockWaits().");
+
+   if(!isAuthorized(token)) {
+      return JsonResponse(R"({"message":"Not authorized"})", Pistache::Http::Code::Unauthorized);
+   }
+
+   nlohmann::json statements = nlohmann::json::array();
+   for(const StatementRetry::LockWaits& waits : StatementRetry::instance().lockWaits()) {
+      nlohmann::json buckets = nlohmann::json::array();
+      for(size_t i = 0; i < waits.buckets.size(); ++i) {
+         nlohmann::json bucket;
+         if(i < StatementRetry::BUCKET_LIMITS_MS.size()) {
+            bucket["le"] = StatementRetry::BUCKET_LIMITS_MS[i];
+         } else {
+            bucket["le"] = "+Inf";
+         }
+         bucket["count"] = waits.buckets[i];
+         buckets.push_back(bucket);
+      }
+
+      nlohmann::json statement;
+      statement["statement"] = waits.statement;
+      statement["executions"] = waits.numExecutions;
+      statement["retries"] = waits.numRetries;
+      statement["failures"] = waits.numFailures;
+      statement["maxWaitMs"] = waits.maxWaitMs;
+      statement["buckets"] = buckets;
+      statements.push_back(statement);
+   }
+
+   nlohmann::json json;
+   json["message"] = "OK";
+   json["statements"] = statements;
+
+   return JsonResponse(json.dump(), Pistache::Http::Code::Ok);
+}
+
+} // End namespace dw
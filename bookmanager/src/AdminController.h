@@ -0,0 +1,89 @@
+/**
+ * @class AdminController
+ * 
+ * Handles the HTTP requests under /api/v1/admin. These requests are authorized by the
+ * ADMIN_TOKEN configuration rather than a user token, sent in the X-Admin-Token header.
+ * If ADMIN_TOKEN is not set every admin request is refused.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef ADMINCONTROLLER_H
+#define ADMINCONTROLLER_H
+
+/*---------  Program Includes  ----------------*/
+#include "JsonResponse.h"
+
+/*---------  System Includes  -----------------*/
+#include <string>
+
+namespace dw {
+
+/*---------  Class Definition  ----------------*/
+
+class AdminController final
+{
+public:
+   
+   /*---------  Public Methods  ------------------*/
+   
+   /**
+    * Constructors and Destructors
+    * 
+    * @param adminToken the token admin requests must supply. By default ADMIN_TOKEN is used.
+    */
+   AdminController();
+   explicit AdminController(const std::string& adminToken);
+   ~AdminController();
+   
+   /**
+    * Check if the token is the admin token.
+    * 
+    * @param token the token sent with the request.
+    * @return true if the token is valid.
+    */
+   bool isAuthorized(const std::string& token) const;
+   
+   /**
+    * Handle the POST request /api/v1/admin/backup. Asks the backup thread to write a
+    * snapshot and returns 202 without waiting for it to finish. Returns 409 if a backup is
+    * already running and 503 if backups are not enabled
+    * or the backup thread is not running.
+    * 
+    * @param token the admin token
+    * @return the HTTP code and message to send to the client
+    */
+   JsonResponse backup(const std::string& token);
+   
+   /**
+    * Handle the GET request /api/v1/admin/maintenance. Returns the most recent database
+    * maintenance runs in the form:
+    * {"message":"OK", "runs":[{"operation":"[string]","shard":[int],"durationMs":[int],"pagesReclaimed":[int],"complete":[bool]},...]}
+    * 
+    * @param token the admin token
+    * @return the HTTP code and message to send to the client
+    */
+   JsonResponse maintenanceHistory(const std::string& token);
+   
+   /**
+    * Handle the GET request /api/v1/admin/lockwaits. Returns how long each repository
+    * statement has waited for database locks, in the form:
+    * {"message":"OK", "statements":[{"statement":"[string]","executions":[int],"retries":[int],"failures":[int],"maxWaitMs":[int],
+    *  "buckets":[{"le":[int or "+Inf"],"count":[int]},...]},...]}
+    * 
+    * @param token the admin token
+    * @return the HTTP code and message to send to the client
+    */
+   JsonResponse lockWaits(const std::string& token);
+   
+private:
+   
+   /*---------  Private Data   -------------------*/
+   
+   std::string mAdminToken;
+};
+
+}
+
+#endif // ADMINCONTROLLER_H
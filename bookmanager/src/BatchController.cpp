@@ -0,0 +1,312 @@
+/*---------  Program Includes  ----------------*/
+#include "BatchController.h"
+#include "BookController.h"
+#include "ChangeJournal.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "SearchCache.h"
+#include "Storage.h"
+#include "WriteBehindBuffer.h"
+#include "dbConnect.h"
+
+/*---------  System Includes  -----------------*/
+#include <cctype>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include "json.hpp"
+
+using namespace std;
+
+namespace dw {
+
+const string BOOKS_PATH = "/api/v1/books";
+const string SEARCH_PATH = "/search";
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+BatchController::BatchController()
+{
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+BatchController::~BatchController()
+{
+}
+
+/******************************************************************************
+ * Name: process
+ * Desc: Run each of the sub-requests in order and combine the responses.
+ ******************************************************************************
+ */
+JsonResponse BatchController::process(const std::string& token, const std::string& jsonData)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "BatchController", "ENTER process.");
+
+   nlohmann::json data;
+   bool useTransaction = false;
+
+   try {
+      data = nlohmann::json::parse(jsonData);
+
+      if(data.find("requests") == data.end() || !data["requests"].is_array()) {
+         throw std::runtime_error("Invalid JSON string. requests must be an array.");
+      }
+
+      long maxRequests = ConfigReader::getInstance().getInt(ConfigReader::Config::BATCH_MAX_REQUESTS);
+      if(data["requests"].size() > (size_t)maxRequests) {
+         throw std::runtime_error("Invalid JSON string. Too many requests in batch.");
+      }
+
+      if(data.find("transaction") != data.end() && data["transaction"].is_boolean()) {
+         useTransaction = data["transaction"];
+      }
+
+      if(useTransaction && storage_backend() != StorageBackend::SQLITE) {
+         throw std::runtime_error("Transactions are only supported by the sqlite storage backend.");
+      }
+   } catch(exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BatchController", "process. ERROR: Invalid batch. &", e.what());
+      return JsonResponse(R"({"message":"ERROR: Invalid batch request", "responses":[]})", Pistache::Http::Code::Bad_Request);
+   }
+
+   SQLite::Database* db = nullptr;
+   unique_ptr<SQLite::Transaction> transaction;
+   long userId = 0;
+   Pistache::Http::Code code = Pistache::Http::Code::Ok;
+   string message = "OK";
+   nlohmann::json responses = nlohmann::json::array();
+   nlohmann::json failed;
+
+   // The token is checked before a connection is taken for the batch.
+   if(BookController().isAuthorized(token) == false) {
+      code = Pistache::Http::Code::Unauthorized;
+      message = "User not authorized";
+   } else {
+      try {
+         // Take a connection out of the pool for the whole batch when running in a
+         // transaction, so all of the sub-requests see the same transaction. All of
+         // the user's books are in one shard, so one connection covers the batch.
+         if(useTransaction) {
+            userId = storage_tokenStore()->getUserIdForToken(token);
+            db = db_getConnection(db_shardForUser(userId));
+            transaction.reset(new SQLite::Transaction(*db));
+         }
+
+         BookController controller(db);
+
+         for(auto& subRequest : data["requests"]) {
+            string method = "";
+            string path = "";
+            string body = "";
+
+            if(subRequest.find("method") != subRequest.end() && subRequest["method"].is_string()) {
+               method = subRequest["method"];
+            }
+
+            if(subRequest.find("path") != subRequest.end() && subRequest["path"].is_string()) {
+               path = subRequest["path"];
+            }
+
+            if(subRequest.find("body") != subRequest.end()) {
+               body = subRequest["body"].dump();
+            }
+
+            JsonResponse response = dispatch(controller, token, method, path, body);
+
+            // Responses are embedded as JSON when possible, otherwise as a string.
+            nlohmann::json result;
+            result["status"] = static_cast<int>(response.code());
+            try {
+               result["body"] = nlohmann::json::parse(response.message());
+            } catch(exception& e) {
+               result["body"] = response.message();
+            }
+            responses.push_back(result);
+
+            // The failing request's own status is in its response. The batch
+            // reports the rollback with one status of its own.
+            int status = static_cast<int>(response.code());
+            if(useTransaction && (status < 200 || status > 299)) {
+               Logger::instance().log(Logger::LogLevel::INFO, "BatchController", "process. Request & failed. Rolling back.", path);
+               code = Pistache::Http::Code::Conflict;
+               message = "ERROR: Batch rolled back";
+               failed = responses.size() - 1;
+               break;
+            }
+         }
+
+         if(transaction && code == Pistache::Http::Code::Ok) {
+            transaction->commit();
+            ChangeJournal::instance().writeCommitted(*db);
+            WriteBehindBuffer::instance().committed(*db);
+
+            // Searches that ran before the commit could not see the changes.
+            SearchCache::instance().invalidate(userId);
+         }
+      } catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "BatchController", "process. ERROR: &", e.what());
+         code = Pistache::Http::Code::Internal_Server_Error;
+         message = "ERROR: Batch failed";
+      }
+   }
+
+   // An uncommitted transaction is rolled back when it is destroyed. The connection
+   // is returned even if the transaction could not be started.
+   transaction.reset();
+   if(db) {
+      WriteBehindBuffer::instance().rolledBack(*db);
+      db_returnConnection(db);
+   }
+
+   nlohmann::json json;
+   json["message"] = message;
+   json["responses"] = responses;
+   if(!failed.is_null()) {
+      json["failed"] = failed;
+   }
+
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BatchController", "LEAVE process. JSON is &.", json);
+
+   return JsonResponse(json.dump(), code);
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: dispatch
+ * Desc: Map a sub-request onto the book controller.
+ ******************************************************************************
+ */
+JsonResponse BatchController::dispatch(BookController& controller,
+                                       const std::string& token,
+                                       const std::string& method,
+                                       const std::string& path,
+                                       const std::string& body)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BatchController", "dispatch. & &", method, path);
+
+   string resource = path;
+   map<string, string> params;
+
+   size_t queryStart = path.find('?');
+   if(queryStart != string::npos) {
+      resource = path.substr(0, queryStart);
+      params = parseQuery(path.substr(queryStart + 1));
+   }
+
+   // Match whole path segments, so /api/v1/booksX and /search2 are unknown.
+   if(resource.compare(0, BOOKS_PATH.size(), BOOKS_PATH) != 0 ||
+      (resource.size() > BOOKS_PATH.size() && resource[BOOKS_PATH.size()] != '/')) {
+      return JsonResponse(R"({"message":"Unknown route"})", Pistache::Http::Code::Not_Found);
+   }
+
+   string subResource = resource.substr(BOOKS_PATH.size());
+
+   if(subResource == "" || subResource == "/") {
+      if(method == "GET") {
+         if(params.count("ids")) {
+            return controller.getByIds(token, params["ids"]);
+         }
+         return controller.getBooks(token, params["archive"] == "true");
+      } else if(method == "POST") {
+         return controller.store(token, body);
+      }
+   } else if(subResource == SEARCH_PATH || subResource.compare(0, SEARCH_PATH.size() + 1, SEARCH_PATH + "/") == 0) {
+      string searchTerm = "";
+      if(subResource.size() > SEARCH_PATH.size() + 1) {
+         searchTerm = urlDecode(subResource.substr(SEARCH_PATH.size() + 1), false);
+      }
+
+      if(method == "GET") {
+         bool includeArchive = params["archive"] == "true";
+         if(searchTerm == "") {
+            return controller.getBooks(token, includeArchive);
+         }
+         return controller.search(token, params["searchType"], searchTerm, includeArchive);
+      }
+   } else {
+      int bookId = 0;
+      try {
+         size_t numChars = 0;
+         bookId = stoi(subResource.substr(1), &numChars);
+         if(numChars != subResource.size() - 1) {
+            bookId = 0;
+         }
+      } catch(exception& e) {
+         bookId = 0;
+      }
+
+      if(bookId < 1) {
+         return JsonResponse(R"({"message":"Unknown route"})", Pistache::Http::Code::Not_Found);
+      }
+
+      if(method == "GET") {
+         return controller.getById(token, bookId);
+      } else if(method == "PUT") {
+         return controller.update(token, bookId, body);
+      } else if(method == "PATCH") {
+         return controller.patch(token, bookId, body);
+      } else if(method == "DELETE") {
+         return controller.remove(token, bookId);
+      }
+   }
+
+   return JsonResponse(R"({"message":"Method not allowed"})", Pistache::Http::Code::Method_Not_Allowed);
+}
+
+/******************************************************************************
+ * Name: urlDecode
+ * Desc: Decode %XX escapes, and + as a space in a query string. An invalid
+ *       escape is kept as it is.
+ ******************************************************************************
+ */
+std::string BatchController::urlDecode(const std::string& text, bool isQuery)
+{
+   string decoded;
+   decoded.reserve(text.size());
+
+   for(size_t i = 0; i < text.size(); i++) {
+      if(text[i] == '%' && i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2])) {
+         decoded += (char)stoi(text.substr(i + 1, 2), nullptr, 16);
+         i += 2;
+      } else if(text[i] == '+' && isQuery) {
+         decoded += ' ';
+      } else {
+         decoded += text[i];
+      }
+   }
+
+   return decoded;
+}
+
+/******************************************************************************
+ * Name: parseQuery
+ * Desc: Split a query string into its parameters.
+ ******************************************************************************
+ */
+map<string, string> BatchController::parseQuery(const std::string& query) const
+{
+   map<string, string> params;
+   stringstream queryStream(query);
+   string param;
+
+   while(getline(queryStream, param, '&')) {
+      size_t index = param.find('=');
+      if(index != string::npos) {
+         params[urlDecode(param.substr(0, index), true)] = urlDecode(param.substr(index + 1), true);
+      } else if(!param.empty()) {
+         params[urlDecode(param, true)] = "";
+      }
+   }
+
+   return params;
+}
+
+} // End namespace dw
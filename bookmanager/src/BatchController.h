@@ -0,0 +1,100 @@
+/**
+ * @class BatchController
+ *
+ * Handles the batch request, which runs several book API requests in one round trip.
+ * The user's token is resolved once for the whole batch. The requests can optionally
+ * be run in a single database transaction.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+
+#ifndef BATCHCONTROLLER_H
+#define BATCHCONTROLLER_H
+
+/*---------  Program Includes  ----------------*/
+#include "BookController.h"
+#include "JsonResponse.h"
+
+/*---------  System Includes  -----------------*/
+#include <map>
+#include <string>
+
+namespace dw {
+
+/*---------  Class Definition  ----------------*/
+
+class BatchController final
+{
+public:
+
+   /*---------  Public Methods  ------------------*/
+
+   /**
+    * Constructors and Destructors
+    */
+   BatchController();
+   virtual ~BatchController();
+
+   /**
+    * Handle the POST request /api/v1/batch. The request data is expected to be in JSON
+    * format in the form:
+    * {"transaction":[bool], "requests":[{"method":"[GET|POST|PUT|PATCH|DELETE]","path":"[path]","body":{...}},...]}
+    *
+    * The path is any of the /api/v1/books routes, including URL encoded query parameters
+    * other than the token. "transaction" and "body" are optional. The response is in the
+    * form: {"message":"OK", "responses":[{"status":[int],"body":{...}},...]}
+    *
+    * When run in a transaction, processing stops at the first request that fails and all
+    * changes are rolled back. The batch is then answered with 409 Conflict, its responses
+    * end with the failing request's own status, and "failed" is that request's index.
+    * Transactions are only available with the SQLite storage backend.
+    *
+    * @param token the users authentication token
+    * @param jsonData The batch request in JSON format.
+    * @return the HTTP code and message to send to the client
+    */
+   JsonResponse process(const std::string& token, const std::string& jsonData);
+
+private:
+
+   /*---------  Private Methods ------------------*/
+
+   /**
+    * Run one sub-request by mapping it to the matching BookController method.
+    *
+    * @param controller the book controller to use for all sub-requests.
+    * @param token the users authentication token
+    * @param method the HTTP method of the sub-request
+    * @param path the path of the sub-request, including any query string
+    * @param body the body of the sub-request as a JSON string
+    * @return the HTTP code and message of the sub-request
+    */
+   JsonResponse dispatch(BookController& controller,
+                         const std::string& token,
+                         const std::string& method,
+                         const std::string& path,
+                         const std::string& body);
+
+   /**
+    * Decode the %XX escapes of part of a URL.
+    *
+    * @param text the encoded text.
+    * @param isQuery true if text is from the query string, where + is a space.
+    * @return the decoded text
+    */
+   static std::string urlDecode(const std::string& text, bool isQuery);
+
+   /**
+    * Split a query string in the form a=1&b=2 into its decoded parameters.
+    *
+    * @param query the query string, without the leading ?
+    * @return map of parameter name to value
+    */
+   std::map<std::string, std::string> parseQuery(const std::string& query) const;
+};
+
+} // End namespace dw
+
+#endif // BATCHCONTROLLER_H
@@ -62,6 +62,8 @@ public:
     */
    void bookId(int bookId) { mId = bookId; }
    void userId(int userId) { mUserId = userId; }
+   void read(bool isRead) { mIsRead = isRead; }
+   void rating(int rating) { mRating = rating; }
    
    /**
     * Get the book data as a string.
@@ -0,0 +1,355 @@
+/*---------  Program Includes  ----------------*/
+#include "BookArchive.h"
+#include "BookLayout.h"
+#include "ChangeJournal.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "SearchCache.h"
+#include "StatementRetry.h"
+#include "WriteBehindBuffer.h"
+#include "dbConnect.h"
+
+/*---------  System Includes  -----------------*/
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const string ARCHIVE_COLUMNS = "id, user_id, title, author, year, read, rating, created_at, updated_at";
+
+const string CREATE_ARCHIVE_SQL = R"(CREATE TABLE IF NOT EXISTS archive.books
+(
+  id integer not null,
+  user_id integer not null,
+  title varchar not null,
+  author varchar not null,
+  year integer null,
+  read tinyint(1) not null,
+  rating integer null,
+  created_at datetime null,
+  updated_at datetime null,
+  primary key(user_id, id)
+))";
+
+const string OLD_BOOKS_SQL = "SELECT id FROM main.books WHERE read = 1 AND COALESCE(updated_at, created_at) < datetime('now', ?)";
+
+const std::chrono::milliseconds PAUSE_BETWEEN_BATCHES(100);
+const std::chrono::hours ARCHIVE_INTERVAL(1);
+const int ARCHIVE_BUSY_TIMEOUT_MS = 1000;
+
+/******************************************************************************
+ * Name: oldBooksSql
+ * Description: The query for the next batch of books to archive, leaving out
+ *              the books given.
+ ******************************************************************************
+ */
+static string oldBooksSql(const vector<int>& skippedIds)
+{
+   string sql = OLD_BOOKS_SQL;
+
+   if(!skippedIds.empty()) {
+      sql += " AND id NOT IN (";
+      for(size_t i = 0; i < skippedIds.size(); ++i) {
+         sql += (i > 0 ? "," : "") + to_string(skippedIds[i]);
+      }
+      sql += ")";
+   }
+
+   return sql + " ORDER BY id LIMIT ?";
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+BookArchive::BookArchive()
+           : mIsRunning(false), mPath(""), mMonths(0)
+{
+   try {
+      mPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::ARCHIVE_PATH);
+   }
+   catch(exception& e) {
+      mPath = "";
+   }
+   mMonths = ConfigReader::getInstance().getInt(ConfigReader::Config::ARCHIVE_MONTHS);
+
+   Logger::instance().log(Logger::LogLevel::INFO, "BookArchive", "Constructor. Archive path is &.", mPath);
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+BookArchive::~BookArchive()
+{
+   if(mThread.joinable()) {
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the book archive.
+ ******************************************************************************
+ */
+BookArchive& BookArchive::instance()
+{
+   static BookArchive mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: isEnabled
+ * Description: Returns true if archiving is configured.
+ ******************************************************************************
+ */
+bool BookArchive::isEnabled() const
+{
+   return !mPath.empty() && mMonths > 0;
+}
+
+/******************************************************************************
+ * Name: path
+ * Description: Returns the archive database file.
+ ******************************************************************************
+ */
+const std::string& BookArchive::path() const
+{
+   return mPath;
+}
+
+/******************************************************************************
+ * Name: configure
+ * Description: Set the archive database and age.
+ ******************************************************************************
+ */
+void BookArchive::configure(const std::string& path, int months)
+{
+   mPath = path;
+   mMonths = months;
+}
+
+/******************************************************************************
+ * Name: attach
+ * Description: Attach the archive database to a connection.
+ ******************************************************************************
+ */
+bool BookArchive::attach(SQLite::Database& db)
+{
+   if(!isEnabled()) {
+      return false;
+   }
+
+   // The connection knows its attached databases, so this needs no query. -1 means
+   // there is no database named archive.
+   if(sqlite3_db_readonly(db.getHandle(), "archive") != -1) {
+      return true;
+   }
+
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookArchive", "attach(). Attaching &.", mPath);
+
+   SQLite::Statement attachQuery(db, "ATTACH DATABASE ? AS archive");
+   attachQuery.bind(1, mPath);
+   attachQuery.exec();
+
+   db.exec(CREATE_ARCHIVE_SQL);
+
+   return true;
+}
+
+/******************************************************************************
+ * Name: archiveBatch
+ * Description: Move one batch of old read books to the archive.
+ ******************************************************************************
+ */
+std::size_t BookArchive::archiveBatch(SQLite::Database& db)
+{
+   if(!attach(db)) {
+      return 0;
+   }
+
+   // Buffered changes count as updates, so write them before choosing books.
+   WriteBehindBuffer::instance().flush();
+
+   string age = "-" + to_string(mMonths) + " months";
+
+   SQLite::Transaction transaction(db);
+
+   // A change queued since the flush is written to the main table, so its book waits
+   // for a later batch.
+   string oldBooks = oldBooksSql(WriteBehindBuffer::instance().pendingBookIds());
+
+   // Replicas read the same archive database, so they are only told the books have gone.
+   vector<pair<int, int>> moved;
+   if(ChangeJournal::instance().isEnabled()) {
+      SQLite::Statement movedQuery(db, "SELECT id, user_id FROM main.books WHERE id IN (" + oldBooks + ")");
+      movedQuery.bind(1, age);
+      movedQuery.bind(2, BATCH_SIZE);
+      while(movedQuery.executeStep()) {
+         moved.push_back(make_pair(movedQuery.getColumn(0).getInt(), movedQuery.getColumn(1).getInt()));
+      }
+   }
+
+   // The archived ids must not be assigned to new books.
+   long long maxId = 0;
+   {
+      SQLite::Statement maxIdQuery(db, "SELECT COALESCE(MAX(id), 0) FROM main.books WHERE id IN (" + oldBooks + ")");
+      maxIdQuery.bind(1, age);
+      maxIdQuery.bind(2, BATCH_SIZE);
+      if(maxIdQuery.executeStep()) {
+         maxId = maxIdQuery.getColumn(0).getInt64();
+      }
+   }
+   books_raiseIdFloor(db, maxId);
+
+   SQLite::Statement copyQuery(db, "INSERT OR REPLACE INTO archive.books (" + ARCHIVE_COLUMNS + ") "
+                                   "SELECT " + ARCHIVE_COLUMNS + " FROM main.books WHERE id IN (" + oldBooks + ")");
+   copyQuery.bind(1, age);
+   copyQuery.bind(2, BATCH_SIZE);
+   int numMoved = copyQuery.exec();
+
+   // The same books are selected again since nothing else can write in this transaction.
+   SQLite::Statement deleteQuery(db, "DELETE FROM main.books WHERE id IN (" + oldBooks + ")");
+   deleteQuery.bind(1, age);
+   deleteQuery.bind(2, BATCH_SIZE);
+   deleteQuery.exec();
+
+   for(auto& book : moved) {
+      ChangeJournal::instance().recordDelete(db, "books", {{"id", book.first}, {"user_id", book.second}});
+   }
+
+   transaction.commit();
+   ChangeJournal::instance().writeCommitted(db);
+
+   if(numMoved > 0) {
+      SearchCache::instance().clear();
+   }
+
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookArchive", "archiveBatch(). Books archived: &.", numMoved);
+
+   return numMoved;
+}
+
+/******************************************************************************
+ * Name: restore
+ * Description: Move a book from the archive back to the main table.
+ ******************************************************************************
+ */
+bool BookArchive::restore(SQLite::Database& db, int userId, int bookId)
+{
+   if(!attach(db)) {
+      return false;
+   }
+
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookArchive", "restore(). User ID: & Book ID &.", userId, bookId);
+
+   int numRestored = 0;
+
+   bool isOutermost = sqlite3_get_autocommit(db.getHandle()) != 0;
+   db.exec("SAVEPOINT restore_book");
+   try {
+      SQLite::Statement copyQuery(db, "INSERT INTO main.books (" + ARCHIVE_COLUMNS + ") "
+                                      "SELECT " + ARCHIVE_COLUMNS + " FROM archive.books WHERE id = ? AND user_id = ?");
+      copyQuery.bind(1, bookId);
+      copyQuery.bind(2, userId);
+      numRestored = copyQuery.exec();
+
+      SQLite::Statement deleteQuery(db, "DELETE FROM archive.books WHERE id = ? AND user_id = ?");
+      deleteQuery.bind(1, bookId);
+      deleteQuery.bind(2, userId);
+      deleteQuery.exec();
+
+      db.exec("RELEASE restore_book");
+   } catch(exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BookArchive", "restore(). ERROR Exception: &.", e.what());
+      StatementRetry::rollbackSavepoint(db, "restore_book", isOutermost);
+      throw;
+   }
+
+   return numRestored > 0;
+}
+
+/******************************************************************************
+ * Name: start
+ * Description: Start the background archive thread.
+ ******************************************************************************
+ */
+void BookArchive::start()
+{
+   if(mIsRunning || !isEnabled()) {
+      return;
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "BookArchive", "start().");
+
+   mIsRunning = true;
+   mThread = std::thread(&BookArchive::run, this);
+}
+
+/******************************************************************************
+ * Name: stop
+ * Description: Stop the background archive thread.
+ ******************************************************************************
+ */
+void BookArchive::stop()
+{
+   if(mThread.joinable()) {
+      Logger::instance().log(Logger::LogLevel::INFO, "BookArchive", "stop().");
+
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: run
+ * Description: Background thread. Archive books in batches, then wait.
+ ******************************************************************************
+ */
+void BookArchive::run()
+{
+   vector<unique_ptr<SQLite::Database>> shards;
+
+   while(mIsRunning) {
+      try {
+         while(shards.size() < db_numShards()) {
+            unique_ptr<SQLite::Database> db(new SQLite::Database(db_shardPath(shards.size()), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE));
+            db->setBusyTimeout(ARCHIVE_BUSY_TIMEOUT_MS);
+            shards.push_back(move(db));
+         }
+
+         // Keep going while there are full batches, pausing so requests can get the lock.
+         for(auto& db : shards) {
+            size_t numMoved = BATCH_SIZE;
+            while(mIsRunning && numMoved == BATCH_SIZE) {
+               numMoved = archiveBatch(*db);
+
+               unique_lock<mutex> lock(mMutex);
+               mWakeUp.wait_for(lock, PAUSE_BETWEEN_BATCHES, [this] { return !mIsRunning; });
+            }
+         }
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "BookArchive", "run(). ERROR Exception: &.", e.what());
+      }
+
+      unique_lock<mutex> lock(mMutex);
+      mWakeUp.wait_for(lock, ARCHIVE_INTERVAL, [this] { return !mIsRunning; });
+   }
+}
+
+} // End namespace dw
@@ -0,0 +1,149 @@
+/**
+ * @class BookArchive
+ *
+ * Singleton class that moves old read books out of the main books table into an archive
+ * database, so the books users mostly look at stay in a small working set. A book is
+ * archived when it has been read and was last updated more than ARCHIVE_MONTHS months
+ * ago, or was added that long ago and never updated. The archive database is
+ * ARCHIVE_PATH, which is ATTACHed as "archive" to each pooled connection when it is
+ * opened, since it cannot be attached inside a transaction, and to other connections
+ * when first needed. Archiving is disabled if either setting is missing.
+ *
+ * Archived ids raise the id floor of their shard, so they are not given to new books.
+ *
+ * All shards share one archive database, keyed by (user_id, id) so each user's archived
+ * books are stored together.
+ *
+ * Books are moved by a background thread in small batches, each in its own transaction,
+ * with a pause between batches so request threads are not blocked. Queries use only the
+ * main table unless the archive is requested. An archived book is moved back to the main
+ * table when it is updated or removed.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef BOOKARCHIVE_H
+#define BOOKARCHIVE_H
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+
+class BookArchive
+{
+public:
+
+   /*---------  Public Constants  ----------------*/
+
+   /**
+    * The number of books moved in each transaction.
+    */
+   static const int BATCH_SIZE = 200;
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the book archive.
+    *
+    * @return dw::BookArchive&
+    */
+   static BookArchive& instance();
+
+   /**
+    * Disable copying
+    */
+   BookArchive(const BookArchive& rhs) = delete;
+   void operator=(const BookArchive& rhs) = delete;
+
+   /**
+    * Returns true if archiving is configured.
+    */
+   bool isEnabled() const;
+
+   /**
+    * Returns the archive database file.
+    */
+   const std::string& path() const;
+
+   /**
+    * Set the archive database and age. An empty path or 0 months disables archiving.
+    * Must be called before the archive is used.
+    *
+    * @param path the archive database file.
+    * @param months books read and last updated more than this many months ago are archived.
+    */
+   void configure(const std::string& path, int months);
+
+   /**
+    * Attach the archive database to a connection as "archive" if it is not already
+    * attached, creating the archive books table if needed.
+    *
+    * @param db the connection.
+    * @return true if the archive is attached, false if archiving is disabled.
+    */
+   bool attach(SQLite::Database& db);
+
+   /**
+    * Move one batch of old read books from the main table to the archive.
+    *
+    * @param db the connection to use.
+    * @return the number of books moved.
+    */
+   std::size_t archiveBatch(SQLite::Database& db);
+
+   /**
+    * Move a book from the archive back to the main table.
+    *
+    * @param db the connection to use.
+    * @param userId the id of the user who owns the book.
+    * @param bookId the id of the book.
+    * @return true if the book was found in the archive and restored.
+    */
+   bool restore(SQLite::Database& db, int userId, int bookId);
+
+   /**
+    * Start the background thread that archives books.
+    */
+   void start();
+
+   /**
+    * Stop the background thread.
+    */
+   void stop();
+
+private:
+
+   /*---------  Private Functions  ---------------*/
+
+   BookArchive();
+   ~BookArchive();
+
+   /**
+    * Background thread. Archives all eligible books in batches, then waits.
+    */
+   void run();
+
+   /*---------  Private Data  --------------------*/
+
+   std::mutex mMutex;
+   std::condition_variable mWakeUp;
+   std::thread mThread;
+   std::atomic<bool> mIsRunning;
+   std::string mPath;
+   int mMonths;
+};
+
+} // End namespace dw
+
+#endif // BOOKARCHIVE_H
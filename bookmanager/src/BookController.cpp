@@ -1,11 +1,17 @@
 /*---------  Program Includes  ----------------*/
 #include "BookController.h"
-#include "BookRepository.h"
+#include "BookPatch.h"
 #include "Logger.h"
-#include "TokenRepository.h"
+#include "SearchCache.h"
+#include "SearchTerm.h"
+#include "Storage.h"
+#include "WriteBehindBuffer.h"
 
 /*---------  System Includes  -----------------*/
+#include <map>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
 using namespace std;
@@ -16,7 +22,8 @@ namespace dw {
  * Constructor
  ******************************************************************************
  */
-BookController::BookController()
+BookController::BookController(SQLite::Database* db)
+              : mDb(db), mUserId(0)
 {
 
 }
@@ -35,9 +42,9 @@ BookController::~BookController()
  * Desc: Retrieves all book data for a user. User id is obtained from the token.
  ******************************************************************************
  */   
-JsonResponse BookController::getBooks(const std::string& token)
+JsonResponse BookController::getBooks(const std::string& token, bool includeArchive)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "BookController", "ENTER getBooks.");
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "ENTER getBooks.");
    
    Pistache::Http::Code code = Pistache::Http::Code::Internal_Server_Error;
    ostringstream   json;
@@ -45,8 +52,8 @@ JsonResponse BookController::getBooks(const std::string& token)
       
    if(userId) {
       try {
-         BookRepository repository;
-         vector<Book> books = repository.getAll(userId);
+         unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+         vector<Book> books = bookStore->getAll(userId, includeArchive);
       
          json << "{\"message\":\"OK\", \"books\":[";
       
@@ -75,7 +82,9 @@ JsonResponse BookController::getBooks(const std::string& token)
       json << "{\"message\":\"User not authorized\", \"books\":[]}";
    }
       
-   Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "LEAVE getBooks. JSON is &.", json.str());
+   if(Logger::instance().isEnabled(Logger::LogLevel::DEBUG)) {
+      Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "LEAVE getBooks. JSON is &.", json.str());
+   }
       
    return JsonResponse(json.str(), code);
 }
@@ -87,13 +96,13 @@ JsonResponse BookController::getBooks(const std::string& token)
  */   
 JsonResponse BookController::getById(const std::string& token, int bookId)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "BookController", "ENTER getById. Token: & Book ID: &", token, to_string(bookId));
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "ENTER getById. Token: & Book ID: &", token, to_string(bookId));
    
    int userId = userIdFromToken(token);
 
    try {
-      BookRepository repository;
-      Book book = repository.getById(userId, bookId);
+      unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+      Book book = bookStore->getById(userId, bookId);
       Pistache::Http::Code code = Pistache::Http::Code::Ok;
       string jsonString = R"({"message":"OK", "book":)" + book.toJson() + "}";
       JsonResponse response(jsonString, code);
@@ -108,6 +117,92 @@ JsonResponse BookController::getById(const std::string& token, int bookId)
    }   
 }
 
+/******************************************************************************
+ * Name: getByIds
+ * Desc: Retrieves the data for a list of books in one request. Books are
+ *       returned in the requested order with a marker for ids not found.
+ ******************************************************************************
+ */   
+JsonResponse BookController::getByIds(const std::string& token, const std::string& ids)
+{
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "ENTER getByIds. IDs: &", Logger::instance().body(ids));
+   
+   Pistache::Http::Code code = Pistache::Http::Code::Internal_Server_Error;
+   ostringstream json;
+   
+   int userId = userIdFromToken(token);
+   if(userId == 0) {
+      json << "{\"message\":\"User not authorized\", \"books\":[]}";
+      return JsonResponse(json.str(), Pistache::Http::Code::Unauthorized);
+   }
+   
+   vector<int> bookIds;
+   try {
+      bookIds = parseIdList(ids);
+      if(bookIds.size() > BookStore::MAX_BATCH_IDS) {
+         throw invalid_argument("Too many ids.");
+      }
+   } catch(exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "getByIds. ERROR: Invalid id list. &", e.what());
+      json << "{\"message\":\"ERROR: Invalid id list\", \"books\":[]}";
+      return JsonResponse(json.str(), Pistache::Http::Code::Bad_Request);
+   }
+   
+   try {
+      unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+      vector<Book> books = bookStore->getByIds(userId, bookIds);
+      
+      map<int, const Book*> booksById;
+      for(const Book& book : books) {
+         booksById[book.id()] = &book;
+      }
+      
+      json << "{\"message\":\"OK\", \"books\":[";
+      
+      int i = 0;
+      for(int bookId : bookIds) {
+         if(i > 0) {
+            json << ",";
+         }
+         
+         auto found = booksById.find(bookId);
+         if(found != booksById.end()) {
+            json << found->second->toJson();
+         } else {
+            json << "{\"id\":" << bookId << ",\"message\":\"Not found\"}";
+         }
+         
+         i++;
+      }
+      code = Pistache::Http::Code::Ok;
+   } catch(exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "getByIds. ERROR: Retrieving books failed. &", e.what());
+      
+      code = Pistache::Http::Code::Internal_Server_Error;
+      
+      json.str("");
+      json.clear();
+      json << "{\"message\":\"ERROR: Cannot retrieve books\", \"books\":[";
+   }
+   json << "]}";
+   
+   if(Logger::instance().isEnabled(Logger::LogLevel::DEBUG)) {
+      Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "LEAVE getByIds. JSON is &.", json.str());
+   }
+   
+   return JsonResponse(json.str(), code);
+}
+
+/******************************************************************************
+ * Name: isAuthorized
+ * Desc: Check that the token belongs to a user.
+ ******************************************************************************
+ */   
+bool BookController::isAuthorized(const std::string& token)
+{
+   return userIdFromToken(token) > 0;
+}
+
 /******************************************************************************
  * Name: remove
  * Desc: Removes a book from the data store
@@ -115,15 +210,16 @@ JsonResponse BookController::getById(const std::string& token, int bookId)
  */   
 JsonResponse BookController::remove(const std::string& token, int bookId)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "BookController", "remove. JSON: &.", to_string(bookId));
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "remove. JSON: &.", to_string(bookId));
    
    ostringstream json;
    Pistache::Http::Code code = Pistache::Http::Code::Internal_Server_Error;
 
    int userId = userIdFromToken(token);
    
-   BookRepository repository;
-   bool isRemoved = repository.remove(userId,bookId);
+   unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+   bool isRemoved = bookStore->remove(userId,bookId);
+   invalidateSearches(userId);
       
    if(isRemoved) {
       Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "remove. Book Removed.");
@@ -142,9 +238,9 @@ JsonResponse BookController::remove(const std::string& token, int bookId)
  * Desc: Search for a book by author, title, or both.
  ******************************************************************************
  */   
-JsonResponse BookController::search(const std::string& token, const std::string& searchTypeIn, const std::string& searchTerm)
+JsonResponse BookController::search(const std::string& token, const std::string& searchTypeIn, const std::string& searchTerm, bool includeArchive)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "BookController", "search: searchTerm &.", searchTerm);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "search: searchTerm &.", searchTerm);
    
    ostringstream json;
    Pistache::Http::Code code = Pistache::Http::Code::Internal_Server_Error;
@@ -152,18 +248,33 @@ JsonResponse BookController::search(const std::string& token, const std::string&
    int userId = userIdFromToken(token);
    if(userId) {
       try {
-         BookRepository::SEARCH_TYPE searchType;
+         BookStore::SEARCH_TYPE searchType;
          if(searchTypeIn == "author") {
-            searchType = BookRepository::SEARCH_TYPE::AUTHOR;
+            searchType = BookStore::SEARCH_TYPE::AUTHOR;
          } else if(searchTypeIn == "title") {
-            searchType = BookRepository::SEARCH_TYPE::TITLE;
+            searchType = BookStore::SEARCH_TYPE::TITLE;
          } else {
-            searchType = BookRepository::SEARCH_TYPE::BOTH;
+            searchType = BookStore::SEARCH_TYPE::BOTH;
          }
-         BookRepository repository;
          std::string fixedSearchTerm = cleanInput(searchTerm);
-         std::cout << "SearchTerm is: <" << fixedSearchTerm << ">" << std::endl;
-         vector<Book> books = repository.search(userId, searchType, fixedSearchTerm);
+         Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "search. SearchTerm is: <&>.", fixedSearchTerm);
+         SearchTerm term(fixedSearchTerm);
+         vector<Book> books;
+         
+         // A batch's connection may be in a transaction that is rolled back, so only
+         // searches made on pooled connections are cached.
+         SearchCache& cache = SearchCache::instance();
+         bool isCacheable = mDb == nullptr && cache.isEnabled();
+         if(isCacheable && cache.narrow(token, userId, searchType, includeArchive, term, books)) {
+            WriteBehindBuffer::instance().apply(books);
+         } else {
+            unsigned long generation = cache.generation(userId);
+            unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+            books = bookStore->search(userId, searchType, fixedSearchTerm, includeArchive);
+            if(isCacheable) {
+               cache.store(token, userId, generation, searchType, includeArchive, term, books);
+            }
+         }
       
          json << "{\"message\":\"OK\", \"books\":[";
       
@@ -177,6 +288,14 @@ JsonResponse BookController::search(const std::string& token, const std::string&
             i++;
          }
          code = Pistache::Http::Code::Ok;
+      } catch(invalid_argument& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "search. ERROR: Invalid search term. &", e.what());
+         
+         code = Pistache::Http::Code::Bad_Request;
+         
+         json.str("");
+         json.clear();
+         json << "{\"message\":\"ERROR: " << e.what() << "\", \"books\":[";
       } catch(exception& e) {
          Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "search. ERROR: Saving book failed. &", e.what());
          
@@ -192,7 +311,9 @@ JsonResponse BookController::search(const std::string& token, const std::string&
       json << "{\"message\":\"User not authorized\", \"books\":[]}";
    }
       
-   Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "LEAVE search. JSON is &.", json.str());
+   if(Logger::instance().isEnabled(Logger::LogLevel::DEBUG)) {
+      Logger::instance().log(Logger::LogLevel::DEBUG, "BookController", "LEAVE search. JSON is &.", json.str());
+   }
       
    return JsonResponse(json.str(), code);
 }
@@ -204,7 +325,7 @@ JsonResponse BookController::search(const std::string& token, const std::string&
  */   
 JsonResponse BookController::store(const std::string& token, const std::string& jsonData)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "BookController", "store. JSON: &.", jsonData);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "store. JSON: &.", Logger::instance().body(jsonData));
    
    long newBookId = 0;
    string message = "";
@@ -216,8 +337,9 @@ JsonResponse BookController::store(const std::string& token, const std::string&
       try {
          Book book(jsonData);
          book.userId(userId);
-         BookRepository repository;
-         newBookId = repository.store(book);
+         unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+         newBookId = bookStore->store(book);
+         invalidateSearches(userId);
       } catch (exception& e) {
          Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "store. ERROR: Saving book failed. &", e.what());
          newBookId = 0;
@@ -247,7 +369,7 @@ JsonResponse BookController::store(const std::string& token, const std::string&
  */   
 JsonResponse BookController::update(const std::string& token, int bookId, const std::string& jsonData)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "BookController", "ENTER - update. Book ID: &, JSON: &.", to_string(bookId), jsonData);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "ENTER - update. Book ID: &, JSON: &.", to_string(bookId), Logger::instance().body(jsonData));
    
    bool isSaved = false;
    bool isAuthorized = false;
@@ -262,8 +384,9 @@ JsonResponse BookController::update(const std::string& token, int bookId, const
          Book book(jsonData);
          book.bookId(bookId);
          book.userId(userId);
-            BookRepository repository;
-            isSaved = repository.update(book);
+         unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+         isSaved = bookStore->update(book);
+         invalidateSearches(userId);
          if(isSaved) {
             isAuthorized = true;
          } else {
@@ -299,51 +422,152 @@ JsonResponse BookController::update(const std::string& token, int bookId, const
    
 }
 
+/******************************************************************************
+ * Name: patch
+ * Desc: Updates only the given fields of an existing book.
+ ******************************************************************************
+ */   
+JsonResponse BookController::patch(const std::string& token, int bookId, const std::string& jsonData)
+{
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "BookController", "ENTER - patch. Book ID: &, JSON: &.", to_string(bookId), Logger::instance().body(jsonData));
+   
+   ostringstream json;
+   Pistache::Http::Code code = Pistache::Http::Code::Internal_Server_Error;
+   
+   int userId = userIdFromToken(token);
+   
+   // A patch that cannot be parsed or breaks a rule is the client's error. Any
+   // failure after that is the server's.
+   unique_ptr<BookPatch> bookPatch;
+   if(userId > 0) {
+      try {
+         bookPatch.reset(new BookPatch(jsonData));
+      } catch (exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "patch. ERROR: Invalid patch. &", e.what());
+         json << "{\"message\":\"ERROR. Book not updated. Invalid data.\"}";
+         code = Pistache::Http::Code::Bad_Request;
+      }
+   }
+   
+   if(userId > 0 && bookPatch) {
+      try {
+         unique_ptr<BookStore> bookStore = storage_bookStore(mDb);
+         WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+         bool isUpdated = false;
+         
+         // Rating and read changes are held briefly so rapid clicks become one write.
+         // A batch's changes are written on its own connection, so they are rolled
+         // back with the batch and seen by its later requests. An archived book is
+         // patched now, which moves it back to the main table.
+         bool isBuffered = storage_backend() == StorageBackend::SQLITE && buffer.isEnabled() && mDb == nullptr;
+         if(isBuffered && buffer.canBuffer(*bookPatch) && bookStore->exists(userId, bookId, false)) {
+            buffer.queue(userId, bookId, *bookPatch);
+            isUpdated = true;
+         } else {
+            isUpdated = bookStore->patch(userId, bookId, *bookPatch);
+         }
+         invalidateSearches(userId);
+         
+         if(isUpdated) {
+            json << "{\"message\":\"Book updated.\"}";
+            code = Pistache::Http::Code::Ok;
+         } else {
+            Logger::instance().log(Logger::LogLevel::INFO, "BookController", "patch. Book does not belong to user. User Id: &, Book Id: &", userId, bookId);
+            json << "{\"message\":\"ERROR. Book not found, not updated.\"}";
+            code = Pistache::Http::Code::Not_Found;
+         }
+      } catch (exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "BookController", "patch. ERROR: Updating book failed. &", e.what());
+         json << "{\"message\":\"ERROR. Book not updated. Server error.\"}";
+         code = Pistache::Http::Code::Internal_Server_Error;
+      }
+   } else if(userId <= 0) {
+      json << "{\"message\":\"User not authorized\"}";
+      code = Pistache::Http::Code::Unauthorized;
+   }
+   
+   return JsonResponse(json.str(), code);
+}
+
+/******************************************************************************
+ * Name: invalidateSearches
+ * Desc: Remove the cached searches of a user whose books have changed. A
+ *       batch's changes are not committed yet, so the batch does it after
+ *       committing.
+ ******************************************************************************
+ */  
+void BookController::invalidateSearches(int userId)
+{
+   if(mDb == nullptr) {
+      SearchCache::instance().invalidate(userId);
+   }
+}
+
 /******************************************************************************
  * Name: userIdFromToken
- * Desc: Get a user id from a token.
+ * Desc: Get a user id from a token. A valid token is cached for the life
+ *       of the controller.
  ******************************************************************************
  */  
 int BookController::userIdFromToken(const std::string& token)
 {
+   // Only look the token up once for each controller.
+   if(mUserId > 0 && token == mToken) {
+      return mUserId;
+   }
+   
    int userId = 0;
-   TokenRepository tokenRepository;
+   unique_ptr<TokenStore> tokenStore = storage_tokenStore();
    
-   if(tokenRepository.exists(token)) {
-      userId = tokenRepository.getUserIdForToken(token);
+   if(tokenStore->exists(token)) {
+      userId = tokenStore->getUserIdForToken(token);
+   }
+   
+   if(userId > 0) {
+      mToken = token;
+      mUserId = userId;
    }
    
    return userId;
 }
 
 /******************************************************************************
- * Name: cleanInput
- * Desc: Replace %20 with a space. 
+ * Name: parseIdList
+ * Desc: Convert a comma separated list of ids to a vector of ints.
  ******************************************************************************
  */  
-std::string BookController::cleanInput(const std::string& input) const
+std::vector<int> BookController::parseIdList(const std::string& ids) const
 {
-   std::stringstream fixedString;
-   
-   if(input.size() < 3) {
-      return input;
-   }
+   vector<int> bookIds;
+   stringstream idStream(ids);
+   string idString;
    
-   size_t prevIndex = 0;
-   size_t index = 0;
-   while(index != std::string::npos) {
-      index = input.find("%20", index);
-      if(index >= std::string::npos) {
-         fixedString << input.substr(prevIndex);
-      } else {
-         fixedString << input.substr(prevIndex, index) << " ";
-         index += 3;
+   while(getline(idStream, idString, ',')) {
+      size_t numChars = 0;
+      int bookId = stoi(idString, &numChars);
+      
+      if(numChars != idString.size() || bookId < 1) {
+         throw invalid_argument("Invalid book id: " + idString);
       }
       
-      prevIndex = index;
+      bookIds.push_back(bookId);
    }
    
-   return fixedString.str();
+   if(bookIds.empty()) {
+      throw invalid_argument("No book ids given.");
+   }
+   
+   return bookIds;
+}
+
+/******************************************************************************
+ * Name: cleanInput
+ * Desc: Decode the %XX escapes in a URL parameter.
+ ******************************************************************************
+ */  
+std::string BookController::cleanInput(const std::string& input) const
+{
+   return SearchTerm::percentDecode(input);
 }
 
 } // End namespace dw
@@ -17,6 +17,11 @@
 /*---------  System Includes  -----------------*/
 #include <iostream>
 #include <string>
+#include <vector>
+
+namespace SQLite {
+   class Database;
+}
 
 namespace dw {
    
@@ -30,8 +35,11 @@ public:
    
    /**
     * Constructors and Destructors
+    * 
+    * @param db optional database connection to use for all book queries. By default each
+    *           query uses a connection from the connection pool.
     */
-   BookController();
+   explicit BookController(SQLite::Database* db = nullptr);
    virtual ~BookController();
   
    /**
@@ -40,9 +48,10 @@ public:
     * {"message":"OK", "books":[{"author":"[string]]","id":[int],"rating":[int],"read":[bool],"title":"[string]","year":"[string]"},...]}
     * 
     * @param token the users authentication token
+    * @param includeArchive true to also return archived books (?archive=true)
     * @return the HTTP code and message to send to the client
     */
-   JsonResponse getBooks(const std::string& token);
+   JsonResponse getBooks(const std::string& token, bool includeArchive = false);
 
    /**
     * Handle the GET request /api/vi/books/id
@@ -52,6 +61,26 @@ public:
     */
    JsonResponse getById(const std::string& token, int bookId);
    
+   /**
+    * Handle the GET request /api/v1/books?ids=1,2,3. All of the books are fetched with one
+    * token lookup and one query. The books are returned in the order requested. An id that
+    * is not found is returned as {"id":[int],"message":"Not found"} in its place.
+    * 
+    * @param token the users authentication token
+    * @param ids comma separated list of book ids
+    * @return the HTTP code and message to send to the client
+    */
+   JsonResponse getByIds(const std::string& token, const std::string& ids);
+   
+   /**
+    * Check if the token belongs to a user. The result is cached, so later requests
+    * made through this controller with the same token do not look it up again.
+    * 
+    * @param token the users authentication token
+    * @return true if the token is valid.
+    */
+   bool isAuthorized(const std::string& token);
+   
    /**
     * Handles the DELETE request to remove a book from the datastore.
     * 
@@ -66,9 +95,10 @@ public:
     * 
     * @param token the users authentication token
     * @param searchTypeIn the type of search to perform: author, title, or both
+    * @param includeArchive true to also search archived books (?archive=true)
     * @return the HTTP code and message to send to the client
     */
-   JsonResponse search(const std::string& token, const std::string& searchTypeIn, const std::string& searchTerm);
+   JsonResponse search(const std::string& token, const std::string& searchTypeIn, const std::string& searchTerm, bool includeArchive = false);
    
    /**
     * Handles the POST request. The book data is expected to be in JSON format in the form:
@@ -92,10 +122,27 @@ public:
     */ 
    JsonResponse update(const std::string& token, int bookId, const std::string& jsonData);
    
+   /**
+    * Handles the PATCH request. Applies a JSON Merge Patch to an existing book, so only the
+    * fields that change need to be sent, for example:
+    * {"rating":[0 to 5]}
+    *
+    * An invalid patch is answered with 400 and a storage failure with 500.
+    *
+    * @param token the users authentication token
+    * @param bookId The ID of the book to update.
+    * @param jsonData The fields to change in JSON format.
+    * @return the HTTP code and message to send to the client
+    */ 
+   JsonResponse patch(const std::string& token, int bookId, const std::string& jsonData);
+   
 private:
    
    /*---------  Private Data   -------------------*/
    
+   SQLite::Database* mDb;
+   std::string mToken;
+   int mUserId;
    
    /*---------  Private Methods ------------------*/
    
@@ -109,7 +156,24 @@ private:
    int userIdFromToken(const std::string& token);
    
    /**
-    * Replaces %20 with a space.
+    * Remove the cached searches of a user whose books have changed. Changes made on a
+    * batch's connection are left to the batch, which removes them once it commits.
+    * 
+    * @param userId the user.
+    */
+   void invalidateSearches(int userId);
+   
+   /**
+    * Parse a comma separated list of ids. Throws std::invalid_argument if any of the ids
+    * is not a positive integer.
+    * 
+    * @param ids the comma separated list of ids.
+    * @return std::vector<int>
+    */
+   std::vector<int> parseIdList(const std::string& ids) const;
+   
+   /**
+    * Decodes the %XX escapes in a URL parameter.
     * 
     * @param input the input parameter from an URL.
     * @return std::string
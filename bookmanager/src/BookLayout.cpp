@@ -0,0 +1,239 @@
+#include "BookLayout.h"
+
+#include "Logger.h"
+#include "dbConnect.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dw {
+   
+const std::string TABLE_SQL = "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'books'";
+
+const std::string CREATE_ID_FLOOR_SQL = "CREATE TABLE IF NOT EXISTS book_id_floor (id_floor integer not null)";
+
+const std::string CREATE_CLUSTERED_SQL = R"(CREATE TABLE books_clustered 
+(
+  id integer not null,
+  user_id integer not null,
+  title varchar not null, 
+  author varchar not null, 
+  year integer null, 
+  read tinyint(1) not null, 
+  rating integer null, 
+  created_at datetime null, 
+  updated_at datetime null,
+  primary key(user_id, id),
+  foreign key(user_id) references users(id)
+) WITHOUT ROWID)";
+
+// The layout of each database file, keyed by path. In-memory databases have no path
+// and are not cached.
+static std::mutex layoutMutex;
+static std::map<std::string, bool> clusteredFiles;
+
+bool books_isClustered(SQLite::Database& db)
+{
+   const std::string& path = db.getFilename();
+   
+   if(!path.empty()) {
+      std::lock_guard<std::mutex> lock(layoutMutex);
+      auto it = clusteredFiles.find(path);
+      if(it != clusteredFiles.end()) {
+         return it->second;
+      }
+   }
+   
+   bool isClustered = false;
+   SQLite::Statement query(db, TABLE_SQL);
+   if(query.executeStep()) {
+      std::string sql = query.getColumn(0).getString();
+      isClustered = sql.find("WITHOUT ROWID") != std::string::npos;
+   }
+   
+   if(!path.empty()) {
+      std::lock_guard<std::mutex> lock(layoutMutex);
+      clusteredFiles[path] = isClustered;
+   }
+   
+   return isClustered;
+}
+
+void books_clusterByUser(SQLite::Database& db)
+{
+   if(books_isClustered(db)) {
+      dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "BookLayout", "books_clusterByUser: Books table is already clustered.");
+      db.exec(CREATE_ID_FLOOR_SQL);
+      return;
+   }
+   
+   dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "BookLayout", "books_clusterByUser: ENTER");
+   
+   SQLite::Transaction transaction(db);
+   
+   db.exec(CREATE_CLUSTERED_SQL);
+   db.exec("INSERT INTO books_clustered (id, user_id, title, author, year, read, rating, created_at, updated_at) "
+           "SELECT id, user_id, title, author, year, read, rating, created_at, updated_at FROM books");
+   db.exec("DROP TABLE books");
+   db.exec("ALTER TABLE books_clustered RENAME TO books");
+   
+   // Used to find the next book id and for lookups by id alone.
+   db.exec("CREATE UNIQUE INDEX books_id_unique ON books (id)");
+   db.exec(CREATE_ID_FLOOR_SQL);
+   
+   transaction.commit();
+   
+   if(!db.getFilename().empty()) {
+      std::lock_guard<std::mutex> lock(layoutMutex);
+      clusteredFiles[db.getFilename()] = true;
+   }
+   
+   // Rewrite the file so the new table's pages are contiguous on disk.
+   db.exec("VACUUM");
+   
+   dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "BookLayout", "books_clusterByUser: LEAVE");
+}
+
+std::string books_nextIdSql(unsigned int shard, unsigned int numShards)
+{
+   std::string n = std::to_string(numShards);
+   
+   // The smallest id above the base that belongs to this shard.
+   return "(SELECT b + 1 + ((" + std::to_string(shard) + " - (b + 1)) % " + n + " + " + n + ") % " + n + " "
+          "FROM (SELECT MAX(COALESCE((SELECT MAX(id) FROM books), 0), "
+                           "COALESCE((SELECT MAX(id_floor) FROM book_id_floor), 0)) AS b))";
+}
+
+void books_raiseIdFloor(SQLite::Database& db, long long id)
+{
+   db.exec(CREATE_ID_FLOOR_SQL);
+   
+   long long idFloor = db.execAndGet("SELECT COALESCE(MAX(id_floor), 0) FROM book_id_floor").getInt64();
+   if(id > idFloor) {
+      db.exec("DELETE FROM book_id_floor");
+      db.exec("INSERT INTO book_id_floor (id_floor) VALUES (" + std::to_string(id) + ")");
+   }
+}
+
+// Open the first numShards shard files, creating them if needed.
+static std::vector<std::unique_ptr<SQLite::Database>> openShards(unsigned int numShards)
+{
+   std::vector<std::unique_ptr<SQLite::Database>> shards;
+   for(unsigned int shard = 0; shard < numShards; ++shard) {
+      shards.emplace_back(new SQLite::Database(db_shardPath(shard), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE));
+   }
+   
+   return shards;
+}
+
+// Give the shards that have no books table the same books table and indexes as shard 0.
+// Returns the number of tables created.
+static int createBooksTables(std::vector<std::unique_ptr<SQLite::Database>>& shards)
+{
+   std::vector<std::string> schema;
+   SQLite::Statement schemaQuery(*shards[0], "SELECT sql FROM sqlite_master WHERE tbl_name = 'books' AND sql IS NOT NULL ORDER BY type DESC");
+   while(schemaQuery.executeStep()) {
+      schema.push_back(schemaQuery.getColumn(0).getString());
+   }
+   
+   int numCreated = 0;
+   for(unsigned int shard = 1; shard < shards.size(); ++shard) {
+      if(!shards[shard]->tableExists("books")) {
+         SQLite::Transaction transaction(*shards[shard]);
+         for(const std::string& sql : schema) {
+            shards[shard]->exec(sql);
+         }
+         transaction.commit();
+         ++numCreated;
+      }
+   }
+   
+   return numCreated;
+}
+
+// Set every shard's id floor to the largest id used in any shard, including by archived
+// books, so those ids are never assigned again.
+static void raiseIdFloors(std::vector<std::unique_ptr<SQLite::Database>>& shards)
+{
+   long long idFloor = 0;
+   for(auto& shard : shards) {
+      shard->exec(CREATE_ID_FLOOR_SQL);
+      idFloor = std::max(idFloor, shard->execAndGet("SELECT MAX(COALESCE((SELECT MAX(id) FROM books), 0), "
+                                                    "COALESCE((SELECT MAX(id_floor) FROM book_id_floor), 0))").getInt64());
+   }
+   
+   for(auto& shard : shards) {
+      SQLite::Transaction transaction(*shard);
+      books_raiseIdFloor(*shard, idFloor);
+      transaction.commit();
+   }
+}
+
+void books_createShards(unsigned int numShards)
+{
+   if(numShards <= 1) {
+      return;
+   }
+   
+   std::vector<std::unique_ptr<SQLite::Database>> shards = openShards(numShards);
+   
+   int numCreated = createBooksTables(shards);
+   if(numCreated > 0) {
+      raiseIdFloors(shards);
+      dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "BookLayout", "books_createShards: Created the books table in & shards.", numCreated);
+   }
+}
+
+long books_reshard(unsigned int fromShards, unsigned int toShards)
+{
+   dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "BookLayout", "books_reshard: ENTER. From & to & shards.", fromShards, toShards);
+   
+   std::vector<std::unique_ptr<SQLite::Database>> shards = openShards(std::max(fromShards, toShards));
+   createBooksTables(shards);
+   
+   long numMoved = 0;
+   
+   for(unsigned int from = 0; from < fromShards; ++from) {
+      SQLite::Database& db = *shards[from];
+      
+      for(unsigned int to = 0; to < toShards; ++to) {
+         if(to == from) {
+            continue;
+         }
+         
+         SQLite::Statement attach(db, "ATTACH DATABASE ? AS target");
+         attach.bind(1, db_shardPath(to));
+         attach.exec();
+         
+         {
+            SQLite::Transaction transaction(db);
+            
+            SQLite::Statement copy(db, "INSERT INTO target.books SELECT * FROM main.books WHERE user_id % ? = ?");
+            copy.bind(1, toShards);
+            copy.bind(2, to);
+            numMoved += copy.exec();
+            
+            SQLite::Statement remove(db, "DELETE FROM main.books WHERE user_id % ? = ?");
+            remove.bind(1, toShards);
+            remove.bind(2, to);
+            remove.exec();
+            
+            transaction.commit();
+         }
+         
+         db.exec("DETACH DATABASE target");
+      }
+   }
+   
+   raiseIdFloors(shards);
+   
+   dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "BookLayout", "books_reshard: LEAVE. Books moved &.", numMoved);
+   
+   return numMoved;
+}
+
+} // End namespace dw
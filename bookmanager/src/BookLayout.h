@@ -0,0 +1,73 @@
+/**
+ * Functions to manage the storage layout of the books table.
+ * 
+ * By default books are stored in a rowid table ordered by the global insert id, so one
+ * user's books are spread across the database file. The clustered layout stores the
+ * table WITHOUT ROWID with a primary key of (user_id, id), so each user's books are
+ * kept together in adjacent pages. The clustered layout is applied by migration with
+ * "bookmanager --cluster-books".
+ * 
+ * In the clustered layout new book ids are one more than the largest of MAX(id) and the
+ * id floor instead of AUTOINCREMENT, so the id of the most recently added book can be
+ * reused after it is deleted.
+ * 
+ * When books are split across several shards, shard n assigns the ids above the id
+ * floor that are equal to n modulo the number of shards, so ids stay unique across all
+ * shards. The floor is the largest id in any shard when the books were last resharded,
+ * so ids kept by books that moved shards are never reused. Archiving raises the floor
+ * to the largest archived id, so an archived book's id is not reused either.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef BOOKLAYOUT_H
+#define BOOKLAYOUT_H
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include <string>
+
+namespace dw {
+   
+   /**
+    * Returns true if the books table uses the clustered WITHOUT ROWID layout. The
+    * layout of a database file is only read once, since it only changes when
+    * books_clusterByUser() migrates it.
+    */
+   bool books_isClustered(SQLite::Database& db);
+   
+   /**
+    * Migrate the books table to the clustered layout. Does nothing if the table is
+    * already clustered. Runs in a single transaction.
+    */
+   void books_clusterByUser(SQLite::Database& db);
+   
+   /**
+    * Get an SQL expression for the next book id in a shard, for use in an INSERT.
+    */
+   std::string books_nextIdSql(unsigned int shard, unsigned int numShards);
+   
+   /**
+    * Raise the id floor of a database so no id up to id is assigned again. Creates the
+    * floor table if needed.
+    */
+   void books_raiseIdFloor(SQLite::Database& db, long long id);
+   
+   /**
+    * Create the books table, its indexes and the id floor in each of the first numShards
+    * shards that has no books table, with the same schema as shard 0. Shard files are
+    * created empty when they are first opened, so this runs before the server uses them.
+    */
+   void books_createShards(unsigned int numShards);
+   
+   /**
+    * Move each user's books to the shard they belong to when the books are split across
+    * toShards shards instead of fromShards. Must only be run while the server is stopped.
+    * Each move between two shards is a single transaction.
+    * 
+    * @return the number of books moved.
+    */
+   long books_reshard(unsigned int fromShards, unsigned int toShards);
+}
+#endif
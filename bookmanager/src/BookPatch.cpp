@@ -0,0 +1,100 @@
+
+/*---------  Program Includes  ----------------*/
+#include "BookPatch.h"
+#include "Logger.h"
+
+/*---------  System Includes  -----------------*/
+#include <stdexcept>
+#include <string>
+#include "json.hpp"
+
+using namespace std;
+
+namespace dw {
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+BookPatch::BookPatch(const std::string& jsonString)
+{
+   parseJsonString(jsonString);
+}
+
+/******************************************************************************
+ * Name: empty
+ * Desc: Returns true if no fields are set.
+ ******************************************************************************
+ */
+bool BookPatch::empty() const
+{
+   return !(mHasTitle || mHasAuthor || mHasYear || mHasRead || mHasRating);
+}
+
+/******************************************************************************
+ * Name: parseJsonString
+ * Desc: Parse the given JSON merge patch to obtain the fields to update.
+ ******************************************************************************
+ */
+void BookPatch::parseJsonString(const std::string& jsonString)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookPatch", "Parse JSON string. JSON string &.", jsonString);
+
+   auto data = nlohmann::json::parse(jsonString);
+
+   if(!data.is_object()) {
+      throw std::runtime_error("Invalid JSON string. Patch must be an object.");
+   }
+
+   for(auto it = data.begin(); it != data.end(); ++it) {
+      const string& key = it.key();
+      const auto& value = it.value();
+
+      if(key == "id" || key == "userId") {
+         continue;
+      }
+
+      if(value.is_null()) {
+         throw std::runtime_error("Invalid JSON string. " + key + " cannot be removed.");
+      }
+
+      if(key == "title") {
+         if(!value.is_string()) {
+            throw std::runtime_error("Invalid JSON string. Title must be string");
+         }
+         mTitle = value;
+         mHasTitle = true;
+      } else if(key == "author") {
+         if(!value.is_string()) {
+            throw std::runtime_error("Invalid JSON string. Author must be string.");
+         }
+         mAuthor = value;
+         mHasAuthor = true;
+      } else if(key == "year") {
+         if(!value.is_string()) {
+            throw std::runtime_error("Invalid JSON string. year must be string.");
+         }
+         mYear = value;
+         mHasYear = true;
+      } else if(key == "read") {
+         if(!value.is_boolean()) {
+            throw std::runtime_error("Invalid JSON string. isRead must be boolean");
+         }
+         mIsRead = value;
+         mHasRead = true;
+      } else if(key == "rating") {
+         if(!value.is_number_integer()) {
+            throw std::runtime_error("Invalid JSON string. Rating must be an integer.");
+         }
+         mRating = value;
+         if(mRating < 0 || mRating > 5) {
+            throw std::runtime_error("Invalid JSON string. Rating must be integer between 0 and 5.");
+         }
+         mHasRating = true;
+      } else {
+         throw std::runtime_error("Invalid JSON string. Unknown field " + key + ".");
+      }
+   }
+}
+
+} // End namespace dw
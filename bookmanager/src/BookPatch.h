@@ -0,0 +1,88 @@
+/**
+ * @class BookPatch
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ *
+ * Description:
+ * Stores a partial update for a book, parsed from a JSON Merge Patch (RFC 7396) string.
+ * Only the fields present in the patch are set. The fields are validated with the same
+ * rules as Book. If the patch is invalid, an std::runtime_error exception is thrown.
+ *
+ * The id and userId fields are ignored since they cannot be changed. None of the book
+ * fields can be removed, so a null value is treated as invalid.
+ *
+ */
+#ifndef BOOKPATCH_H
+#define BOOKPATCH_H
+
+/*---------  System Includes  -----------------*/
+#include <string>
+
+namespace dw {
+
+class BookPatch final
+{
+public:
+
+   /*---------  Public Functions  ---------------*/
+
+   /**
+    * Constructors and Destructors
+    */
+   BookPatch() = delete;
+   explicit BookPatch(const std::string& jsonString);
+   virtual ~BookPatch() = default;
+
+   /**
+    * Check which fields are set in the patch.
+    */
+   bool hasTitle() const { return mHasTitle; }
+   bool hasAuthor() const { return mHasAuthor; }
+   bool hasYear() const { return mHasYear; }
+   bool hasRead() const { return mHasRead; }
+   bool hasRating() const { return mHasRating; }
+
+   /**
+    * Returns true if the patch does not change any fields.
+    */
+   bool empty() const;
+
+   /**
+    * Get methods. The value is only valid if the matching has method returns true.
+    */
+   std::string title() const { return mTitle; }
+   std::string author() const { return mAuthor; }
+   std::string year() const { return mYear; }
+   bool read() const { return mIsRead; }
+   int rating() const { return mRating; }
+
+private:
+
+   /*---------  Private Functions ---------------*/
+
+   /**
+    * Parses a JSON merge patch string. If the JSON data is invalid, an std::runtime_error
+    * exception is thrown.
+    */
+   void parseJsonString(const std::string& jsonString);
+
+   /*---------  Private Data  ------------------*/
+
+   bool        mHasTitle = false;
+   bool        mHasAuthor = false;
+   bool        mHasYear = false;
+   bool        mHasRead = false;
+   bool        mHasRating = false;
+
+   std::string mTitle;
+   std::string mAuthor;
+   std::string mYear;
+   bool        mIsRead = false;
+   int         mRating = 0;
+};
+
+}
+
+#endif // BOOKPATCH_H
@@ -1,14 +1,22 @@
 
 /*---------  Program Includes  ----------------*/
 #include "BookRepository.h"
+#include "BookArchive.h"
+#include "BookLayout.h"
+#include "ChangeJournal.h"
 #include "ConfigReader.h"
 #include "Book.h"
 #include "Logger.h"
+#include "RequestDeadline.h"
+#include "SearchTerm.h"
+#include "StatementRetry.h"
+#include "WriteBehindBuffer.h"
 #include "dbConnect.h"
 
 /*--------  System Includes  --------------*/
 #include <iostream>
 #include <vector>
+#include <sqlite3.h>
 
 
 using namespace std;
@@ -19,7 +27,8 @@ namespace dw {
  * Constructor
  ******************************************************************************
  */
-BookRepository::BookRepository()
+BookRepository::BookRepository(SQLite::Database* db)
+              : mDb(db), mIsPooledConnection(db == nullptr), mShard(0)
 {
    try {
       mDbPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::DB_PATH); 
@@ -34,7 +43,7 @@ BookRepository::BookRepository()
    //mDb = make_shared<SQLite::Database>(mDbPath, 
    //                                    SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
    
-   mDb = db_getConnection();
+   // A pooled connection is taken on first use, once the user's shard is known.
 }
 
 /******************************************************************************
@@ -44,7 +53,9 @@ BookRepository::BookRepository()
 BookRepository::~BookRepository()
 {
    Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "Desstructor.");
-   db_returnConnection(mDb);
+   if(mIsPooledConnection && mDb != nullptr) {
+      db_returnConnection(mDb);
+   }
 }
 
 /******************************************************************************
@@ -52,14 +63,21 @@ BookRepository::~BookRepository()
  * Description: Return all stored books in a vector.
  ******************************************************************************
  */
-vector<Book> BookRepository::getAll(int userId)
+vector<Book> BookRepository::getAll(int userId, bool includeArchive)
 {
    Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "getAll()");
    
+   SQLite::Database& db = connection(userId);
+   
+   string selectQuery = "SELECT id, user_id, title, author, year, read, rating FROM books WHERE user_id = :userId";
+   if(includeArchive && BookArchive::instance().attach(db)) {
+      selectQuery += " UNION ALL SELECT id, user_id, title, author, year, read, rating FROM archive.books WHERE user_id = :userId";
+   }
+   
    vector<Book> books;
    try 
    {
-      SQLite::Statement query(*(mDb), "SELECT * FROM books WHERE user_id = :userId");
+      SQLite::Statement query(db, selectQuery);
       query.bind(":userId", userId);
       
       while (query.executeStep())
@@ -81,6 +99,8 @@ vector<Book> BookRepository::getAll(int userId)
       throw;
    }
    
+   WriteBehindBuffer::instance().apply(books);
+   
    return books;
 }
 
@@ -91,11 +111,13 @@ vector<Book> BookRepository::getAll(int userId)
  */
 Book BookRepository::getById(int userId, int bookId)
 {
-   Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "getById(). User ID: & Book ID &.", to_string(userId), to_string(bookId));
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "getById(). User ID: & Book ID &.", userId, bookId);
+   
+   SQLite::Database& db = connection(userId);
    
    bool hasResults = false;
    
-   SQLite::Statement query(*(mDb), "SELECT id, user_id, title, author, year, read, rating FROM books WHERE id = :id AND user_id = :user_id");
+   SQLite::Statement query(db, "SELECT id, user_id, title, author, year, read, rating FROM books WHERE id = :id AND user_id = :user_id");
    query.bind(":id", bookId);
    query.bind(":user_id", userId);
    
@@ -111,6 +133,24 @@ Book BookRepository::getById(int userId, int bookId)
    
    if(hasResults == false) {
       query.reset();
+      
+      // Archived books are only looked for after a miss, so hot reads stay on one table.
+      if(BookArchive::instance().attach(db)) {
+         SQLite::Statement archiveQuery(db, "SELECT id, user_id, title, author, year, read, rating FROM archive.books WHERE id = :id AND user_id = :user_id");
+         archiveQuery.bind(":id", bookId);
+         archiveQuery.bind(":user_id", userId);
+         
+         if(archiveQuery.executeStep()) {
+            return Book(archiveQuery.getColumn(0),
+                        archiveQuery.getColumn(1), 
+                        archiveQuery.getColumn(2), 
+                        archiveQuery.getColumn(3),
+                        archiveQuery.getColumn(4), 
+                        (int)archiveQuery.getColumn(5), 
+                        archiveQuery.getColumn(6));
+         }
+      }
+      
       throw out_of_range("Book with that id does not exist for user.");
    }
    
@@ -123,9 +163,197 @@ Book BookRepository::getById(int userId, int bookId)
              query.getColumn(6));
    query.reset();
    
+   WriteBehindBuffer::instance().apply(book);
+   
    return book;
 }
 
+/******************************************************************************
+ * Name: getByIds
+ * Description: Return the stored books with the given ids using one query.
+ ******************************************************************************
+ */
+vector<Book> BookRepository::getByIds(int userId, const vector<int>& bookIds)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "getByIds(). User ID: & Num IDs &.", userId, bookIds.size());
+   
+   vector<Book> books;
+   
+   if(bookIds.empty()) {
+      return books;
+   }
+   
+   if(bookIds.size() > MAX_BATCH_IDS) {
+      throw out_of_range("Too many book ids requested.");
+   }
+   
+   SQLite::Database& db = connection(userId);
+   
+   // One placeholder per id so the whole batch is a single statement.
+   string selectQuery = "SELECT id, user_id, title, author, year, read, rating FROM books WHERE user_id = ? AND id IN (?";
+   for(size_t i = 1; i < bookIds.size(); ++i) {
+      selectQuery += ",?";
+   }
+   selectQuery += ")";
+   
+   try 
+   {
+      SQLite::Statement query(db, selectQuery);
+      query.bind(1, userId);
+      
+      int index = 2;
+      for(int bookId : bookIds) {
+         query.bind(index, bookId);
+         index++;
+      }
+      
+      while (query.executeStep())
+      {
+         Book book(query.getColumn(0),
+                   query.getColumn(1), 
+                   query.getColumn(2), 
+                   query.getColumn(3), 
+                   query.getColumn(4), 
+                   (int)query.getColumn(5), 
+                   query.getColumn(6));
+         
+         books.push_back(book);
+      }
+   }
+   catch (exception& e)
+   {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "getByIds(). ERROR Exception: &.", e.what());
+      throw;
+   }
+   
+   WriteBehindBuffer::instance().apply(books);
+   
+   return books;
+}
+
+/******************************************************************************
+ * Name: patch
+ * Description: Update only the given columns of a book.
+ ******************************************************************************
+ */
+bool BookRepository::patch(int userId, int bookId, const BookPatch& patch)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "patch(). Book ID: & User ID &.", bookId, userId);
+   
+   if (bookId < 1 || userId < 1) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "patch(). Invalid user ID or Book ID");
+      return false;
+   }
+   
+   // Write any buffered changes with this update. Values in the patch are newer. They
+   // stay buffered until the update has been written.
+   WriteBehindBuffer::Hold hold(userId, bookId);
+   const WriteBehindBuffer::PendingChange& pending = hold.change();
+   
+   bool hasRead = patch.hasRead() || pending.hasRead;
+   bool isRead = patch.hasRead() ? patch.read() : pending.read;
+   bool hasRating = patch.hasRating() || pending.hasRating;
+   int rating = patch.hasRating() ? patch.rating() : pending.rating;
+   
+   // Nothing to write, so only check that the book exists.
+   if(patch.empty() && !hasRead && !hasRating) {
+      return exists(userId, bookId);
+   }
+   
+   string patchQuery = "UPDATE books SET ";
+   string separator = "";
+   
+   if(patch.hasTitle()) {
+      patchQuery += separator + "title=:title";
+      separator = ", ";
+   }
+   if(patch.hasAuthor()) {
+      patchQuery += separator + "author=:author";
+      separator = ", ";
+   }
+   if(patch.hasYear()) {
+      patchQuery += separator + "year=:year";
+      separator = ", ";
+   }
+   if(hasRead) {
+      patchQuery += separator + "read=:read";
+      separator = ", ";
+   }
+   if(hasRating) {
+      patchQuery += separator + "rating=:rating";
+      separator = ", ";
+   }
+   patchQuery += ", updated_at=datetime('now') WHERE id=:id AND user_id=:user_id";
+   
+   SQLite::Database& db = connection(userId);
+   
+   SQLite::Statement query(db, patchQuery);
+   
+   if(patch.hasTitle()) {
+      query.bind(":title", patch.title());
+   }
+   if(patch.hasAuthor()) {
+      query.bind(":author", patch.author());
+   }
+   if(patch.hasYear()) {
+      query.bind(":year", patch.year());
+   }
+   if(hasRead) {
+      query.bind(":read", isRead);
+   }
+   if(hasRating) {
+      query.bind(":rating", rating);
+   }
+   query.bind(":id", bookId);
+   query.bind(":user_id", userId);
+   
+   int result = StatementRetry::instance().exec(db, query, "books.patch");
+   
+   if(!result && restoreArchived(userId, bookId)) {
+      query.reset();
+      result = StatementRetry::instance().exec(db, query, "books.patch");
+   }
+   
+   hold.written(db);
+   
+   if(result) {
+      ChangeJournal::instance().recordUpsert(db, "books", {{"id", bookId}, {"user_id", userId}});
+      Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "patch(). Book has been updated.");
+   } else {
+      Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "patch(). ERROR book not updated.");
+   }
+   
+   return result > 0;
+}
+
+/******************************************************************************
+ * Name: exists
+ * Description: Check if a book exists for a user.
+ ******************************************************************************
+ */
+bool BookRepository::exists(int userId, int bookId, bool includeArchive)
+{
+   SQLite::Database& db = connection(userId);
+   
+   SQLite::Statement query(db, "SELECT 1 FROM books WHERE id = ? AND user_id = ?");
+   query.bind(1, bookId);
+   query.bind(2, userId);
+   
+   if(query.executeStep()) {
+      return true;
+   }
+   
+   if(includeArchive && BookArchive::instance().attach(db)) {
+      SQLite::Statement archiveQuery(db, "SELECT 1 FROM archive.books WHERE id = ? AND user_id = ?");
+      archiveQuery.bind(1, bookId);
+      archiveQuery.bind(2, userId);
+      
+      return archiveQuery.executeStep();
+   }
+   
+   return false;
+}
+
 /******************************************************************************
  * Name: remove
  * Description: Remove a book from the data store.
@@ -133,21 +361,36 @@ Book BookRepository::getById(int userId, int bookId)
  */
 bool BookRepository::remove(int userId, int bookId)
 {
-   Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "remove(). Book ID: & User ID &.", to_string(bookId), to_string(userId));
+   Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "remove(). Book ID: & User ID &.", bookId, userId);
    
    bool isRemoved = false;
    
    string deleteQuery = "DELETE FROM books WHERE id = ? AND user_id = ?";
    
+   WriteBehindBuffer::Hold hold(userId, bookId);
+   
+   SQLite::Database& db = connection(userId);
+   
    // Create a new database connection when storing a new book. Connection will be closed
    // when db goes out-of-scope.
    //
-   SQLite::Statement query((*mDb), deleteQuery);
+   SQLite::Statement query(db, deleteQuery);
    query.bind(1, bookId);
    query.bind(2, userId);
-   int result = query.exec();
+   int result = StatementRetry::instance().exec(db, query, "books.remove");
+   
+   // Not in the main table, so it may have been archived.
+   if(!result && BookArchive::instance().attach(db)) {
+      SQLite::Statement archiveQuery(db, "DELETE FROM archive.books WHERE id = ? AND user_id = ?");
+      archiveQuery.bind(1, bookId);
+      archiveQuery.bind(2, userId);
+      result = StatementRetry::instance().exec(db, archiveQuery, "books.remove_archived");
+   }
+   
+   hold.written(db);
    
    if(result) {
+      ChangeJournal::instance().recordDelete(db, "books", {{"id", bookId}, {"user_id", userId}});
       isRemoved = true;
    }
    
@@ -160,36 +403,48 @@ bool BookRepository::remove(int userId, int bookId)
  * Description: Find the books with the given search term.
  ******************************************************************************
  */
-std::vector<Book> BookRepository::search(int user_id, SEARCH_TYPE searchType, std::string searchTerm)
+std::vector<Book> BookRepository::search(int user_id, SEARCH_TYPE searchType, std::string searchTerm, bool includeArchive)
 {
    Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "search(). Search Term: &.", searchTerm);
    
+   SearchTerm term(searchTerm);
+   
+   SQLite::Database& db = connection(user_id);
+   
    vector<Book> books;
    
-   string searchQuery = "SELECT id, user_id, title, author, year, read, rating FROM books WHERE user_id = :user_id AND ";
+   vector<string> columns;
    switch(searchType)
    {
       case SEARCH_TYPE::AUTHOR:
-         searchQuery += "author LIKE :search";
+         columns = {"author"};
          break;
          
       case SEARCH_TYPE::TITLE:
-         searchQuery += "title LIKE :search";
+         columns = {"title"};
          break;
          
       case SEARCH_TYPE::BOTH:
       default:
-         searchQuery += "(title LIKE :search OR author LIKE :search)";
+         columns = {"title", "author"};
+   }
+   string condition = term.condition(columns);
+   
+   string searchQuery = "SELECT id, user_id, title, author, year, read, rating FROM books WHERE user_id = :user_id AND " + condition;
+   if(includeArchive && BookArchive::instance().attach(db)) {
+      searchQuery += " UNION ALL SELECT id, user_id, title, author, year, read, rating FROM archive.books WHERE user_id = :user_id AND " + condition;
    }
          
    
    try 
    {
-      string searchString = "%" + searchTerm + "%";
-      
-      SQLite::Statement query(*(mDb), searchQuery);
+      SQLite::Statement query(db, searchQuery);
       query.bind(":user_id", user_id);
-      query.bind(":search", searchString);
+      
+      vector<string> parameters = term.parameters();
+      for(size_t i = 0; i < parameters.size(); ++i) {
+         query.bind(":term" + to_string(i), parameters[i]);
+      }
    
       while (query.executeStep())
       {
@@ -209,6 +464,9 @@ std::vector<Book> BookRepository::search(int user_id, SEARCH_TYPE searchType, st
       Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "search(). ERROR Exception: &.", e.what());
       throw;
    }
+   
+   WriteBehindBuffer::instance().apply(books);
+   
    return books;
 }
 
@@ -222,14 +480,30 @@ long BookRepository::store(const Book& book)
 {
    Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "store(). Book data: &.", book.toString());
 
+   SQLite::Database& db = connection(book.userId());
+
    long newId = 0;
    
-   string insertQuery = "INSERT INTO books (user_id, title, author, year, read, rating) VALUES (?,?,?,?,?,?)";
+   // The clustered layout has no rowid and shards share one id space, so in either
+   // case the id is assigned here, above the id floor so archived ids are not reused.
+   // The new id is always the largest in the table. The rowid table is AUTOINCREMENT,
+   // which never reuses an id.
+   string idQuery = "";
+   if(db_numShards() > 1) {
+      idQuery = books_nextIdSql(db_shardForUser(book.userId()), db_numShards());
+   } else if(books_isClustered(db)) {
+      idQuery = books_nextIdSql(0, 1);
+   }
+   bool isAssignedId = !idQuery.empty();
    
-   // Create a new database connection when storing a new book. Connection will be closed
-   // when db goes out-of-scope.
-   //
-   SQLite::Statement query((*mDb), insertQuery);
+   string insertQuery = "INSERT INTO books (user_id, title, author, year, read, rating, created_at, updated_at) "
+                        "VALUES (?,?,?,?,?,?,datetime('now'),datetime('now'))";
+   if(isAssignedId) {
+      insertQuery = "INSERT INTO books (user_id, title, author, year, read, rating, created_at, updated_at, id) "
+                    "VALUES (?,?,?,?,?,?,datetime('now'),datetime('now')," + idQuery + ")";
+   }
+   
+   SQLite::Statement query(db, insertQuery);
    
    query.bind(1, book.userId());
    query.bind(2, book.title());
@@ -238,12 +512,44 @@ long BookRepository::store(const Book& book)
    query.bind(5, book.read());
    query.bind(6, book.rating());
    
-   int result = query.exec();
+   int result = 0;
+   
+   if(isAssignedId) {
+      // Keep the write lock until the new id has been read back. A locked database rolls
+      // back the savepoint, so the whole block is retried.
+      bool isRetry = false;
+      result = StatementRetry::instance().run(db, "books.store", [&]() {
+         int numInserted = 0;
+         if(isRetry) {
+            StatementRetry::resetStatement(query);
+         }
+         isRetry = true;
+         
+         bool isOutermost = sqlite3_get_autocommit(db.getHandle()) != 0;
+         db.exec("SAVEPOINT store_book");
+         try {
+            numInserted = query.exec();
+            if(numInserted) {
+               newId = db.execAndGet("SELECT MAX(id) FROM books").getInt64();
+            }
+            db.exec("RELEASE store_book");
+         } catch(exception& e) {
+            Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "store(). ERROR Exception: &.", e.what());
+            StatementRetry::rollbackSavepoint(db, "store_book", isOutermost);
+            throw;
+         }
+         return numInserted;
+      });
+   } else {
+      result = StatementRetry::instance().exec(db, query, "books.store");
+      if(result) {
+         newId = db.getLastInsertRowid();
+      }
+   }
    
    if(result) {
-      newId = mDb->getLastInsertRowid();
-      
-      Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "store(). Book created. Id is: &.", to_string(newId));
+      ChangeJournal::instance().recordUpsert(db, "books", {{"id", newId}, {"user_id", book.userId()}});
+      Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "store(). Book created. Id is: &.", newId);
    } else {
       Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "store(). ERROR book not saved.");
    }
@@ -267,12 +573,17 @@ bool BookRepository::update(const Book& book) {
    
    bool isSaved = false;
    
-   string updateQuery = "UPDATE books set title=?, author=?, year=?, read=?, rating=? WHERE id=? AND user_id=?";
+   string updateQuery = "UPDATE books set title=?, author=?, year=?, read=?, rating=?, updated_at=datetime('now') WHERE id=? AND user_id=?";
+   
+   // The full update replaces any buffered rating or read changes once it is written.
+   WriteBehindBuffer::Hold hold(book.userId(), book.id());
+   
+   SQLite::Database& db = connection(book.userId());
    
    // Create a new database connection when updating a book. Connection will be closed
    // when db goes out-of-scope.
    //
-   SQLite::Statement query((*mDb), updateQuery);
+   SQLite::Statement query(db, updateQuery);
    
    query.bind(1, book.title());
    query.bind(2, book.author());
@@ -282,10 +593,18 @@ bool BookRepository::update(const Book& book) {
    query.bind(6, book.id());
    query.bind(7, book.userId());
    
-   int result = query.exec();
+   int result = StatementRetry::instance().exec(db, query, "books.update");
+   
+   if(!result && restoreArchived(book.userId(), book.id())) {
+      query.reset();
+      result = StatementRetry::instance().exec(db, query, "books.update");
+   }
+   
+   hold.written(db);
    
    if(result) {
       isSaved = true;
+      ChangeJournal::instance().recordUpsert(db, "books", {{"id", book.id()}, {"user_id", book.userId()}});
       Logger::instance().log(Logger::LogLevel::DEBUG, "BookRepository", "update(). Book has been updated.");
    } else {
       Logger::instance().log(Logger::LogLevel::ERROR, "BookRepository", "update(). ERROR book not updated.");
@@ -295,5 +614,47 @@ bool BookRepository::update(const Book& book) {
    return isSaved;
 }
 
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: connection
+ * Description: Get the connection for the shard that holds a user's books.
+ ******************************************************************************
+ */
+SQLite::Database& BookRepository::connection(int userId)
+{
+   if(!mIsPooledConnection) {
+      return *mDb;
+   }
+   
+   unsigned int shard = db_shardForUser(userId);
+   if(mDb == nullptr || shard != mShard) {
+      if(mDb != nullptr) {
+         db_returnConnection(mDb);
+      }
+      mDb = db_getConnection(shard);
+      mShard = shard;
+      RequestDeadline::watch(*mDb);
+   }
+   
+   return *mDb;
+}
+
+/******************************************************************************
+ * Name: restoreArchived
+ * Description: Move an archived book back to the main table.
+ ******************************************************************************
+ */
+bool BookRepository::restoreArchived(int userId, int bookId)
+{
+   if(!BookArchive::instance().isEnabled()) {
+      return false;
+   }
+   
+   SQLite::Database& db = connection(userId);
+   
+   return BookArchive::instance().restore(db, userId, bookId);
+}
+
 } // End Namespace dw
 
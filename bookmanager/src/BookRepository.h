@@ -1,9 +1,9 @@
 /**
  * @class BookRepository
  * 
- * Handles storing, updating and retrieving from the book data store.
- * One database connection is shared for all get requests. All database writes create
- * a new connection and close it when finished.
+ * SQLite implementation of the book data store.
+ * Books are stored in the shard for their user. A pooled connection to the user's shard
+ * is taken on first use and returned when the repository is destroyed.
  * 
  * @author  Dean Wilson
  * @version 1.1
@@ -14,6 +14,8 @@
 
 /*---------  Program Includes  ----------------*/
 #include "Book.h"
+#include "BookPatch.h"
+#include "BookStore.h"
 
 /*--------  System Includes  --------------*/
 #include <SQLiteCpp/SQLiteCpp.h>
@@ -25,52 +27,73 @@
 
 namespace dw {
 
-class BookRepository
+class BookRepository : public BookStore
 {
    
 public:
    
-   enum SEARCH_TYPE
-   {
-      AUTHOR,
-      BOTH,
-      TITLE
-   };
    /*-----------  Public Functions  ----------------*/
    
    /**
-    * Constructor and destructor
+    * Constructor and destructor. If a database connection is passed in it is used for all
+    * queries and is not returned to the connection pool, otherwise a connection to the
+    * user's shard is taken from the pool and returned when the repository is destroyed.
+    * 
+    * @param db optional database connection to use, for example one with an open
+    *           transaction. It must be a connection to the shard of every user queried.
     */
-   BookRepository();
-   virtual ~BookRepository();
+   explicit BookRepository(SQLite::Database* db = nullptr);
+   ~BookRepository() override;
   
    /**
     * Gets all stored books.
     * 
     * @param userId the user ID of the books to return
+    * @param includeArchive true to also return books that have been archived.
     * @return std::vector<Book>
     */
-   std::vector<Book> getAll(int userId);
+   std::vector<Book> getAll(int userId, bool includeArchive = false) override;
    
    /**
-    * Get the stored book object for the given id.
+    * Get the stored book object for the given id. Archived books are also found.
     * @throws out_of_range exception if the book cannot be retrieved.
     * 
     * @param userId The id of the user requesting the book 
     * @param bookId The id of the book to retrieve.
     * @return The book data.
     */
-    Book getById(int userId, int bookId);
+    Book getById(int userId, int bookId) override;
+   
+   /**
+    * Get the stored books for a list of ids with a single query. Ids that do not exist or
+    * do not belong to the user are not included in the result.
+    * @throws out_of_range exception if more than MAX_BATCH_IDS ids are requested.
+    * 
+    * @param userId The id of the user requesting the books
+    * @param bookIds The ids of the books to retrieve.
+    * @return The books found, in no particular order.
+    */
+   std::vector<Book> getByIds(int userId, const std::vector<int>& bookIds) override;
    
    /**
-    * Delete the book with the given id from the data store. Returns true if successful,
+    * Check if a book exists for a user, either in the main table or the archive.
+    * 
+    * @param userId The id of the user who owns the book
+    * @param bookId The id of the book.
+    * @param includeArchive true to also look for the book in the archive.
+    * @return true if the book exists.
+    */
+   bool exists(int userId, int bookId, bool includeArchive = true) override;
+   
+   /**
+    * Delete the book with the given id from the data store, including the archive. Returns true if successful,
     * otherwise returns false.
     * 
     * @param userId the id of the user who is requesting the delete
     * @param bookId the id of the book to delete
     * @return true if the book was removed, otherwise false.
     */
-   bool remove(int userId, int bookId);
+   bool remove(int userId, int bookId) override;
   
    
    /**
@@ -80,9 +103,10 @@ public:
     * @param user_id the id of the user doing the search.
     * @param searchTerm the string to search for.
     * @param searchType the type of search to do
+    * @param includeArchive true to also search books that have been archived.
     * @return std::vector< dw::Book > The list of books that match the search criteria.
     */
-   std::vector<Book> search(int user_id, SEARCH_TYPE searchType, std::string searchTerm);
+   std::vector<Book> search(int user_id, SEARCH_TYPE searchType, std::string searchTerm, bool includeArchive = false) override;
    
    /**
     * Store a new book object in the data store.
@@ -90,21 +114,50 @@ public:
     * @param book The book to store.
     * @return true if the book was stored, false otherwise.
     */
-   long store(const Book& book);
+   long store(const Book& book) override;
    
    /**
-    * Update a book object in the data store.
+    * Apply a partial update to a book. Only the columns set in the patch are written.
+    * An archived book is moved back to the main table first.
+    * 
+    * @param userId the id of the user who owns the book
+    * @param bookId the id of the book to update
+    * @param patch the fields to update.
+    * @return true if the book exists for the user and was updated, false otherwise.
+    */
+   bool patch(int userId, int bookId, const BookPatch& patch) override;
+   
+   /**
+    * Update a book object in the data store. An archived book is moved back to the
+    * main table first.
     * 
     * @param book the updated book object.
     * @return true if the book was successfully updated, false otherwise.
     */
-   bool update(const Book& book);
+   bool update(const Book& book) override;
   
 private:
    
+   /*-----------  Private Functions  ---------------*/
+   
+   /**
+    * Move a book from the archive back to the main table so it can be updated.
+    * 
+    * @return true if the book was archived and has been restored.
+    */
+   bool restoreArchived(int userId, int bookId);
+   
+   /**
+    * Get the connection to use for a user's books. A pooled connection is swapped for
+    * one to the user's shard if needed.
+    */
+   SQLite::Database& connection(int userId);
+   
    /*-----------  Private Data    ------------------*/
    
    SQLite::Database* mDb;
+   bool mIsPooledConnection;
+   unsigned int mShard;
    std::string mDbPath;
 
 };
@@ -0,0 +1,141 @@
+/**
+ * @class BookStore
+ * 
+ * Interface to the book data store. Controllers use this interface so the storage
+ * backend can be changed in config.cfg. BookRepository is the SQLite implementation and
+ * MemoryBookStore is the in-memory implementation.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef BOOKSTORE_H
+#define BOOKSTORE_H
+
+/*---------  Program Includes  ----------------*/
+#include "Book.h"
+#include "BookPatch.h"
+
+/*--------  System Includes  --------------*/
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dw {
+
+class BookStore
+{
+public:
+   
+   enum SEARCH_TYPE
+   {
+      AUTHOR,
+      BOTH,
+      TITLE
+   };
+   
+   /*-----------  Public Constants  ----------------*/
+   
+   /**
+    * The maximum number of ids that can be fetched with one call to getByIds. Keeps the
+    * number of bound parameters well below the SQLite limit.
+    */
+   static const std::size_t MAX_BATCH_IDS = 100;
+   
+   /*-----------  Public Functions  ----------------*/
+   
+   virtual ~BookStore() = default;
+   
+   /**
+    * Gets all stored books.
+    * 
+    * @param userId the user ID of the books to return
+    * @param includeArchive true to also return books that have been archived.
+    * @return std::vector<Book>
+    */
+   virtual std::vector<Book> getAll(int userId, bool includeArchive = false) = 0;
+   
+   /**
+    * Get the stored book object for the given id.
+    * @throws out_of_range exception if the book cannot be retrieved.
+    * 
+    * @param userId The id of the user requesting the book 
+    * @param bookId The id of the book to retrieve.
+    * @return The book data.
+    */
+   virtual Book getById(int userId, int bookId) = 0;
+   
+   /**
+    * Get the stored books for a list of ids. Ids that do not exist or do not belong to
+    * the user are not included in the result.
+    * @throws out_of_range exception if more than MAX_BATCH_IDS ids are requested.
+    * 
+    * @param userId The id of the user requesting the books
+    * @param bookIds The ids of the books to retrieve.
+    * @return The books found, in no particular order.
+    */
+   virtual std::vector<Book> getByIds(int userId, const std::vector<int>& bookIds) = 0;
+   
+   /**
+    * Check if a book exists for a user.
+    * 
+    * @param userId The id of the user who owns the book
+    * @param bookId The id of the book.
+    * @param includeArchive true to also look for the book in the archive.
+    * @return true if the book exists.
+    */
+   virtual bool exists(int userId, int bookId, bool includeArchive = true) = 0;
+   
+   /**
+    * Delete the book with the given id from the data store.
+    * 
+    * @param userId the id of the user who is requesting the delete
+    * @param bookId the id of the book to delete
+    * @return true if the book was removed, otherwise false.
+    */
+   virtual bool remove(int userId, int bookId) = 0;
+   
+   /**
+    * Search for books that match the search term in the author's name, book title or
+    * both, ignoring case. Only books that belong to the user are returned. See SearchTerm
+    * for the forms of term.
+    * 
+    * @param user_id the id of the user doing the search.
+    * @param searchType the type of search to do
+    * @param searchTerm the string to search for.
+    * @param includeArchive true to also search books that have been archived.
+    * @return std::vector< dw::Book > The list of books that match the search criteria.
+    * @throws std::invalid_argument if the search term is too long or has too many words.
+    */
+   virtual std::vector<Book> search(int user_id, SEARCH_TYPE searchType, std::string searchTerm, bool includeArchive = false) = 0;
+   
+   /**
+    * Store a new book object in the data store. Book ids are unique across all users.
+    * 
+    * @param book The book to store.
+    * @return the id of the new book, or 0 if it was not stored.
+    */
+   virtual long store(const Book& book) = 0;
+   
+   /**
+    * Apply a partial update to a book. Only the fields set in the patch are changed.
+    * 
+    * @param userId the id of the user who owns the book
+    * @param bookId the id of the book to update
+    * @param patch the fields to update.
+    * @return true if the book exists for the user and was updated, false otherwise.
+    */
+   virtual bool patch(int userId, int bookId, const BookPatch& patch) = 0;
+   
+   /**
+    * Update a book object in the data store.
+    * 
+    * @param book the updated book object.
+    * @return true if the book was successfully updated, false otherwise.
+    */
+   virtual bool update(const Book& book) = 0;
+};
+
+} // End namespace dw
+
+#endif // BOOKSTORE_H
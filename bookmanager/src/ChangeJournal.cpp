@@ -0,0 +1,478 @@
+/*---------  Program Includes  ----------------*/
+#include "ChangeJournal.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+
+/*---------  System Includes  -----------------*/
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const set<string> JOURNALED_TABLES = {"books", "users", "tokens"};
+
+// The last entry is found by reading back this far from the end of the journal.
+const streamoff JOURNAL_TAIL_BYTES = 64 * 1024;
+
+/******************************************************************************
+ * Name: isColumnName
+ * Description: Returns true if the name is safe to use as a column name.
+ ******************************************************************************
+ */
+static bool isColumnName(const string& name)
+{
+   return !name.empty() && all_of(name.begin(), name.end(), [](char c) { return (c >= 'a' && c <= 'z') || c == '_'; });
+}
+
+/******************************************************************************
+ * Name: checkTable
+ * Description: Throws if the table is not one that is journaled.
+ ******************************************************************************
+ */
+static void checkTable(const string& table)
+{
+   if(JOURNALED_TABLES.count(table) == 0) {
+      throw std::invalid_argument("Table is not journaled: " + table);
+   }
+}
+
+/******************************************************************************
+ * Name: whereClause
+ * Description: Build "column = ? AND ..." for the columns in a key.
+ ******************************************************************************
+ */
+static string whereClause(const nlohmann::json& key)
+{
+   if(!key.is_object() || key.empty()) {
+      throw std::invalid_argument("Invalid journal key.");
+   }
+
+   string clause = "";
+   for(auto column = key.begin(); column != key.end(); ++column) {
+      if(!isColumnName(column.key())) {
+         throw std::invalid_argument("Invalid journal column: " + column.key());
+      }
+      clause += (clause.empty() ? "" : " AND ") + column.key() + " = ?";
+   }
+
+   return clause;
+}
+
+/******************************************************************************
+ * Name: bindValue
+ * Description: Bind a JSON value to a statement parameter.
+ ******************************************************************************
+ */
+static void bindValue(SQLite::Statement& query, int index, const nlohmann::json& value)
+{
+   if(value.is_null()) {
+      query.bind(index);
+   } else if(value.is_boolean()) {
+      query.bind(index, value.get<bool>() ? 1 : 0);
+   } else if(value.is_number_integer()) {
+      query.bind(index, value.get<long long>());
+   } else if(value.is_number()) {
+      query.bind(index, value.get<double>());
+   } else if(value.is_string()) {
+      query.bind(index, value.get<string>());
+   } else {
+      throw std::invalid_argument("Invalid journal value: " + value.dump());
+   }
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+ChangeJournal::ChangeJournal()
+             : mPath(""), mSequence(-1)
+{
+   try {
+      mPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::JOURNAL_PATH);
+   }
+   catch(exception& e) {
+      mPath = "";
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "ChangeJournal", "Constructor. Journal path is &.", mPath);
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+ChangeJournal::~ChangeJournal()
+{
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the change journal.
+ ******************************************************************************
+ */
+ChangeJournal& ChangeJournal::instance()
+{
+   static ChangeJournal mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: isEnabled
+ * Description: Returns true if journaling is configured.
+ ******************************************************************************
+ */
+bool ChangeJournal::isEnabled() const
+{
+   return !mPath.empty();
+}
+
+/******************************************************************************
+ * Name: configure
+ * Description: Set the journal file.
+ ******************************************************************************
+ */
+void ChangeJournal::configure(const std::string& path)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   if(mFile.is_open()) {
+      mFile.close();
+   }
+
+   mPath = path;
+   mSequence = -1;
+   mPending.clear();
+   mCommitted.clear();
+}
+
+/******************************************************************************
+ * Name: lastSequence
+ * Description: Returns the sequence number of the last entry written.
+ ******************************************************************************
+ */
+long ChangeJournal::lastSequence()
+{
+   lock_guard<mutex> lock(mMutex);
+
+   if(!isEnabled()) {
+      return 0;
+   }
+
+   open();
+
+   return mSequence;
+}
+
+/******************************************************************************
+ * Name: recordUpsert
+ * Description: Record the current contents of a changed row.
+ ******************************************************************************
+ */
+void ChangeJournal::recordUpsert(SQLite::Database& db, const std::string& table, const nlohmann::json& key)
+{
+   if(!isEnabled()) {
+      return;
+   }
+
+   checkTable(table);
+
+   SQLite::Statement query(db, "SELECT * FROM " + table + " WHERE " + whereClause(key));
+   int index = 1;
+   for(auto& value : key) {
+      bindValue(query, index++, value);
+   }
+
+   // The row is read under the lock, so entries for the same row are written in the
+   // order their contents were read.
+   lock_guard<mutex> lock(mMutex);
+
+   if(!query.executeStep()) {
+      return;
+   }
+
+   nlohmann::json row = nlohmann::json::object();
+   for(int column = 0; column < query.getColumnCount(); ++column) {
+      SQLite::Column value = query.getColumn(column);
+      switch(value.getType()) {
+         case SQLITE_INTEGER:
+            row[value.getName()] = value.getInt64();
+            break;
+
+         case SQLITE_FLOAT:
+            row[value.getName()] = value.getDouble();
+            break;
+
+         case SQLITE_NULL:
+            row[value.getName()] = nullptr;
+            break;
+
+         default:
+            row[value.getName()] = value.getString();
+            break;
+      }
+   }
+
+   nlohmann::json entry;
+   entry["table"] = table;
+   entry["op"] = "upsert";
+   entry["row"] = row;
+
+   record(db, entry);
+}
+
+/******************************************************************************
+ * Name: recordDelete
+ * Description: Record that a row was deleted.
+ ******************************************************************************
+ */
+void ChangeJournal::recordDelete(SQLite::Database& db, const std::string& table, const nlohmann::json& key)
+{
+   if(!isEnabled()) {
+      return;
+   }
+
+   checkTable(table);
+   whereClause(key);
+
+   nlohmann::json entry;
+   entry["table"] = table;
+   entry["op"] = "delete";
+   entry["key"] = key;
+
+   lock_guard<mutex> lock(mMutex);
+   record(db, entry);
+}
+
+/******************************************************************************
+ * Name: writeCommitted
+ * Description: Append the entries of a connection's committed transaction.
+ ******************************************************************************
+ */
+void ChangeJournal::writeCommitted(SQLite::Database& db)
+{
+   if(!isEnabled()) {
+      return;
+   }
+
+   sqlite3* handle = db.getHandle();
+
+   lock_guard<mutex> lock(mMutex);
+
+   // A COMMIT that failed leaves the transaction open, and its entries are kept until
+   // it is committed again or rolled back.
+   if(sqlite3_get_autocommit(handle)) {
+      writeCommitted(handle);
+   }
+}
+
+/******************************************************************************
+ * Name: apply
+ * Description: Apply one journal entry to a database.
+ ******************************************************************************
+ */
+void ChangeJournal::apply(SQLite::Database& db, const nlohmann::json& entry)
+{
+   if(!entry.is_object() || entry.count("table") == 0 || entry.count("op") == 0 ||
+      !entry.at("table").is_string() || !entry.at("op").is_string()) {
+      throw std::invalid_argument("Invalid journal entry.");
+   }
+
+   string table = entry.at("table");
+   string op = entry.at("op");
+   checkTable(table);
+
+   if(op == "upsert") {
+      const nlohmann::json& row = entry.count("row") ? entry.at("row") : nlohmann::json();
+      if(!row.is_object() || row.empty()) {
+         throw std::invalid_argument("Invalid journal row.");
+      }
+
+      string columns = "";
+      string values = "";
+      for(auto column = row.begin(); column != row.end(); ++column) {
+         if(!isColumnName(column.key())) {
+            throw std::invalid_argument("Invalid journal column: " + column.key());
+         }
+         columns += (columns.empty() ? "" : ", ") + column.key();
+         values += values.empty() ? "?" : ", ?";
+      }
+
+      SQLite::Statement query(db, "INSERT OR REPLACE INTO " + table + " (" + columns + ") VALUES (" + values + ")");
+      int index = 1;
+      for(auto& value : row) {
+         bindValue(query, index++, value);
+      }
+      query.exec();
+   } else if(op == "delete") {
+      const nlohmann::json& key = entry.count("key") ? entry.at("key") : nlohmann::json();
+
+      SQLite::Statement query(db, "DELETE FROM " + table + " WHERE " + whereClause(key));
+      int index = 1;
+      for(auto& value : key) {
+         bindValue(query, index++, value);
+      }
+      query.exec();
+   } else {
+      throw std::invalid_argument("Invalid journal operation: " + op);
+   }
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: record
+ * Description: Write the entry now, or when the connection's transaction commits.
+ ******************************************************************************
+ */
+void ChangeJournal::record(SQLite::Database& db, nlohmann::json& entry)
+{
+   sqlite3* handle = db.getHandle();
+
+   if(sqlite3_get_autocommit(handle)) {
+      // Entries of an earlier transaction whose caller did not write them go first.
+      writeCommitted(handle);
+
+      vector<nlohmann::json> entries = {entry};
+      write(entries);
+      return;
+   }
+
+   // Nothing else may set the hooks, since SQLite keeps only one of each. Replacing a
+   // hook returns its argument, which is the handle if the journal set it before.
+   void* commitArgument = sqlite3_commit_hook(handle, &ChangeJournal::onCommit, handle);
+   void* rollbackArgument = sqlite3_rollback_hook(handle, &ChangeJournal::onRollback, handle);
+   assert(commitArgument == nullptr || commitArgument == handle);
+   assert(rollbackArgument == nullptr || rollbackArgument == handle);
+   (void)commitArgument;
+   (void)rollbackArgument;
+
+   mPending[handle].push_back(entry);
+}
+
+/******************************************************************************
+ * Name: writeCommitted
+ * Description: Append the entries held for a connection that has committed.
+ ******************************************************************************
+ */
+void ChangeJournal::writeCommitted(sqlite3* handle)
+{
+   auto committed = mCommitted.find(handle);
+   if(committed == mCommitted.end()) {
+      return;
+   }
+
+   try {
+      write(committed->second);
+   }
+   catch(exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "ChangeJournal", "writeCommitted(). ERROR Exception: &.", e.what());
+   }
+   mCommitted.erase(committed);
+}
+
+/******************************************************************************
+ * Name: write
+ * Description: Number the entries and append them to the journal.
+ ******************************************************************************
+ */
+void ChangeJournal::write(std::vector<nlohmann::json>& entries)
+{
+   open();
+
+   for(auto& entry : entries) {
+      entry["seq"] = ++mSequence;
+      mFile << entry.dump() << '\n';
+   }
+   mFile.flush();
+
+   if(!mFile) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "ChangeJournal", "write(). ERROR writing to &.", mPath);
+   }
+}
+
+/******************************************************************************
+ * Name: open
+ * Description: Open the journal and find the last sequence number.
+ ******************************************************************************
+ */
+void ChangeJournal::open()
+{
+   if(mFile.is_open()) {
+      return;
+   }
+
+   mSequence = 0;
+
+   ifstream journal(mPath, ios::binary|ios::ate);
+   if(journal.is_open()) {
+      streamoff size = journal.tellg();
+      journal.seekg(max<streamoff>(0, size - JOURNAL_TAIL_BYTES));
+
+      string line;
+      while(getline(journal, line)) {
+         try {
+            if(!journal.eof()) {
+               mSequence = nlohmann::json::parse(line).at("seq").get<long>();
+            }
+         }
+         catch(exception& e) {
+            // The first line read may start part way through an entry.
+         }
+      }
+   }
+
+   mFile.open(mPath, ios::app);
+   if(!mFile.is_open()) {
+      throw std::runtime_error("Could not open journal " + mPath);
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "ChangeJournal", "open(). Last sequence is &.", mSequence);
+}
+
+/******************************************************************************
+ * Name: onCommit
+ * Description: Hold the entries of a connection that is committing until COMMIT
+ *              returns. The commit is not durable yet, and may still fail.
+ ******************************************************************************
+ */
+int ChangeJournal::onCommit(void* handle)
+{
+   ChangeJournal& journal = instance();
+   lock_guard<mutex> lock(journal.mMutex);
+
+   auto pending = journal.mPending.find(static_cast<sqlite3*>(handle));
+   if(pending != journal.mPending.end()) {
+      vector<nlohmann::json>& committed = journal.mCommitted[pending->first];
+      committed.insert(committed.end(), pending->second.begin(), pending->second.end());
+      journal.mPending.erase(pending);
+   }
+
+   // Returning 0 lets the commit go ahead.
+   return 0;
+}
+
+/******************************************************************************
+ * Name: onRollback
+ * Description: Drop the entries held for a connection when it rolls back.
+ ******************************************************************************
+ */
+void ChangeJournal::onRollback(void* handle)
+{
+   ChangeJournal& journal = instance();
+   lock_guard<mutex> lock(journal.mMutex);
+
+   // Committed entries that are still held belong to a COMMIT that failed.
+   journal.mPending.erase(static_cast<sqlite3*>(handle));
+   journal.mCommitted.erase(static_cast<sqlite3*>(handle));
+}
+
+} // End namespace dw
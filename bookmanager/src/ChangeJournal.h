@@ -0,0 +1,163 @@
+/**
+ * @class ChangeJournal
+ *
+ * Singleton class that appends every change made to the books, users and tokens tables
+ * to a sequenced journal file, JOURNAL_PATH, so read replicas can apply the same changes
+ * to their own copy of the database. Journaling is disabled if JOURNAL_PATH is not set.
+ *
+ * Each line of the journal is one JSON entry:
+ * {"seq":[int],"table":"[string]","op":"upsert","row":{[column]:[value],...}}
+ * {"seq":[int],"table":"[string]","op":"delete","key":{[column]:[value],...}}
+ *
+ * An upsert holds the whole row as it was after the change, so entries can be applied
+ * more than once and a replica converges on the same data however far back it starts.
+ *
+ * Changes made inside a transaction are held until the transaction commits, and dropped
+ * if it rolls back, so the journal only ever holds committed changes. They are appended
+ * by writeCommitted(), which the code that commits calls once COMMIT has returned, so
+ * an entry is never written for a commit that failed.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef CHANGEJOURNAL_H
+#define CHANGEJOURNAL_H
+
+/*---------  System Includes  -----------------*/
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+struct sqlite3;
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+
+class ChangeJournal
+{
+public:
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the change journal.
+    *
+    * @return dw::ChangeJournal&
+    */
+   static ChangeJournal& instance();
+
+   /**
+    * Disable copying
+    */
+   ChangeJournal(const ChangeJournal& rhs) = delete;
+   void operator=(const ChangeJournal& rhs) = delete;
+
+   /**
+    * Returns true if journaling is configured.
+    */
+   bool isEnabled() const;
+
+   /**
+    * Set the journal file. An empty path disables journaling. Must be called before any
+    * changes are recorded.
+    *
+    * @param path the journal file.
+    */
+   void configure(const std::string& path);
+
+   /**
+    * Returns the sequence number of the last entry written to the journal.
+    */
+   long lastSequence();
+
+   /**
+    * Record the current contents of a row after it was inserted or updated. Nothing is
+    * recorded if the row does not exist.
+    *
+    * @param db the connection that made the change.
+    * @param table the table that was changed.
+    * @param key the columns and values that identify the row.
+    */
+   void recordUpsert(SQLite::Database& db, const std::string& table, const nlohmann::json& key);
+
+   /**
+    * Record that a row was deleted.
+    *
+    * @param db the connection that made the change.
+    * @param table the table that was changed.
+    * @param key the columns and values that identify the row.
+    */
+   void recordDelete(SQLite::Database& db, const std::string& table, const nlohmann::json& key);
+
+   /**
+    * Append the changes held for a connection's transaction once it has committed. Call
+    * it after every commit of a transaction that may have recorded changes.
+    *
+    * @param db the connection that committed.
+    */
+   void writeCommitted(SQLite::Database& db);
+
+   /**
+    * Apply one journal entry to a database.
+    *
+    * @param db the database to change.
+    * @param entry the journal entry.
+    * @throws std::invalid_argument if the entry is not valid.
+    */
+   static void apply(SQLite::Database& db, const nlohmann::json& entry);
+
+private:
+
+   /*---------  Private Functions  ---------------*/
+
+   ChangeJournal();
+   ~ChangeJournal();
+
+   /**
+    * Write the entry now, or hold it until the connection's transaction commits.
+    * mMutex must be held.
+    */
+   void record(SQLite::Database& db, nlohmann::json& entry);
+
+   /**
+    * Append the entries held for a connection that has committed. mMutex must be held.
+    */
+   void writeCommitted(sqlite3* handle);
+
+   /**
+    * Number the entries and append them to the journal. mMutex must be held.
+    */
+   void write(std::vector<nlohmann::json>& entries);
+
+   /**
+    * Open the journal file and find the last sequence number. mMutex must be held.
+    */
+   void open();
+
+   /**
+    * SQLite commit and rollback hooks for connections that have recorded changes in a
+    * transaction.
+    */
+   static int onCommit(void* handle);
+   static void onRollback(void* handle);
+
+   /*---------  Private Data  --------------------*/
+
+   std::mutex mMutex;
+   std::string mPath;
+   std::ofstream mFile;
+   long mSequence;
+   std::map<sqlite3*, std::vector<nlohmann::json>> mPending;
+   std::map<sqlite3*, std::vector<nlohmann::json>> mCommitted;
+};
+
+} // End namespace dw
+
+#endif // CHANGEJOURNAL_H
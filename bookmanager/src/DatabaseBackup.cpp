@@ -0,0 +1,368 @@
+/*---------  Program Includes  ----------------*/
+#include "DatabaseBackup.h"
+#include "BookArchive.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "dbConnect.h"
+
+/*---------  System Includes  -----------------*/
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const std::chrono::milliseconds PAUSE_BETWEEN_STEPS(10);
+const std::chrono::milliseconds PAUSE_WHEN_BUSY(100);
+const string TEMP_SUFFIX = ".tmp";
+
+/******************************************************************************
+ * Name: fileName
+ * Description: Returns the last component of a path.
+ ******************************************************************************
+ */
+static string fileName(const string& path)
+{
+   size_t index = path.find_last_of('/');
+
+   return index == string::npos ? path : path.substr(index + 1);
+}
+
+/******************************************************************************
+ * Name: fileExists
+ * Description: Returns true if the file can be opened.
+ ******************************************************************************
+ */
+static bool fileExists(const string& path)
+{
+   ifstream file(path);
+
+   return file.good();
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+DatabaseBackup::DatabaseBackup()
+              : mIsRunning(false), mIsRequested(false), mIsBackingUp(false),
+                mIsCancelled(false), mDirectory(""), mIntervalMinutes(0)
+{
+   try {
+      mDirectory = ConfigReader::getInstance().getConfig(ConfigReader::Config::BACKUP_DIR);
+   }
+   catch(exception& e) {
+      mDirectory = "";
+   }
+
+   mIntervalMinutes = ConfigReader::getInstance().getInt(ConfigReader::Config::BACKUP_INTERVAL_MINUTES);
+
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseBackup", "Constructor. Backup directory is &.", mDirectory);
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+DatabaseBackup::~DatabaseBackup()
+{
+   if(mThread.joinable()) {
+      mIsCancelled = true;
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the database backup.
+ ******************************************************************************
+ */
+DatabaseBackup& DatabaseBackup::instance()
+{
+   static DatabaseBackup mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: isEnabled
+ * Description: Returns true if backups are configured.
+ ******************************************************************************
+ */
+bool DatabaseBackup::isEnabled() const
+{
+   return !mDirectory.empty();
+}
+
+/******************************************************************************
+ * Name: isRunning
+ * Description: Returns true while the background thread is running.
+ ******************************************************************************
+ */
+bool DatabaseBackup::isRunning() const
+{
+   return mIsRunning;
+}
+
+/******************************************************************************
+ * Name: isBackingUp
+ * Description: Returns true while a backup is being written.
+ ******************************************************************************
+ */
+bool DatabaseBackup::isBackingUp() const
+{
+   return mIsBackingUp;
+}
+
+/******************************************************************************
+ * Name: configure
+ * Description: Set the backup directory and schedule.
+ ******************************************************************************
+ */
+void DatabaseBackup::configure(const std::string& directory, int intervalMinutes)
+{
+   mDirectory = directory;
+   mIntervalMinutes = intervalMinutes;
+}
+
+/******************************************************************************
+ * Name: backupNow
+ * Description: Write a snapshot of all of the database files.
+ ******************************************************************************
+ */
+std::string DatabaseBackup::backupNow()
+{
+   if(!isEnabled()) {
+      throw std::runtime_error("Backups are not configured.");
+   }
+
+   bool isIdle = false;
+   if(!mIsBackingUp.compare_exchange_strong(isIdle, true)) {
+      throw std::runtime_error("A backup is already running.");
+   }
+
+   string snapshot = "";
+   try {
+      snapshot = writeSnapshot();
+   }
+   catch(exception& e) {
+      mIsBackingUp = false;
+      throw;
+   }
+
+   mIsBackingUp = false;
+
+   return snapshot;
+}
+
+/******************************************************************************
+ * Name: requestBackup
+ * Description: Ask the background thread to write a snapshot.
+ ******************************************************************************
+ */
+bool DatabaseBackup::requestBackup()
+{
+   if(!mIsRunning || mIsBackingUp) {
+      return false;
+   }
+
+   bool isRequested = false;
+   if(!mIsRequested.compare_exchange_strong(isRequested, true)) {
+      return false;
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseBackup", "requestBackup().");
+
+   unique_lock<mutex> lock(mMutex);
+   mWakeUp.notify_all();
+
+   return true;
+}
+
+/******************************************************************************
+ * Name: start
+ * Description: Start the background backup thread.
+ ******************************************************************************
+ */
+void DatabaseBackup::start()
+{
+   if(mIsRunning || !isEnabled()) {
+      return;
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseBackup", "start().");
+
+   mIsCancelled = false;
+   mIsRunning = true;
+   mThread = std::thread(&DatabaseBackup::run, this);
+}
+
+/******************************************************************************
+ * Name: stop
+ * Description: Stop the background backup thread.
+ ******************************************************************************
+ */
+void DatabaseBackup::stop()
+{
+   if(mThread.joinable()) {
+      Logger::instance().log(Logger::LogLevel::INFO, "DatabaseBackup", "stop().");
+
+      mIsCancelled = true;
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: copyDatabase
+ * Description: Copy one database file with the online backup API.
+ ******************************************************************************
+ */
+void DatabaseBackup::copyDatabase(const std::string& sourcePath, const std::string& destinationPath)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseBackup", "copyDatabase(). Copying & to &.", sourcePath, destinationPath);
+
+   string tempPath = destinationPath + TEMP_SUFFIX;
+   remove(tempPath.c_str());
+
+   try {
+      SQLite::Database source(sourcePath, SQLite::OPEN_READONLY);
+      SQLite::Database destination(tempPath, SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+      SQLite::Backup backup(destination, "main", source, "main");
+
+      // The source is only locked while a step runs. A busy source is retried after a pause.
+      // A write from another connection restarts the copy, which shows as more pages left
+      // than before the step. After MAX_RESTARTS the rest is copied in one step, which
+      // holds a read lock on the source until it is done, so it cannot restart again.
+      int result = SQLITE_OK;
+      int numRestarts = 0;
+      int remainingPages = -1;
+      while(result != SQLITE_DONE) {
+         if(mIsCancelled) {
+            throw std::runtime_error("Backup cancelled.");
+         }
+
+         bool isWholeCopy = numRestarts >= MAX_RESTARTS;
+         result = backup.executeStep(isWholeCopy ? -1 : PAGES_PER_STEP);
+
+         if(remainingPages >= 0 && backup.getRemainingPageCount() > remainingPages) {
+            ++numRestarts;
+            Logger::instance().log(Logger::LogLevel::DEBUG, "DatabaseBackup", "copyDatabase(). Copy of & restarted & times.", sourcePath, numRestarts);
+         }
+         remainingPages = backup.getRemainingPageCount();
+
+         if(result == SQLITE_BUSY || result == SQLITE_LOCKED) {
+            this_thread::sleep_for(PAUSE_WHEN_BUSY);
+         } else if(result != SQLITE_DONE) {
+            this_thread::sleep_for(PAUSE_BETWEEN_STEPS);
+         }
+      }
+   }
+   catch(exception& e) {
+      remove(tempPath.c_str());
+      throw;
+   }
+
+   if(rename(tempPath.c_str(), destinationPath.c_str()) != 0) {
+      remove(tempPath.c_str());
+      throw std::runtime_error("Could not rename " + tempPath);
+   }
+}
+
+/******************************************************************************
+ * Name: writeSnapshot
+ * Description: Create the snapshot directory and copy the database files into it.
+ ******************************************************************************
+ */
+std::string DatabaseBackup::writeSnapshot()
+{
+   char timestamp[32];
+   time_t now = time(nullptr);
+   tm localTimestamp;
+   localtime_r(&now, &localTimestamp);
+   strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &localTimestamp);
+
+   if(mkdir(mDirectory.c_str(), 0755) != 0 && errno != EEXIST) {
+      throw std::runtime_error("Could not create " + mDirectory);
+   }
+
+   // A second snapshot in the same second gets a numbered suffix.
+   string snapshot = mDirectory + "/backup-" + timestamp;
+   for(int number = 2; mkdir(snapshot.c_str(), 0755) != 0; ++number) {
+      if(errno != EEXIST || number > MAX_SNAPSHOTS_PER_SECOND) {
+         throw std::runtime_error("Could not create " + snapshot);
+      }
+      snapshot = mDirectory + "/backup-" + timestamp + "-" + to_string(number);
+   }
+
+   vector<string> sources;
+   for(unsigned int shard = 0; shard < db_numShards(); ++shard) {
+      sources.push_back(db_shardPath(shard));
+   }
+
+   if(BookArchive::instance().isEnabled() && fileExists(BookArchive::instance().path())) {
+      sources.push_back(BookArchive::instance().path());
+   }
+
+   auto startTime = std::chrono::steady_clock::now();
+
+   for(const string& source : sources) {
+      copyDatabase(source, snapshot + "/" + fileName(source));
+   }
+
+   auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseBackup", "writeSnapshot(). Wrote & in & ms.", snapshot, to_string(elapsed.count()));
+
+   return snapshot;
+}
+
+/******************************************************************************
+ * Name: run
+ * Description: Background thread. Wait for the schedule or a request, then back up.
+ ******************************************************************************
+ */
+void DatabaseBackup::run()
+{
+   while(mIsRunning) {
+      {
+         unique_lock<mutex> lock(mMutex);
+         auto isWoken = [this] { return !mIsRunning || mIsRequested; };
+
+         if(mIntervalMinutes > 0) {
+            mWakeUp.wait_for(lock, std::chrono::minutes(mIntervalMinutes), isWoken);
+         } else {
+            mWakeUp.wait(lock, isWoken);
+         }
+      }
+
+      if(!mIsRunning) {
+         break;
+      }
+
+      try {
+         backupNow();
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "DatabaseBackup", "run(). ERROR Exception: &.", e.what());
+      }
+
+      mIsRequested = false;
+   }
+}
+
+} // End namespace dw
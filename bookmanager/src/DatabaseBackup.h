@@ -0,0 +1,167 @@
+/**
+ * @class DatabaseBackup
+ *
+ * Singleton class that writes consistent snapshots of the database files while the server
+ * is running. Each snapshot is a directory BACKUP_DIR/backup-YYYYMMDD-HHMMSS holding a copy
+ * of every shard and of the archive database. Backups are disabled if BACKUP_DIR is not set.
+ *
+ * A background thread takes a snapshot every BACKUP_INTERVAL_MINUTES minutes, or when one
+ * is requested through the admin endpoint. Pages are copied with the SQLite online backup
+ * API a few at a time, with a pause between steps, so the source database is only locked
+ * for a few milliseconds at a time. If another connection writes to the source during the
+ * copy, SQLite restarts the copy, so each file is always a consistent snapshot. A copy
+ * restarted MAX_RESTARTS times is finished in a single step, which holds a read lock on
+ * the source until it is done.
+ *
+ * A snapshot written in the same second as another has a numbered suffix, such as
+ * backup-YYYYMMDD-HHMMSS-2.
+ *
+ * Files are written with a ".tmp" suffix and renamed once they are complete.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef DATABASEBACKUP_H
+#define DATABASEBACKUP_H
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace dw {
+
+class DatabaseBackup
+{
+public:
+
+   /*---------  Public Constants  ----------------*/
+
+   /**
+    * The number of pages copied in each backup step.
+    */
+   static const int PAGES_PER_STEP = 64;
+
+   /**
+    * The number of times a copy is restarted by writes before the rest of it is copied
+    * in one step.
+    */
+   static const int MAX_RESTARTS = 3;
+
+   /**
+    * The most snapshots written in the same second.
+    */
+   static const int MAX_SNAPSHOTS_PER_SECOND = 100;
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the database backup.
+    *
+    * @return dw::DatabaseBackup&
+    */
+   static DatabaseBackup& instance();
+
+   /**
+    * Disable copying
+    */
+   DatabaseBackup(const DatabaseBackup& rhs) = delete;
+   void operator=(const DatabaseBackup& rhs) = delete;
+
+   /**
+    * Returns true if backups are configured.
+    */
+   bool isEnabled() const;
+
+   /**
+    * Returns true while the background thread is running.
+    */
+   bool isRunning() const;
+
+   /**
+    * Returns true while a backup is being written.
+    */
+   bool isBackingUp() const;
+
+   /**
+    * Set the backup directory and schedule. An empty directory disables backups. Must be
+    * called before the thread is started.
+    *
+    * @param directory the directory snapshots are written to.
+    * @param intervalMinutes minutes between scheduled backups. 0 only backs up on request.
+    */
+   void configure(const std::string& directory, int intervalMinutes);
+
+   /**
+    * Write a snapshot of all of the database files on the calling thread.
+    *
+    * @return the snapshot directory.
+    * @throws std::runtime_error if backups are disabled, one is already running, or the
+    *         snapshot could not be written.
+    */
+   std::string backupNow();
+
+   /**
+    * Ask the background thread to write a snapshot.
+    *
+    * @return false if backups are disabled, the thread is not running, or a backup is
+    *         already requested or running.
+    */
+   bool requestBackup();
+
+   /**
+    * Start the background backup thread.
+    */
+   void start();
+
+   /**
+    * Stop the background thread. A backup in progress is abandoned.
+    */
+   void stop();
+
+private:
+
+   /*---------  Private Functions  ---------------*/
+
+   DatabaseBackup();
+   ~DatabaseBackup();
+
+   /**
+    * Copy one database file with the online backup API.
+    *
+    * @param sourcePath the database to copy.
+    * @param destinationPath the file to write.
+    */
+   void copyDatabase(const std::string& sourcePath, const std::string& destinationPath);
+
+   /**
+    * Create the snapshot directory and copy each of the database files into it.
+    *
+    * @return the snapshot directory.
+    */
+   std::string writeSnapshot();
+
+   /**
+    * Background thread. Waits for the schedule or a request, then writes a snapshot.
+    */
+   void run();
+
+   /*---------  Private Data  --------------------*/
+
+   std::mutex mMutex;
+   std::condition_variable mWakeUp;
+   std::thread mThread;
+   std::atomic<bool> mIsRunning;
+   std::atomic<bool> mIsRequested;
+   std::atomic<bool> mIsBackingUp;
+   std::atomic<bool> mIsCancelled;
+   std::string mDirectory;
+   int mIntervalMinutes;
+};
+
+} // End namespace dw
+
+#endif // DATABASEBACKUP_H
@@ -0,0 +1,380 @@
+/*---------  Program Includes  ----------------*/
+#include "DatabaseMaintenance.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "dbConnect.h"
+
+/*---------  System Includes  -----------------*/
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const std::size_t DatabaseMaintenance::HISTORY_SIZE;
+
+const std::chrono::minutes CHECK_INTERVAL(1);
+const int MAINTENANCE_BUSY_TIMEOUT_MS = 1000;
+
+// The progress handler is called after this many virtual machine steps.
+const int PROGRESS_STEPS = 1000;
+
+// ANALYZE looks at about this many rows of each index.
+const int ANALYSIS_LIMIT = 1000;
+
+const int VACUUM_PAGES_PER_STEP = 100;
+const int AUTO_VACUUM_INCREMENTAL = 2;
+
+const vector<DatabaseMaintenance::Operation> OPERATIONS = {
+   DatabaseMaintenance::Operation::CHECKPOINT,
+   DatabaseMaintenance::Operation::OPTIMIZE,
+   DatabaseMaintenance::Operation::INCREMENTAL_VACUUM,
+   DatabaseMaintenance::Operation::ANALYZE
+};
+
+/******************************************************************************
+ * Name: operationInterval
+ * Description: The time between runs of an operation.
+ ******************************************************************************
+ */
+static std::chrono::minutes operationInterval(DatabaseMaintenance::Operation operation)
+{
+   switch(operation) {
+      case DatabaseMaintenance::Operation::CHECKPOINT:
+         return std::chrono::minutes(10);
+
+      case DatabaseMaintenance::Operation::OPTIMIZE:
+         return std::chrono::minutes(60);
+
+      default:
+         return std::chrono::minutes(24 * 60);
+   }
+}
+
+/******************************************************************************
+ * Name: operationBudget
+ * Description: The longest an operation may run on one shard.
+ ******************************************************************************
+ */
+static std::chrono::milliseconds operationBudget(DatabaseMaintenance::Operation operation)
+{
+   switch(operation) {
+      case DatabaseMaintenance::Operation::OPTIMIZE:
+         return std::chrono::milliseconds(500);
+
+      case DatabaseMaintenance::Operation::ANALYZE:
+         return std::chrono::milliseconds(5000);
+
+      case DatabaseMaintenance::Operation::INCREMENTAL_VACUUM:
+         return std::chrono::milliseconds(2000);
+
+      default:
+         return std::chrono::milliseconds(1000);
+   }
+}
+
+/******************************************************************************
+ * Name: onProgress
+ * Description: SQLite progress handler. Interrupts the statement once the
+ *              deadline has passed.
+ ******************************************************************************
+ */
+static int onProgress(void* deadline)
+{
+   return std::chrono::steady_clock::now() > *static_cast<std::chrono::steady_clock::time_point*>(deadline) ? 1 : 0;
+}
+
+/******************************************************************************
+ * Name: freePages
+ * Description: The number of unused pages in the database file.
+ ******************************************************************************
+ */
+static long freePages(SQLite::Database& db)
+{
+   return db.execAndGet("PRAGMA freelist_count").getInt64();
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+DatabaseMaintenance::DatabaseMaintenance()
+                   : mIsRunning(false),
+                     mIdleRequests(ConfigReader::getInstance().getInt(ConfigReader::Config::MAINTENANCE_IDLE_REQUESTS))
+{
+
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "Constructor. Idle requests per minute &.", to_string(mIdleRequests));
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+DatabaseMaintenance::~DatabaseMaintenance()
+{
+   if(mThread.joinable()) {
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the database maintenance.
+ ******************************************************************************
+ */
+DatabaseMaintenance& DatabaseMaintenance::instance()
+{
+   static DatabaseMaintenance mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: operationName
+ * Description: Returns the name of an operation.
+ ******************************************************************************
+ */
+std::string DatabaseMaintenance::operationName(Operation operation)
+{
+   switch(operation) {
+      case Operation::OPTIMIZE:
+         return "optimize";
+
+      case Operation::ANALYZE:
+         return "analyze";
+
+      case Operation::INCREMENTAL_VACUUM:
+         return "incremental_vacuum";
+
+      case Operation::CHECKPOINT:
+         return "checkpoint";
+   }
+
+   return "";
+}
+
+/******************************************************************************
+ * Name: enableIncrementalVacuum
+ * Description: Switch a database to auto_vacuum=INCREMENTAL.
+ ******************************************************************************
+ */
+void DatabaseMaintenance::enableIncrementalVacuum(SQLite::Database& db)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "enableIncrementalVacuum(). Database &.", db.getFilename());
+
+   // The setting only takes effect on an existing database once it has been rebuilt.
+   db.exec("PRAGMA auto_vacuum = INCREMENTAL");
+   db.exec("VACUUM");
+}
+
+/******************************************************************************
+ * Name: retryDelay
+ * Description: The time to wait before trying an interrupted operation again.
+ ******************************************************************************
+ */
+std::chrono::minutes DatabaseMaintenance::retryDelay(Operation operation, int numInterrupted)
+{
+   std::chrono::minutes interval = operationInterval(operation);
+   std::chrono::minutes delay = CHECK_INTERVAL;
+
+   for(int i = 1; i < numInterrupted && delay < interval; ++i) {
+      delay *= 2;
+   }
+
+   return delay < interval ? delay : interval;
+}
+
+/******************************************************************************
+ * Name: runOperation
+ * Description: Run one operation within its time budget.
+ ******************************************************************************
+ */
+DatabaseMaintenance::Run DatabaseMaintenance::runOperation(SQLite::Database& db, unsigned int shard, Operation operation)
+{
+   Run result = {operation, shard, 0, 0, true};
+
+   auto startTime = std::chrono::steady_clock::now();
+   auto deadline = startTime + operationBudget(operation);
+   sqlite3_progress_handler(db.getHandle(), PROGRESS_STEPS, &onProgress, &deadline);
+
+   try {
+      switch(operation) {
+         case Operation::OPTIMIZE:
+            db.exec("PRAGMA optimize");
+            break;
+
+         case Operation::ANALYZE:
+            db.exec("PRAGMA analysis_limit = " + to_string(ANALYSIS_LIMIT));
+            db.exec("ANALYZE");
+            break;
+
+         case Operation::INCREMENTAL_VACUUM:
+            if(db.execAndGet("PRAGMA auto_vacuum").getInt() == AUTO_VACUUM_INCREMENTAL) {
+               long startPages = freePages(db);
+               long pages = startPages;
+
+               // Small steps, so each write transaction is short.
+               while(pages > 0 && std::chrono::steady_clock::now() < deadline) {
+                  db.exec("PRAGMA incremental_vacuum(" + to_string(VACUUM_PAGES_PER_STEP) + ")");
+                  pages = freePages(db);
+               }
+
+               result.pagesReclaimed = startPages - pages;
+               result.isComplete = pages == 0;
+            }
+            break;
+
+         case Operation::CHECKPOINT:
+            if(db.execAndGet("PRAGMA journal_mode").getString() == "wal") {
+               SQLite::Statement checkpoint(db, "PRAGMA wal_checkpoint(TRUNCATE)");
+               if(checkpoint.executeStep()) {
+                  // Columns are: busy, frames in the log, frames checkpointed.
+                  result.isComplete = checkpoint.getColumn(0).getInt() == 0;
+                  result.pagesReclaimed = checkpoint.getColumn(2).getInt();
+               }
+            }
+            break;
+      }
+   }
+   catch(exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "DatabaseMaintenance", "runOperation(). & stopped: &.", operationName(operation), string(e.what()));
+      result.isComplete = false;
+   }
+
+   sqlite3_progress_handler(db.getHandle(), 0, nullptr, nullptr);
+
+   result.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "runOperation(). & on shard & took & ms.",
+                          operationName(operation), to_string(shard), to_string(result.durationMs));
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "runOperation(). Pages reclaimed &. Complete &.",
+                          to_string(result.pagesReclaimed), string(result.isComplete ? "true" : "false"));
+
+   lock_guard<mutex> lock(mMutex);
+   mHistory.push_back(result);
+   if(mHistory.size() > HISTORY_SIZE) {
+      mHistory.pop_front();
+   }
+
+   return result;
+}
+
+/******************************************************************************
+ * Name: history
+ * Description: Get the most recent runs.
+ ******************************************************************************
+ */
+std::vector<DatabaseMaintenance::Run> DatabaseMaintenance::history() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   return vector<Run>(mHistory.begin(), mHistory.end());
+}
+
+/******************************************************************************
+ * Name: start
+ * Description: Start the background maintenance thread.
+ ******************************************************************************
+ */
+void DatabaseMaintenance::start()
+{
+   if(mIsRunning) {
+      return;
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "start().");
+
+   mIsRunning = true;
+   mThread = std::thread(&DatabaseMaintenance::run, this);
+}
+
+/******************************************************************************
+ * Name: stop
+ * Description: Stop the background maintenance thread.
+ ******************************************************************************
+ */
+void DatabaseMaintenance::stop()
+{
+   if(mThread.joinable()) {
+      Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "stop().");
+
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: run
+ * Description: Background thread. Run the operations that are due when quiet.
+ ******************************************************************************
+ */
+void DatabaseMaintenance::run()
+{
+   unsigned long lastRequests = db_numConnectionRequests();
+
+   while(mIsRunning) {
+      {
+         unique_lock<mutex> lock(mMutex);
+         mWakeUp.wait_for(lock, CHECK_INTERVAL, [this] { return !mIsRunning; });
+      }
+
+      unsigned long requests = db_numConnectionRequests();
+      bool isQuiet = requests - lastRequests <= mIdleRequests;
+      lastRequests = requests;
+
+      if(!mIsRunning || !isQuiet) {
+         continue;
+      }
+
+      try {
+         while(mShards.size() < db_numShards()) {
+            unique_ptr<SQLite::Database> db(new SQLite::Database(db_shardPath(mShards.size()), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE));
+            db->setBusyTimeout(MAINTENANCE_BUSY_TIMEOUT_MS);
+            mShards.push_back(move(db));
+         }
+
+         for(Operation operation : OPERATIONS) {
+            auto now = std::chrono::steady_clock::now();
+            auto nextRun = mNextRun.find(operation);
+            if(nextRun != mNextRun.end() && now < nextRun->second) {
+               continue;
+            }
+
+            bool isComplete = true;
+            for(unsigned int shard = 0; shard < mShards.size() && mIsRunning; ++shard) {
+               isComplete = runOperation(*mShards[shard], shard, operation).isComplete && isComplete;
+            }
+
+            // An unfinished operation is tried again later, waiting longer each time.
+            if(isComplete) {
+               mNumInterrupted[operation] = 0;
+               mNextRun[operation] = now + operationInterval(operation);
+            } else {
+               int numInterrupted = ++mNumInterrupted[operation];
+               mNextRun[operation] = now + retryDelay(operation, numInterrupted);
+               Logger::instance().log(Logger::LogLevel::INFO, "DatabaseMaintenance", "run(). & interrupted & times in a row.",
+                                      operationName(operation), to_string(numInterrupted));
+            }
+
+            // Stop if requests have started coming in.
+            if(db_numConnectionRequests() - lastRequests > mIdleRequests) {
+               break;
+            }
+         }
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "DatabaseMaintenance", "run(). ERROR Exception: &.", e.what());
+      }
+   }
+}
+
+} // End namespace dw
@@ -0,0 +1,167 @@
+/**
+ * @class DatabaseMaintenance
+ *
+ * Singleton class that keeps the database files healthy while the server runs. A
+ * background thread checks how busy the server is once a minute. When no more than
+ * MAINTENANCE_IDLE_REQUESTS requests took a database connection in the last minute, it
+ * runs each operation that is due on every shard:
+ *
+ * - PRAGMA optimize, hourly.
+ * - ANALYZE, daily, limited to a sample of each index.
+ * - PRAGMA incremental_vacuum, daily, if the database uses auto_vacuum=INCREMENTAL.
+ *   Use "bookmanager --incremental-vacuum" once to switch a database to it.
+ * - PRAGMA wal_checkpoint(TRUNCATE), every 10 minutes, if the database is in WAL mode.
+ *
+ * Each operation has a time budget. An operation that runs past its budget is
+ * interrupted and tried again at a later quiet time. The wait doubles each time it is
+ * interrupted in a row, from one minute up to the operation's own interval, so an
+ * operation that never fits its budget stops taking every quiet minute. The duration and
+ * pages reclaimed by each run are logged and kept in a short history.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef DATABASEMAINTENANCE_H
+#define DATABASEMAINTENANCE_H
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+
+class DatabaseMaintenance
+{
+public:
+
+   /*---------  Public Types  --------------------*/
+
+   enum class Operation {
+      OPTIMIZE,
+      ANALYZE,
+      INCREMENTAL_VACUUM,
+      CHECKPOINT
+   };
+
+   /**
+    * The result of one operation on one shard.
+    */
+   struct Run
+   {
+      Operation operation;
+      unsigned int shard;
+      long durationMs;
+      long pagesReclaimed;
+      bool isComplete;
+   };
+
+   /*---------  Public Constants  ----------------*/
+
+   /**
+    * The number of runs kept in the history.
+    */
+   static const std::size_t HISTORY_SIZE = 50;
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the database maintenance.
+    *
+    * @return dw::DatabaseMaintenance&
+    */
+   static DatabaseMaintenance& instance();
+
+   /**
+    * Disable copying
+    */
+   DatabaseMaintenance(const DatabaseMaintenance& rhs) = delete;
+   void operator=(const DatabaseMaintenance& rhs) = delete;
+
+   /**
+    * Returns the name of an operation.
+    */
+   static std::string operationName(Operation operation);
+
+   /**
+    * Switch a database to auto_vacuum=INCREMENTAL. This rebuilds the file with VACUUM, so
+    * it must be run while the server is stopped.
+    *
+    * @param db the database.
+    */
+   static void enableIncrementalVacuum(SQLite::Database& db);
+
+   /**
+    * Returns how long to wait before trying an operation again after it has been
+    * interrupted a number of times in a row.
+    *
+    * @param operation the operation.
+    * @param numInterrupted the number of runs in a row that did not complete.
+    */
+   static std::chrono::minutes retryDelay(Operation operation, int numInterrupted);
+
+   /**
+    * Run one operation within its time budget and add the result to the history.
+    *
+    * @param db the database.
+    * @param shard the shard the database holds.
+    * @param operation the operation to run.
+    * @return the result.
+    */
+   Run runOperation(SQLite::Database& db, unsigned int shard, Operation operation);
+
+   /**
+    * Get the most recent runs, oldest first.
+    */
+   std::vector<Run> history() const;
+
+   /**
+    * Start the background maintenance thread.
+    */
+   void start();
+
+   /**
+    * Stop the background thread.
+    */
+   void stop();
+
+private:
+
+   /*---------  Private Functions  ---------------*/
+
+   DatabaseMaintenance();
+   ~DatabaseMaintenance();
+
+   /**
+    * Background thread. Runs the operations that are due whenever the server is quiet.
+    */
+   void run();
+
+   /*---------  Private Data  --------------------*/
+
+   mutable std::mutex mMutex;
+   std::condition_variable mWakeUp;
+   std::thread mThread;
+   std::atomic<bool> mIsRunning;
+   unsigned long mIdleRequests;
+   std::deque<Run> mHistory;
+   std::map<Operation, std::chrono::steady_clock::time_point> mNextRun;
+   std::map<Operation, int> mNumInterrupted;
+   std::vector<std::unique_ptr<SQLite::Database>> mShards;
+};
+
+} // End namespace dw
+
+#endif // DATABASEMAINTENANCE_H
@@ -0,0 +1,365 @@
+/*---------  Program Includes  ----------------*/
+#include "JournalReplica.h"
+#include "ChangeJournal.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "SearchCache.h"
+#include "dbConnect.h"
+
+/*---------  System Includes  -----------------*/
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include "json.hpp"
+
+using namespace std;
+
+namespace dw {
+
+const std::chrono::milliseconds POLL_INTERVAL(200);
+const size_t MAX_ENTRIES_PER_BATCH = 1000;
+const int REPLICA_BUSY_TIMEOUT_MS = 1000;
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+JournalReplica::JournalReplica()
+              : mIsRunning(false), mPath(""), mFileId(0), mOffset(0), mLastApplied(-1)
+{
+   try {
+      mPath = ConfigReader::getInstance().getConfig(ConfigReader::Config::JOURNAL_PATH);
+   }
+   catch(exception& e) {
+      mPath = "";
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "JournalReplica", "Constructor. Journal path is &.", mPath);
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+JournalReplica::~JournalReplica()
+{
+   if(mThread.joinable()) {
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the journal replica.
+ ******************************************************************************
+ */
+JournalReplica& JournalReplica::instance()
+{
+   static JournalReplica mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: isEnabled
+ * Description: Returns true if a journal is configured.
+ ******************************************************************************
+ */
+bool JournalReplica::isEnabled() const
+{
+   return !mPath.empty();
+}
+
+/******************************************************************************
+ * Name: configure
+ * Description: Set the journal to follow.
+ ******************************************************************************
+ */
+void JournalReplica::configure(const std::string& path)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   mPath = path;
+   mFileId = 0;
+   mOffset = 0;
+   mLastApplied = -1;
+   mShardApplied.clear();
+   mShards.clear();
+}
+
+/******************************************************************************
+ * Name: catchUp
+ * Description: Apply the entries written to the journal since the last call.
+ ******************************************************************************
+ */
+std::size_t JournalReplica::catchUp()
+{
+   lock_guard<mutex> lock(mMutex);
+
+   if(!isEnabled()) {
+      return 0;
+   }
+
+   open();
+
+   ifstream journal(mPath, ios::binary|ios::ate);
+   if(!journal.is_open()) {
+      return 0;
+   }
+
+   // A journal that is a different file, or smaller than the position read so far, has
+   // been replaced.
+   bool isReplaced = journal.tellg() < mOffset;
+   struct stat status;
+   if(stat(mPath.c_str(), &status) == 0) {
+      isReplaced = isReplaced || (mFileId != 0 && status.st_ino != mFileId);
+      mFileId = status.st_ino;
+   }
+
+   if(isReplaced) {
+      Logger::instance().log(Logger::LogLevel::INFO, "JournalReplica", "catchUp(). Journal & was replaced.", mPath);
+      restart(journal);
+   }
+   journal.seekg(mOffset);
+
+   size_t numApplied = 0;
+   bool isMore = true;
+
+   while(isMore) {
+      vector<nlohmann::json> entries;
+      streamoff offset = mOffset;
+      string line;
+
+      // An entry is only read once the whole line has been written.
+      while(entries.size() < MAX_ENTRIES_PER_BATCH && getline(journal, line) && !journal.eof()) {
+         offset = journal.tellg();
+         try {
+            nlohmann::json entry = nlohmann::json::parse(line);
+            if(entry.at("seq").get<long>() > mLastApplied) {
+               entries.push_back(entry);
+            }
+         }
+         catch(exception& e) {
+            Logger::instance().log(Logger::LogLevel::ERROR, "JournalReplica", "catchUp(). ERROR Invalid entry: &.", line);
+         }
+      }
+      isMore = entries.size() == MAX_ENTRIES_PER_BATCH;
+
+      if(entries.empty()) {
+         mOffset = offset;
+         break;
+      }
+
+      // Each shard changed by the batch gets one transaction, which also stores the
+      // shard's position, so a crash between commits leaves every shard's position
+      // matching its data.
+      map<unsigned int, unique_ptr<SQLite::Transaction>> transactions;
+      long lastApplied = mLastApplied;
+
+      for(const nlohmann::json& entry : entries) {
+         unsigned int shard = 0;
+         if(entry.value("table", "") == "books") {
+            const nlohmann::json& values = entry.count("row") ? entry.at("row") : entry.value("key", nlohmann::json::object());
+            shard = db_shardForUser(values.value("user_id", 0));
+         }
+
+         lastApplied = entry.at("seq").get<long>();
+
+         // Already applied to this shard before the replica was restarted.
+         if(lastApplied <= mShardApplied[shard]) {
+            continue;
+         }
+
+         if(!transactions[shard]) {
+            transactions[shard].reset(new SQLite::Transaction(*mShards[shard]));
+         }
+
+         try {
+            ChangeJournal::apply(*mShards[shard], entry);
+         }
+         catch(std::invalid_argument& e) {
+            Logger::instance().log(Logger::LogLevel::ERROR, "JournalReplica", "catchUp(). ERROR Skipping entry: &.", e.what());
+         }
+      }
+
+      for(auto& transaction : transactions) {
+         storePosition(*mShards[transaction.first], lastApplied);
+         transaction.second->commit();
+         mShardApplied[transaction.first] = lastApplied;
+      }
+
+      mOffset = offset;
+      mLastApplied = lastApplied;
+      numApplied += entries.size();
+   }
+
+   if(numApplied > 0) {
+      SearchCache::instance().clear();
+      Logger::instance().log(Logger::LogLevel::DEBUG, "JournalReplica", "catchUp(). Applied & entries. Last is &.", numApplied, mLastApplied);
+   }
+
+   return numApplied;
+}
+
+/******************************************************************************
+ * Name: lastApplied
+ * Description: Returns the sequence number of the last entry applied.
+ ******************************************************************************
+ */
+long JournalReplica::lastApplied()
+{
+   lock_guard<mutex> lock(mMutex);
+
+   open();
+
+   return mLastApplied;
+}
+
+/******************************************************************************
+ * Name: start
+ * Description: Start the background thread that follows the journal.
+ ******************************************************************************
+ */
+void JournalReplica::start()
+{
+   if(mIsRunning || !isEnabled()) {
+      return;
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "JournalReplica", "start().");
+
+   mIsRunning = true;
+   mThread = std::thread(&JournalReplica::run, this);
+}
+
+/******************************************************************************
+ * Name: stop
+ * Description: Stop the background thread.
+ ******************************************************************************
+ */
+void JournalReplica::stop()
+{
+   if(mThread.joinable()) {
+      Logger::instance().log(Logger::LogLevel::INFO, "JournalReplica", "stop().");
+
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: open
+ * Description: Open the shard connections and read the last applied position.
+ ******************************************************************************
+ */
+void JournalReplica::open()
+{
+   while(mShards.size() < db_numShards()) {
+      unique_ptr<SQLite::Database> db(new SQLite::Database(db_shardPath(mShards.size()), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE));
+      db->setBusyTimeout(REPLICA_BUSY_TIMEOUT_MS);
+      mShards.push_back(move(db));
+   }
+
+   if(mShardApplied.size() == mShards.size()) {
+      return;
+   }
+
+   for(size_t shard = mShardApplied.size(); shard < mShards.size(); ++shard) {
+      SQLite::Database* db = mShards[shard].get();
+      db->exec("CREATE TABLE IF NOT EXISTS journal_position (seq integer not null)");
+
+      long position = 0;
+      SQLite::Statement query(*db, "SELECT seq FROM journal_position");
+      if(query.executeStep()) {
+         position = query.getColumn(0).getInt64();
+      } else {
+         db->exec("INSERT INTO journal_position (seq) VALUES (0)");
+      }
+      mShardApplied.push_back(position);
+   }
+
+   // Reading starts after the entry every shard has applied.
+   if(mLastApplied < 0) {
+      mLastApplied = *min_element(mShardApplied.begin(), mShardApplied.end());
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "JournalReplica", "open(). Last applied entry is &.", to_string(mLastApplied));
+}
+
+/******************************************************************************
+ * Name: restart
+ * Description: Read a replaced journal from the beginning.
+ ******************************************************************************
+ */
+void JournalReplica::restart(std::istream& journal)
+{
+   // A new journal may number its entries from 1 again, so every entry in it is applied.
+   // Entries can be applied more than once, so it does not matter if it continues the
+   // numbering of the old one.
+   long firstSequence = 1;
+   string line;
+   journal.seekg(0);
+   if(getline(journal, line) && !journal.eof()) {
+      try {
+         firstSequence = nlohmann::json::parse(line).at("seq").get<long>();
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "JournalReplica", "restart(). ERROR Invalid entry: &.", line);
+      }
+   }
+   journal.clear();
+
+   mLastApplied = min(mLastApplied, firstSequence - 1);
+   for(size_t shard = 0; shard < mShards.size(); ++shard) {
+      if(mShardApplied[shard] > mLastApplied) {
+         mShardApplied[shard] = mLastApplied;
+         storePosition(*mShards[shard], mLastApplied);
+      }
+   }
+   mOffset = 0;
+}
+
+/******************************************************************************
+ * Name: storePosition
+ * Description: Store the last entry applied to a shard.
+ ******************************************************************************
+ */
+void JournalReplica::storePosition(SQLite::Database& db, long sequence)
+{
+   SQLite::Statement position(db, "UPDATE journal_position SET seq = ?");
+   position.bind(1, (long long)sequence);
+   position.exec();
+}
+
+/******************************************************************************
+ * Name: run
+ * Description: Background thread. Apply new entries, then wait for more.
+ ******************************************************************************
+ */
+void JournalReplica::run()
+{
+   while(mIsRunning) {
+      try {
+         catchUp();
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "JournalReplica", "run(). ERROR Exception: &.", e.what());
+      }
+
+      unique_lock<mutex> lock(mMutex);
+      mWakeUp.wait_for(lock, POLL_INTERVAL, [this] { return !mIsRunning; });
+   }
+}
+
+} // End namespace dw
@@ -0,0 +1,143 @@
+/**
+ * @class JournalReplica
+ *
+ * Singleton class that keeps a read replica's database up to date by tailing the
+ * primary's change journal, JOURNAL_PATH, and applying each new entry to its own copy of
+ * the database. It is used when the server is started with --replica.
+ *
+ * Entries are applied in batches, one transaction per shard. Book entries go to the
+ * replica's shard for the user, so the replica can have a different number of shards.
+ * Each shard stores the sequence number of the last entry applied to it in its
+ * journal_position table, in the same transaction as the entries, so a restarted replica
+ * carries on where each shard stopped.
+ *
+ * A journal that is replaced, such as when the primary starts a new one, is read from
+ * the beginning, and all of its entries are applied.
+ *
+ * A replica is seeded from a backup of the primary. Entries can be applied more than once,
+ * so it does not matter if the backup already holds some of the changes in the journal.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef JOURNALREPLICA_H
+#define JOURNALREPLICA_H
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <ios>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+
+class JournalReplica
+{
+public:
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the journal replica.
+    *
+    * @return dw::JournalReplica&
+    */
+   static JournalReplica& instance();
+
+   /**
+    * Disable copying
+    */
+   JournalReplica(const JournalReplica& rhs) = delete;
+   void operator=(const JournalReplica& rhs) = delete;
+
+   /**
+    * Returns true if a journal is configured.
+    */
+   bool isEnabled() const;
+
+   /**
+    * Set the journal to follow and start reading it from the beginning again.
+    *
+    * @param path the primary's journal file.
+    */
+   void configure(const std::string& path);
+
+   /**
+    * Apply all of the complete entries written to the journal since the last call.
+    *
+    * @return the number of entries applied.
+    */
+   std::size_t catchUp();
+
+   /**
+    * Returns the sequence number of the last entry applied.
+    */
+   long lastApplied();
+
+   /**
+    * Start the background thread that follows the journal.
+    */
+   void start();
+
+   /**
+    * Stop the background thread.
+    */
+   void stop();
+
+private:
+
+   /*---------  Private Functions  ---------------*/
+
+   JournalReplica();
+   ~JournalReplica();
+
+   /**
+    * Open the shard connections and read the last applied position. mMutex must be held.
+    */
+   void open();
+
+   /**
+    * Read a replaced journal from the beginning, applying all of its entries. mMutex
+    * must be held.
+    */
+   void restart(std::istream& journal);
+
+   /**
+    * Store the last entry applied to a shard.
+    */
+   static void storePosition(SQLite::Database& db, long sequence);
+
+   /**
+    * Background thread. Applies new entries, then waits for more.
+    */
+   void run();
+
+   /*---------  Private Data  --------------------*/
+
+   std::mutex mMutex;
+   std::condition_variable mWakeUp;
+   std::thread mThread;
+   std::atomic<bool> mIsRunning;
+   std::string mPath;
+   ino_t mFileId;
+   std::streamoff mOffset;
+   long mLastApplied;
+   std::vector<long> mShardApplied;
+   std::vector<std::unique_ptr<SQLite::Database>> mShards;
+};
+
+} // End namespace dw
+
+#endif // JOURNALREPLICA_H
@@ -0,0 +1,257 @@
+/*---------  Program Includes  ----------------*/
+#include "MemoryBookStore.h"
+#include "Logger.h"
+#include "SearchTerm.h"
+
+/*--------  System Includes  --------------*/
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace dw {
+
+struct MemoryBooks
+{
+   shared_timed_mutex mutex;
+   map<int, map<int, Book>> booksByUser;
+   long lastId = 0;
+};
+
+/******************************************************************************
+ * Name: memoryBooks
+ * Description: The books shared by all memory book stores.
+ ******************************************************************************
+ */
+static MemoryBooks& memoryBooks()
+{
+   static MemoryBooks books;
+   
+   return books;
+}
+
+/******************************************************************************
+ * Name: getAll
+ * Description: Return all of a user's books.
+ ******************************************************************************
+ */
+vector<Book> MemoryBookStore::getAll(int userId, bool)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "MemoryBookStore", "getAll()");
+   
+   MemoryBooks& data = memoryBooks();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   vector<Book> books;
+   auto user = data.booksByUser.find(userId);
+   if(user != data.booksByUser.end()) {
+      for(auto& entry : user->second) {
+         books.push_back(entry.second);
+      }
+   }
+   
+   return books;
+}
+
+/******************************************************************************
+ * Name: getById
+ * Description: Return the book with the given id.
+ ******************************************************************************
+ */
+Book MemoryBookStore::getById(int userId, int bookId)
+{
+   MemoryBooks& data = memoryBooks();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.booksByUser.find(userId);
+   if(user != data.booksByUser.end()) {
+      auto book = user->second.find(bookId);
+      if(book != user->second.end()) {
+         return book->second;
+      }
+   }
+   
+   throw out_of_range("Book with that id does not exist for user.");
+}
+
+/******************************************************************************
+ * Name: getByIds
+ * Description: Return the books with the given ids.
+ ******************************************************************************
+ */
+vector<Book> MemoryBookStore::getByIds(int userId, const vector<int>& bookIds)
+{
+   if(bookIds.size() > MAX_BATCH_IDS) {
+      throw out_of_range("Too many book ids requested.");
+   }
+   
+   MemoryBooks& data = memoryBooks();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   vector<Book> books;
+   auto user = data.booksByUser.find(userId);
+   if(user != data.booksByUser.end()) {
+      for(int bookId : bookIds) {
+         auto book = user->second.find(bookId);
+         if(book != user->second.end()) {
+            books.push_back(book->second);
+         }
+      }
+   }
+   
+   return books;
+}
+
+/******************************************************************************
+ * Name: exists
+ * Description: Check if a book exists for a user.
+ ******************************************************************************
+ */
+bool MemoryBookStore::exists(int userId, int bookId, bool)
+{
+   MemoryBooks& data = memoryBooks();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.booksByUser.find(userId);
+   
+   return user != data.booksByUser.end() && user->second.count(bookId) > 0;
+}
+
+/******************************************************************************
+ * Name: remove
+ * Description: Remove a book.
+ ******************************************************************************
+ */
+bool MemoryBookStore::remove(int userId, int bookId)
+{
+   MemoryBooks& data = memoryBooks();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.booksByUser.find(userId);
+   
+   return user != data.booksByUser.end() && user->second.erase(bookId) > 0;
+}
+
+/******************************************************************************
+ * Name: search
+ * Description: Find the user's books that contain the search term.
+ ******************************************************************************
+ */
+vector<Book> MemoryBookStore::search(int user_id, SEARCH_TYPE searchType, string searchTerm, bool)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "MemoryBookStore", "search(). Search Term: &.", searchTerm);
+   
+   SearchTerm term(searchTerm);
+   
+   MemoryBooks& data = memoryBooks();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   vector<Book> books;
+   auto user = data.booksByUser.find(user_id);
+   if(user == data.booksByUser.end()) {
+      return books;
+   }
+   
+   for(auto& entry : user->second) {
+      const Book& book = entry.second;
+      vector<string> texts;
+      if(searchType != SEARCH_TYPE::AUTHOR) {
+         texts.push_back(book.title());
+      }
+      if(searchType != SEARCH_TYPE::TITLE) {
+         texts.push_back(book.author());
+      }
+      
+      if(term.matches(texts)) {
+         books.push_back(book);
+      }
+   }
+   
+   return books;
+}
+
+/******************************************************************************
+ * Name: store
+ * Description: Store a new book and return its id.
+ ******************************************************************************
+ */
+long MemoryBookStore::store(const Book& book)
+{
+   MemoryBooks& data = memoryBooks();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   long newId = ++data.lastId;
+   
+   Book newBook(book);
+   newBook.bookId(newId);
+   data.booksByUser[book.userId()].emplace(newId, newBook);
+   
+   return newId;
+}
+
+/******************************************************************************
+ * Name: patch
+ * Description: Update only the given fields of a book.
+ ******************************************************************************
+ */
+bool MemoryBookStore::patch(int userId, int bookId, const BookPatch& patch)
+{
+   MemoryBooks& data = memoryBooks();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.booksByUser.find(userId);
+   if(user == data.booksByUser.end()) {
+      return false;
+   }
+   
+   auto entry = user->second.find(bookId);
+   if(entry == user->second.end()) {
+      return false;
+   }
+   
+   const Book& book = entry->second;
+   Book patchedBook(bookId,
+                    userId,
+                    patch.hasTitle() ? patch.title() : book.title(),
+                    patch.hasAuthor() ? patch.author() : book.author(),
+                    patch.hasYear() ? patch.year() : book.year(),
+                    patch.hasRead() ? patch.read() : book.read(),
+                    patch.hasRating() ? patch.rating() : book.rating());
+   entry->second = patchedBook;
+   
+   return true;
+}
+
+/******************************************************************************
+ * Name: update
+ * Description: Replace a stored book.
+ ******************************************************************************
+ */
+bool MemoryBookStore::update(const Book& book)
+{
+   if (book.id() < 1 || book.userId() < 1) {
+      return false;
+   }
+   
+   MemoryBooks& data = memoryBooks();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.booksByUser.find(book.userId());
+   if(user == data.booksByUser.end()) {
+      return false;
+   }
+   
+   auto entry = user->second.find(book.id());
+   if(entry == user->second.end()) {
+      return false;
+   }
+   
+   entry->second = book;
+   
+   return true;
+}
+
+} // End namespace dw
@@ -0,0 +1,42 @@
+/**
+ * @class MemoryBookStore
+ * 
+ * In-memory implementation of the book data store. All instances share the same books,
+ * which are kept in a map per user and guarded by a reader/writer lock so any number of
+ * request threads can read at once. There is no archive, so includeArchive is ignored.
+ * Searches match the search term as plain text, ignoring case.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef MEMORYBOOKSTORE_H
+#define MEMORYBOOKSTORE_H
+
+/*---------  Program Includes  ----------------*/
+#include "BookStore.h"
+
+namespace dw {
+
+class MemoryBookStore : public BookStore
+{
+public:
+   /*-----------  Public Functions  ----------------*/
+   
+   MemoryBookStore() = default;
+   ~MemoryBookStore() override = default;
+   
+   std::vector<Book> getAll(int userId, bool includeArchive = false) override;
+   Book getById(int userId, int bookId) override;
+   std::vector<Book> getByIds(int userId, const std::vector<int>& bookIds) override;
+   bool exists(int userId, int bookId, bool includeArchive = true) override;
+   bool remove(int userId, int bookId) override;
+   std::vector<Book> search(int user_id, SEARCH_TYPE searchType, std::string searchTerm, bool includeArchive = false) override;
+   long store(const Book& book) override;
+   bool patch(int userId, int bookId, const BookPatch& patch) override;
+   bool update(const Book& book) override;
+};
+
+} // End namespace dw
+
+#endif // MEMORYBOOKSTORE_H
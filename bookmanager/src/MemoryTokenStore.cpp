@@ -0,0 +1,130 @@
+/*---------  Program Includes  ----------------*/
+#include "MemoryTokenStore.h"
+#include "Logger.h"
+
+/*--------  System Includes  --------------*/
+#include <climits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+
+using namespace std;
+
+namespace dw {
+
+struct MemoryTokens
+{
+   shared_timed_mutex mutex;
+   map<string, unsigned int> userIds;
+   map<unsigned int, string> tokens;
+   mt19937_64 engine{random_device{}()};
+};
+
+/******************************************************************************
+ * Name: memoryTokens
+ * Description: The tokens shared by all memory token stores.
+ ******************************************************************************
+ */
+static MemoryTokens& memoryTokens()
+{
+   static MemoryTokens tokens;
+   
+   return tokens;
+}
+
+/******************************************************************************
+ * Name: create
+ * Description: Create a new token for a user, or return the existing one.
+ ******************************************************************************
+ */
+string MemoryTokenStore::create(unsigned int userId)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "MemoryTokenStore", "create(). User ID: &.", userId);
+   
+   MemoryTokens& data = memoryTokens();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto existing = data.tokens.find(userId);
+   if(existing != data.tokens.end()) {
+      return existing->second;
+   }
+   
+   // Same form as the SQLite tokens: a random hex number followed by the user id.
+   uniform_int_distribution<long> dist(LONG_MAX/2, LONG_MAX);
+   stringstream ss;
+   ss << std::hex << dist(data.engine);
+   string token = ss.str() + to_string(userId);
+   
+   data.tokens[userId] = token;
+   data.userIds[token] = userId;
+   
+   return token;
+}
+
+/******************************************************************************
+ * Name: exists
+ * Description: Check to see if a token exists.
+ ******************************************************************************
+ */
+bool MemoryTokenStore::exists(string token)
+{
+   MemoryTokens& data = memoryTokens();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   return data.userIds.count(token) > 0;
+}
+
+/******************************************************************************
+ * Name: getTokenForUserId
+ * Description: Get the token for a user ID.
+ ******************************************************************************
+ */
+string MemoryTokenStore::getTokenForUserId(unsigned int userId)
+{
+   MemoryTokens& data = memoryTokens();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto token = data.tokens.find(userId);
+   
+   return token != data.tokens.end() ? token->second : "";
+}
+
+/******************************************************************************
+ * Name: getUserIdForToken
+ * Description: Get the user ID for a given token.
+ ******************************************************************************
+ */
+long MemoryTokenStore::getUserIdForToken(const std::string& token)
+{
+   MemoryTokens& data = memoryTokens();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto userId = data.userIds.find(token);
+   
+   return userId != data.userIds.end() ? userId->second : 0;
+}
+
+/******************************************************************************
+ * Name: remove
+ * Description: Remove a token.
+ ******************************************************************************
+ */
+bool MemoryTokenStore::remove(string token)
+{
+   MemoryTokens& data = memoryTokens();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto userId = data.userIds.find(token);
+   if(userId == data.userIds.end()) {
+      return false;
+   }
+   
+   data.tokens.erase(userId->second);
+   data.userIds.erase(userId);
+   
+   return true;
+}
+
+} // End namespace dw
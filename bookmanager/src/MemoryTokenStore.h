@@ -0,0 +1,36 @@
+/**
+ * @class MemoryTokenStore
+ * 
+ * In-memory implementation of the authentication token data store. All instances share
+ * the same tokens, guarded by a reader/writer lock.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef MEMORYTOKENSTORE_H
+#define MEMORYTOKENSTORE_H
+
+/*---------  Program Includes  ----------------*/
+#include "TokenStore.h"
+
+namespace dw {
+
+class MemoryTokenStore : public TokenStore
+{
+public:
+   /*-----------  Public Functions  ----------------*/
+   
+   MemoryTokenStore() = default;
+   ~MemoryTokenStore() override = default;
+   
+   std::string create(unsigned int userId) override;
+   bool exists(std::string token) override;
+   std::string getTokenForUserId(unsigned int userId) override;
+   long getUserIdForToken(const std::string& token) override;
+   bool remove(std::string token) override;
+};
+
+} // End namespace dw
+
+#endif // MEMORYTOKENSTORE_H
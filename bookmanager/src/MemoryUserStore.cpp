@@ -0,0 +1,134 @@
+/*---------  Program Includes  ----------------*/
+#include "MemoryUserStore.h"
+#include "Logger.h"
+
+/*--------  System Includes  --------------*/
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+using namespace std;
+
+namespace dw {
+
+struct MemoryUsers
+{
+   shared_timed_mutex mutex;
+   map<unsigned int, User> users;
+   long lastId = 0;
+};
+
+/******************************************************************************
+ * Name: memoryUsers
+ * Description: The users shared by all memory user stores.
+ ******************************************************************************
+ */
+static MemoryUsers& memoryUsers()
+{
+   static MemoryUsers users;
+   
+   return users;
+}
+
+/******************************************************************************
+ * Name: count
+ * Description: Returns the number of users.
+ ******************************************************************************
+ */
+long MemoryUserStore::count()
+{
+   MemoryUsers& data = memoryUsers();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   return data.users.size();
+}
+
+/******************************************************************************
+ * Name: getById
+ * Description: Get the user info for the given ID.
+ ******************************************************************************
+ */
+User MemoryUserStore::getById(unsigned int id)
+{
+   MemoryUsers& data = memoryUsers();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.users.find(id);
+   if(user != data.users.end()) {
+      return user->second;
+   }
+   
+   return User(0,"","","");
+}
+
+/******************************************************************************
+ * Name: getUserId
+ * Description: Get the user ID for the given email and password.
+ ******************************************************************************
+ */
+long MemoryUserStore::getUserId(string email, string password)
+{
+   MemoryUsers& data = memoryUsers();
+   shared_lock<shared_timed_mutex> lock(data.mutex);
+   
+   for(auto& entry : data.users) {
+      if(entry.second.email() == email && entry.second.password() == password) {
+         return entry.first;
+      }
+   }
+   
+   return 0;
+}
+
+/******************************************************************************
+ * Name: remove
+ * Description: Remove a user.
+ ******************************************************************************
+ */
+void MemoryUserStore::remove(unsigned int id)
+{
+   MemoryUsers& data = memoryUsers();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   if(data.users.erase(id) != 1) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "MemoryUserStore", "remove(). ERROR: User & not found.", id);
+   }
+}
+
+/******************************************************************************
+ * Name: store
+ * Description: Store a new user and return the new id.
+ ******************************************************************************
+ */
+long MemoryUserStore::store(const User& user)
+{
+   MemoryUsers& data = memoryUsers();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   long newId = ++data.lastId;
+   data.users.emplace(newId, User(newId, user.name(), user.email(), user.password()));
+   
+   return newId;
+}
+
+/******************************************************************************
+ * Name: updatePassword
+ * Description: Update a user's password.
+ ******************************************************************************
+ */
+bool MemoryUserStore::updatePassword(unsigned int id, const std::string& password)
+{
+   MemoryUsers& data = memoryUsers();
+   unique_lock<shared_timed_mutex> lock(data.mutex);
+   
+   auto user = data.users.find(id);
+   if(user == data.users.end()) {
+      return false;
+   }
+   
+   user->second = User(id, user->second.name(), user->second.email(), password);
+   
+   return true;
+}
+
+} // End namespace dw
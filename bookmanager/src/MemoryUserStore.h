@@ -0,0 +1,37 @@
+/**
+ * @class MemoryUserStore
+ * 
+ * In-memory implementation of the user data store. All instances share the same users,
+ * guarded by a reader/writer lock.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef MEMORYUSERSTORE_H
+#define MEMORYUSERSTORE_H
+
+/*---------  Program Includes  ----------------*/
+#include "UserStore.h"
+
+namespace dw {
+
+class MemoryUserStore : public UserStore
+{
+public:
+   /*-----------  Public Functions  ----------------*/
+   
+   MemoryUserStore() = default;
+   ~MemoryUserStore() override = default;
+   
+   long count() override;
+   User getById(unsigned int id) override;
+   long getUserId(std::string email, std::string password) override;
+   void remove(unsigned int id) override;
+   long store(const User& user) override;
+   bool updatePassword(unsigned int id, const std::string& password) override;
+};
+
+} // End namespace dw
+
+#endif // MEMORYUSERSTORE_H
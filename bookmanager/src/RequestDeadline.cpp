@@ -0,0 +1,179 @@
+/*---------  Program Includes  ----------------*/
+#include "RequestDeadline.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+
+/*---------  System Includes  -----------------*/
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const std::string DEFAULT_ROUTE = "";
+
+// The progress handler is called after this many virtual machine steps.
+const int DEADLINE_PROGRESS_STEPS = 1000;
+
+// The deadline of the request this thread is serving, if any.
+static thread_local const std::chrono::steady_clock::time_point* threadDeadline = nullptr;
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+RequestDeadline::RequestDeadline(const std::string& route)
+               : RequestDeadline(routeBudget(route))
+{
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+RequestDeadline::RequestDeadline(std::chrono::milliseconds budget)
+               : mDeadline(std::chrono::steady_clock::now() + budget), mPrevious(threadDeadline)
+{
+   if(budget.count() > 0) {
+      threadDeadline = &mDeadline;
+   }
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+RequestDeadline::~RequestDeadline()
+{
+   threadDeadline = mPrevious;
+}
+
+/******************************************************************************
+ * Name: routeBudget
+ * Description: Returns the budget for a route.
+ ******************************************************************************
+ */
+std::chrono::milliseconds RequestDeadline::routeBudget(const std::string& route)
+{
+   // Each thread reads the budgets again after the configuration is reloaded.
+   static thread_local map<string, std::chrono::milliseconds> budgets;
+   static thread_local unsigned long version = 0;
+
+   unsigned long configVersion = ConfigReader::getInstance().version();
+   if(budgets.empty() || version != configVersion) {
+      budgets = readBudgets();
+      version = configVersion;
+   }
+
+   auto budget = budgets.find(route);
+   if(budget == budgets.end()) {
+      budget = budgets.find(DEFAULT_ROUTE);
+   }
+
+   return budget->second;
+}
+
+/******************************************************************************
+ * Name: isExpired
+ * Description: Returns true if this thread's deadline has passed.
+ ******************************************************************************
+ */
+bool RequestDeadline::isExpired()
+{
+   return threadDeadline != nullptr && std::chrono::steady_clock::now() > *threadDeadline;
+}
+
+/******************************************************************************
+ * Name: watch
+ * Description: Interrupt the connection's statements when the deadline passes.
+ ******************************************************************************
+ */
+void RequestDeadline::watch(SQLite::Database& db)
+{
+   // The handler reads the deadline of whichever thread is using the connection.
+   sqlite3_progress_handler(db.getHandle(), DEADLINE_PROGRESS_STEPS, &RequestDeadline::onProgress, nullptr);
+}
+
+/******************************************************************************
+ * Name: check
+ * Description: Replace an error response with 503 if the deadline has passed.
+ ******************************************************************************
+ */
+JsonResponse RequestDeadline::check(JsonResponse response) const
+{
+   if(threadDeadline == &mDeadline && isExpired() && static_cast<int>(response.code()) >= 400) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "RequestDeadline", "check(). Request ran past its deadline.");
+      return JsonResponse(R"({"message":"Request took too long"})", Pistache::Http::Code::Service_Unavailable);
+   }
+
+   return response;
+}
+
+/******************************************************************************
+ * Name: errorCode
+ * Description: The code for a request that failed with an exception.
+ ******************************************************************************
+ */
+Pistache::Http::Code RequestDeadline::errorCode() const
+{
+   if(threadDeadline == &mDeadline && isExpired()) {
+      return Pistache::Http::Code::Service_Unavailable;
+   }
+
+   return Pistache::Http::Code::Internal_Server_Error;
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: readBudgets
+ * Description: Read REQUEST_DEADLINE_MS and ROUTE_DEADLINES_MS.
+ ******************************************************************************
+ */
+std::map<std::string, std::chrono::milliseconds> RequestDeadline::readBudgets()
+{
+   map<string, std::chrono::milliseconds> budgets;
+   budgets[DEFAULT_ROUTE] = std::chrono::milliseconds(ConfigReader::getInstance().getInt(ConfigReader::Config::REQUEST_DEADLINE_MS));
+
+   string routes = "";
+   try {
+      routes = ConfigReader::getInstance().getConfig(ConfigReader::Config::ROUTE_DEADLINES_MS);
+   }
+   catch(exception& e) {
+      routes = "";
+   }
+
+   istringstream stream(routes);
+   string entry;
+   while(getline(stream, entry, ',')) {
+      string::size_type separator = entry.find('=');
+      try {
+         if(separator == string::npos || separator == 0) {
+            throw std::invalid_argument(entry);
+         }
+         budgets[entry.substr(0, separator)] = std::chrono::milliseconds(stol(entry.substr(separator + 1)));
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "RequestDeadline", "readBudgets(). ERROR Invalid route deadline: &.", entry);
+      }
+   }
+
+   return budgets;
+}
+
+/******************************************************************************
+ * Name: onProgress
+ * Description: SQLite progress handler. Interrupts the statement once the
+ *              deadline has passed.
+ ******************************************************************************
+ */
+int RequestDeadline::onProgress(void*)
+{
+   return isExpired() ? 1 : 0;
+}
+
+} // End namespace dw
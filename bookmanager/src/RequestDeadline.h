@@ -0,0 +1,120 @@
+/**
+ * @class RequestDeadline
+ *
+ * Limits how long a request may use the database. WebServer creates one at the start of
+ * each request handler. Until it goes out of scope, every connection the repositories
+ * watch on that thread has its statements interrupted once the deadline has passed, so a
+ * slow query cannot hold a server thread indefinitely.
+ *
+ * The budget is REQUEST_DEADLINE_MS, or the route's entry in ROUTE_DEADLINES_MS, for
+ * example "search=2000,batch=10000". A budget of 0 means no deadline.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef REQUESTDEADLINE_H
+#define REQUESTDEADLINE_H
+
+/*---------  Program Includes  ----------------*/
+#include "JsonResponse.h"
+
+/*---------  System Includes  -----------------*/
+#include <chrono>
+#include <map>
+#include <string>
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+
+class RequestDeadline final
+{
+public:
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Start the deadline for a request on this thread.
+    *
+    * @param route the route name used to look up the budget.
+    */
+   explicit RequestDeadline(const std::string& route);
+
+   /**
+    * Start a deadline with the given budget on this thread.
+    *
+    * @param budget the time the request may take. 0 means no deadline.
+    */
+   explicit RequestDeadline(std::chrono::milliseconds budget);
+
+   /**
+    * Restores the deadline that was active before this one.
+    */
+   ~RequestDeadline();
+
+   /**
+    * Disable copying
+    */
+   RequestDeadline(const RequestDeadline& rhs) = delete;
+   void operator=(const RequestDeadline& rhs) = delete;
+
+   /**
+    * Returns the budget for a route.
+    *
+    * @param route the route name.
+    */
+   static std::chrono::milliseconds routeBudget(const std::string& route);
+
+   /**
+    * Returns true if a deadline is active on this thread and it has passed.
+    */
+   static bool isExpired();
+
+   /**
+    * Interrupt the connection's statements when this thread's deadline passes. This only
+    * needs to be called once for each connection.
+    *
+    * @param db the connection.
+    */
+   static void watch(SQLite::Database& db);
+
+   /**
+    * Returns the response to send. An error response to a request that ran past its
+    * deadline is replaced with 503.
+    *
+    * @param response the controller's response.
+    */
+   JsonResponse check(JsonResponse response) const;
+
+   /**
+    * Returns the code for a request that failed with an exception: 503 if the deadline
+    * has passed, 500 otherwise.
+    */
+   Pistache::Http::Code errorCode() const;
+
+private:
+
+   /*---------  Private Functions  ---------------*/
+
+   /**
+    * Read the route budgets from the configuration.
+    */
+   static std::map<std::string, std::chrono::milliseconds> readBudgets();
+
+   /**
+    * SQLite progress handler. Returns 1 to interrupt the statement.
+    */
+   static int onProgress(void*);
+
+   /*---------  Private Data  --------------------*/
+
+   std::chrono::steady_clock::time_point mDeadline;
+   const std::chrono::steady_clock::time_point* mPrevious;
+};
+
+} // End namespace dw
+
+#endif // REQUESTDEADLINE_H
@@ -0,0 +1,341 @@
+/*---------  Program Includes  ----------------*/
+#include "SearchCache.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "ResourceLimits.h"
+
+/*---------  System Includes  -----------------*/
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+using namespace std;
+
+namespace dw {
+
+// Unless SEARCH_CACHE_SESSIONS is set, the cache may use a sixteenth of the
+// memory, allowing each session's results this much.
+const std::uint64_t SESSION_BUDGET_BYTES = 64 * 1024;
+const int MIN_DEFAULT_SESSIONS = 100;
+const int MAX_DEFAULT_SESSIONS = 10000;
+
+/******************************************************************************
+ * Name: defaultMaxSessions
+ * Description: The number of sessions that fit in the cache's share of memory.
+ ******************************************************************************
+ */
+static int defaultMaxSessions()
+{
+   std::uint64_t numSessions = ResourceLimits::memoryBytes() / 16 / SESSION_BUDGET_BYTES;
+
+   return (int)max<std::uint64_t>(MIN_DEFAULT_SESSIONS, min<std::uint64_t>(MAX_DEFAULT_SESSIONS, numSessions));
+}
+
+/******************************************************************************
+ * Name: toLower
+ * Description: Lower case the ASCII letters, as LIKE and NOCASE do.
+ ******************************************************************************
+ */
+static string toLower(const string& text)
+{
+   string lower = text;
+   transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+   return lower;
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+SearchCache::SearchCache()
+           : mLifetime(ConfigReader::getInstance().getInt(ConfigReader::Config::SEARCH_CACHE_MS)),
+             mMaxSessions(ConfigReader::getInstance().getInt(ConfigReader::Config::SEARCH_CACHE_SESSIONS, defaultMaxSessions())),
+             mNumClears(0),
+             mNumHits(0)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "SearchCache", "Constructor. Lifetime & ms. Sessions &.",
+                          to_string(mLifetime.count()), to_string(mMaxSessions));
+
+   // The cached searches are only dropped if the settings changed.
+   ConfigReader::getInstance().addReloadListener([this]() {
+      std::chrono::milliseconds lifetime(ConfigReader::getInstance().getInt(ConfigReader::Config::SEARCH_CACHE_MS));
+      size_t maxSessions = ConfigReader::getInstance().getInt(ConfigReader::Config::SEARCH_CACHE_SESSIONS, defaultMaxSessions());
+      {
+         lock_guard<mutex> lock(mMutex);
+         if(lifetime == mLifetime && maxSessions == mMaxSessions) {
+            return;
+         }
+      }
+      configure(lifetime, maxSessions);
+   });
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+SearchCache::~SearchCache()
+{
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the search cache.
+ ******************************************************************************
+ */
+SearchCache& SearchCache::instance()
+{
+   static SearchCache mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: isEnabled
+ * Description: Returns true if searches are cached.
+ ******************************************************************************
+ */
+bool SearchCache::isEnabled() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   return mLifetime.count() > 0 && mMaxSessions > 0;
+}
+
+/******************************************************************************
+ * Name: configure
+ * Description: Change the lifetime and number of sessions.
+ ******************************************************************************
+ */
+void SearchCache::configure(std::chrono::milliseconds lifetime, std::size_t maxSessions)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   mLifetime = lifetime;
+   mMaxSessions = maxSessions;
+   mEntries.clear();
+}
+
+/******************************************************************************
+ * Name: narrow
+ * Description: Answer a search by filtering the session's last search.
+ ******************************************************************************
+ */
+bool SearchCache::narrow(const std::string& session, int userId, BookStore::SEARCH_TYPE searchType,
+                         bool includeArchive, const SearchTerm& term, std::vector<Book>& books)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   auto found = mEntries.find(session);
+   if(found == mEntries.end()) {
+      return false;
+   }
+
+   Entry& entry = found->second;
+   if(entry.expires <= std::chrono::steady_clock::now()) {
+      mEntries.erase(found);
+      return false;
+   }
+
+   if(entry.userId != userId || entry.searchType != searchType || entry.includeArchive != includeArchive ||
+      !isNarrowing(entry.term, term)) {
+      return false;
+   }
+
+   vector<Book> matches;
+   for(const Book& book : entry.books) {
+      if(term.matches(searchedTexts(book, searchType))) {
+         matches.push_back(book);
+      }
+   }
+
+   Logger::instance().log(Logger::LogLevel::DEBUG, "SearchCache", "narrow(). Kept & of & books.",
+                          matches.size(), entry.books.size());
+
+   // The narrower search becomes the last search, but it does not last any longer.
+   entry.term = term;
+   entry.books = matches;
+   books = matches;
+   ++mNumHits;
+
+   return true;
+}
+
+/******************************************************************************
+ * Name: generation
+ * Description: Returns the generation of a user's books.
+ ******************************************************************************
+ */
+unsigned long SearchCache::generation(int userId) const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   // Both only grow, so the sum changes whenever either does.
+   auto found = mGenerations.find(userId);
+   return mNumClears + (found == mGenerations.end() ? 0 : found->second);
+}
+
+/******************************************************************************
+ * Name: store
+ * Description: Keep the results of a search as the session's last search.
+ ******************************************************************************
+ */
+void SearchCache::store(const std::string& session, int userId, unsigned long generation, BookStore::SEARCH_TYPE searchType,
+                        bool includeArchive, const SearchTerm& term, const std::vector<Book>& books)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   if(mLifetime.count() <= 0 || mMaxSessions == 0) {
+      return;
+   }
+
+   auto found = mGenerations.find(userId);
+   if(mNumClears + (found == mGenerations.end() ? 0 : found->second) != generation) {
+      Logger::instance().log(Logger::LogLevel::DEBUG, "SearchCache", "store(). User & changed during the search. Not kept.", userId);
+      mEntries.erase(session);
+      return;
+   }
+
+   mEntries.erase(session);
+   makeRoom();
+
+   Entry entry = {userId, searchType, includeArchive, term, books, std::chrono::steady_clock::now() + mLifetime};
+   mEntries.insert(make_pair(session, entry));
+}
+
+/******************************************************************************
+ * Name: invalidate
+ * Description: Remove the searches of a user.
+ ******************************************************************************
+ */
+void SearchCache::invalidate(int userId)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   ++mGenerations[userId];
+
+   for(auto entry = mEntries.begin(); entry != mEntries.end();) {
+      if(entry->second.userId == userId) {
+         entry = mEntries.erase(entry);
+      } else {
+         ++entry;
+      }
+   }
+}
+
+/******************************************************************************
+ * Name: clear
+ * Description: Remove all searches.
+ ******************************************************************************
+ */
+void SearchCache::clear()
+{
+   lock_guard<mutex> lock(mMutex);
+
+   ++mNumClears;
+
+   mEntries.clear();
+}
+
+/******************************************************************************
+ * Name: numHits
+ * Description: Returns the number of searches answered from the cache.
+ ******************************************************************************
+ */
+unsigned long SearchCache::numHits() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   return mNumHits;
+}
+
+/******************************************************************************
+ * Name: isNarrowing
+ * Description: Check that every book matching next also matches previous.
+ ******************************************************************************
+ */
+bool SearchCache::isNarrowing(const SearchTerm& previous, const SearchTerm& next)
+{
+   // An empty term matched every book.
+   if(previous.tokens().empty()) {
+      return true;
+   }
+   if(next.tokens().empty()) {
+      return false;
+   }
+
+   switch(previous.plan()) {
+      case SearchTerm::Plan::EXACT:
+         return next.plan() == SearchTerm::Plan::EXACT &&
+                toLower(next.tokens().front()) == toLower(previous.tokens().front());
+
+      case SearchTerm::Plan::PREFIX: {
+         // A column that is, or starts with, the longer phrase starts with the shorter one.
+         string prefix = toLower(previous.tokens().front());
+         return next.plan() != SearchTerm::Plan::CONTAINS &&
+                toLower(next.tokens().front()).compare(0, prefix.size(), prefix) == 0;
+      }
+
+      case SearchTerm::Plan::CONTAINS:
+         // A column holding a new word also holds every part of it.
+         for(const string& previousToken : previous.tokens()) {
+            string lowerPrevious = toLower(previousToken);
+            bool isCovered = any_of(next.tokens().begin(), next.tokens().end(), [&lowerPrevious](const string& token) {
+               return toLower(token).find(lowerPrevious) != string::npos;
+            });
+            if(!isCovered) {
+               return false;
+            }
+         }
+         return true;
+   }
+
+   return false;
+}
+
+/******************************************************************************
+ * Name: searchedTexts
+ * Description: Returns the text of a book that a search looks in.
+ ******************************************************************************
+ */
+std::vector<std::string> SearchCache::searchedTexts(const Book& book, BookStore::SEARCH_TYPE searchType)
+{
+   vector<string> texts;
+
+   if(searchType != BookStore::SEARCH_TYPE::AUTHOR) {
+      texts.push_back(book.title());
+   }
+   if(searchType != BookStore::SEARCH_TYPE::TITLE) {
+      texts.push_back(book.author());
+   }
+
+   return texts;
+}
+
+/******************************************************************************
+ * Name: makeRoom
+ * Description: Remove expired entries, then the oldest, to make room for one.
+ ******************************************************************************
+ */
+void SearchCache::makeRoom()
+{
+   auto now = std::chrono::steady_clock::now();
+
+   for(auto entry = mEntries.begin(); entry != mEntries.end();) {
+      if(entry->second.expires <= now) {
+         entry = mEntries.erase(entry);
+      } else {
+         ++entry;
+      }
+   }
+
+   while(!mEntries.empty() && mEntries.size() >= mMaxSessions) {
+      auto oldest = min_element(mEntries.begin(), mEntries.end(), [](const pair<const string, Entry>& a, const pair<const string, Entry>& b) {
+         return a.second.expires < b.second.expires;
+      });
+      mEntries.erase(oldest);
+   }
+}
+
+} // End namespace dw
@@ -0,0 +1,183 @@
+/**
+ * @class SearchCache
+ *
+ * Singleton class that keeps the results of the last search made by each session, so
+ * search-as-you-type does not query the database on every key press. When the next
+ * search of the session can only match books the last one matched, for example "terry"
+ * after "ter", the cached books are filtered in memory instead.
+ *
+ * An entry lasts SEARCH_CACHE_MS milliseconds from the query that filled it, however
+ * often it is narrowed. At most SEARCH_CACHE_SESSIONS sessions are kept. A
+ * SEARCH_CACHE_MS of 0 disables the cache.
+ *
+ * Anything that changes a user's books must call invalidate(), after the change is
+ * committed, so the next search goes to the database. A search takes the user's
+ * generation before its query, and its results are only kept if no change was
+ * committed while it ran.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef SEARCHCACHE_H
+#define SEARCHCACHE_H
+
+/*---------  Program Includes  ----------------*/
+#include "Book.h"
+#include "BookStore.h"
+#include "SearchTerm.h"
+
+/*---------  System Includes  -----------------*/
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dw {
+
+class SearchCache
+{
+public:
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the search cache.
+    *
+    * @return dw::SearchCache&
+    */
+   static SearchCache& instance();
+
+   /**
+    * Disable copying
+    */
+   SearchCache(const SearchCache& rhs) = delete;
+   void operator=(const SearchCache& rhs) = delete;
+
+   /**
+    * Returns true if searches are cached.
+    */
+   bool isEnabled() const;
+
+   /**
+    * Change how long entries last and how many sessions are kept. All entries are removed.
+    *
+    * @param lifetime how long an entry lasts. 0 disables the cache.
+    * @param maxSessions the number of sessions kept.
+    */
+   void configure(std::chrono::milliseconds lifetime, std::size_t maxSessions);
+
+   /**
+    * Answer a search from the session's last search, if the new term can only match
+    * books the last one matched.
+    *
+    * @param session the session's token.
+    * @param userId the user searching.
+    * @param searchType the columns searched.
+    * @param includeArchive true if archived books are searched.
+    * @param term the new search term.
+    * @param books set to the matching books if the search was answered.
+    * @return true if the search was answered from the cache.
+    */
+   bool narrow(const std::string& session, int userId, BookStore::SEARCH_TYPE searchType,
+               bool includeArchive, const SearchTerm& term, std::vector<Book>& books);
+
+   /**
+    * Returns the generation of a user's books, which changes whenever they are
+    * invalidated. Take it before querying the database for a search to store.
+    *
+    * @param userId the user.
+    */
+   unsigned long generation(int userId) const;
+
+   /**
+    * Keep the results of a search made in the database as the session's last search.
+    * They are not kept if the user's books were invalidated since the generation was
+    * taken, as the query may have missed the change.
+    *
+    * @param session the session's token.
+    * @param userId the user searching.
+    * @param generation the user's generation, taken before the query.
+    * @param searchType the columns searched.
+    * @param includeArchive true if archived books are searched.
+    * @param term the search term.
+    * @param books the matching books.
+    */
+   void store(const std::string& session, int userId, unsigned long generation, BookStore::SEARCH_TYPE searchType,
+              bool includeArchive, const SearchTerm& term, const std::vector<Book>& books);
+
+   /**
+    * Remove the searches of a user whose books have changed.
+    *
+    * @param userId the user.
+    */
+   void invalidate(int userId);
+
+   /**
+    * Remove all searches.
+    */
+   void clear();
+
+   /**
+    * Returns the number of searches answered from the cache.
+    */
+   unsigned long numHits() const;
+
+   /**
+    * Returns true if every book that matches next also matches previous, so next can be
+    * answered by filtering the books previous matched.
+    *
+    * @param previous the last search term.
+    * @param next the new search term.
+    */
+   static bool isNarrowing(const SearchTerm& previous, const SearchTerm& next);
+
+   /**
+    * Returns the text of a book that a search of the given type looks in.
+    *
+    * @param book the book.
+    * @param searchType the columns searched.
+    */
+   static std::vector<std::string> searchedTexts(const Book& book, BookStore::SEARCH_TYPE searchType);
+
+private:
+
+   /*---------  Private Types  -------------------*/
+
+   struct Entry
+   {
+      int userId;
+      BookStore::SEARCH_TYPE searchType;
+      bool includeArchive;
+      SearchTerm term;
+      std::vector<Book> books;
+      std::chrono::steady_clock::time_point expires;
+   };
+
+   /*---------  Private Functions  ---------------*/
+
+   SearchCache();
+   ~SearchCache();
+
+   /**
+    * Remove the expired entries, then the oldest until there is room for one more.
+    * mMutex must be held.
+    */
+   void makeRoom();
+
+   /*---------  Private Data  --------------------*/
+
+   mutable std::mutex mMutex;
+   std::chrono::milliseconds mLifetime;
+   std::size_t mMaxSessions;
+   std::map<std::string, Entry> mEntries;
+   std::map<int, unsigned long> mGenerations;   // Invalidations of each user.
+   unsigned long mNumClears;
+   unsigned long mNumHits;
+};
+
+} // End namespace dw
+
+#endif // SEARCHCACHE_H
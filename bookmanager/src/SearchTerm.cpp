@@ -0,0 +1,283 @@
+/*---------  Program Includes  ----------------*/
+#include "SearchTerm.h"
+
+/*---------  System Includes  -----------------*/
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace dw {
+
+const char LIKE_ESCAPE = '\\';
+
+/******************************************************************************
+ * Name: hexValue
+ * Description: Returns the value of a hex digit, or -1.
+ ******************************************************************************
+ */
+static int hexValue(char c)
+{
+   if(c >= '0' && c <= '9') {
+      return c - '0';
+   }
+   if(c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+   }
+   if(c >= 'A' && c <= 'F') {
+      return c - 'A' + 10;
+   }
+
+   return -1;
+}
+
+/******************************************************************************
+ * Name: toLower
+ * Description: Lower case the ASCII letters, as LIKE and NOCASE do.
+ ******************************************************************************
+ */
+static string toLower(const string& text)
+{
+   string lower = text;
+   transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+   return lower;
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+SearchTerm::SearchTerm(const std::string& term)
+          : mPlan(Plan::CONTAINS)
+{
+   // Trim and collapse the spaces in a single pass.
+   string text = "";
+   for(char c : term) {
+      if(isspace((unsigned char)c)) {
+         if(!text.empty() && text.back() != ' ') {
+            text += ' ';
+         }
+      } else {
+         text += c;
+      }
+   }
+   if(!text.empty() && text.back() == ' ') {
+      text.pop_back();
+   }
+
+   if(text.size() > MAX_LENGTH) {
+      throw std::invalid_argument("Search term is longer than " + to_string(MAX_LENGTH) + " characters.");
+   }
+
+   if(text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+      mPlan = Plan::EXACT;
+      text = text.substr(1, text.size() - 2);
+   } else if(!text.empty() && text.back() == '*') {
+      mPlan = Plan::PREFIX;
+      text.erase(text.find_last_not_of('*') + 1);
+   }
+
+   if(text.size() > 0 && text.front() == ' ') {
+      text.erase(0, 1);
+   }
+   if(text.size() > 0 && text.back() == ' ') {
+      text.pop_back();
+   }
+
+   if(mPlan != Plan::CONTAINS) {
+      if(!text.empty()) {
+         mTokens.push_back(text);
+      } else {
+         mPlan = Plan::CONTAINS;
+      }
+      return;
+   }
+
+   // A word that is part of another word adds nothing, so it is left out.
+   istringstream words(text);
+   string word;
+   vector<string> allWords;
+   while(getline(words, word, ' ')) {
+      allWords.push_back(word);
+   }
+   if(allWords.size() > MAX_TOKENS) {
+      throw std::invalid_argument("Search term has more than " + to_string(MAX_TOKENS) + " words.");
+   }
+
+   stable_sort(allWords.begin(), allWords.end(), [](const string& a, const string& b) { return a.size() > b.size(); });
+   for(const string& candidate : allWords) {
+      string lowerCandidate = toLower(candidate);
+      bool isCovered = any_of(mTokens.begin(), mTokens.end(), [&lowerCandidate](const string& token) {
+         return toLower(token).find(lowerCandidate) != string::npos;
+      });
+      if(!isCovered) {
+         mTokens.push_back(candidate);
+      }
+   }
+}
+
+/******************************************************************************
+ * Name: percentDecode
+ * Description: Decode %XX escapes in a URL parameter.
+ ******************************************************************************
+ */
+std::string SearchTerm::percentDecode(const std::string& input)
+{
+   string decoded;
+   decoded.reserve(input.size());
+
+   for(size_t i = 0; i < input.size(); ++i) {
+      if(input[i] == '%' && i + 2 < input.size() && hexValue(input[i + 1]) >= 0 && hexValue(input[i + 2]) >= 0) {
+         decoded += (char)(hexValue(input[i + 1]) * 16 + hexValue(input[i + 2]));
+         i += 2;
+      } else {
+         decoded += input[i];
+      }
+   }
+
+   return decoded;
+}
+
+/******************************************************************************
+ * Name: escapeLike
+ * Description: Escape the LIKE wildcards in literal text.
+ ******************************************************************************
+ */
+std::string SearchTerm::escapeLike(const std::string& text)
+{
+   string escaped;
+   escaped.reserve(text.size());
+
+   for(char c : text) {
+      if(c == '%' || c == '_' || c == LIKE_ESCAPE) {
+         escaped += LIKE_ESCAPE;
+      }
+      escaped += c;
+   }
+
+   return escaped;
+}
+
+/******************************************************************************
+ * Name: plan
+ * Description: Returns the plan chosen for the term.
+ ******************************************************************************
+ */
+SearchTerm::Plan SearchTerm::plan() const
+{
+   return mPlan;
+}
+
+/******************************************************************************
+ * Name: tokens
+ * Description: Returns the words matched.
+ ******************************************************************************
+ */
+const std::vector<std::string>& SearchTerm::tokens() const
+{
+   return mTokens;
+}
+
+/******************************************************************************
+ * Name: condition
+ * Description: Build the SQL condition that matches the term.
+ ******************************************************************************
+ */
+std::string SearchTerm::condition(const std::vector<std::string>& columns) const
+{
+   if(mTokens.empty() || columns.empty()) {
+      return "(1)";
+   }
+
+   string condition = "";
+   for(size_t i = 0; i < mTokens.size(); ++i) {
+      string parameter = ":term" + to_string(i);
+      string tokenCondition = "";
+
+      for(const string& column : columns) {
+         if(!tokenCondition.empty()) {
+            tokenCondition += " OR ";
+         }
+         if(mPlan == Plan::EXACT) {
+            tokenCondition += column + " = " + parameter + " COLLATE NOCASE";
+         } else {
+            tokenCondition += column + " LIKE " + parameter + " ESCAPE '\\'";
+         }
+      }
+
+      condition += (condition.empty() ? "(" : " AND (") + tokenCondition + ")";
+   }
+
+   return "(" + condition + ")";
+}
+
+/******************************************************************************
+ * Name: parameters
+ * Description: Returns the values to bind to the condition's parameters.
+ ******************************************************************************
+ */
+std::vector<std::string> SearchTerm::parameters() const
+{
+   vector<string> values;
+
+   for(const string& token : mTokens) {
+      switch(mPlan) {
+         case Plan::EXACT:
+            values.push_back(token);
+            break;
+
+         case Plan::PREFIX:
+            values.push_back(escapeLike(token) + "%");
+            break;
+
+         case Plan::CONTAINS:
+            values.push_back("%" + escapeLike(token) + "%");
+            break;
+      }
+   }
+
+   return values;
+}
+
+/******************************************************************************
+ * Name: matches
+ * Description: Check if the term matches any of the texts.
+ ******************************************************************************
+ */
+bool SearchTerm::matches(const std::vector<std::string>& texts) const
+{
+   vector<string> lowerTexts;
+   for(const string& text : texts) {
+      lowerTexts.push_back(toLower(text));
+   }
+
+   for(const string& token : mTokens) {
+      string lowerToken = toLower(token);
+      bool isMatch = false;
+
+      for(const string& text : lowerTexts) {
+         if(mPlan == Plan::EXACT) {
+            isMatch = text == lowerToken;
+         } else if(mPlan == Plan::PREFIX) {
+            isMatch = text.compare(0, lowerToken.size(), lowerToken) == 0;
+         } else {
+            isMatch = text.find(lowerToken) != string::npos;
+         }
+
+         if(isMatch) {
+            break;
+         }
+      }
+
+      if(!isMatch) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+} // End namespace dw
@@ -0,0 +1,116 @@
+/**
+ * @class SearchTerm
+ *
+ * Compiles a user's search term into the cheapest query that answers it. The term is
+ * trimmed and runs of spaces are collapsed, then the plan is chosen from its form:
+ *
+ * - "exact words" in double quotes is an EXACT match of the whole column, which can use
+ *   an index.
+ * - words* ending in a star is a PREFIX match of the whole column.
+ * - anything else is a CONTAINS match. Each word must appear in the column, in any order.
+ *
+ * The words are matched literally. % and _ are escaped so they are not LIKE wildcards.
+ * A term longer than MAX_LENGTH or with more than MAX_TOKENS words is refused with
+ * std::invalid_argument, so one request cannot build an expensive pattern.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef SEARCHTERM_H
+#define SEARCHTERM_H
+
+/*---------  System Includes  -----------------*/
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dw {
+
+class SearchTerm final
+{
+public:
+
+   /*---------  Public Types  --------------------*/
+
+   enum class Plan {
+      EXACT,
+      PREFIX,
+      CONTAINS
+   };
+
+   /*---------  Public Constants  ----------------*/
+
+   static const std::size_t MAX_LENGTH = 100;
+   static const std::size_t MAX_TOKENS = 5;
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Compile a search term.
+    *
+    * @param term the decoded search term.
+    * @throws std::invalid_argument if the term is too long or has too many words.
+    */
+   explicit SearchTerm(const std::string& term);
+
+   /**
+    * Decode %XX escapes in a URL parameter. Invalid escapes are left as they are.
+    *
+    * @param input the parameter from the URL.
+    * @return the decoded parameter.
+    */
+   static std::string percentDecode(const std::string& input);
+
+   /**
+    * Escape the LIKE wildcards and the escape character in text.
+    *
+    * @param text the literal text.
+    * @return text that LIKE ... ESCAPE '\' matches literally.
+    */
+   static std::string escapeLike(const std::string& text);
+
+   /**
+    * Returns the plan chosen for the term.
+    */
+   Plan plan() const;
+
+   /**
+    * Returns the words matched. EXACT and PREFIX terms have one, the whole phrase. An
+    * empty term has none and matches everything.
+    */
+   const std::vector<std::string>& tokens() const;
+
+   /**
+    * Build the SQL condition that matches the term in any of the columns. The condition
+    * uses the parameters :term0, :term1 and so on.
+    *
+    * @param columns the columns to search.
+    * @return the condition, in brackets.
+    */
+   std::string condition(const std::vector<std::string>& columns) const;
+
+   /**
+    * Returns the values to bind to :term0, :term1 and so on.
+    */
+   std::vector<std::string> parameters() const;
+
+   /**
+    * Check if the term matches any of the texts, ignoring ASCII case as LIKE does.
+    *
+    * @param texts the column values to search.
+    * @return true if the term matches.
+    */
+   bool matches(const std::vector<std::string>& texts) const;
+
+private:
+
+   /*---------  Private Data  --------------------*/
+
+   Plan mPlan;
+   std::vector<std::string> mTokens;
+};
+
+} // End namespace dw
+
+#endif // SEARCHTERM_H
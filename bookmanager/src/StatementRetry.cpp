@@ -0,0 +1,308 @@
+/*---------  Program Includes  ----------------*/
+#include "StatementRetry.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "RequestDeadline.h"
+
+/*---------  System Includes  -----------------*/
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const vector<long> StatementRetry::BUCKET_LIMITS_MS = {0, 1, 5, 10, 50, 100, 500, 1000};
+
+const int DEFAULT_INITIAL_BACKOFF_MS = 5;
+const int DEFAULT_MAX_BACKOFF_MS = 100;
+
+// The waits between calls of the busy handler. The same as SQLite's own busy timeout.
+const vector<int> BUSY_DELAYS_MS = {1, 2, 5, 10, 15, 20, 25, 25, 25, 50, 50, 100};
+
+// The time this thread has spent waiting for locks, and when the current wait started.
+static thread_local long threadWaitMs = 0;
+static thread_local std::chrono::steady_clock::time_point threadBusyStart;
+
+/******************************************************************************
+ * Name: sleepMs
+ * Description: Sleep and add the time to this thread's lock wait.
+ ******************************************************************************
+ */
+static void sleepMs(int ms)
+{
+   if(ms > 0) {
+      this_thread::sleep_for(std::chrono::milliseconds(ms));
+      threadWaitMs += ms;
+   }
+}
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+StatementRetry::StatementRetry()
+              : mPolicy({(int)ConfigReader::getInstance().getInt(ConfigReader::Config::DB_BUSY_TIMEOUT_MS),
+                         (int)ConfigReader::getInstance().getInt(ConfigReader::Config::DB_RETRY_DEADLINE_MS),
+                         DEFAULT_INITIAL_BACKOFF_MS, DEFAULT_MAX_BACKOFF_MS}),
+                mBusyTimeoutMs(mPolicy.busyTimeoutMs)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "StatementRetry", "Constructor. Busy timeout & ms. Deadline & ms.",
+                          to_string(mPolicy.busyTimeoutMs), to_string(mPolicy.deadlineMs));
+
+   ConfigReader::getInstance().addReloadListener([this]() {
+      Policy reloaded = policy();
+      reloaded.busyTimeoutMs = (int)ConfigReader::getInstance().getInt(ConfigReader::Config::DB_BUSY_TIMEOUT_MS);
+      reloaded.deadlineMs = (int)ConfigReader::getInstance().getInt(ConfigReader::Config::DB_RETRY_DEADLINE_MS);
+      configure(reloaded);
+   });
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+StatementRetry::~StatementRetry()
+{
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the statement retry.
+ ******************************************************************************
+ */
+StatementRetry& StatementRetry::instance()
+{
+   static StatementRetry mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: policy
+ * Description: Returns the retry policy.
+ ******************************************************************************
+ */
+StatementRetry::Policy StatementRetry::policy() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   return mPolicy;
+}
+
+/******************************************************************************
+ * Name: configure
+ * Description: Change the retry policy.
+ ******************************************************************************
+ */
+void StatementRetry::configure(const Policy& policy)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   mPolicy = policy;
+   mBusyTimeoutMs = policy.busyTimeoutMs;
+}
+
+/******************************************************************************
+ * Name: exec
+ * Description: Execute a statement, retrying while the database is locked.
+ ******************************************************************************
+ */
+int StatementRetry::exec(SQLite::Database& db, SQLite::Statement& query, const std::string& name)
+{
+   bool isRetry = false;
+
+   return run(db, name, [&query, &isRetry]() {
+      if(isRetry) {
+         resetStatement(query);
+      }
+      isRetry = true;
+
+      return query.exec();
+   });
+}
+
+/******************************************************************************
+ * Name: resetStatement
+ * Description: Reset a statement after a failed step.
+ ******************************************************************************
+ */
+void StatementRetry::resetStatement(SQLite::Statement& query)
+{
+   // Resetting after a failed step reports the step's error again, but the statement is
+   // reset and keeps its bindings.
+   try {
+      query.reset();
+   }
+   catch(SQLite::Exception& e) {
+   }
+}
+
+/******************************************************************************
+ * Name: rollbackSavepoint
+ * Description: Undo and release a savepoint after an error.
+ ******************************************************************************
+ */
+void StatementRetry::rollbackSavepoint(SQLite::Database& db, const std::string& name, bool isOutermost)
+{
+   // Some errors make SQLite roll back the whole transaction itself.
+   if(sqlite3_get_autocommit(db.getHandle())) {
+      return;
+   }
+
+   try {
+      db.exec("ROLLBACK TO " + name);
+      db.exec("RELEASE " + name);
+      return;
+   }
+   catch(SQLite::Exception& e) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "StatementRetry", "rollbackSavepoint(). ERROR & not undone: &.", name, e.what());
+   }
+
+   if(isOutermost && !sqlite3_get_autocommit(db.getHandle())) {
+      try {
+         db.exec("ROLLBACK");
+      }
+      catch(SQLite::Exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "StatementRetry", "rollbackSavepoint(). ERROR Transaction not rolled back: &.", e.what());
+      }
+   }
+}
+
+/******************************************************************************
+ * Name: lockWaits
+ * Description: Get the lock waits of each statement run so far.
+ ******************************************************************************
+ */
+std::vector<StatementRetry::LockWaits> StatementRetry::lockWaits() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   vector<LockWaits> waits;
+   for(auto& statement : mLockWaits) {
+      waits.push_back(statement.second);
+   }
+
+   return waits;
+}
+
+/******************************************************************************
+ * Name: clear
+ * Description: Forget the lock waits recorded so far.
+ ******************************************************************************
+ */
+void StatementRetry::clear()
+{
+   lock_guard<mutex> lock(mMutex);
+
+   mLockWaits.clear();
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: begin
+ * Description: Use the busy handler on the connection and start the attempt.
+ ******************************************************************************
+ */
+StatementRetry::Attempt StatementRetry::begin(SQLite::Database& db)
+{
+   // This replaces any busy timeout set on the connection.
+   sqlite3_busy_handler(db.getHandle(), &StatementRetry::onBusy, &mBusyTimeoutMs);
+
+   Attempt attempt = {std::chrono::steady_clock::now(), threadWaitMs, policy().initialBackoffMs, 0,
+                      sqlite3_get_autocommit(db.getHandle()) == 0};
+
+   return attempt;
+}
+
+/******************************************************************************
+ * Name: backOff
+ * Description: Wait before the next attempt if the error was a lock error, the
+ *              deadlines have not passed and there is no outer transaction.
+ ******************************************************************************
+ */
+bool StatementRetry::backOff(const SQLite::Exception& e, Attempt& attempt)
+{
+   int errorCode = e.getErrorCode();
+   if((errorCode != SQLITE_BUSY && errorCode != SQLITE_LOCKED) || attempt.isInTransaction || RequestDeadline::isExpired()) {
+      return false;
+   }
+
+   Policy currentPolicy = policy();
+   long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - attempt.start).count();
+   long remainingMs = currentPolicy.deadlineMs - elapsedMs;
+   if(remainingMs <= 0) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "StatementRetry", "backOff(). Database still locked after & ms and & retries.",
+                             to_string(elapsedMs), to_string(attempt.numRetries));
+      return false;
+   }
+
+   // Jitter spreads out connections that were refused the lock at the same time.
+   static thread_local std::mt19937 random(std::random_device{}());
+   std::uniform_int_distribution<int> jitter(attempt.backoffMs / 2, max(attempt.backoffMs, 1));
+
+   sleepMs(static_cast<int>(min<long>(jitter(random), remainingMs)));
+
+   attempt.backoffMs = min(attempt.backoffMs * 2, currentPolicy.maxBackoffMs);
+   attempt.numRetries++;
+
+   return true;
+}
+
+/******************************************************************************
+ * Name: record
+ * Description: Add the attempt's lock wait to the statement's histogram.
+ ******************************************************************************
+ */
+void StatementRetry::record(const std::string& name, const Attempt& attempt, bool isFailed)
+{
+   long waitMs = threadWaitMs - attempt.startWaitMs;
+
+   lock_guard<mutex> lock(mMutex);
+
+   auto waits = mLockWaits.find(name);
+   if(waits == mLockWaits.end()) {
+      LockWaits newWaits = {name, 0, 0, 0, 0, vector<unsigned long>(BUCKET_LIMITS_MS.size() + 1, 0)};
+      waits = mLockWaits.insert(make_pair(name, newWaits)).first;
+   }
+
+   size_t bucket = upper_bound(BUCKET_LIMITS_MS.begin(), BUCKET_LIMITS_MS.end(), waitMs - 1) - BUCKET_LIMITS_MS.begin();
+
+   waits->second.numExecutions++;
+   waits->second.numRetries += attempt.numRetries;
+   waits->second.numFailures += isFailed ? 1 : 0;
+   waits->second.maxWaitMs = max(waits->second.maxWaitMs, waitMs);
+   waits->second.buckets[bucket]++;
+}
+
+/******************************************************************************
+ * Name: onBusy
+ * Description: SQLite busy handler. Returns 1 to try for the lock again or 0
+ *              to give up with SQLITE_BUSY.
+ ******************************************************************************
+ */
+int StatementRetry::onBusy(void* busyTimeoutMs, int count)
+{
+   auto now = std::chrono::steady_clock::now();
+   if(count == 0) {
+      threadBusyStart = now;
+   }
+
+   long waitedMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - threadBusyStart).count();
+   long remainingMs = static_cast<std::atomic<int>*>(busyTimeoutMs)->load() - waitedMs;
+   if(remainingMs <= 0 || RequestDeadline::isExpired()) {
+      return 0;
+   }
+
+   int delayMs = BUSY_DELAYS_MS[min<size_t>(count, BUSY_DELAYS_MS.size() - 1)];
+   sleepMs(static_cast<int>(min<long>(delayMs, remainingMs)));
+
+   return 1;
+}
+
+} // End namespace dw
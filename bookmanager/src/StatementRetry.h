@@ -0,0 +1,217 @@
+/**
+ * @class StatementRetry
+ *
+ * Singleton class that runs the repositories' write statements when the database may be
+ * locked by another connection. A busy handler waits up to DB_BUSY_TIMEOUT_MS for each
+ * lock. If the statement still fails with SQLITE_BUSY or SQLITE_LOCKED it is run again
+ * after an exponential backoff with jitter, until DB_RETRY_DEADLINE_MS has passed since
+ * the first attempt. After that the SQLite::Exception is thrown to the caller. Statements
+ * run inside a caller's transaction only get the busy handler, since the caller has to
+ * roll back and start again.
+ *
+ * The time each statement spent waiting for locks is kept in a histogram per statement
+ * name, so contention shows up before it turns into errors.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef STATEMENTRETRY_H
+#define STATEMENTRETRY_H
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <SQLiteCpp/SQLiteCpp.h>
+
+namespace dw {
+
+class StatementRetry
+{
+public:
+
+   /*---------  Public Types  --------------------*/
+
+   struct Policy
+   {
+      int busyTimeoutMs;
+      int deadlineMs;
+      int initialBackoffMs;
+      int maxBackoffMs;
+   };
+
+   /**
+    * The lock waits of one statement. buckets[i] counts the executions that waited no
+    * more than BUCKET_LIMITS_MS[i]. The last bucket counts the longer waits.
+    */
+   struct LockWaits
+   {
+      std::string statement;
+      unsigned long numExecutions;
+      unsigned long numRetries;
+      unsigned long numFailures;
+      long maxWaitMs;
+      std::vector<unsigned long> buckets;
+   };
+
+   /*---------  Public Constants  ----------------*/
+
+   static const std::vector<long> BUCKET_LIMITS_MS;
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the statement retry.
+    *
+    * @return dw::StatementRetry&
+    */
+   static StatementRetry& instance();
+
+   /**
+    * Disable copying
+    */
+   StatementRetry(const StatementRetry& rhs) = delete;
+   void operator=(const StatementRetry& rhs) = delete;
+
+   /**
+    * Returns the retry policy.
+    */
+   Policy policy() const;
+
+   /**
+    * Change the retry policy.
+    */
+   void configure(const Policy& policy);
+
+   /**
+    * Execute a statement that does not return rows, retrying while the database is locked.
+    *
+    * @param db the connection the statement was prepared on.
+    * @param query the bound statement.
+    * @param name the name the lock waits are recorded under.
+    * @return the number of rows changed.
+    */
+   int exec(SQLite::Database& db, SQLite::Statement& query, const std::string& name);
+
+   /**
+    * Reset a statement after a failed step so it can be run again with the same bindings.
+    *
+    * @param query the statement.
+    */
+   static void resetStatement(SQLite::Statement& query);
+
+   /**
+    * Undo and release a savepoint after an error, without throwing, so the caller can
+    * throw the original error. If the savepoint cannot be undone and it began the
+    * transaction, the whole transaction is rolled back, so the connection is never left
+    * with a transaction open.
+    *
+    * @param db the connection.
+    * @param name the savepoint.
+    * @param isOutermost true if the savepoint was made outside a transaction.
+    */
+   static void rollbackSavepoint(SQLite::Database& db, const std::string& name, bool isOutermost);
+
+   /**
+    * Run a function that uses the database, retrying while the database is locked. The
+    * function is called again from the start, so it must undo its own partial work when
+    * it throws.
+    *
+    * @param db the connection the function uses.
+    * @param name the name the lock waits are recorded under.
+    * @param function the function to run. It must return a value.
+    * @return the value returned by the function.
+    */
+   template<typename Function>
+   auto run(SQLite::Database& db, const std::string& name, Function function) -> decltype(function());
+
+   /**
+    * Get the lock waits of each statement run so far, ordered by name.
+    */
+   std::vector<LockWaits> lockWaits() const;
+
+   /**
+    * Forget the lock waits recorded so far.
+    */
+   void clear();
+
+private:
+
+   /*---------  Private Types  -------------------*/
+
+   struct Attempt
+   {
+      std::chrono::steady_clock::time_point start;
+      long startWaitMs;
+      int backoffMs;
+      unsigned long numRetries;
+      bool isInTransaction;
+   };
+
+   /*---------  Private Functions  ---------------*/
+
+   StatementRetry();
+   ~StatementRetry();
+
+   /**
+    * Use the busy handler on the connection and note when the first attempt started.
+    */
+   Attempt begin(SQLite::Database& db);
+
+   /**
+    * Wait before the next attempt. Returns false if the error is not a lock error, the
+    * retry or request deadline has passed or the attempt is part of a larger transaction.
+    */
+   bool backOff(const SQLite::Exception& e, Attempt& attempt);
+
+   /**
+    * Add the attempt's lock wait to the statement's histogram.
+    */
+   void record(const std::string& name, const Attempt& attempt, bool isFailed);
+
+   /**
+    * SQLite busy handler. Waits for a lock until the busy timeout.
+    */
+   static int onBusy(void* busyTimeoutMs, int count);
+
+   /*---------  Private Data  --------------------*/
+
+   mutable std::mutex mMutex;
+   Policy mPolicy;
+   std::atomic<int> mBusyTimeoutMs;
+   std::map<std::string, LockWaits> mLockWaits;
+};
+
+/******************************************************************************
+ * Name: run
+ * Description: Run a function, retrying while the database is locked.
+ ******************************************************************************
+ */
+template<typename Function>
+auto StatementRetry::run(SQLite::Database& db, const std::string& name, Function function) -> decltype(function())
+{
+   Attempt attempt = begin(db);
+
+   while(true) {
+      try {
+         auto result = function();
+         record(name, attempt, false);
+
+         return result;
+      }
+      catch(SQLite::Exception& e) {
+         if(!backOff(e, attempt)) {
+            record(name, attempt, true);
+            throw;
+         }
+      }
+   }
+}
+
+} // End namespace dw
+
+#endif // STATEMENTRETRY_H
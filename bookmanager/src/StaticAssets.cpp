@@ -0,0 +1,686 @@
+/*---------  Program Includes  ----------------*/
+#include "StaticAssets.h"
+#include "Logger.h"
+
+/*---------  System Includes  -----------------*/
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <brotli/encode.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace std;
+
+namespace dw {
+
+const int WATCH_POLL_MS = 500;
+const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+const map<string, string> CONTENT_TYPES = {
+   {"css", "text/css"},
+   {"eot", "application/vnd.ms-fontobject"},
+   {"gif", "image/gif"},
+   {"htm", "text/html"},
+   {"html", "text/html"},
+   {"ico", "image/x-icon"},
+   {"jpeg", "image/jpeg"},
+   {"jpg", "image/jpeg"},
+   {"js", "text/javascript"},
+   {"json", "application/json"},
+   {"map", "application/json"},
+   {"otf", "font/otf"},
+   {"png", "image/png"},
+   {"svg", "image/svg+xml"},
+   {"ttf", "font/ttf"},
+   {"txt", "text/plain"},
+   {"woff", "font/woff"},
+   {"woff2", "font/woff2"}
+};
+
+// Content types that are already compressed, such as images and woff fonts, are
+// not compressed again.
+const vector<string> COMPRESSED_TYPES = {
+   "application/javascript",
+   "application/json",
+   "application/vnd.ms-fontobject",
+   "font/otf",
+   "font/ttf",
+   "image/svg+xml",
+   "image/x-icon",
+   "text/"
+};
+
+/******************************************************************************
+ * Name: isCompressible
+ * Description: True if the content type is worth compressing.
+ ******************************************************************************
+ */
+static bool isCompressible(const string& contentType)
+{
+   for(const string& type : COMPRESSED_TYPES) {
+      if(contentType.compare(0, type.size(), type) == 0) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/******************************************************************************
+ * Name: gzipCompress
+ * Description: Compress with gzip at the highest level. Returns an empty
+ *              string if it fails.
+ ******************************************************************************
+ */
+static string gzipCompress(const string& text)
+{
+   z_stream stream = {};
+   // 16 more window bits writes a gzip header rather than a zlib one.
+   if(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return "";
+   }
+
+   string compressed(deflateBound(&stream, text.size()), '\0');
+   stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+   stream.avail_in = (uInt)text.size();
+   stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+   stream.avail_out = (uInt)compressed.size();
+
+   bool isDone = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+   compressed.resize(stream.total_out);
+   deflateEnd(&stream);
+
+   return isDone ? compressed : "";
+}
+
+/******************************************************************************
+ * Name: brotliCompress
+ * Description: Compress with brotli at the highest quality. Returns an empty
+ *              string if it fails.
+ ******************************************************************************
+ */
+static string brotliCompress(const string& text, const string& contentType)
+{
+   BrotliEncoderMode mode = contentType.compare(0, 5, "font/") == 0 ? BROTLI_MODE_FONT : BROTLI_MODE_TEXT;
+   size_t size = BrotliEncoderMaxCompressedSize(text.size());
+   string compressed(size, '\0');
+
+   if(size == 0 || !BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, mode,
+                                          text.size(), reinterpret_cast<const uint8_t*>(text.data()),
+                                          &size, reinterpret_cast<uint8_t*>(&compressed[0]))) {
+      return "";
+   }
+   compressed.resize(size);
+
+   return compressed;
+}
+
+/******************************************************************************
+ * Name: contentHash
+ * Description: The 64 bit FNV-1a hash of the text. Unlike std::hash it is the
+ *              same in every build, so every server gives a file the same tag.
+ ******************************************************************************
+ */
+static uint64_t contentHash(const string& text)
+{
+   uint64_t hash = 14695981039346656037ULL;
+   for(char c : text) {
+      hash ^= (unsigned char)c;
+      hash *= 1099511628211ULL;
+   }
+
+   return hash;
+}
+
+/******************************************************************************
+ * Name: opaqueTag
+ * Description: An entity tag without the W/ of a weak tag, for the weak
+ *              comparison If-None-Match uses.
+ ******************************************************************************
+ */
+static string opaqueTag(const string& tag)
+{
+   return tag.compare(0, 2, "W/") == 0 ? tag.substr(2) : tag;
+}
+
+/******************************************************************************
+ * Name: acceptedQuality
+ * Description: The quality, from 0 to 1, that an Accept-Encoding header gives
+ *              an encoding, or -1 if it does not name it.
+ ******************************************************************************
+ */
+static double acceptedQuality(const string& acceptEncoding, const string& encoding)
+{
+   istringstream stream(acceptEncoding);
+   string entry;
+
+   while(getline(stream, entry, ',')) {
+      entry.erase(remove_if(entry.begin(), entry.end(), [](char c) { return isspace((unsigned char)c); }), entry.end());
+      transform(entry.begin(), entry.end(), entry.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+      string::size_type separator = entry.find(';');
+      if(entry.substr(0, separator) != encoding) {
+         continue;
+      }
+
+      string::size_type quality = entry.find("q=", separator);
+      if(separator == string::npos || quality == string::npos) {
+         return 1;
+      }
+      try {
+         return stod(entry.substr(quality + 2));
+      }
+      catch(exception& e) {
+         return 0;
+      }
+   }
+
+   return -1;
+}
+
+/******************************************************************************
+ * Name: Asset::encoded
+ ******************************************************************************
+ */
+const std::string& StaticAssets::Asset::encoded(Encoding encoding) const
+{
+   if(encoding == Encoding::BROTLI && !brotliBody.empty()) {
+      return brotliBody;
+   }
+   if(encoding == Encoding::GZIP && !gzipBody.empty()) {
+      return gzipBody;
+   }
+
+   return body;
+}
+
+/******************************************************************************
+ * Name: Asset::entityTag
+ * Description: The encoding goes inside the quotes, as in "1a2b3c-br".
+ ******************************************************************************
+ */
+std::string StaticAssets::Asset::entityTag(Encoding encoding) const
+{
+   const string& encodedBody = encoded(encoding);
+   if(&encodedBody == &brotliBody) {
+      return etag.substr(0, etag.size() - 1) + "-br\"";
+   }
+   if(&encodedBody == &gzipBody) {
+      return etag.substr(0, etag.size() - 1) + "-gzip\"";
+   }
+
+   return etag;
+}
+
+/******************************************************************************
+ * Name: Asset::isCompressed
+ ******************************************************************************
+ */
+bool StaticAssets::Asset::isCompressed() const
+{
+   return !gzipBody.empty() || !brotliBody.empty();
+}
+
+/******************************************************************************
+ * Name: listDirectory
+ * Description: The names of the files and subdirectories of a directory.
+ ******************************************************************************
+ */
+static void listDirectory(const string& path, vector<string>& files, vector<string>& directories)
+{
+   DIR* dir = opendir(path.c_str());
+   if(dir == nullptr) {
+      return;
+   }
+
+   while(dirent* entry = readdir(dir)) {
+      string name = entry->d_name;
+      struct stat info;
+      if(name[0] == '.' || stat((path + "/" + name).c_str(), &info) != 0) {
+         continue;
+      }
+
+      if(S_ISDIR(info.st_mode)) {
+         directories.push_back(name);
+      } else if(S_ISREG(info.st_mode)) {
+         files.push_back(name);
+      }
+   }
+
+   closedir(dir);
+}
+
+/******************************************************************************
+ * Name: Constructor
+ ******************************************************************************
+ */
+StaticAssets::StaticAssets(const std::string& rootPath, const std::vector<std::string>& directories,
+                           std::size_t maxFileBytes, bool isCompressed)
+   : mRootPath(rootPath),
+     mDirectories(directories),
+     mMaxFileBytes(maxFileBytes),
+     mIsCompressed(isCompressed),
+     mAssets(make_shared<const Assets>())
+{
+}
+
+/******************************************************************************
+ * Name: Destructor
+ ******************************************************************************
+ */
+StaticAssets::~StaticAssets()
+{
+   stopWatching();
+}
+
+/******************************************************************************
+ * Name: load
+ * Description: Read every file and publish them together.
+ ******************************************************************************
+ */
+void StaticAssets::load()
+{
+   lock_guard<mutex> lock(mUpdateMutex);
+
+   shared_ptr<Assets> assets = make_shared<Assets>();
+   for(const string& directory : mDirectories) {
+      readDirectory(directory, *assets);
+   }
+   atomic_store(&mAssets, shared_ptr<const Assets>(assets));
+
+   Logger::instance().log(Logger::LogLevel::INFO, "StaticAssets", "load(). & files, & bytes.", numAssets(), numBytes());
+}
+
+/******************************************************************************
+ * Name: find
+ ******************************************************************************
+ */
+std::shared_ptr<const StaticAssets::Asset> StaticAssets::find(const std::string& path) const
+{
+   shared_ptr<const Assets> assets = atomic_load(&mAssets);
+
+   auto found = assets->find(path);
+   if(found == assets->end()) {
+      return nullptr;
+   }
+
+   return found->second;
+}
+
+/******************************************************************************
+ * Name: refresh
+ * Description: Publish a copy of the files with the one file changed. Only the
+ *              pointers are copied.
+ ******************************************************************************
+ */
+bool StaticAssets::refresh(const std::string& path)
+{
+   shared_ptr<const Asset> asset = read(path);
+
+   lock_guard<mutex> lock(mUpdateMutex);
+
+   shared_ptr<Assets> assets = make_shared<Assets>(*atomic_load(&mAssets));
+   if(asset) {
+      (*assets)[path] = asset;
+   } else {
+      assets->erase(path);
+   }
+   atomic_store(&mAssets, shared_ptr<const Assets>(assets));
+
+   return asset != nullptr;
+}
+
+/******************************************************************************
+ * Name: numAssets
+ ******************************************************************************
+ */
+std::size_t StaticAssets::numAssets() const
+{
+   return atomic_load(&mAssets)->size();
+}
+
+/******************************************************************************
+ * Name: numBytes
+ ******************************************************************************
+ */
+std::size_t StaticAssets::numBytes() const
+{
+   size_t numBytes = 0;
+   for(const auto& asset : *atomic_load(&mAssets)) {
+      numBytes += asset.second->body.size() + asset.second->gzipBody.size() + asset.second->brotliBody.size();
+   }
+
+   return numBytes;
+}
+
+/******************************************************************************
+ * Name: startWatching
+ * Description: Start the thread that refreshes changed files.
+ ******************************************************************************
+ */
+void StaticAssets::startWatching()
+{
+   if(mMaxFileBytes == 0 || mIsWatching.exchange(true)) {
+      return;
+   }
+
+   mWatcher = thread(&StaticAssets::watch, this);
+}
+
+/******************************************************************************
+ * Name: stopWatching
+ * Description: Stop the watcher thread.
+ ******************************************************************************
+ */
+void StaticAssets::stopWatching()
+{
+   mIsWatching = false;
+
+   if(mWatcher.joinable()) {
+      mWatcher.join();
+   }
+}
+
+/******************************************************************************
+ * Name: contentType
+ ******************************************************************************
+ */
+std::string StaticAssets::contentType(const std::string& path)
+{
+   string::size_type dot = path.rfind('.');
+   if(dot == string::npos || path.find('/', dot) != string::npos) {
+      return "application/octet-stream";
+   }
+
+   string extension = path.substr(dot + 1);
+   for(char& c : extension) {
+      c = (char)tolower((unsigned char)c);
+   }
+
+   auto found = CONTENT_TYPES.find(extension);
+
+   return found == CONTENT_TYPES.end() ? "application/octet-stream" : found->second;
+}
+
+/******************************************************************************
+ * Name: chooseEncoding
+ * Description: Choose the accepted encoding with the highest quality. An
+ *              encoding not named is accepted if "*" is, and no encoding is
+ *              accepted unless refused.
+ ******************************************************************************
+ */
+StaticAssets::Encoding StaticAssets::chooseEncoding(const std::string& acceptEncoding, const Asset& asset)
+{
+   double any = acceptedQuality(acceptEncoding, "*");
+   auto quality = [&](const string& encoding, double unnamed) {
+      double named = acceptedQuality(acceptEncoding, encoding);
+      return named >= 0 ? named : (any >= 0 ? any : unnamed);
+   };
+
+   Encoding chosen = Encoding::IDENTITY;
+   double best = quality("identity", 1);
+
+   if(!asset.gzipBody.empty()) {
+      double gzip = max(quality("gzip", 0), acceptedQuality(acceptEncoding, "x-gzip"));
+      if(gzip > 0 && gzip >= best) {
+         chosen = Encoding::GZIP;
+         best = gzip;
+      }
+   }
+   if(!asset.brotliBody.empty()) {
+      double brotli = quality("br", 0);
+      if(brotli > 0 && brotli >= best) {
+         chosen = Encoding::BROTLI;
+      }
+   }
+
+   return chosen;
+}
+
+/******************************************************************************
+ * Name: isNotModified
+ ******************************************************************************
+ */
+bool StaticAssets::isNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince,
+                                 const std::string& etag, std::time_t modified)
+{
+   if(!ifNoneMatch.empty()) {
+      istringstream stream(ifNoneMatch);
+      string tag;
+      while(getline(stream, tag, ',')) {
+         tag.erase(remove_if(tag.begin(), tag.end(), [](char c) { return isspace((unsigned char)c); }), tag.end());
+         if(tag == "*" || opaqueTag(tag) == opaqueTag(etag)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   if(ifModifiedSince.empty()) {
+      return false;
+   }
+
+   tm since = {};
+   const char* end = strptime(ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &since);
+   if(end == nullptr) {
+      return false;
+   }
+
+   return modified <= timegm(&since);
+}
+
+/******************************************************************************
+ * Name: httpDate
+ ******************************************************************************
+ */
+std::string StaticAssets::httpDate(std::time_t time)
+{
+   tm utc = {};
+   gmtime_r(&time, &utc);
+
+   char date[64];
+   strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+
+   return date;
+}
+
+/******************************************************************************
+ * Name: fileEntityTag
+ ******************************************************************************
+ */
+std::string StaticAssets::fileEntityTag(std::uint64_t size, std::time_t modified)
+{
+   ostringstream tag;
+   tag << "W/\"" << hex << size << "-" << (uint64_t)modified << "\"";
+
+   return tag.str();
+}
+
+/******************************************************************************
+ * Name: read
+ ******************************************************************************
+ */
+std::shared_ptr<const StaticAssets::Asset> StaticAssets::read(const std::string& path) const
+{
+   string fullPath = mRootPath + "/" + path;
+
+   struct stat info;
+   if(mMaxFileBytes == 0 || stat(fullPath.c_str(), &info) != 0 || !S_ISREG(info.st_mode) ||
+      (size_t)info.st_size > mMaxFileBytes) {
+      return nullptr;
+   }
+
+   ifstream file(fullPath, ios::binary);
+   if(!file.is_open()) {
+      return nullptr;
+   }
+
+   stringstream body;
+   body << file.rdbuf();
+
+   shared_ptr<Asset> asset = make_shared<Asset>();
+   asset->body = body.str();
+   asset->contentType = contentType(path);
+   asset->modified = info.st_mtime;
+   asset->lastModified = httpDate(asset->modified);
+
+   ostringstream etag;
+   etag << "\"" << hex << contentHash(asset->body) << "\"";
+   asset->etag = etag.str();
+
+   if(mIsCompressed && isCompressible(asset->contentType)) {
+      asset->gzipBody = gzipCompress(asset->body);
+      if(asset->gzipBody.size() >= asset->body.size()) {
+         asset->gzipBody.clear();
+      }
+      asset->brotliBody = brotliCompress(asset->body, asset->contentType);
+      if(asset->brotliBody.size() >= asset->body.size()) {
+         asset->brotliBody.clear();
+      }
+   }
+
+   return asset;
+}
+
+/******************************************************************************
+ * Name: readDirectory
+ ******************************************************************************
+ */
+void StaticAssets::readDirectory(const std::string& directory, Assets& assets) const
+{
+   vector<string> files;
+   vector<string> directories;
+   listDirectory(mRootPath + "/" + directory, files, directories);
+
+   for(const string& name : files) {
+      string path = directory + "/" + name;
+      shared_ptr<const Asset> asset = read(path);
+      if(asset) {
+         assets[path] = asset;
+      }
+   }
+
+   for(const string& name : directories) {
+      readDirectory(directory + "/" + name, assets);
+   }
+}
+
+/******************************************************************************
+ * Name: refreshDirectory
+ * Description: Replace the files below the directory with what is on the disk.
+ ******************************************************************************
+ */
+void StaticAssets::refreshDirectory(const std::string& directory)
+{
+   Assets found;
+   readDirectory(directory, found);
+
+   lock_guard<mutex> lock(mUpdateMutex);
+
+   shared_ptr<Assets> assets = make_shared<Assets>(*atomic_load(&mAssets));
+   string prefix = directory + "/";
+   for(auto asset = assets->lower_bound(prefix); asset != assets->end() && asset->first.compare(0, prefix.size(), prefix) == 0;) {
+      asset = assets->erase(asset);
+   }
+   assets->insert(found.begin(), found.end());
+   atomic_store(&mAssets, shared_ptr<const Assets>(assets));
+}
+
+/******************************************************************************
+ * Name: addWatches
+ ******************************************************************************
+ */
+void StaticAssets::addWatches(int fd, const std::string& directory, std::map<int, std::string>& watches) const
+{
+   int wd = inotify_add_watch(fd, (mRootPath + "/" + directory).c_str(), WATCH_EVENTS);
+   if(wd < 0) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "StaticAssets", "addWatches(). Cannot watch &.", directory);
+      return;
+   }
+   watches[wd] = directory;
+
+   vector<string> files;
+   vector<string> directories;
+   listDirectory(mRootPath + "/" + directory, files, directories);
+   for(const string& name : directories) {
+      addWatches(fd, directory + "/" + name, watches);
+   }
+}
+
+/******************************************************************************
+ * Name: watch
+ * Description: Refresh each file named by an event. Deploys usually change
+ *              many files at once, so the events read together are applied
+ *              together.
+ ******************************************************************************
+ */
+void StaticAssets::watch()
+{
+   int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if(fd < 0) {
+      Logger::instance().log(Logger::LogLevel::ERROR, "StaticAssets", "watch(). Cannot watch for changes.");
+      return;
+   }
+
+   map<int, string> watches;
+   for(const string& directory : mDirectories) {
+      addWatches(fd, directory, watches);
+   }
+
+   alignas(inotify_event) char buffer[4096];
+   pollfd events = {fd, POLLIN, 0};
+
+   while(mIsWatching) {
+      if(poll(&events, 1, WATCH_POLL_MS) <= 0) {
+         continue;
+      }
+
+      vector<string> changedFiles;
+      vector<string> changedDirectories;
+      ssize_t length = 0;
+      while((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+         for(char* pos = buffer; pos < buffer + length;) {
+            inotify_event* event = reinterpret_cast<inotify_event*>(pos);
+            auto watched = watches.find(event->wd);
+            if(event->mask & IN_IGNORED) {
+               watches.erase(event->wd);
+            } else if(watched != watches.end() && event->len > 0 && event->name[0] != '.') {
+               string path = watched->second + "/" + event->name;
+               if(!(event->mask & IN_ISDIR)) {
+                  // A new file is read when it is closed.
+                  if(!(event->mask & IN_CREATE)) {
+                     changedFiles.push_back(path);
+                  }
+               } else if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                  addWatches(fd, path, watches);
+                  changedDirectories.push_back(path);
+               } else if(event->mask & IN_MOVED_FROM) {
+                  changedDirectories.push_back(path);
+               }
+            }
+            pos += sizeof(inotify_event) + event->len;
+         }
+      }
+
+      for(const string& path : changedFiles) {
+         refresh(path);
+      }
+      for(const string& path : changedDirectories) {
+         refreshDirectory(path);
+      }
+
+      if(!changedFiles.empty() || !changedDirectories.empty()) {
+         Logger::instance().log(Logger::LogLevel::INFO, "StaticAssets", "watch(). Refreshed. & files, & bytes.", numAssets(), numBytes());
+      }
+   }
+
+   close(fd);
+}
+
+} // End namespace dw
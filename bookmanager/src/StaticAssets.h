@@ -0,0 +1,235 @@
+/**
+ * @class StaticAssets
+ *
+ * The css, fonts, img and js files, read into memory when the server starts so requests
+ * for them are answered without touching the disk. The content type of each file is
+ * worked out once, when it is read.
+ *
+ * A thread watches the directories and reads a file again when it is written, added or
+ * replaced, and removes it when it is deleted. Each change publishes a new set of files,
+ * so find() takes no lock and a request always sees a whole file.
+ *
+ * Files larger than the maximum size are not kept, and are served from the disk.
+ *
+ * Text, scripts and fonts are also compressed with gzip and brotli when they are read,
+ * so requests that accept either are answered with the smaller file without compressing
+ * it again. Variants that are not smaller than the file are not kept.
+ *
+ * Each file's entity tag is a hash of its contents, so it only changes when the file
+ * does, and is the same on every server.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef STATICASSETS_H
+#define STATICASSETS_H
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dw {
+
+class StaticAssets
+{
+public:
+
+   /*---------  Public Types  --------------------*/
+
+   enum class Encoding
+   {
+      IDENTITY,
+      GZIP,
+      BROTLI
+   };
+
+   struct Asset
+   {
+      std::string body;
+      std::string gzipBody;      // Empty if not compressed with gzip.
+      std::string brotliBody;    // Empty if not compressed with brotli.
+      std::string contentType;
+      std::time_t modified;
+      std::string lastModified;  // modified as an HTTP date.
+      std::string etag;          // A hash of body, quoted.
+
+      /**
+       * Returns the body in an encoding the asset has.
+       */
+      const std::string& encoded(Encoding encoding) const;
+
+      /**
+       * Returns the entity tag of the body in an encoding. Each encoding has its own.
+       */
+      std::string entityTag(Encoding encoding) const;
+
+      /**
+       * Returns true if the asset has compressed variants, so responses vary by
+       * Accept-Encoding.
+       */
+      bool isCompressed() const;
+   };
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * @param rootPath the directory holding the asset directories.
+    * @param directories the asset directories, such as "css" and "js".
+    * @param maxFileBytes the largest file kept in memory. 0 keeps none.
+    * @param isCompressed true to keep gzip and brotli variants of the files.
+    */
+   StaticAssets(const std::string& rootPath, const std::vector<std::string>& directories,
+                std::size_t maxFileBytes, bool isCompressed = true);
+
+   /**
+    * Stops the watcher thread.
+    */
+   ~StaticAssets();
+
+   /**
+    * Disable copying
+    */
+   StaticAssets(const StaticAssets& rhs) = delete;
+   void operator=(const StaticAssets& rhs) = delete;
+
+   /**
+    * Read all the files in the directories and their subdirectories.
+    */
+   void load();
+
+   /**
+    * Returns a file, or nullptr if it is not kept.
+    *
+    * @param path the file's path below the root, such as "js/vue.min.js".
+    */
+   std::shared_ptr<const Asset> find(const std::string& path) const;
+
+   /**
+    * Read a file again, or stop keeping it if it was deleted or has grown too large.
+    *
+    * @param path the file's path below the root.
+    * @return true if the file is kept.
+    */
+   bool refresh(const std::string& path);
+
+   /**
+    * Returns the number of files kept.
+    */
+   std::size_t numAssets() const;
+
+   /**
+    * Returns the bytes of the files kept, including their compressed variants.
+    */
+   std::size_t numBytes() const;
+
+   /**
+    * Start a thread that refreshes the files when they change on the disk.
+    */
+   void startWatching();
+
+   /**
+    * Stop the watcher thread.
+    */
+   void stopWatching();
+
+   /**
+    * Returns the content type of a file from its extension.
+    *
+    * @param path the file's path.
+    */
+   static std::string contentType(const std::string& path);
+
+   /**
+    * Returns the encoding of an asset a client prefers. Brotli is preferred to gzip,
+    * and gzip to no encoding, when the client accepts them equally.
+    *
+    * @param acceptEncoding the request's Accept-Encoding header, such as "gzip, br".
+    * @param asset the asset.
+    */
+   static Encoding chooseEncoding(const std::string& acceptEncoding, const Asset& asset);
+
+   /**
+    * Returns true if a conditional request's copy of a file is current, so it can be
+    * answered with 304 Not Modified. If-Modified-Since is only used when the request
+    * has no If-None-Match.
+    *
+    * @param ifNoneMatch the request's If-None-Match header, or an empty string.
+    * @param ifModifiedSince the request's If-Modified-Since header, or an empty string.
+    * @param etag the file's entity tag.
+    * @param modified when the file was last changed.
+    */
+   static bool isNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince,
+                             const std::string& etag, std::time_t modified);
+
+   /**
+    * Returns a time as an HTTP date, such as "Mon, 19 Oct 2026 14:30:00 GMT".
+    */
+   static std::string httpDate(std::time_t time);
+
+   /**
+    * Returns a weak entity tag for a file that is not kept, from its size and the time
+    * it was last changed.
+    */
+   static std::string fileEntityTag(std::uint64_t size, std::time_t modified);
+
+private:
+
+   /*---------  Private Types  -------------------*/
+
+   typedef std::map<std::string, std::shared_ptr<const Asset>> Assets;
+
+   /*---------  Private Functions  ---------------*/
+
+   /**
+    * Read a file into an Asset, or return nullptr if it cannot be read or is too large.
+    */
+   std::shared_ptr<const Asset> read(const std::string& path) const;
+
+   /**
+    * Read the files of a directory and its subdirectories into assets.
+    */
+   void readDirectory(const std::string& directory, Assets& assets) const;
+
+   /**
+    * Read a directory again after it was added, moved or removed.
+    */
+   void refreshDirectory(const std::string& directory);
+
+   /**
+    * Watch a directory and its subdirectories, adding each to watches.
+    */
+   void addWatches(int fd, const std::string& directory, std::map<int, std::string>& watches) const;
+
+   /**
+    * The watcher thread.
+    */
+   void watch();
+
+   /*---------  Private Data  --------------------*/
+
+   const std::string mRootPath;
+   const std::vector<std::string> mDirectories;
+   const std::size_t mMaxFileBytes;
+   const bool mIsCompressed;
+
+   // Read with std::atomic_load and replaced with std::atomic_store. Writers hold
+   // mUpdateMutex so no change is lost.
+   std::shared_ptr<const Assets> mAssets;
+   std::mutex mUpdateMutex;
+
+   std::thread mWatcher;
+   std::atomic<bool> mIsWatching{false};
+};
+
+} // End namespace dw
+
+#endif // STATICASSETS_H
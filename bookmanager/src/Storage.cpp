@@ -0,0 +1,81 @@
+#include "Storage.h"
+
+#include "BookRepository.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "MemoryBookStore.h"
+#include "MemoryTokenStore.h"
+#include "MemoryUserStore.h"
+#include "TokenRepository.h"
+#include "UserRepository.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+namespace dw {
+
+static StorageBackend configuredBackend()
+{
+   StorageBackend backend = StorageBackend::SQLITE;
+   
+   try {
+      std::string name = ConfigReader::getInstance().getConfig(ConfigReader::Config::STORAGE_BACKEND);
+      if(name == "memory") {
+         backend = StorageBackend::MEMORY;
+      } else if(name != "sqlite") {
+         Logger::instance().log(Logger::LogLevel::ERROR, "Storage", "Unknown storage backend &. Using sqlite.", name);
+      }
+   }
+   catch(std::out_of_range& e) {
+      backend = StorageBackend::SQLITE;
+   }
+   
+   return backend;
+}
+
+static std::atomic<StorageBackend>& currentBackend()
+{
+   static std::atomic<StorageBackend> backend(configuredBackend());
+   
+   return backend;
+}
+
+StorageBackend storage_backend()
+{
+   return currentBackend();
+}
+
+void storage_setBackend(StorageBackend backend)
+{
+   currentBackend() = backend;
+}
+
+std::unique_ptr<BookStore> storage_bookStore(SQLite::Database* db)
+{
+   if(storage_backend() == StorageBackend::MEMORY) {
+      return std::unique_ptr<BookStore>(new MemoryBookStore());
+   }
+   
+   return std::unique_ptr<BookStore>(new BookRepository(db));
+}
+
+std::unique_ptr<UserStore> storage_userStore()
+{
+   if(storage_backend() == StorageBackend::MEMORY) {
+      return std::unique_ptr<UserStore>(new MemoryUserStore());
+   }
+   
+   return std::unique_ptr<UserStore>(new UserRepository());
+}
+
+std::unique_ptr<TokenStore> storage_tokenStore()
+{
+   if(storage_backend() == StorageBackend::MEMORY) {
+      return std::unique_ptr<TokenStore>(new MemoryTokenStore());
+   }
+   
+   return std::unique_ptr<TokenStore>(new TokenRepository());
+}
+
+} // End namespace dw
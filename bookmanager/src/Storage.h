@@ -0,0 +1,67 @@
+/**
+ * Functions to create the data stores for the selected storage backend.
+ * 
+ * The backend is set with STORAGE_BACKEND in config.cfg:
+ *    sqlite - the SQLite database at DB_PATH. This is the default.
+ *    memory - in-memory stores shared by all threads. Data is lost when the server stops,
+ *             so it is only meant for load tests and benchmarks.
+ * 
+ * The write behind buffer, book archive and batch transactions only apply to the
+ * SQLite backend.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef STORAGE_H
+#define STORAGE_H
+
+/*---------  Program Includes  ----------------*/
+#include "BookStore.h"
+#include "TokenStore.h"
+#include "UserStore.h"
+
+/*--------  System Includes  --------------*/
+#include <memory>
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+   
+   enum class StorageBackend
+   {
+      SQLITE,
+      MEMORY
+   };
+   
+   /**
+    * Get the storage backend in use. Read from config.cfg the first time it is called.
+    */
+   StorageBackend storage_backend();
+   
+   /**
+    * Change the storage backend. Used by tests and benchmarks.
+    */
+   void storage_setBackend(StorageBackend backend);
+   
+   /**
+    * Create a book store for the current backend.
+    * 
+    * @param db optional SQLite connection to use, for example one with an open
+    *           transaction. Ignored by the memory backend.
+    */
+   std::unique_ptr<BookStore> storage_bookStore(SQLite::Database* db = nullptr);
+   
+   /**
+    * Create a user store for the current backend.
+    */
+   std::unique_ptr<UserStore> storage_userStore();
+   
+   /**
+    * Create a token store for the current backend.
+    */
+   std::unique_ptr<TokenStore> storage_tokenStore();
+}
+#endif
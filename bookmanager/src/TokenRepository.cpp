@@ -1,6 +1,9 @@
 #include "TokenRepository.h"
+#include "ChangeJournal.h"
 #include "ConfigReader.h"
 #include "Logger.h"
+#include "RequestDeadline.h"
+#include "StatementRetry.h"
 
 #include <climits>
 #include <ctime>
@@ -39,6 +42,7 @@ TokenRepository::TokenRepository()
    
    mDb = make_shared<SQLite::Database>(dbPath, 
                                        SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   RequestDeadline::watch(*mDb);
 }
 
 /******************************************************************************
@@ -68,9 +72,10 @@ TokenRepository::create(unsigned int userId)
       statement.bind(1, userId);
       statement.bind(2, token);
       
-      int result = statement.exec();
+      int result = StatementRetry::instance().exec(*mDb, statement, "tokens.create");
       
       if(result) {      
+         ChangeJournal::instance().recordUpsert(*mDb, "tokens", {{"token", token}});
          Logger::instance().log(Logger::LogLevel::DEBUG, "TokenRepository", "create(). Token created.");
       } else {
          Logger::instance().log(Logger::LogLevel::ERROR, "TokenRepository", "create(). ERROR token not saved.");
@@ -164,7 +169,11 @@ TokenRepository::remove(std::string token)
    SQLite::Statement query(*mDb, REMOVE_SQL);
    query.bind(1, token);
    
-   int affectedRows = query.exec();
+   int affectedRows = StatementRetry::instance().exec(*mDb, query, "tokens.remove");
+   
+   if(affectedRows > 0) {
+      ChangeJournal::instance().recordDelete(*mDb, "tokens", {{"token", token}});
+   }
 
    return (affectedRows > 0);
 }
@@ -12,6 +12,9 @@
 #ifndef TOKENREPOSITORY_H
 #define TOKENREPOSITORY_H
 
+/*---------  Program Includes  ----------------*/
+#include "TokenStore.h"
+
 /*--------  System Includes  --------------*/
 #include <memory>
 #include <string>
@@ -20,7 +23,7 @@
 
 namespace dw {
    
-class TokenRepository
+class TokenRepository : public TokenStore
 {
 public:
    /*-----------  Public Constants  ----------------*/
@@ -32,7 +35,7 @@ public:
     * Constructor and destructor
     */
    TokenRepository();
-   virtual ~TokenRepository();
+   ~TokenRepository() override;
 
    /**
     * Remove all expired tokens from the database.
@@ -44,7 +47,7 @@ public:
     * @param userId the user ID to create the token for.
     */
    std::string 
-   create(unsigned int userId);
+   create(unsigned int userId) override;
 
    /**
     * Check to see if a token exists in the database.
@@ -52,7 +55,7 @@ public:
     * @return bool
     */
    bool 
-   exists(std::string token);
+   exists(std::string token) override;
    
    /**
     * Find the token for the given user Id.
@@ -60,7 +63,7 @@ public:
     * @return the token for the given user.
     */
    std::string 
-   getTokenForUserId(unsigned int userId);
+   getTokenForUserId(unsigned int userId) override;
    
    /**
     * Find the user ID for a given token.
@@ -69,7 +72,7 @@ public:
     * @return the user ID
     */
    long 
-   getUserIdForToken(const std::string& token);
+   getUserIdForToken(const std::string& token) override;
 
    /**
     * Remove the given token from the database.
@@ -78,7 +81,7 @@ public:
     * @remove return true if the token was deleted.
     */
    bool
-   remove(std::string token);
+   remove(std::string token) override;
    
 private:
    /*-----------  Private Functions  ---------------*/
@@ -0,0 +1,69 @@
+/**
+ * @class TokenStore
+ * 
+ * Interface to the authentication token data store. TokenRepository is the SQLite
+ * implementation and MemoryTokenStore is the in-memory implementation.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef TOKENSTORE_H
+#define TOKENSTORE_H
+
+/*--------  System Includes  --------------*/
+#include <string>
+
+namespace dw {
+
+class TokenStore
+{
+public:
+   /*-----------  Public Functions  ----------------*/
+   
+   virtual ~TokenStore() = default;
+   
+   /**
+    * Create a token for a user. If the user already has a token it is returned.
+    * 
+    * @param userId the user ID to create the token for.
+    * @return the token, or an empty string if it could not be created.
+    */
+   virtual std::string create(unsigned int userId) = 0;
+   
+   /**
+    * Check to see if a token exists.
+    * 
+    * @param token the token to look for.
+    * @return bool
+    */
+   virtual bool exists(std::string token) = 0;
+   
+   /**
+    * Find the token for the given user Id.
+    * 
+    * @param userId
+    * @return the token for the given user, or an empty string if there is none.
+    */
+   virtual std::string getTokenForUserId(unsigned int userId) = 0;
+   
+   /**
+    * Find the user ID for a given token.
+    * 
+    * @param token the token to find the ID for.
+    * @return the user ID, or 0 if the token is not found.
+    */
+   virtual long getUserIdForToken(const std::string& token) = 0;
+   
+   /**
+    * Remove the given token.
+    * 
+    * @param token The token to remove.
+    * @return true if the token was deleted.
+    */
+   virtual bool remove(std::string token) = 0;
+};
+
+} // End namespace dw
+
+#endif // TOKENSTORE_H
@@ -109,7 +109,7 @@ string User::toString() const
 void User::parseJsonString(const std::string& jsonString)
 {
    auto data = nlohmann::json::parse(jsonString);
-   Logger::instance().log(Logger::LogLevel::INFO, "User", "Parse JSON string &.", data);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "User", "Parse JSON string of & bytes.", data.size());
    //cout << "In User::parseJsonString - Data is " << data << " size " << data.size() << endl;
      
    if(data.size() < 3) {
@@ -41,6 +41,7 @@ class User final
         const std::string& email, 
         const std::string& password);
    explicit User(const std::string& jsonString);
+   User(const User& other) = default;
    virtual ~User() = default;
    
    User& operator= (const User& other);
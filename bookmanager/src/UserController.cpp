@@ -35,7 +35,7 @@ UserController::~UserController()
 JsonResponse 
 UserController::registerUser(std::string jsonData)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "UserController", "registerUser. JSON: &.", jsonData);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "UserController", "registerUser. JSON of & bytes.", jsonData.size());
    
    Pistache::Http::Code code = Pistache::Http::Code::Internal_Server_Error;
    std::ostringstream json;
@@ -64,7 +64,7 @@ UserController::registerUser(std::string jsonData)
 JsonResponse
 UserController::loginUser(std::string jsonData)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "UserController", "login. JSON: &.", jsonData);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "UserController", "login. JSON of & bytes.", jsonData.size());
    
    // Parse the json string to get the username and password
    auto data = nlohmann::json::parse(jsonData);
@@ -115,7 +115,7 @@ UserController::loginUser(std::string jsonData)
 JsonResponse
 UserController::logoutUser(std::string jsonData)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "UserController", "logout.");
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "UserController", "logout.");
    
    std::string token;
    bool isSuccessful = false;
@@ -1,8 +1,11 @@
 /*---------  Program Includes  ----------------*/
 #include "UserRepository.h"
+#include "ChangeJournal.h"
 #include "ConfigReader.h"
 #include "dbConnect.h"
 #include "Logger.h"
+#include "RequestDeadline.h"
+#include "StatementRetry.h"
 
 /*--------  System Includes  --------------*/
 #include <SQLiteCpp/SQLiteCpp.h>
@@ -32,6 +35,7 @@ UserRepository::UserRepository()
 //   mDb = make_shared<SQLite::Database>(mDbPath, 
 //                                       SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
 mDb = db_getConnection();
+RequestDeadline::watch(*mDb);
 
 }
 
@@ -104,7 +108,7 @@ UserRepository::getUserId(string email, string password)
 {
    Logger::instance().log(Logger::LogLevel::DEBUG, 
                           "UserRepository", 
-                          "getUserId(). Email: & Password: &.", email, password);
+                          "getUserId(). Email: &.", email);
       
    long userId = 0;
    
@@ -137,12 +141,15 @@ UserRepository::remove(unsigned int id)
    string sql = "DELETE FROM users WHERE id = ?";
    SQLite::Database db(mDbPath, 
                        SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   RequestDeadline::watch(db);
    SQLite::Statement query(db, sql);
    query.bind(1, (long long)id);
-   int result = query.exec();
+   int result = StatementRetry::instance().exec(db, query, "users.remove");
    
    if(result != 1) {
       Logger::instance().log(Logger::LogLevel::ERROR, "UserRepository", "remove(). ERROR: &.", result);
+   } else {
+      ChangeJournal::instance().recordDelete(db, "users", {{"id", id}});
    }
 }
 
@@ -165,18 +172,20 @@ UserRepository::store(const User& user)
    //
    SQLite::Database db(mDbPath, 
                        SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
+   RequestDeadline::watch(db);
    SQLite::Statement query(db, insertQuery);
    
    query.bind(1, user.name());
    query.bind(2, user.email());
    query.bind(3, user.password());
    
-   int result = query.exec();
+   int result = StatementRetry::instance().exec(db, query, "users.store");
    
    if(result) {
       newId = db.getLastInsertRowid();
+      ChangeJournal::instance().recordUpsert(db, "users", {{"id", newId}});
       
-      Logger::instance().log(Logger::LogLevel::DEBUG, "UserRepository", "store(). User created. Id is: &.", to_string(newId));
+      Logger::instance().log(Logger::LogLevel::DEBUG, "UserRepository", "store(). User created. Id is: &.", newId);
    } else {
       Logger::instance().log(Logger::LogLevel::ERROR, "UserRepository", "store(). ERROR user not saved.");
       newId = 0;
@@ -203,9 +212,10 @@ UserRepository::updatePassword(unsigned int id, const std::string& password)
    query.bind(1, password);
    query.bind(2, (long long)id);
 
-   int result = query.exec();
+   int result = StatementRetry::instance().exec(*mDb, query, "users.update_password");
    
    if(result) {
+      ChangeJournal::instance().recordUpsert(*mDb, "users", {{"id", id}});
       isUpdated = true;
    }
    
@@ -1,7 +1,7 @@
 /**
  * @class UserRepository
  * 
- * Handles storing, updating and retrieving data from the user data store.
+ * SQLite implementation of the user data store.
  * One database connection is shared for all get requests. All database writes create
  * a new connection and close it when finished.
  * 
@@ -15,6 +15,7 @@
 
 /*---------  Program Includes  ----------------*/
 #include "User.h"
+#include "UserStore.h"
 
 /*--------  System Includes  --------------*/
 #include <memory>
@@ -23,7 +24,7 @@
 
 namespace dw {
  
-class UserRepository
+class UserRepository : public UserStore
 {
 public:
    /*-----------  Public Functions  ----------------*/
@@ -32,7 +33,7 @@ public:
     * Constructor and destructor
     */
    UserRepository();
-   virtual ~UserRepository();
+   ~UserRepository() override;
    
    /**
     * Disable copying
@@ -45,7 +46,7 @@ public:
    * 
    * @return long int
    */
-   long count();
+   long count() override;
    
    /**
     * Get all user information for the given user id. If the user is not found 
@@ -54,7 +55,7 @@ public:
     * @param id The user id to find the data for.
     * @return User
     */
-   User getById(unsigned int id);
+   User getById(unsigned int id) override;
       
    /**
    * Check if the given user ID / password combination is in the database. Returns 
@@ -64,14 +65,14 @@ public:
    * @param password The user's password
    * @return long
    */
-   long getUserId(std::string email, std::string password);
+   long getUserId(std::string email, std::string password) override;
    
    /**
    * Remove the user with the given id from the database.
    * 
    * @param id the user id
    */
-   void remove(unsigned int id);
+   void remove(unsigned int id) override;
    
    /**
     * Store a new user object in the data store.
@@ -79,7 +80,7 @@ public:
     * @param user The user to store.
     * @return New user ID if successful, otherwise 0. 
     */
-   long store(const User& user);
+   long store(const User& user) override;
   
    /**
    * Update the user's password.
@@ -88,7 +89,7 @@ public:
    * @param password the new password
    * @return bool
    */
-   bool updatePassword(unsigned int id, const std::string &password);
+   bool updatePassword(unsigned int id, const std::string &password) override;
 
    
 private:
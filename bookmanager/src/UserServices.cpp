@@ -1,8 +1,7 @@
 /*---------  Program Includes  ----------------*/
 #include "Logger.h"
 #include "UserServices.h"
-#include "UserRepository.h"
-#include "TokenRepository.h"
+#include "Storage.h"
 #include "User.h"
 
 /*---------  System Includes  -----------------*/
@@ -18,6 +17,7 @@ namespace dw {
  ******************************************************************************
  */
 UserServices::UserServices()
+           : mUserStore(storage_userStore())
 {
 
 }
@@ -43,11 +43,11 @@ UserServices::registerUser(const User& user)
    Logger::instance().log(Logger::LogLevel::DEBUG, "UserServices", "registerUser. ENTER.");
       
    string token("");
-   long newId = mUserRepository.store(user);
+   long newId = mUserStore->store(user);
    
    if(newId) {
-      TokenRepository tokenRepository;
-      token = tokenRepository.create(newId);
+      unique_ptr<TokenStore> tokenStore = storage_tokenStore();
+      token = tokenStore->create(newId);
       
    }
    
@@ -67,13 +67,10 @@ UserServices::loginUser(const string& email, const string& password)
    Logger::instance().log(Logger::LogLevel::DEBUG, "UserServices", "loginUser. ENTER. Email: &", email);
      
    string token("");
-   TokenRepository tokenRepository;
-   UserRepository userRepository;
-   
-   long userId = userRepository.getUserId(email, password);
+   long userId = mUserStore->getUserId(email, password);
    if(userId) {
-      TokenRepository tokenRepository;
-      token = tokenRepository.create(userId);      
+      unique_ptr<TokenStore> tokenStore = storage_tokenStore();
+      token = tokenStore->create(userId);      
    }
    
    Logger::instance().log(Logger::LogLevel::DEBUG, "UserServices", "loginUser. LEAVE");
@@ -91,8 +88,8 @@ UserServices::logoutUser(std::string token)
 {
    Logger::instance().log(Logger::LogLevel::DEBUG, "UserServices", "logoutUser. ENTER.");
      
-   TokenRepository tokenRepository;
-   bool isSuccessful = tokenRepository.remove(token);
+   unique_ptr<TokenStore> tokenStore = storage_tokenStore();
+   bool isSuccessful = tokenStore->remove(token);
    
    return isSuccessful;
 }
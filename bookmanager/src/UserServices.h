@@ -13,10 +13,11 @@
 
 /*---------  Program Includes  ----------------*/
 #include "User.h"
-#include "UserRepository.h"
+#include "UserStore.h"
 #include "JsonResponse.h"
 
 /*---------  System Includes  -----------------*/
+#include <memory>
 #include <string>
 
 namespace dw {
@@ -58,7 +59,7 @@ public:
     
 private:
    /*---------  Private Data   -------------------*/
-   UserRepository mUserRepository;
+   std::unique_ptr<UserStore> mUserStore;
 };
 
 } // end namespace dw
@@ -0,0 +1,81 @@
+/**
+ * @class UserStore
+ * 
+ * Interface to the user data store. UserRepository is the SQLite implementation and
+ * MemoryUserStore is the in-memory implementation.
+ * 
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+/*---------  Program Includes  ----------------*/
+#include "User.h"
+
+/*--------  System Includes  --------------*/
+#include <string>
+
+namespace dw {
+
+class UserStore
+{
+public:
+   /*-----------  Public Functions  ----------------*/
+   
+   virtual ~UserStore() = default;
+   
+   /**
+   * Get the number of user records in the datastore.
+   * 
+   * @return long int
+   */
+   virtual long count() = 0;
+   
+   /**
+    * Get all user information for the given user id. If the user is not found 
+    * id of the returned user id will be 0.
+    * 
+    * @param id The user id to find the data for.
+    * @return User
+    */
+   virtual User getById(unsigned int id) = 0;
+   
+   /**
+   * Get the id of the user with the given email and password.
+   * 
+   * @param email The user's email address
+   * @param password The user's password
+   * @return the user id, or 0 if not found.
+   */
+   virtual long getUserId(std::string email, std::string password) = 0;
+   
+   /**
+   * Remove the user with the given id.
+   * 
+   * @param id the user id
+   */
+   virtual void remove(unsigned int id) = 0;
+   
+   /**
+    * Store a new user object in the data store.
+    * 
+    * @param user The user to store.
+    * @return New user ID if successful, otherwise 0. 
+    */
+   virtual long store(const User& user) = 0;
+   
+   /**
+   * Update the user's password.
+   * 
+   * @param id       the user's id
+   * @param password the new password
+   * @return true if the user was found and updated.
+   */
+   virtual bool updatePassword(unsigned int id, const std::string& password) = 0;
+};
+
+} // End namespace dw
+
+#endif // USERSTORE_H
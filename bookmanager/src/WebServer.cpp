@@ -1,27 +1,115 @@
 /*---------  Program Includes  ----------------*/
 #include "WebServer.h"
+#include "AdminController.h"
+#include "BatchController.h"
+#include "BookArchive.h"
 #include "BookController.h"
+#include "BookLayout.h"
+#include "DatabaseBackup.h"
+#include "DatabaseMaintenance.h"
 #include "UserController.h"
 #include "IndexPage.h"
+#include "JournalReplica.h"
 #include "JsonResponse.h"
+#include "RequestDeadline.h"
+#include "StaticAssets.h"
+#include "Storage.h"
+#include "WriteBehindBuffer.h"
 #include "dbConnect.h"
+#include "ConfigReader.h"
 #include "Logger.h"
 
 /*---------  System Includes  --------------*/
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <sys/stat.h>
 
 using namespace std;
 
 namespace dw {
+
+// Static files without a max age in STATIC_MAX_AGE are revalidated on every use.
+const char NO_CACHE[] = "no-cache";
+
+// Admin requests send ADMIN_TOKEN in this header. It is not accepted in the URL, where
+// it would be written to access logs and browser history.
+const char ADMIN_TOKEN_HEADER[] = "X-Admin-Token";
+
+/******************************************************************************
+ * Name: staticMaxFileBytes
+ * Desc: The largest static file kept in memory.
+ ******************************************************************************
+ */
+static std::size_t staticMaxFileBytes()
+{
+   long maxFileKb = ConfigReader::getInstance().getInt(ConfigReader::Config::STATIC_MAX_FILE_KB);
+
+   return (std::size_t)maxFileKb * 1024;
+}
+
+/******************************************************************************
+ * Name: isStaticCompressed
+ * Desc: True unless STATIC_COMPRESS is false.
+ ******************************************************************************
+ */
+static bool isStaticCompressed()
+{
+   try {
+      return ConfigReader::getInstance().getConfig(ConfigReader::Config::STATIC_COMPRESS) != "false";
+   }
+   catch(exception& e) {
+      return true;
+   }
+}
    
+/******************************************************************************
+ * Name: readCacheControl
+ * Desc: Read the Cache-Control of each static directory from STATIC_MAX_AGE,
+ *       such as "fonts=604800,img=86400".
+ ******************************************************************************
+ */
+static std::map<std::string, std::string> readCacheControl()
+{
+   std::map<std::string, std::string> cacheControl;
+   
+   std::string maxAges = "";
+   try {
+      maxAges = ConfigReader::getInstance().getConfig(ConfigReader::Config::STATIC_MAX_AGE);
+   }
+   catch(exception& e) {
+      maxAges = "";
+   }
+   
+   std::istringstream stream(maxAges);
+   std::string entry;
+   while(getline(stream, entry, ',')) {
+      std::string::size_type separator = entry.find('=');
+      try {
+         if(separator == std::string::npos || separator == 0) {
+            throw std::invalid_argument(entry);
+         }
+         long maxAge = stol(entry.substr(separator + 1));
+         cacheControl[entry.substr(0, separator)] = maxAge > 0 ? "public, max-age=" + to_string(maxAge) : NO_CACHE;
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "WebServer", "readCacheControl(). ERROR Invalid max age: &.", entry);
+      }
+   }
+   
+   return cacheControl;
+}
+
 /******************************************************************************
  * Constructor
  ******************************************************************************
  */
-WebServer::WebServer(Pistache::Address addr, std::string serverpath)
+WebServer::WebServer(Pistache::Address addr, std::string serverpath, bool isReplica)
           : mServerPath(serverpath),
-            mHttpEndpoint(std::make_shared<Pistache::Http::Endpoint>(addr))
+            mIsReplica(isReplica),
+            mHttpEndpoint(std::make_shared<Pistache::Http::Endpoint>(addr)),
+            mAssets(serverpath, {"css", "fonts", "img", "js"}, staticMaxFileBytes(), isStaticCompressed()),
+            mCacheControl(readCacheControl())
 {
    Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "Construct.");
 
@@ -58,6 +146,36 @@ void WebServer::init(size_t threads)
         
     mHttpEndpoint->init(options);
     
+    // Shard files are created empty, so give new shards the books table before any
+    // request or background thread writes to them.
+    if(mIsReplica || storage_backend() == StorageBackend::SQLITE) {
+        books_createShards(db_numShards());
+    }
+    
+    // Batches run in a transaction, where the archive cannot be attached, so it is
+    // attached to each connection when the connection is opened.
+    if(BookArchive::instance().isEnabled()) {
+        db_setConnectionSetup([](SQLite::Database& db, unsigned int) {
+            BookArchive::instance().attach(db);
+        });
+    }
+    
+    // These all work directly on the SQLite database. A replica's database is only
+    // changed by applying the primary's journal.
+    if(mIsReplica) {
+        JournalReplica::instance().start();
+        DatabaseBackup::instance().start();
+        DatabaseMaintenance::instance().start();
+    } else if(storage_backend() == StorageBackend::SQLITE) {
+        WriteBehindBuffer::instance().start();
+        BookArchive::instance().start();
+        DatabaseBackup::instance().start();
+        DatabaseMaintenance::instance().start();
+    }
+    
+    mAssets.load();
+    mAssets.startWatching();
+    
     setupRoutes();
 }
 
@@ -69,6 +187,12 @@ void WebServer::init(size_t threads)
 void WebServer::shutdown()
 {
     mHttpEndpoint->shutdown();
+    mAssets.stopWatching();
+    JournalReplica::instance().stop();
+    DatabaseMaintenance::instance().stop();
+    DatabaseBackup::instance().stop();
+    BookArchive::instance().stop();
+    WriteBehindBuffer::instance().stop();
 }
 
 /******************************************************************************
@@ -113,10 +237,6 @@ void WebServer::setupRoutes()
                 Pistache::Rest::Routes::bind(&WebServer::serveJs, this));
    
     // Api Routes
-    Pistache::Rest::Routes::Delete(router, 
-                "/api/v1/books/:id", 
-                Pistache::Rest::Routes::bind(&WebServer::handleDeleteBook, this));
-    
     Pistache::Rest::Routes::Get(router, 
                 "/api/v1/books/:id", 
                 Pistache::Rest::Routes::bind(&WebServer::handleGetBookById, this));
@@ -129,25 +249,52 @@ void WebServer::setupRoutes()
                 "/api/v1/books/search/:searchTerm", 
                 Pistache::Rest::Routes::bind(&WebServer::handleGetSearchBooks, this));
     
-    Pistache::Rest::Routes::Post(router,
-                 "/api/v1/books",
-                 Pistache::Rest::Routes::bind(&WebServer::handlePostBooks, this));
-   
-    Pistache::Rest::Routes::Put(router,
-                 "/api/v1/books/:id",
-                 Pistache::Rest::Routes::bind(&WebServer::handlePutBooks, this));
-   
-    Pistache::Rest::Routes::Post(router,
-                 "/api/v1/auth/login",
-                 Pistache::Rest::Routes::bind(&WebServer::handlePostLogin, this));
+    // A replica only serves reads. Changes are made on the primary.
+    if(!mIsReplica) {
+        Pistache::Rest::Routes::Delete(router, 
+                    "/api/v1/books/:id", 
+                    Pistache::Rest::Routes::bind(&WebServer::handleDeleteBook, this));
+        
+        Pistache::Rest::Routes::Post(router,
+                     "/api/v1/books",
+                     Pistache::Rest::Routes::bind(&WebServer::handlePostBooks, this));
+       
+        Pistache::Rest::Routes::Put(router,
+                     "/api/v1/books/:id",
+                     Pistache::Rest::Routes::bind(&WebServer::handlePutBooks, this));
+       
+        Pistache::Rest::Routes::Patch(router,
+                     "/api/v1/books/:id",
+                     Pistache::Rest::Routes::bind(&WebServer::handlePatchBooks, this));
+       
+        Pistache::Rest::Routes::Post(router,
+                     "/api/v1/batch",
+                     Pistache::Rest::Routes::bind(&WebServer::handlePostBatch, this));
+       
+        Pistache::Rest::Routes::Post(router,
+                     "/api/v1/auth/login",
+                     Pistache::Rest::Routes::bind(&WebServer::handlePostLogin, this));
+
+        Pistache::Rest::Routes::Post(router,
+                     "/api/v1/auth/register",
+                     Pistache::Rest::Routes::bind(&WebServer::handlePostRegister, this));
+
+        Pistache::Rest::Routes::Post(router,
+                     "/api/v1/auth/logout",
+                     Pistache::Rest::Routes::bind(&WebServer::handleLogout, this));
+    }
 
     Pistache::Rest::Routes::Post(router,
-                 "/api/v1/auth/register",
-                 Pistache::Rest::Routes::bind(&WebServer::handlePostRegister, this));
+                 "/api/v1/admin/backup",
+                 Pistache::Rest::Routes::bind(&WebServer::handlePostBackup, this));
 
-    Pistache::Rest::Routes::Post(router,
-                 "/api/v1/auth/logout",
-                 Pistache::Rest::Routes::bind(&WebServer::handleLogout, this));
+    Pistache::Rest::Routes::Get(router,
+                "/api/v1/admin/maintenance",
+                Pistache::Rest::Routes::bind(&WebServer::handleGetMaintenance, this));
+
+    Pistache::Rest::Routes::Get(router,
+                "/api/v1/admin/lockwaits",
+                Pistache::Rest::Routes::bind(&WebServer::handleGetLockWaits, this));
 
     // Catch unknown pages
     Pistache::Rest::Routes::Get(router, 
@@ -162,7 +309,7 @@ void WebServer::setupRoutes()
  ******************************************************************************
  */ 
 void WebServer::handleIndex(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response) {
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleIndex");
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handleIndex");
    
    response.send(Pistache::Http::Code::Ok, mIndexPage->getPage());
 }
@@ -177,7 +324,11 @@ void WebServer::serveCss(const Pistache::Rest::Request& request, Pistache::Http:
    auto splat = request.splatAt(0).as<std::string>();
     std::string cssFile = mServerPath + "/css/" + splat;
     
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "serveCss(). Serving &.", cssFile);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "serveCss(). Serving &.", cssFile);
+   
+   if(serveAsset("css/" + splat, request, response)) {
+      return;
+   }
     
    try {
       auto result = Pistache::Http::serveFile(response, cssFile.c_str());
@@ -201,7 +352,11 @@ void WebServer::serveFonts(const Pistache::Rest::Request& request, Pistache::Htt
    auto splat = request.splatAt(0).as<std::string>();
     std::string fontFile = mServerPath + "/fonts/" + splat;
     
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "serveFonts. Serving &.", fontFile);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "serveFonts. Serving &.", fontFile);
+   
+   if(serveAsset("fonts/" + splat, request, response)) {
+      return;
+   }
    
    try {
    auto result = Pistache::Http::serveFile(response, fontFile.c_str());
@@ -224,7 +379,11 @@ void WebServer::serveImage(const Pistache::Rest::Request& request, Pistache::Htt
    auto splat = request.splatAt(0).as<std::string>();
    std::string imgFile = mServerPath + "/img/" + splat;
     
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "serveImg(). Serving &.", imgFile);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "serveImg(). Serving &.", imgFile);
+   
+   if(serveAsset("img/" + splat, request, response)) {
+      return;
+   }
    
    try {
       auto result = Pistache::Http::serveFile(response, imgFile.c_str());
@@ -247,7 +406,11 @@ void WebServer::serveJs(const Pistache::Rest::Request& request, Pistache::Http::
    auto splat = request.splatAt(0).as<std::string>();
    std::string jsFile = mServerPath + "/js/" + splat;
     
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "serveJs(). Serving &.", jsFile);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "serveJs(). Serving &.", jsFile);
+   
+   if(serveAsset("js/" + splat, request, response)) {
+      return;
+   }
    
    try {
       response.headers().add<Pistache::Http::Header::ContentType>(MIME(Text, Javascript));
@@ -261,6 +424,65 @@ void WebServer::serveJs(const Pistache::Rest::Request& request, Pistache::Http::
    }
 }
 
+/******************************************************************************
+ * Name: serveAsset
+ * Desc: Serve a static file from memory, compressed if the client accepts it,
+ *       or answer 304 if the client's copy is current. Files too large to
+ *       keep, or added since the watcher last looked, are given their caching
+ *       headers here and served from the disk by the caller.
+ ******************************************************************************
+ */
+bool WebServer::serveAsset(const std::string& path, const Pistache::Rest::Request& request,
+                           Pistache::Http::ResponseWriter& response)
+{
+   std::string ifNoneMatch = getHeader(request, "If-None-Match");
+   std::string ifModifiedSince = getHeader(request, "If-Modified-Since");
+   
+   auto cacheControl = mCacheControl.find(path.substr(0, path.find('/')));
+   response.headers().addRaw(Pistache::Http::Header::Raw("Cache-Control",
+      cacheControl == mCacheControl.end() ? NO_CACHE : cacheControl->second));
+   
+   std::shared_ptr<const StaticAssets::Asset> asset = mAssets.find(path);
+   if(!asset) {
+      struct stat info;
+      if(stat((mServerPath + "/" + path).c_str(), &info) != 0) {
+         return false;
+      }
+      
+      std::string etag = StaticAssets::fileEntityTag(info.st_size, info.st_mtime);
+      response.headers().addRaw(Pistache::Http::Header::Raw("ETag", etag));
+      response.headers().addRaw(Pistache::Http::Header::Raw("Last-Modified", StaticAssets::httpDate(info.st_mtime)));
+      if(StaticAssets::isNotModified(ifNoneMatch, ifModifiedSince, etag, info.st_mtime)) {
+         response.send(Pistache::Http::Code::Not_Modified);
+         return true;
+      }
+      return false;
+   }
+   
+   StaticAssets::Encoding encoding = StaticAssets::chooseEncoding(getHeader(request, "Accept-Encoding"), *asset);
+   std::string etag = asset->entityTag(encoding);
+   
+   response.headers().addRaw(Pistache::Http::Header::Raw("ETag", etag));
+   response.headers().addRaw(Pistache::Http::Header::Raw("Last-Modified", asset->lastModified));
+   if(asset->isCompressed()) {
+      response.headers().addRaw(Pistache::Http::Header::Raw("Vary", "Accept-Encoding"));
+   }
+   if(StaticAssets::isNotModified(ifNoneMatch, ifModifiedSince, etag, asset->modified)) {
+      response.send(Pistache::Http::Code::Not_Modified);
+      return true;
+   }
+   
+   response.headers().addRaw(Pistache::Http::Header::Raw("Content-Type", asset->contentType));
+   if(encoding == StaticAssets::Encoding::BROTLI) {
+      response.headers().addRaw(Pistache::Http::Header::Raw("Content-Encoding", "br"));
+   } else if(encoding == StaticAssets::Encoding::GZIP) {
+      response.headers().addRaw(Pistache::Http::Header::Raw("Content-Encoding", "gzip"));
+   }
+   response.send(Pistache::Http::Code::Ok, asset->encoded(encoding));
+   
+   return true;
+}
+
 /******************************************************************************
  * Name: handleGetBooks
  * Desc: Handles delete requests.
@@ -271,34 +493,47 @@ void WebServer::handleDeleteBook(const Pistache::Rest::Request& request, Pistach
    int id = request.param(":id").as<int>();
    std::string token = getUrlParam(request, "token");
       
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleDeleteBook(). Serving &.", to_string(id));
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handleDeleteBook(). Serving &.", to_string(id));
+   
+   RequestDeadline deadline("remove");
    
    try {
       BookController controller;
-      JsonResponse jsonResponse = controller.remove(token, id);
+      JsonResponse jsonResponse = deadline.check(controller.remove(token, id));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } catch (exception& e) {
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleDeleteBook(). ERROR: &.", e.what());
-      response.send(Pistache::Http::Code::Internal_Server_Error, "Error occurred when deleting book.");
+      response.send(deadline.errorCode(), "Error occurred when deleting book.");
    }
 }
 
 /******************************************************************************
  * Name: handleGetBooks
- * Desc: Handles GET request for all books.
+ * Desc: Handles GET request for all books, or for a list of books when the
+ *       ids parameter is given.
  ******************************************************************************
  */  
 void WebServer::handleGetBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleGetBooks().");
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handleGetBooks().");
 
    std::string token = getUrlParam(request, "token");
+   std::string ids = getUrlParam(request, "ids");
+   bool includeArchive = getUrlParam(request, "archive") == "true";
    
+   RequestDeadline deadline("books");
    BookController controller;
-   JsonResponse jsonResponse = controller.getBooks(token);
-   response.setMime(MIME(Application, Json));
-   response.send(jsonResponse.code(), jsonResponse.message());
+   
+   if(ids == "") {
+      JsonResponse jsonResponse = deadline.check(controller.getBooks(token, includeArchive));
+      response.setMime(MIME(Application, Json));
+      response.send(jsonResponse.code(), jsonResponse.message());
+   } else {
+      JsonResponse jsonResponse = deadline.check(controller.getByIds(token, ids));
+      response.setMime(MIME(Application, Json));
+      response.send(jsonResponse.code(), jsonResponse.message());
+   }
 }
 
 /******************************************************************************
@@ -311,10 +546,11 @@ void WebServer::handleGetBookById(const Pistache::Rest::Request& request, Pistac
    std::string token = getUrlParam(request, "token");
    int id = request.param(":id").as<int>();
    
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleGetBookById(). Message: &.", to_string(id));
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handleGetBookById(). Message: &.", to_string(id));
    
+   RequestDeadline deadline("book");
    BookController controller;
-   JsonResponse jsonResponse = controller.getById(token, id);
+   JsonResponse jsonResponse = deadline.check(controller.getById(token, id));
    
    response.setMime(MIME(Application, Json));
    response.send(jsonResponse.code(), jsonResponse.message());
@@ -329,6 +565,7 @@ void WebServer::handleGetSearchBooks(const Pistache::Rest::Request& request, Pis
 {
    std::string token = getUrlParam(request, "token");
    std::string searchType = getUrlParam(request, "searchType");
+   bool includeArchive = getUrlParam(request, "archive") == "true";
    std::string searchTerm = "";
    
    try {
@@ -337,16 +574,17 @@ void WebServer::handleGetSearchBooks(const Pistache::Rest::Request& request, Pis
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleGetSearch(). No Search term: &.", e.what());
       searchTerm = "";
    }
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleGetSearch(). Message: &.", searchTerm);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handleGetSearch(). Message: &.", searchTerm);
    
+   RequestDeadline deadline("search");
    BookController controller;
    
    if(searchTerm == "") {
-      JsonResponse jsonResponse = controller.getBooks(token);
+      JsonResponse jsonResponse = deadline.check(controller.getBooks(token, includeArchive));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } else {
-      JsonResponse jsonResponse = controller.search(token, searchType, searchTerm);
+      JsonResponse jsonResponse = deadline.check(controller.search(token, searchType, searchTerm, includeArchive));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    }
@@ -362,18 +600,47 @@ void WebServer::handleGetSearchBooks(const Pistache::Rest::Request& request, Pis
 void WebServer::handlePostBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
    std::string message = request.body();
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostBooks(). Message: &.", message);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handlePostBooks(). Message: &.", Logger::instance().body(message));
   
    std::string token = getUrlParam(request, "token");
    
+   RequestDeadline deadline("store");
+   
    try {
       BookController controller;
-      JsonResponse jsonResponse = controller.store(token, message);
+      JsonResponse jsonResponse = deadline.check(controller.store(token, message));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } catch (exception& e) {
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostBooks(). ERROR: &.", e.what());
-      response.send(Pistache::Http::Code::Internal_Server_Error, "Server error occurred when adding book.");
+      response.send(deadline.errorCode(), "Server error occurred when adding book.");
+   }
+}
+
+/******************************************************************************
+ * Name: handlePatchBooks
+ * Desc: Handles PATCH requests.
+ ******************************************************************************
+ */   
+void WebServer::handlePatchBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+   int id = request.param(":id").as<int>();
+   
+   std::string message = request.body();
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handlePatchBooks(). Message: &.", Logger::instance().body(message));
+  
+   std::string token = getUrlParam(request, "token");
+      
+   RequestDeadline deadline("patch");
+   
+   try {
+      BookController controller;
+      JsonResponse jsonResponse = deadline.check(controller.patch(token, id, message));
+      response.setMime(MIME(Application, Json));
+      response.send(jsonResponse.code(), jsonResponse.message());
+   } catch (exception& e) {
+      Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePatchBooks(). ERROR: &.", e.what());
+      response.send(deadline.errorCode(), "Server error occurred when updating book.");
    }
 }
 
@@ -387,21 +654,104 @@ void WebServer::handlePutBooks(const Pistache::Rest::Request& request, Pistache:
    int id = request.param(":id").as<int>();
    
    std::string message = request.body();
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePutBooks(). Message: &.", message);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handlePutBooks(). Message: &.", Logger::instance().body(message));
   
    std::string token = getUrlParam(request, "token");
       
+   RequestDeadline deadline("update");
+   
    try {
       BookController controller;
-      JsonResponse jsonResponse = controller.update(token, id, message);
+      JsonResponse jsonResponse = deadline.check(controller.update(token, id, message));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } catch (exception& e) {
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePutBooks(). ERROR: &.", e.what());
-      response.send(Pistache::Http::Code::Internal_Server_Error, "Server error occurred when updating adding book.");
+      response.send(deadline.errorCode(), "Server error occurred when updating adding book.");
    }
 }
 
+/******************************************************************************
+ * Name: handlePostBatch
+ * Desc: Handles the POST request /api/v1/batch.
+ ******************************************************************************
+ */
+void WebServer::handlePostBatch(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+   std::string message = request.body();
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handlePostBatch(). Message: &.", Logger::instance().body(message));
+  
+   std::string token = getUrlParam(request, "token");
+   
+   RequestDeadline deadline("batch");
+   
+   try {
+      BatchController controller;
+      JsonResponse jsonResponse = deadline.check(controller.process(token, message));
+      response.setMime(MIME(Application, Json));
+      response.send(jsonResponse.code(), jsonResponse.message());
+   } catch (exception& e) {
+      Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostBatch(). ERROR: &.", e.what());
+      response.send(deadline.errorCode(), "Server error occurred when processing batch.");
+   }
+}
+
+/******************************************************************************
+ * Name: handlePostBackup
+ * Desc: Handles the POST request /api/v1/admin/backup.
+ ******************************************************************************
+ */
+void WebServer::handlePostBackup(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostBackup().");
+
+   std::string token = getHeader(request, ADMIN_TOKEN_HEADER);
+
+   try {
+      AdminController controller;
+      JsonResponse jsonResponse = controller.backup(token);
+      response.setMime(MIME(Application, Json));
+      response.send(jsonResponse.code(), jsonResponse.message());
+   } catch (exception& e) {
+      Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostBackup(). ERROR: &.", e.what());
+      response.send(Pistache::Http::Code::Internal_Server_Error, "Server error occurred when starting backup.");
+   }
+}
+
+/******************************************************************************
+ * Name: handleGetMaintenance
+ * Desc: Handles the GET request /api/v1/admin/maintenance.
+ ******************************************************************************
+ */
+void WebServer::handleGetMaintenance(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleGetMaintenance().");
+
+   std::string token = getHeader(request, ADMIN_TOKEN_HEADER);
+
+   AdminController controller;
+   JsonResponse jsonResponse = controller.maintenanceHistory(token);
+   response.setMime(MIME(Application, Json));
+   response.send(jsonResponse.code(), jsonResponse.message());
+}
+
+/******************************************************************************
+ * Name: handleGetLockWaits
+ * Desc: Handles the GET request /api/v1/admin/lockwaits.
+ ******************************************************************************
+ */
+void WebServer::handleGetLockWaits(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
+{
+   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleGetLockWaits().");
+
+   std::string token = getHeader(request, ADMIN_TOKEN_HEADER);
+
+   AdminController controller;
+   JsonResponse jsonResponse = controller.lockWaits(token);
+   response.setMime(MIME(Application, Json));
+   response.send(jsonResponse.code(), jsonResponse.message());
+}
+
 /******************************************************************************
  * Name: handlePostLogin
  * Desc: Handles the POST request /api/v1/login.
@@ -410,16 +760,19 @@ void WebServer::handlePutBooks(const Pistache::Rest::Request& request, Pistache:
 void WebServer::handlePostLogin(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
    std::string message = request.body();
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostLogin(). Message: &.", message);
+   // The body holds the password.
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handlePostLogin(). Message of & bytes.", message.size());
   
+   RequestDeadline deadline("user");
+   
    try {
       UserController controller;
-      JsonResponse jsonResponse = controller.loginUser(message);
+      JsonResponse jsonResponse = deadline.check(controller.loginUser(message));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } catch (exception& e) {
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostLogin(). ERROR: &.", e.what());
-      response.send(Pistache::Http::Code::Internal_Server_Error, "Server error occurred when adding book.");
+      response.send(deadline.errorCode(), "Server error occurred when adding book.");
    }
 }
 
@@ -431,16 +784,19 @@ void WebServer::handlePostLogin(const Pistache::Rest::Request& request, Pistache
 void WebServer::handlePostRegister(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
    std::string message = request.body();
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostRegister(). Message: &.", message);
+   // The body holds the password.
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handlePostRegister(). Message of & bytes.", message.size());
   
+   RequestDeadline deadline("user");
+   
    try {
       UserController controller;
-      JsonResponse jsonResponse = controller.registerUser(message);
+      JsonResponse jsonResponse = deadline.check(controller.registerUser(message));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } catch (exception& e) {
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handlePostRegister(). ERROR: &.", e.what());
-      response.send(Pistache::Http::Code::Internal_Server_Error, "Server error occurred when adding book.");
+      response.send(deadline.errorCode(), "Server error occurred when adding book.");
    }
 }
 
@@ -452,16 +808,18 @@ void WebServer::handlePostRegister(const Pistache::Rest::Request& request, Pista
 void WebServer::handleLogout(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
    std::string message = request.body();
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleLogout().Message: &.", message);
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "handleLogout(). Message: &.", Logger::instance().body(message));
      
+   RequestDeadline deadline("user");
+   
    try {
       UserController controller;
-      JsonResponse jsonResponse = controller.logoutUser(message);
+      JsonResponse jsonResponse = deadline.check(controller.logoutUser(message));
       response.setMime(MIME(Application, Json));
       response.send(jsonResponse.code(), jsonResponse.message());
    } catch (exception& e) {
       Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "handleLogout(). ERROR: &.", e.what());
-      response.send(Pistache::Http::Code::Internal_Server_Error, "Server error occurred when logging out user.");
+      response.send(deadline.errorCode(), "Server error occurred when logging out user.");
    }
 }
 
@@ -472,11 +830,29 @@ void WebServer::handleLogout(const Pistache::Rest::Request& request, Pistache::H
  */ 
 void WebServer::serveUnknown(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response)
 {
-   Logger::instance().log(Logger::LogLevel::INFO, "WebServer", "serveUnknown(). Page not found: &.", request.resource());
+   Logger::instance().logSampled(Logger::LogLevel::INFO, "WebServer", "serveUnknown(). Page not found: &.", request.resource());
    
    response.send(Pistache::Http::Code::Not_Found, "Page not found");
 }
 
+/******************************************************************************
+ * Name: getHeader
+ * Desc: Get a request header Pistache does not parse, or an empty string.
+ ******************************************************************************
+ */  
+std::string WebServer::getHeader(const Pistache::Rest::Request& request, const std::string& name)
+{
+   if(!request.headers().has(name)) {
+      return "";
+   }
+   
+   try {
+      return request.headers().getRaw(name).value();
+   } catch(exception& e) {
+      return "";
+   }
+}
+
 /******************************************************************************
  * Name: getUrlParam
  * Desc: Extract the token from the URL.
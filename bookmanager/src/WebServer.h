@@ -11,6 +11,7 @@
 #define WEBSERVER_H
 
 /*---------  System Includes  --------------*/
+#include <map>
 #include <memory>
 #include <string>
 
@@ -26,6 +27,7 @@
 #include "BookController.h"
 #include "UserController.h"
 #include "IndexPage.h"
+#include "StaticAssets.h"
 
 namespace dw {
     
@@ -37,8 +39,11 @@ public:
    
    /**
     * Constructors and Destructors
+    * 
+    * @param isReplica true to run as a read replica that only serves read requests and
+    *                  follows the primary's change journal.
     */
-    WebServer(Pistache::Address addr, std::string serverpath);
+    WebServer(Pistache::Address addr, std::string serverpath, bool isReplica = false);
     virtual ~WebServer();
     
     /**
@@ -65,10 +70,15 @@ private:
     void handleIndex(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handleGetBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handlePostBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void handlePatchBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handlePutBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handleGetBookById(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handleGetSearchBooks(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handleDeleteBook(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void handlePostBatch(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void handlePostBackup(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void handleGetMaintenance(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    void handleGetLockWaits(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handlePostLogin(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handlePostRegister(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void handleLogout(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
@@ -79,17 +89,27 @@ private:
     void serveImage(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void serveJs(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
     void serveUnknown(const Pistache::Rest::Request& request, Pistache::Http::ResponseWriter response);
+    bool serveAsset(const std::string& path, const Pistache::Rest::Request& request,
+                    Pistache::Http::ResponseWriter& response);
     
     std::string getUrlParam(const Pistache::Rest::Request& request, const std::string& param);
+    std::string getHeader(const Pistache::Rest::Request& request, const std::string& name);
     
     
    /*----------------- Private Data  -----------------------*/
     const std::string mServerPath;
+    const bool mIsReplica;
     std::shared_ptr<Pistache::Http::Endpoint> mHttpEndpoint;
     Pistache::Rest::Router router;
     
     // Web page objects
     std::shared_ptr<WebPage> mIndexPage;
+    
+    // The css, fonts, img and js files, kept in memory.
+    StaticAssets mAssets;
+    
+    // The Cache-Control header of each static directory.
+    const std::map<std::string, std::string> mCacheControl;
 };
     
 }
@@ -0,0 +1,567 @@
+/*---------  Program Includes  ----------------*/
+#include "WriteBehindBuffer.h"
+#include "BookArchive.h"
+#include "ChangeJournal.h"
+#include "ConfigReader.h"
+#include "Logger.h"
+#include "dbConnect.h"
+
+/*---------  System Includes  -----------------*/
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace dw {
+
+const string FLUSH_SQL = "UPDATE books SET read = COALESCE(?, read), rating = COALESCE(?, rating), updated_at = datetime('now') WHERE id = ? AND user_id = ?";
+const int FLUSH_BUSY_TIMEOUT_MS = 1000;
+
+// Changes nothing, but takes the write lock.
+const string FLUSH_LOCK_SQL = "UPDATE books SET id = id WHERE 0";
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+WriteBehindBuffer::WriteBehindBuffer()
+                 : mWindowMs(0), mIsRunning(false), mNumPending(0), mSequence(0)
+{
+   mWindowMs = ConfigReader::getInstance().getInt(ConfigReader::Config::WRITE_BEHIND_MS);
+
+   Logger::instance().log(Logger::LogLevel::INFO, "WriteBehindBuffer", "Constructor. Window is & ms.", mWindowMs.load());
+
+   // A new window applies once the buffer is running. Starting it needs a restart.
+   ConfigReader::getInstance().addReloadListener([this]() {
+      long window = ConfigReader::getInstance().getInt(ConfigReader::Config::WRITE_BEHIND_MS);
+      if(mIsRunning && window != mWindowMs) {
+         setWindow(std::chrono::milliseconds(window));
+         Logger::instance().log(Logger::LogLevel::INFO, "WriteBehindBuffer", "Reloaded. Window is & ms.", window);
+      }
+   });
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+WriteBehindBuffer::~WriteBehindBuffer()
+{
+   if(mThread.joinable()) {
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+}
+
+/******************************************************************************
+ * Name: instance
+ * Description: Get the write behind buffer.
+ ******************************************************************************
+ */
+WriteBehindBuffer& WriteBehindBuffer::instance()
+{
+   static WriteBehindBuffer mInstance;
+
+   return mInstance;
+}
+
+/******************************************************************************
+ * Name: isEnabled
+ * Description: Returns true if the window is set.
+ ******************************************************************************
+ */
+bool WriteBehindBuffer::isEnabled() const
+{
+   return mWindowMs > 0;
+}
+
+/******************************************************************************
+ * Name: canBuffer
+ * Description: Only the read flag and rating are buffered.
+ ******************************************************************************
+ */
+bool WriteBehindBuffer::canBuffer(const BookPatch& patch) const
+{
+   bool isHotField = patch.hasRead() || patch.hasRating();
+   bool isOtherField = patch.hasTitle() || patch.hasAuthor() || patch.hasYear();
+
+   return isHotField && !isOtherField;
+}
+
+/******************************************************************************
+ * Name: setWindow
+ * Description: Set the time to hold changes.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::setWindow(std::chrono::milliseconds window)
+{
+   flush();
+   mWindowMs = window.count();
+   mWakeUp.notify_all();
+}
+
+/******************************************************************************
+ * Name: start
+ * Description: Start the background writer thread.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::start()
+{
+   if(mIsRunning || !isEnabled()) {
+      return;
+   }
+
+   Logger::instance().log(Logger::LogLevel::INFO, "WriteBehindBuffer", "start().");
+
+   mIsRunning = true;
+   mThread = std::thread(&WriteBehindBuffer::run, this);
+}
+
+/******************************************************************************
+ * Name: stop
+ * Description: Stop the background writer thread and write pending changes.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::stop()
+{
+   if(mThread.joinable()) {
+      Logger::instance().log(Logger::LogLevel::INFO, "WriteBehindBuffer", "stop().");
+
+      mIsRunning = false;
+      mWakeUp.notify_all();
+      mThread.join();
+   }
+
+   flush();
+}
+
+/******************************************************************************
+ * Name: queue
+ * Description: Buffer the latest read flag and rating for a book.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::queue(int userId, int bookId, const BookPatch& patch)
+{
+   Logger::instance().log(Logger::LogLevel::DEBUG, "WriteBehindBuffer", "queue(). User ID: & Book ID &.", userId, bookId);
+
+   lock_guard<mutex> lock(mMutex);
+
+   PendingChange& change = mPending[BookKey(userId, bookId)];
+   change.sequence = ++mSequence;
+   if(patch.hasRead()) {
+      change.hasRead = true;
+      change.read = patch.read();
+   }
+   if(patch.hasRating()) {
+      change.hasRating = true;
+      change.rating = patch.rating();
+   }
+
+   mNumPending = mPending.size() + mFlushing.size();
+}
+
+/******************************************************************************
+ * Name: apply
+ * Description: Overlay pending changes onto books.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::apply(std::vector<Book>& books) const
+{
+   if(mNumPending == 0) {
+      return;
+   }
+
+   for(Book& book : books) {
+      apply(book);
+   }
+}
+
+void WriteBehindBuffer::apply(Book& book) const
+{
+   if(mNumPending == 0) {
+      return;
+   }
+
+   lock_guard<mutex> lock(mMutex);
+   BookKey key(book.userId(), book.id());
+
+   // Values being written are older than values still pending.
+   auto flushing = mFlushing.find(key);
+   if(flushing != mFlushing.end()) {
+      applyChange(flushing->second, book);
+   }
+
+   auto pending = mPending.find(key);
+   if(pending != mPending.end()) {
+      applyChange(pending->second, book);
+   }
+}
+
+/******************************************************************************
+ * Name: committed
+ * Description: Drop the values replaced in a committed transaction.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::committed(SQLite::Database& db)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   auto uncommitted = mUncommitted.find(&db);
+   if(uncommitted == mUncommitted.end()) {
+      return;
+   }
+
+   for(const auto& written : uncommitted->second) {
+      drop(written.first, written.second);
+   }
+   mUncommitted.erase(uncommitted);
+}
+
+/******************************************************************************
+ * Name: rolledBack
+ * Description: Release the books held in a rolled back transaction.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::rolledBack(SQLite::Database& db)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   auto uncommitted = mUncommitted.find(&db);
+   if(uncommitted == mUncommitted.end()) {
+      return;
+   }
+
+   for(const auto& written : uncommitted->second) {
+      release(written.first);
+   }
+   mUncommitted.erase(uncommitted);
+}
+
+/******************************************************************************
+ * Name: flush
+ * Description: Write all pending changes in one transaction per shard.
+ ******************************************************************************
+ */
+std::size_t WriteBehindBuffer::flush()
+{
+   lock_guard<mutex> flushLock(mFlushMutex);
+
+   // Each shard is written in its own transaction.
+   map<unsigned int, vector<BookKey>> changesByShard;
+   {
+      lock_guard<mutex> lock(mMutex);
+      if(mPending.empty()) {
+         return 0;
+      }
+      mFlushing.swap(mPending);
+
+      for(auto& entry : mFlushing) {
+         changesByShard[db_shardForUser(entry.first.first)].push_back(entry.first);
+      }
+   }
+   
+   size_t numWritten = 0;
+   
+   for(auto& shardChanges : changesByShard) {
+      try {
+         unique_ptr<SQLite::Database>& db = mDbs[shardChanges.first];
+         if(!db) {
+            db.reset(new SQLite::Database(db_shardPath(shardChanges.first), SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE));
+            db->setBusyTimeout(FLUSH_BUSY_TIMEOUT_MS);
+         }
+         
+         // A database cannot be attached in a transaction.
+         bool isArchiveAttached = BookArchive::instance().attach(*db);
+         
+         SQLite::Transaction transaction(*db);
+         
+         // Another update to a book is written either before the lock is taken, so it
+         // has already dropped the values, or after the flush commits. A book held now
+         // is left for that update.
+         db->exec(FLUSH_LOCK_SQL);
+         SQLite::Statement query(*db, FLUSH_SQL);
+         size_t numShardWritten = 0;
+         
+         for(const BookKey& key : shardChanges.second) {
+            PendingChange change;
+            if(!nextFlush(key, change)) {
+               continue;
+            }
+            
+            if(change.hasRead) {
+               query.bind(1, change.read);
+            } else {
+               query.bind(1);
+            }
+            if(change.hasRating) {
+               query.bind(2, change.rating);
+            } else {
+               query.bind(2);
+            }
+            query.bind(3, key.second);
+            query.bind(4, key.first);
+            
+            // The book may have been archived since the change was queued. It is moved
+            // back, as any other update to an archived book does.
+            int numUpdated = query.exec();
+            if(!numUpdated && isArchiveAttached && BookArchive::instance().restore(*db, key.first, key.second)) {
+               query.reset();
+               numUpdated = query.exec();
+            }
+            
+            if(numUpdated) {
+               ChangeJournal::instance().recordUpsert(*db, "books", {{"id", key.second}, {"user_id", key.first}});
+            }
+            query.reset();
+            ++numShardWritten;
+         }
+         
+         transaction.commit();
+         ChangeJournal::instance().writeCommitted(*db);
+         numWritten += numShardWritten;
+      }
+      catch(exception& e) {
+         Logger::instance().log(Logger::LogLevel::ERROR, "WriteBehindBuffer", "flush(). ERROR Exception: &.", e.what());
+         
+         // Keep the changes for the next flush unless newer values have been queued.
+         lock_guard<mutex> lock(mMutex);
+         for(const BookKey& key : shardChanges.second) {
+            auto flushing = mFlushing.find(key);
+            if(flushing != mFlushing.end()) {
+               mPending.insert(*flushing);
+            }
+         }
+      }
+   }
+   
+   Logger::instance().log(Logger::LogLevel::DEBUG, "WriteBehindBuffer", "flush(). Books written: &.", numWritten);
+   
+   lock_guard<mutex> lock(mMutex);
+   mFlushing.clear();
+   mNumPending = mPending.size();
+
+   return numWritten;
+}
+
+/******************************************************************************
+ * Name: numPending
+ * Description: Get the number of books with pending changes.
+ ******************************************************************************
+ */
+std::size_t WriteBehindBuffer::numPending() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   return mPending.size();
+}
+
+/******************************************************************************
+ * Name: pendingBookIds
+ * Description: Get the ids of the books with changes not written yet.
+ ******************************************************************************
+ */
+std::vector<int> WriteBehindBuffer::pendingBookIds() const
+{
+   lock_guard<mutex> lock(mMutex);
+
+   vector<int> bookIds;
+   for(const ChangeMap* changes : {&mPending, &mFlushing}) {
+      for(const auto& entry : *changes) {
+         bookIds.push_back(entry.first.second);
+      }
+   }
+
+   return bookIds;
+}
+
+/*----------------- Private Methods ---------------------*/
+
+/******************************************************************************
+ * Name: run
+ * Description: Background thread. Writes pending changes every window.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::run()
+{
+   while(mIsRunning) {
+      {
+         unique_lock<mutex> lock(mMutex);
+         mWakeUp.wait_for(lock, std::chrono::milliseconds(mWindowMs > 0 ? mWindowMs.load() : 1000));
+      }
+
+      flush();
+   }
+}
+
+/******************************************************************************
+ * Name: applyChange
+ * Description: Copy pending values onto a book.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::applyChange(const PendingChange& change, Book& book) const
+{
+   if(change.hasRead) {
+      book.read(change.read);
+   }
+   if(change.hasRating) {
+      book.rating(change.rating);
+   }
+}
+
+/******************************************************************************
+ * Name: hold
+ * Description: Mark a book as held and merge its pending values. The caller
+ *              holds mMutex.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::hold(const BookKey& key, PendingChange& change)
+{
+   ++mHeld[key];
+
+   // Values being written are older than values still pending.
+   for(const ChangeMap* changes : {&mFlushing, &mPending}) {
+      auto entry = changes->find(key);
+      if(entry == changes->end()) {
+         continue;
+      }
+
+      if(entry->second.hasRead) {
+         change.hasRead = true;
+         change.read = entry->second.read;
+      }
+      if(entry->second.hasRating) {
+         change.hasRating = true;
+         change.rating = entry->second.rating;
+      }
+      change.sequence = entry->second.sequence;
+   }
+}
+
+/******************************************************************************
+ * Name: release
+ * Description: Release a held book. The caller holds mMutex.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::release(const BookKey& key)
+{
+   auto held = mHeld.find(key);
+   if(held != mHeld.end() && --held->second == 0) {
+      mHeld.erase(held);
+   }
+}
+
+/******************************************************************************
+ * Name: drop
+ * Description: Drop the pending values written by another update and release
+ *              the book. Values queued after it was held are kept. The caller
+ *              holds mMutex.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::drop(const BookKey& key, unsigned long sequence)
+{
+   for(ChangeMap* changes : {&mFlushing, &mPending}) {
+      auto entry = changes->find(key);
+      if(entry != changes->end() && entry->second.sequence <= sequence) {
+         changes->erase(entry);
+      }
+   }
+
+   mNumPending = mPending.size() + mFlushing.size();
+   release(key);
+}
+
+/******************************************************************************
+ * Name: nextFlush
+ * Description: Get the change to flush for a book, unless it is held.
+ ******************************************************************************
+ */
+bool WriteBehindBuffer::nextFlush(const BookKey& key, PendingChange& change)
+{
+   lock_guard<mutex> lock(mMutex);
+
+   auto flushing = mFlushing.find(key);
+   if(flushing == mFlushing.end()) {
+      return false;
+   }
+
+   // The update holding the book writes these values, or keeps them if it fails.
+   if(mHeld.count(key)) {
+      mPending.insert(*flushing);
+      mFlushing.erase(flushing);
+      return false;
+   }
+
+   change = flushing->second;
+   return true;
+}
+
+/*----------------- Hold ---------------------*/
+
+/******************************************************************************
+ * Constructor
+ ******************************************************************************
+ */
+WriteBehindBuffer::Hold::Hold(int userId, int bookId)
+                       : mUserId(userId), mBookId(bookId), mIsWritten(false)
+{
+   WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+   lock_guard<mutex> lock(buffer.mMutex);
+
+   buffer.hold(BookKey(userId, bookId), mChange);
+}
+
+/******************************************************************************
+ * Destructor
+ ******************************************************************************
+ */
+WriteBehindBuffer::Hold::~Hold()
+{
+   if(mIsWritten) {
+      return;
+   }
+
+   WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+   lock_guard<mutex> lock(buffer.mMutex);
+
+   buffer.release(BookKey(mUserId, mBookId));
+}
+
+/******************************************************************************
+ * Name: change
+ * Description: Get the pending values read when the book was held.
+ ******************************************************************************
+ */
+const WriteBehindBuffer::PendingChange& WriteBehindBuffer::Hold::change() const
+{
+   return mChange;
+}
+
+/******************************************************************************
+ * Name: written
+ * Description: Drop the pending values the update replaced, now or when its
+ *              transaction commits.
+ ******************************************************************************
+ */
+void WriteBehindBuffer::Hold::written(SQLite::Database& db)
+{
+   if(mIsWritten) {
+      return;
+   }
+   mIsWritten = true;
+
+   WriteBehindBuffer& buffer = WriteBehindBuffer::instance();
+   lock_guard<mutex> lock(buffer.mMutex);
+   BookKey key(mUserId, mBookId);
+
+   if(sqlite3_get_autocommit(db.getHandle()) == 0) {
+      buffer.mUncommitted[&db].push_back(make_pair(key, mChange.sequence));
+   } else {
+      buffer.drop(key, mChange.sequence);
+   }
+}
+
+} // End namespace dw
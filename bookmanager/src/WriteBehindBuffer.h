@@ -0,0 +1,269 @@
+/**
+ * @class WriteBehindBuffer
+ *
+ * Singleton class that holds rating and read flag changes for a short time before
+ * writing them to the database. Only the latest value for each book is kept, so rapid
+ * clicks on the star rating or read toggle become one write. Pending changes are written
+ * in one transaction per database shard by a background thread.
+ *
+ * Books read from the database are passed through apply() so that callers see the
+ * pending values. Any other write to a book must hold it with a WriteBehindBuffer::Hold,
+ * which gives the pending values to write with it and keeps a flush from writing them
+ * over the update. The values are dropped once the update commits. Updates made in a
+ * transaction commit later, so its owner calls committed() or rolledBack().
+ *
+ * The window is set with WRITE_BEHIND_MS in config.cfg. If it is missing or 0 the buffer
+ * is disabled and changes are written directly.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+#ifndef WRITEBEHINDBUFFER_H
+#define WRITEBEHINDBUFFER_H
+
+/*---------  Program Includes  ----------------*/
+#include "Book.h"
+#include "BookPatch.h"
+
+/*---------  System Includes  -----------------*/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace SQLite {
+   class Database;
+}
+
+namespace dw {
+
+class WriteBehindBuffer
+{
+public:
+
+   /*---------  Public Types  --------------------*/
+
+   /**
+    * The buffered changes for one book.
+    */
+   struct PendingChange
+   {
+      bool hasRead = false;
+      bool read = false;
+      bool hasRating = false;
+      int  rating = 0;
+      unsigned long sequence = 0;
+   };
+
+   /**
+    * Holds a book while another update to it is written. The pending values are kept
+    * until the update has been written, and are kept if it fails.
+    */
+   class Hold
+   {
+   public:
+
+      /**
+       * Hold a book and read its pending values.
+       *
+       * @param userId the id of the user who owns the book.
+       * @param bookId the id of the book.
+       */
+      Hold(int userId, int bookId);
+
+      /**
+       * Release the book. The pending values are kept unless written() was called.
+       */
+      ~Hold();
+
+      /**
+       * Disable copying
+       */
+      Hold(const Hold& rhs) = delete;
+      void operator=(const Hold& rhs) = delete;
+
+      /**
+       * Get the pending values read when the book was held.
+       */
+      const PendingChange& change() const;
+
+      /**
+       * The update has been written, so the pending values it replaced are dropped.
+       * If the connection is in a transaction they are dropped when it commits.
+       *
+       * @param db the connection used for the update.
+       */
+      void written(SQLite::Database& db);
+
+   private:
+
+      int mUserId;
+      int mBookId;
+      PendingChange mChange;
+      bool mIsWritten;
+   };
+
+   /*---------  Public Functions  ----------------*/
+
+   /**
+    * Get the write behind buffer.
+    *
+    * @return dw::WriteBehindBuffer&
+    */
+   static WriteBehindBuffer& instance();
+
+   /**
+    * Disable copying
+    */
+   WriteBehindBuffer(const WriteBehindBuffer& rhs) = delete;
+   void operator=(const WriteBehindBuffer& rhs) = delete;
+
+   /**
+    * Returns true if changes should be buffered.
+    */
+   bool isEnabled() const;
+
+   /**
+    * Returns true if the patch only changes fields that can be buffered.
+    *
+    * @param patch the patch to check.
+    */
+   bool canBuffer(const BookPatch& patch) const;
+
+   /**
+    * Set the time changes are held before being written. 0 disables the buffer. Any
+    * pending changes are written first.
+    *
+    * @param window the time to hold changes.
+    */
+   void setWindow(std::chrono::milliseconds window);
+
+   /**
+    * Start the background thread that writes pending changes.
+    */
+   void start();
+
+   /**
+    * Stop the background thread and write any pending changes.
+    */
+   void stop();
+
+   /**
+    * Buffer the read flag and rating from a patch, replacing any earlier pending values.
+    *
+    * @param userId the id of the user who owns the book.
+    * @param bookId the id of the book.
+    * @param patch the changes. Only read and rating are used.
+    */
+   void queue(int userId, int bookId, const BookPatch& patch);
+
+   /**
+    * Overlay any pending changes onto books read from the database.
+    *
+    * @param books the books to update.
+    */
+   void apply(std::vector<Book>& books) const;
+   void apply(Book& book) const;
+
+   /**
+    * Drop the pending values replaced by updates written in a transaction, once it has
+    * been committed, and release their books.
+    *
+    * @param db the connection that committed.
+    */
+   void committed(SQLite::Database& db);
+
+   /**
+    * Release the books held by updates in a transaction that was rolled back. Their
+    * pending values are kept. Does nothing after committed().
+    *
+    * @param db the connection that rolled back.
+    */
+   void rolledBack(SQLite::Database& db);
+
+   /**
+    * Write all pending changes to the database in one transaction per shard.
+    *
+    * @return the number of books written.
+    */
+   std::size_t flush();
+
+   /**
+    * Get the number of books with pending changes.
+    */
+   std::size_t numPending() const;
+
+   /**
+    * Get the ids of the books with changes that have not been written yet.
+    */
+   std::vector<int> pendingBookIds() const;
+
+private:
+
+   /*---------  Private Types  -------------------*/
+
+   using BookKey = std::pair<int, int>;
+   using ChangeMap = std::map<BookKey, PendingChange>;
+
+   /*---------  Private Functions  ---------------*/
+
+   WriteBehindBuffer();
+   ~WriteBehindBuffer();
+
+   /**
+    * Background thread. Writes pending changes once every window.
+    */
+   void run();
+
+   /**
+    * Copy the pending values in the change onto the book.
+    */
+   void applyChange(const PendingChange& change, Book& book) const;
+
+   /**
+    * Mark a book as held and return its pending values, merged into one change.
+    */
+   void hold(const BookKey& key, PendingChange& change);
+
+   /**
+    * Release a held book.
+    */
+   void release(const BookKey& key);
+
+   /**
+    * Drop the pending values up to a sequence number and release the book.
+    */
+   void drop(const BookKey& key, unsigned long sequence);
+
+   /**
+    * Get the next change to flush for a book. A held book is moved back to the pending
+    * changes instead. Returns false if there is nothing to write.
+    */
+   bool nextFlush(const BookKey& key, PendingChange& change);
+
+   /*---------  Private Data  --------------------*/
+
+   mutable std::mutex mMutex;
+   std::mutex mFlushMutex;
+   std::condition_variable mWakeUp;
+   std::thread mThread;
+   std::atomic<long> mWindowMs;
+   std::atomic<bool> mIsRunning;
+   std::atomic<std::size_t> mNumPending;
+   unsigned long mSequence;
+   ChangeMap mPending;
+   ChangeMap mFlushing;
+   std::map<BookKey, int> mHeld;
+   std::map<const SQLite::Database*, std::vector<std::pair<BookKey, unsigned long>>> mUncommitted;
+   std::map<unsigned int, std::unique_ptr<SQLite::Database>> mDbs;
+};
+
+} // End namespace dw
+
+#endif // WRITEBEHINDBUFFER_H
@@ -1,9 +1,16 @@
 
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <vector>
+#include "BookLayout.h"
+#include "ChangeJournal.h"
 #include "ConfigReader.h"
+#include "DatabaseMaintenance.h"
 #include "Logger.h"
+#include "ResourceLimits.h"
 #include "WebServer.h"
+#include "dbConnect.h"
 #include "pistache/http.h"
 
 using namespace std;
@@ -12,20 +19,104 @@ using namespace dw;
 
 int main(int argc, char *argv[]) {
     
-    // Defaults. Can be overridden by command line args. 
+    // Flags such as --server-threads=8 set configurations. The other arguments
+    // are the mode, port and number of threads.
+    vector<string> args = {argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        try {
+            if (!ConfigReader::getInstance().setOverride(argv[i]))
+                args.push_back(argv[i]);
+        }
+        catch (exception& e) {
+            cout << "Config failed to initialize." << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    argc = args.size();
+
+    // Defaults. Can be overridden by command line args. One thread for each CPU the
+    // container allows.
     Pistache::Port port(9080);
-    int threads = 2;
+    int threads = ConfigReader::getInstance().getInt(ConfigReader::Config::SERVER_THREADS, ResourceLimits::numCpus());
+
+    // Migrate the books table to the clustered layout and exit.
+    if (argc == 2 && args[1] == "--cluster-books") {
+        try {
+            for (unsigned int shard = 0; shard < db_numShards(); ++shard) {
+                SQLite::Database* db = db_getConnection(shard);
+                books_clusterByUser(*db);
+                db_returnConnection(db);
+            }
+            db_shutdown();
+        }
+        catch (exception& e) {
+            cout << "Migration failed: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        
+        cout << "Books table is clustered by user." << endl;
+        return EXIT_SUCCESS;
+    }
+
+    // Switch every shard to incremental vacuum and exit. The server must be stopped.
+    if (argc == 2 && args[1] == "--incremental-vacuum") {
+        try {
+            for (unsigned int shard = 0; shard < db_numShards(); ++shard) {
+                SQLite::Database db(db_shardPath(shard), SQLite::OPEN_READWRITE);
+                DatabaseMaintenance::enableIncrementalVacuum(db);
+            }
+        }
+        catch (exception& e) {
+            cout << "Vacuum failed: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        
+        cout << "Databases use incremental vacuum." << endl;
+        return EXIT_SUCCESS;
+    }
+
+    // Move books between shards for a new shard count and exit. The server must be stopped.
+    if (argc == 3 && args[1] == "--reshard") {
+        try {
+            unsigned int numShards = std::stoul(args[2]);
+            if (numShards == 0) {
+                throw invalid_argument("The number of shards must be at least 1.");
+            }
+            
+            long numMoved = books_reshard(db_numShards(), numShards);
+            
+            cout << "Moved " << numMoved << " books. Set DB_SHARDS=" << numShards << " in config.cfg." << endl;
+        }
+        catch (exception& e) {
+            cout << "Resharding failed: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        
+        return EXIT_SUCCESS;
+    }
+
+    // Run as a read replica that follows the primary's change journal. The replica's
+    // config.cfg has its own DB_PATH and the primary's JOURNAL_PATH.
+    bool isReplica = false;
+    int firstArg = 1;
+    if (argc >= 2 && args[1] == "--replica") {
+        isReplica = true;
+        firstArg = 2;
+        
+        // Only the primary writes to the journal.
+        ChangeJournal::instance().configure("");
+    }
 
     // First arg is port, second is number of threads to use.
-    if (argc >= 2) {
-        port = std::stol(argv[1]);
+    if (argc >= firstArg + 1) {
+        port = std::stol(args[firstArg]);
 
-        if (argc == 3)
-            threads = std::stol(argv[2]);
+        if (argc == firstArg + 2)
+            threads = std::stol(args[firstArg + 1]);
     }
 
     // Find the server's working directory
-    string serverpath(argv[0]);
+    string serverpath(args[0]);
     serverpath = serverpath.substr(0, serverpath.find_last_of("/"));
 
     // Set up the config
@@ -44,14 +135,21 @@ int main(int argc, char *argv[]) {
     cout << "Cores = " << hardware_concurrency() << endl;
     cout << "Using " << threads << " threads" << endl;
     cout << "Port: 9080 " << endl;
+    if (isReplica)
+        cout << "Running as a read replica" << endl;
 
     Pistache::Address addr(Pistache::Ipv4::any(), port);
-    dw::WebServer server(addr, serverpath);
+    dw::WebServer server(addr, serverpath, isReplica);
+
+    // Tuning settings such as the log level, cache sizes and timeouts are
+    // applied when config.cfg is saved.
+    ConfigReader::getInstance().startWatching();
 
     server.init(threads);
     server.start();
     
     server.shutdown();
+    ConfigReader::getInstance().stopWatching();
     
    return EXIT_SUCCESS;
 }
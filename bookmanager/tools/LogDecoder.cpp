@@ -0,0 +1,42 @@
+/*
+ * logdecoder: converts a binary log written with LOG_FORMAT=binary to text.
+ *
+ *    logdecoder logfile.bin > logfile.log
+ *
+ * With no file the binary log is read from standard input.
+ */
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "BinaryLog.h"
+
+using namespace std;
+using namespace dw;
+
+int main(int argc, char *argv[]) {
+
+    if (argc > 2) {
+        cerr << "Usage: " << argv[0] << " [binary log file]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    bool isValid = false;
+    if (argc == 2) {
+        ifstream log(argv[1], ios::binary);
+        if (!log.is_open()) {
+            cerr << "Cannot open " << argv[1] << endl;
+            return EXIT_FAILURE;
+        }
+        isValid = BinaryLog::decode(log, cout);
+    }
+    else {
+        isValid = BinaryLog::decode(cin, cout);
+    }
+
+    if (!isValid) {
+        cerr << "The log is not a binary log or ends part way through a message." << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
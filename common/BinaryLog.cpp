@@ -0,0 +1,241 @@
+
+/*---------  Program Includes  ---------------*/
+#include "BinaryLog.h"
+
+/*---------  System Includes  --------------*/
+#include <algorithm>
+#include <ctime>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace dw {
+
+// A char array, so it is set before the logger is constructed at startup.
+const char BinaryLog::MAGIC[] = "DWBLOG1\n";
+
+///////////////////////////////////////////////////////////////////////////////
+// Class: BinaryLogReader
+// Description: Reads values from the log, failing at the end of the data.
+///////////////////////////////////////////////////////////////////////////////
+
+class BinaryLogReader
+{
+public:
+	BinaryLogReader(const string& data, size_t pos) : mData(data), mPos(pos) {}
+
+	template <typename T>
+	bool read(T& value)
+	{
+		if(mData.size() - mPos < sizeof(T)) {
+			return false;
+		}
+		memcpy(&value, mData.data() + mPos, sizeof(T));
+		mPos += sizeof(T);
+		return true;
+	}
+
+	bool readString(string& value)
+	{
+		uint32_t length = 0;
+		if(!read(length) || mData.size() - mPos < length) {
+			return false;
+		}
+		value.assign(mData, mPos, length);
+		mPos += length;
+		return true;
+	}
+
+	size_t pos() const
+	{
+		return mPos;
+	}
+
+private:
+	const string& mData;
+	size_t mPos;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: readValue
+// Description: Read one parameter and write it as text.
+///////////////////////////////////////////////////////////////////////////////
+
+static bool readValue(BinaryLogReader& reader, ostream& out)
+{
+	char type = 0;
+	if(!reader.read(type)) {
+		return false;
+	}
+
+	bool isRead = false;
+	switch(type) {
+		case 'i': {
+			int64_t value = 0;
+			isRead = reader.read(value);
+			out << value;
+			break;
+		}
+		case 'u': {
+			uint64_t value = 0;
+			isRead = reader.read(value);
+			out << value;
+			break;
+		}
+		case 'd': {
+			double value = 0;
+			isRead = reader.read(value);
+			out << value;
+			break;
+		}
+		case 'b': {
+			uint8_t value = 0;
+			isRead = reader.read(value);
+			out << (value != 0);
+			break;
+		}
+		case 'c': {
+			char value = 0;
+			isRead = reader.read(value);
+			out << value;
+			break;
+		}
+		case 's': {
+			string value;
+			isRead = reader.readString(value);
+			out << value;
+			break;
+		}
+		default:
+			isRead = false;
+			break;
+	}
+
+	return isRead;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: writeLines
+// Description: Write the messages of one run of the logger in time order.
+///////////////////////////////////////////////////////////////////////////////
+
+static void writeLines(vector<pair<int64_t, string>>& lines, ostream& out)
+{
+	stable_sort(lines.begin(), lines.end(), [](const pair<int64_t, string>& a, const pair<int64_t, string>& b) {
+		return a.first < b.first;
+	});
+
+	for(const pair<int64_t, string>& line : lines) {
+		out << line.second << "\n";
+	}
+	lines.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: appendFormat
+// Description: Add a format record.
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryLog::appendFormat(std::string& out, std::uint32_t id, const std::string& format)
+{
+	out += FORMAT_RECORD;
+	appendRaw<uint32_t>(out, id);
+	appendString(out, format.data(), format.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: appendLogStart
+// Description: Add the fixed part of a log record.
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryLog::appendLogStart(std::string& out, std::uint32_t id, std::int64_t nanoseconds,
+                               const std::string& module, std::uint8_t numParams)
+{
+	out += LOG_RECORD;
+	appendRaw<uint32_t>(out, id);
+	appendRaw<int64_t>(out, nanoseconds);
+	appendString(out, module.data(), module.size());
+	appendRaw<uint8_t>(out, numParams);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: decode
+// Description: Decode a binary log to text.
+///////////////////////////////////////////////////////////////////////////////
+
+bool BinaryLog::decode(std::istream& in, std::ostream& out)
+{
+	string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	map<uint32_t, string> formats;
+	vector<pair<int64_t, string>> lines;
+	size_t pos = 0;
+	bool isValid = data.compare(0, MAGIC_SIZE, MAGIC) == 0;
+
+	while(isValid && pos < data.size()) {
+		if(data.compare(pos, MAGIC_SIZE, MAGIC) == 0) {
+			writeLines(lines, out);
+			formats.clear();
+			pos += MAGIC_SIZE;
+			continue;
+		}
+
+		BinaryLogReader reader(data, pos + 1);
+		uint32_t id = 0;
+		isValid = reader.read(id);
+
+		if(isValid && data[pos] == FORMAT_RECORD) {
+			isValid = reader.readString(formats[id]);
+		}
+		else if(isValid && data[pos] == LOG_RECORD) {
+			int64_t nanoseconds = 0;
+			string module;
+			uint8_t numParams = 0;
+			isValid = reader.read(nanoseconds) && reader.readString(module) && reader.read(numParams);
+
+			auto format = formats.find(id);
+			isValid = isValid && format != formats.end();
+
+			ostringstream line;
+			if(isValid) {
+				time_t second = (time_t)(nanoseconds / 1000000000);
+				tm localTimestamp;
+				char timestamp[64] = {0};
+				localtime_r(&second, &localTimestamp);
+				strftime(timestamp, sizeof(timestamp), "%F %T", &localTimestamp);
+				line << timestamp << " [" << module << "] ";
+
+				// Each & in the format is replaced by the next parameter.
+				size_t start = 0;
+				for(uint8_t i = 0; isValid && i < numParams; ++i) {
+					size_t marker = format->second.find('&', start);
+					if(marker == string::npos) {
+						isValid = false;
+						break;
+					}
+					line.write(format->second.data() + start, marker - start);
+					isValid = readValue(reader, line);
+					start = marker + 1;
+				}
+				line << format->second.substr(min(start, format->second.size()));
+			}
+
+			if(isValid) {
+				lines.push_back(make_pair(nanoseconds, line.str()));
+			}
+		}
+		else {
+			isValid = false;
+		}
+
+		pos = reader.pos();
+	}
+
+	writeLines(lines, out);
+
+	return isValid;
+}
+
+} // End namespace dw
@@ -0,0 +1,189 @@
+/**
+ * @class BinaryLog
+ *
+ * Encodes and decodes the binary log written by Logger when LOG_FORMAT is binary. A log
+ * message is stored as the id of its format string, the time and the raw bytes of its
+ * parameters, so nothing is formatted while the server runs. The format strings are
+ * written once, the first time they are used. The logdecoder tool turns a binary log back
+ * into the same text the text log holds.
+ *
+ * The file is a sequence of records. Each time the logger starts it writes MAGIC, and the
+ * format ids that follow are only valid until the next MAGIC.
+ *
+ *    'F' [u32 id] [string format]
+ *    'L' [u32 id] [i64 nanoseconds since the epoch] [string module] [u8 count] [value]...
+ *
+ * A value is a type byte followed by the value: 'i' i64, 'u' u64, 'd' double, 'b' u8,
+ * 'c' char or 's' string. A string is a u32 length followed by the bytes. Numbers are
+ * stored in the byte order of the machine that wrote the log.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+/*---------  System Includes  --------------*/
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace dw {
+
+/*---------  Class Declaration -------------*/
+
+class BinaryLog
+{
+public:
+
+   /*---------  Public Constants  ---------------*/
+
+   static const char MAGIC[];
+   static const std::size_t MAGIC_SIZE = 8;
+
+   static const char FORMAT_RECORD = 'F';
+   static const char LOG_RECORD = 'L';
+
+   /*---------  Public Methods  ---------------*/
+
+   /**
+    * Add a format record.
+    *
+    * @param out the bytes to add to.
+    * @param id the format's id.
+    * @param format the format string.
+    */
+   static void appendFormat(std::string& out, std::uint32_t id, const std::string& format);
+
+   /**
+    * Add the start of a log record. The parameters must follow.
+    *
+    * @param out the bytes to add to.
+    * @param id the id of the message's format.
+    * @param nanoseconds the time of the message.
+    * @param module the module which the message applies to.
+    * @param numParams the number of parameters that follow.
+    */
+   static void appendLogStart(std::string& out, std::uint32_t id, std::int64_t nanoseconds,
+                              const std::string& module, std::uint8_t numParams);
+
+   /**
+    * Add a parameter of a log record. Numbers, bools, chars and strings are stored as
+    * they are. Any other type is formatted as text.
+    *
+    * @param out the bytes to add to.
+    * @param param the parameter.
+    */
+   template <typename T>
+   static void appendParam(std::string& out, const T& param)
+   {
+      appendValue(out, param, Kind<T>());
+   }
+
+   /**
+    * Decode a binary log to text, one line for each message in the same form as the text
+    * log. The messages written since each start of the logger are sorted by time.
+    *
+    * @param in the binary log.
+    * @param out where the text is written.
+    * @return false if the log is not valid or ends part way through a record.
+    */
+   static bool decode(std::istream& in, std::ostream& out);
+
+private:
+
+   /*---------  Private Types      --------------*/
+
+   enum ValueKind {BOOL, CHAR, SIGNED, UNSIGNED, FLOAT, C_STRING, STRING, OTHER};
+
+   template <typename T>
+   using Kind = std::integral_constant<ValueKind,
+      std::is_same<T, bool>::value ? BOOL :
+      std::is_same<T, char>::value ? CHAR :
+      std::is_integral<T>::value && std::is_signed<T>::value ? SIGNED :
+      std::is_integral<T>::value ? UNSIGNED :
+      std::is_floating_point<T>::value ? FLOAT :
+      std::is_convertible<const T&, const char*>::value ? C_STRING :
+      std::is_same<T, std::string>::value ? STRING : OTHER>;
+
+   /*---------  Private Methods    ---------------*/
+
+   template <typename T>
+   static void appendRaw(std::string& out, T value)
+   {
+      out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+   }
+
+   static void appendString(std::string& out, const char* text, std::size_t length)
+   {
+      appendRaw<std::uint32_t>(out, length);
+      out.append(text, length);
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, BOOL>)
+   {
+      out += 'b';
+      appendRaw<std::uint8_t>(out, param ? 1 : 0);
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, CHAR>)
+   {
+      out += 'c';
+      out += param;
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, SIGNED>)
+   {
+      out += 'i';
+      appendRaw<std::int64_t>(out, param);
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, UNSIGNED>)
+   {
+      out += 'u';
+      appendRaw<std::uint64_t>(out, param);
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, FLOAT>)
+   {
+      out += 'd';
+      appendRaw<double>(out, param);
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, C_STRING>)
+   {
+      const char* text = param;
+      out += 's';
+      appendString(out, text, std::strlen(text));
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, STRING>)
+   {
+      out += 's';
+      appendString(out, param.data(), param.size());
+   }
+
+   template <typename T>
+   static void appendValue(std::string& out, const T& param, std::integral_constant<ValueKind, OTHER>)
+   {
+      std::ostringstream text;
+      text << param;
+      appendValue(out, text.str(), std::integral_constant<ValueKind, STRING>());
+   }
+};
+
+} // End namespace dw
+
+#endif // BINARYLOG_H
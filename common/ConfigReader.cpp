@@ -4,12 +4,18 @@
 
 /*---------  System Includes  --------------*/
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <map>
 #include <string>
 #include <exception>
 #include <stdexcept>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -17,13 +23,56 @@ namespace dw {
 
 const char* CONFIG_FILE_LOCATION = "config.cfg";
 
+// The start of the environment variables that replace configurations.
+const char* ENVIRONMENT_PREFIX = "BOOKMANAGER_";
+
+// How often the watcher checks whether it has been stopped.
+const int WATCH_POLL_MS = 500;
+
+// The default and limits of each whole number configuration. The logger reads
+// some of these while the program's statics are being built, so this must stay a
+// plain array. Defaults worked out when the program runs are given by the caller.
+const ConfigReader::IntSetting INT_SETTINGS[] = {
+   // Configuration                                   Default   Min   Max
+   {ConfigReader::Config::WRITE_BEHIND_MS,                  0,    0,  60000},
+   {ConfigReader::Config::ARCHIVE_MONTHS,                   0,    0,  1200},
+   {ConfigReader::Config::DB_SHARDS,                        1,    1,  1024},
+   {ConfigReader::Config::BACKUP_INTERVAL_MINUTES,          0,    0,  525600},
+   {ConfigReader::Config::MAINTENANCE_IDLE_REQUESTS,       30,    0,  1000000},
+   {ConfigReader::Config::DB_BUSY_TIMEOUT_MS,             100,    0,  60000},
+   {ConfigReader::Config::DB_RETRY_DEADLINE_MS,          2000,    0,  600000},
+   {ConfigReader::Config::REQUEST_DEADLINE_MS,           5000,    0,  3600000},
+   {ConfigReader::Config::SEARCH_CACHE_MS,              10000,    0,  3600000},
+   {ConfigReader::Config::SEARCH_CACHE_SESSIONS,         1000,    0,  1000000},
+   {ConfigReader::Config::LOG_QUEUE_SIZE,                8192,   64,  1 << 20},
+   {ConfigReader::Config::LOG_ROTATE_MB,                  100,    0,  1 << 20},
+   {ConfigReader::Config::LOG_ROTATE_HOURS,                24,    0,  8760},
+   {ConfigReader::Config::LOG_KEEP_FILES,                  10,    0,  10000},
+   {ConfigReader::Config::LOG_BODY_BYTES,                 256,    0,  65536},
+   {ConfigReader::Config::SERVER_THREADS,                   4,    1,  256},
+   {ConfigReader::Config::DB_POOL_SIZE,                     6,    1,  1024},
+   {ConfigReader::Config::BATCH_MAX_REQUESTS,              20,    1,  1000},
+   {ConfigReader::Config::STATIC_MAX_FILE_KB,            4096,    0,  1 << 20}
+};
+
 /******************************************************************************
  * Constructor
  ******************************************************************************
  */
 ConfigReader::ConfigReader()
 {
-   readInConfigs();
+   std::unique_ptr<Snapshot> snapshot = readInConfigs();
+
+   for(size_t i = 0; i < snapshot->values.size(); ++i) {
+      if(snapshot->isSet[i]) {
+         // Secrets are not written to the console.
+         bool isSecret = i == static_cast<size_t>(Config::ADMIN_TOKEN);
+         cout << "Config Map Values " << (isSecret ? "********" : snapshot->values[i]) << endl;
+      }
+   }
+
+   mSnapshot = snapshot.get();
+   mSnapshots.push_back(move(snapshot));
 }
 
 /******************************************************************************
@@ -32,7 +81,7 @@ ConfigReader::ConfigReader()
  */
 ConfigReader::~ConfigReader()
 {
-
+   stopWatching();
 }
 
 /******************************************************************************
@@ -54,6 +103,138 @@ ConfigReader::configEnumToString(ConfigReader::Config configIn) const
          config = "DB_PATH";
          break;
          
+      case Config::WRITE_BEHIND_MS:
+         config = "WRITE_BEHIND_MS";
+         break;
+         
+      case Config::ARCHIVE_PATH:
+         config = "ARCHIVE_PATH";
+         break;
+         
+      case Config::ARCHIVE_MONTHS:
+         config = "ARCHIVE_MONTHS";
+         break;
+         
+      case Config::STORAGE_BACKEND:
+         config = "STORAGE_BACKEND";
+         break;
+         
+      case Config::DB_SHARDS:
+         config = "DB_SHARDS";
+         break;
+         
+      case Config::BACKUP_DIR:
+         config = "BACKUP_DIR";
+         break;
+         
+      case Config::BACKUP_INTERVAL_MINUTES:
+         config = "BACKUP_INTERVAL_MINUTES";
+         break;
+         
+      case Config::ADMIN_TOKEN:
+         config = "ADMIN_TOKEN";
+         break;
+         
+      case Config::JOURNAL_PATH:
+         config = "JOURNAL_PATH";
+         break;
+         
+      case Config::MAINTENANCE_IDLE_REQUESTS:
+         config = "MAINTENANCE_IDLE_REQUESTS";
+         break;
+         
+      case Config::DB_BUSY_TIMEOUT_MS:
+         config = "DB_BUSY_TIMEOUT_MS";
+         break;
+         
+      case Config::DB_RETRY_DEADLINE_MS:
+         config = "DB_RETRY_DEADLINE_MS";
+         break;
+         
+      case Config::REQUEST_DEADLINE_MS:
+         config = "REQUEST_DEADLINE_MS";
+         break;
+         
+      case Config::ROUTE_DEADLINES_MS:
+         config = "ROUTE_DEADLINES_MS";
+         break;
+         
+      case Config::SEARCH_CACHE_MS:
+         config = "SEARCH_CACHE_MS";
+         break;
+         
+      case Config::SEARCH_CACHE_SESSIONS:
+         config = "SEARCH_CACHE_SESSIONS";
+         break;
+         
+      case Config::LOG_QUEUE_SIZE:
+         config = "LOG_QUEUE_SIZE";
+         break;
+         
+      case Config::LOG_OVERFLOW:
+         config = "LOG_OVERFLOW";
+         break;
+         
+      case Config::LOG_FORMAT:
+         config = "LOG_FORMAT";
+         break;
+         
+      case Config::LOG_PATH:
+         config = "LOG_PATH";
+         break;
+         
+      case Config::LOG_ROTATE_MB:
+         config = "LOG_ROTATE_MB";
+         break;
+         
+      case Config::LOG_ROTATE_HOURS:
+         config = "LOG_ROTATE_HOURS";
+         break;
+         
+      case Config::LOG_KEEP_FILES:
+         config = "LOG_KEEP_FILES";
+         break;
+         
+      case Config::LOG_COMPRESS:
+         config = "LOG_COMPRESS";
+         break;
+         
+      case Config::LOG_SAMPLE_PERCENT:
+         config = "LOG_SAMPLE_PERCENT";
+         break;
+         
+      case Config::LOG_RATE_LIMITS:
+         config = "LOG_RATE_LIMITS";
+         break;
+         
+      case Config::LOG_BODY_BYTES:
+         config = "LOG_BODY_BYTES";
+         break;
+         
+      case Config::SERVER_THREADS:
+         config = "SERVER_THREADS";
+         break;
+         
+      case Config::DB_POOL_SIZE:
+         config = "DB_POOL_SIZE";
+         break;
+         
+      case Config::BATCH_MAX_REQUESTS:
+         config = "BATCH_MAX_REQUESTS";
+         break;
+         
+      case Config::STATIC_MAX_FILE_KB:
+         config = "STATIC_MAX_FILE_KB";
+         break;
+         
+      case Config::STATIC_COMPRESS:
+         config = "STATIC_COMPRESS";
+         break;
+         
+      case Config::STATIC_MAX_AGE:
+         config = "STATIC_MAX_AGE";
+         break;
+         
       default:
          config = "NONE";
          break;
@@ -84,6 +265,138 @@ ConfigReader::configStringToEnum(const string& configString) const
    {
       config = Config::LOG_LEVEL;
    }
+   else if (configString == "WRITE_BEHIND_MS")
+   {
+      config = Config::WRITE_BEHIND_MS;
+   }
+   else if (configString == "ARCHIVE_PATH")
+   {
+      config = Config::ARCHIVE_PATH;
+   }
+   else if (configString == "ARCHIVE_MONTHS")
+   {
+      config = Config::ARCHIVE_MONTHS;
+   }
+   else if (configString == "STORAGE_BACKEND")
+   {
+      config = Config::STORAGE_BACKEND;
+   }
+   else if (configString == "DB_SHARDS")
+   {
+      config = Config::DB_SHARDS;
+   }
+   else if (configString == "BACKUP_DIR")
+   {
+      config = Config::BACKUP_DIR;
+   }
+   else if (configString == "BACKUP_INTERVAL_MINUTES")
+   {
+      config = Config::BACKUP_INTERVAL_MINUTES;
+   }
+   else if (configString == "ADMIN_TOKEN")
+   {
+      config = Config::ADMIN_TOKEN;
+   }
+   else if (configString == "JOURNAL_PATH")
+   {
+      config = Config::JOURNAL_PATH;
+   }
+   else if (configString == "MAINTENANCE_IDLE_REQUESTS")
+   {
+      config = Config::MAINTENANCE_IDLE_REQUESTS;
+   }
+   else if (configString == "DB_BUSY_TIMEOUT_MS")
+   {
+      config = Config::DB_BUSY_TIMEOUT_MS;
+   }
+   else if (configString == "DB_RETRY_DEADLINE_MS")
+   {
+      config = Config::DB_RETRY_DEADLINE_MS;
+   }
+   else if (configString == "REQUEST_DEADLINE_MS")
+   {
+      config = Config::REQUEST_DEADLINE_MS;
+   }
+   else if (configString == "ROUTE_DEADLINES_MS")
+   {
+      config = Config::ROUTE_DEADLINES_MS;
+   }
+   else if (configString == "SEARCH_CACHE_MS")
+   {
+      config = Config::SEARCH_CACHE_MS;
+   }
+   else if (configString == "SEARCH_CACHE_SESSIONS")
+   {
+      config = Config::SEARCH_CACHE_SESSIONS;
+   }
+   else if (configString == "LOG_QUEUE_SIZE")
+   {
+      config = Config::LOG_QUEUE_SIZE;
+   }
+   else if (configString == "LOG_OVERFLOW")
+   {
+      config = Config::LOG_OVERFLOW;
+   }
+   else if (configString == "LOG_FORMAT")
+   {
+      config = Config::LOG_FORMAT;
+   }
+   else if (configString == "LOG_PATH")
+   {
+      config = Config::LOG_PATH;
+   }
+   else if (configString == "LOG_ROTATE_MB")
+   {
+      config = Config::LOG_ROTATE_MB;
+   }
+   else if (configString == "LOG_ROTATE_HOURS")
+   {
+      config = Config::LOG_ROTATE_HOURS;
+   }
+   else if (configString == "LOG_KEEP_FILES")
+   {
+      config = Config::LOG_KEEP_FILES;
+   }
+   else if (configString == "LOG_COMPRESS")
+   {
+      config = Config::LOG_COMPRESS;
+   }
+   else if (configString == "LOG_SAMPLE_PERCENT")
+   {
+      config = Config::LOG_SAMPLE_PERCENT;
+   }
+   else if (configString == "LOG_RATE_LIMITS")
+   {
+      config = Config::LOG_RATE_LIMITS;
+   }
+   else if (configString == "LOG_BODY_BYTES")
+   {
+      config = Config::LOG_BODY_BYTES;
+   }
+   else if (configString == "SERVER_THREADS")
+   {
+      config = Config::SERVER_THREADS;
+   }
+   else if (configString == "DB_POOL_SIZE")
+   {
+      config = Config::DB_POOL_SIZE;
+   }
+   else if (configString == "BATCH_MAX_REQUESTS")
+   {
+      config = Config::BATCH_MAX_REQUESTS;
+   }
+   else if (configString == "STATIC_MAX_FILE_KB")
+   {
+      config = Config::STATIC_MAX_FILE_KB;
+   }
+   else if (configString == "STATIC_COMPRESS")
+   {
+      config = Config::STATIC_COMPRESS;
+   }
+   else if (configString == "STATIC_MAX_AGE")
+   {
+      config = Config::STATIC_MAX_AGE;
+   }
    else
    {
       config = Config::NONE;
@@ -100,16 +413,101 @@ ConfigReader::configStringToEnum(const string& configString) const
 string 
 ConfigReader::getConfig(ConfigReader::Config config) const
 {
-   auto configIter = mConfigCache1.find(config);
-   if(configIter == mConfigCache1.end()) {
+   const Snapshot* snapshot = mSnapshot.load(memory_order_acquire);
+   size_t index = (size_t)config;
+
+   if(index >= snapshot->values.size() || !snapshot->isSet[index]) {
       string logLevel = configEnumToString(config);
       string error = "No such configuration found: " + logLevel;
       throw(out_of_range(error));
    }
 
-   string configValue = configIter->second;
+   return snapshot->values[index];
+}
+
+/******************************************************************************
+ * Name: getInt
+ * Description: Get a whole number configuration within its limits.
+ ******************************************************************************
+ */
+long ConfigReader::getInt(ConfigReader::Config config) const
+{
+   return getInt(config, intSetting(config).defaultValue);
+}
+
+/******************************************************************************
+ * Name: getInt
+ * Description: Get a whole number configuration within its limits, with a
+ *              default worked out by the caller.
+ ******************************************************************************
+ */
+long ConfigReader::getInt(ConfigReader::Config config, long defaultValue) const
+{
+   const IntSetting& setting = intSetting(config);
+   long value = defaultValue;
+
+   try {
+      value = stol(getConfig(config));
+   }
+   catch(exception& e) {
+      value = defaultValue;
+   }
 
-   return configValue;
+   return min(max(value, setting.minValue), setting.maxValue);
+}
+
+/******************************************************************************
+ * Name: intSetting
+ * Description: Find the default and limits of a whole number configuration.
+ ******************************************************************************
+ */
+const ConfigReader::IntSetting& ConfigReader::intSetting(ConfigReader::Config config)
+{
+   for(const IntSetting& setting : INT_SETTINGS) {
+      if(setting.config == config) {
+         return setting;
+      }
+   }
+
+   throw invalid_argument("Not a whole number configuration: " + to_string(static_cast<int>(config)));
+}
+
+/******************************************************************************
+ * Name: setOverride
+ * Description: Set a configuration from a command line flag.
+ ******************************************************************************
+ */
+bool ConfigReader::setOverride(const std::string& flag)
+{
+   string::size_type separator = flag.find('=');
+   if(flag.compare(0, 2, "--") != 0 || separator == string::npos) {
+      return false;
+   }
+
+   // --server-threads names SERVER_THREADS.
+   string name = flag.substr(2, separator - 2);
+   transform(name.begin(), name.end(), name.begin(), [](char c) {
+      return c == '-' ? '_' : (char)toupper((unsigned char)c);
+   });
+
+   Config config = configStringToEnum(name);
+   if(config == Config::NONE) {
+      return false;
+   }
+
+   // An empty flag such as --server-threads= removes the override.
+   {
+      lock_guard<mutex> lock(mReloadMutex);
+      string value = flag.substr(separator + 1);
+      if(value.empty()) {
+         mOverrides.erase(config);
+      } else {
+         mOverrides[config] = value;
+      }
+   }
+   reload();
+
+   return true;
 }
 
 /******************************************************************************
@@ -124,19 +522,153 @@ ConfigReader& ConfigReader::getInstance()
    return mInstance;
 }
 
+/******************************************************************************
+ * Name: version
+ * Description: Returns the number of times the configuration has changed.
+ ******************************************************************************
+ */
+unsigned long ConfigReader::version() const
+{
+   return mSnapshot.load(memory_order_acquire)->version;
+}
+
+/******************************************************************************
+ * Name: reload
+ * Description: Read the file again and publish the values if they changed.
+ ******************************************************************************
+ */
+bool ConfigReader::reload()
+{
+   {
+      lock_guard<mutex> lock(mReloadMutex);
+
+      std::unique_ptr<Snapshot> snapshot;
+      try {
+         snapshot = readInConfigs();
+      }
+      catch(exception& e) {
+         cerr << "ConfigReader::reload. Keeping the current configuration. " << e.what() << endl;
+         return false;
+      }
+
+      const Snapshot* current = mSnapshot.load(memory_order_acquire);
+      if(snapshot->values == current->values && snapshot->isSet == current->isSet) {
+         return false;
+      }
+
+      snapshot->version = current->version + 1;
+      mSnapshot.store(snapshot.get(), memory_order_release);
+      mSnapshots.push_back(move(snapshot));
+   }
+
+   vector<function<void()>> listeners;
+   {
+      lock_guard<mutex> lock(mListenerMutex);
+      listeners = mListeners;
+   }
+
+   for(function<void()>& listener : listeners) {
+      listener();
+   }
+
+   return true;
+}
+
+/******************************************************************************
+ * Name: addReloadListener
+ * Description: Add a function to call after a reload.
+ ******************************************************************************
+ */
+void ConfigReader::addReloadListener(std::function<void()> listener)
+{
+   lock_guard<mutex> lock(mListenerMutex);
+
+   mListeners.push_back(listener);
+}
+
+/******************************************************************************
+ * Name: startWatching
+ * Description: Start the thread that reloads the file when it changes.
+ ******************************************************************************
+ */
+void ConfigReader::startWatching()
+{
+   if(mIsWatching.exchange(true)) {
+      return;
+   }
+
+   mWatcher = thread(&ConfigReader::watch, this);
+}
+
+/******************************************************************************
+ * Name: stopWatching
+ * Description: Stop the watcher thread.
+ ******************************************************************************
+ */
+void ConfigReader::stopWatching()
+{
+   mIsWatching = false;
+
+   if(mWatcher.joinable()) {
+      mWatcher.join();
+   }
+}
+
+/******************************************************************************
+ * Name: watch
+ * Description: Watch the directory holding the file, as editors often write
+ *              a new file and rename it over the old one.
+ ******************************************************************************
+ */
+void ConfigReader::watch()
+{
+   int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if(fd < 0 || inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+      cerr << "ConfigReader::watch. Cannot watch " << CONFIG_FILE_LOCATION << " for changes." << endl;
+      if(fd >= 0) close(fd);
+      return;
+   }
+
+   alignas(inotify_event) char buffer[4096];
+   pollfd events = {fd, POLLIN, 0};
+
+   while(mIsWatching) {
+      if(poll(&events, 1, WATCH_POLL_MS) <= 0) {
+         continue;
+      }
+
+      bool isChanged = false;
+      ssize_t length = 0;
+      while((length = read(fd, buffer, sizeof(buffer))) > 0) {
+         for(char* pos = buffer; pos < buffer + length;) {
+            inotify_event* event = reinterpret_cast<inotify_event*>(pos);
+            if(event->len > 0 && string(event->name) == CONFIG_FILE_LOCATION) {
+               isChanged = true;
+            }
+            pos += sizeof(inotify_event) + event->len;
+         }
+      }
+
+      if(isChanged && reload()) {
+         cout << "ConfigReader::watch. Reloaded " << CONFIG_FILE_LOCATION << endl;
+      }
+   }
+
+   close(fd);
+}
+
 /**
  * Name: readInConfigs
  * Description: Read in configurations from file
  */
-void ConfigReader::readInConfigs()
+std::unique_ptr<ConfigReader::Snapshot> ConfigReader::readInConfigs() const
 {
    string line("");
    string error = "ConfigReader::readInConfigs. Can't open file specified. "; 
 
    ifstream fin;
    try {
-      //fin.open(CONFIG_FILE_LOCATION);
-      fin.open("config.cfg");
+      fin.open(CONFIG_FILE_LOCATION);
    }
    catch (ifstream::failure e) {
       std::cout << error << e.what() << endl;
@@ -146,18 +678,30 @@ void ConfigReader::readInConfigs()
       throw invalid_argument(error.c_str());
    }
 
+   std::unique_ptr<Snapshot> snapshot(new Snapshot());
    while (fin.good() && !fin.eof())
    {
       getline(fin, line);
-      storeConfig(line);
+      storeConfig(line, *snapshot);
    }
 
    fin.close();
 
-   for(auto it = mConfigCache1.cbegin(); it != mConfigCache1.cend(); ++it) {
-      //cout << "Config Map Values" << it->first << ": " << it->second << endl;
-      cout << "Config Map Values " << it->second << endl;
+   for(size_t i = 1; i < snapshot->values.size(); ++i) {
+      string name = ENVIRONMENT_PREFIX + configEnumToString((Config)i);
+      const char* value = getenv(name.c_str());
+      if(value != nullptr && *value != '\0') {
+         snapshot->values[i] = value;
+         snapshot->isSet[i] = true;
+      }
    }
+
+   for(const pair<const Config, string>& flag : mOverrides) {
+      snapshot->values[(size_t)flag.first] = flag.second;
+      snapshot->isSet[(size_t)flag.first] = true;
+   }
+
+   return snapshot;
 }
 
 /**
@@ -172,7 +716,7 @@ void ConfigReader::readInConfigs()
  *      LogLevel=DEBUG
  *      # This is a comment
  */
-void ConfigReader::storeConfig(const string& configLine)
+void ConfigReader::storeConfig(const string& configLine, Snapshot& snapshot) const
 {
    // First check if this is a comment.
    if(configLine.front() != '#')
@@ -190,11 +734,11 @@ void ConfigReader::storeConfig(const string& configLine)
          // Add into the cache if neither string is empty
          if(!configuration.empty() && !value.empty())
          {
-            mConfigCache[configuration] = value;
             Config configEnum = configStringToEnum(configuration);
             if(configEnum != Config::NONE)
             {
-               mConfigCache1[configEnum] = value;
+               snapshot.values[(size_t)configEnum] = value;
+               snapshot.isSet[(size_t)configEnum] = true;
             }
          }
       }
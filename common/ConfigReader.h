@@ -4,6 +4,17 @@
  * This is a singleton class to manage configurations. All configurations are 
  * read in during initialization and cached. 
  * 
+ * The values are held in an immutable snapshot that is replaced as a whole when
+ * config.cfg is reloaded, so reading a value takes no lock.
+ * 
+ * A value in config.cfg is replaced by an environment variable named BOOKMANAGER_
+ * followed by the configuration, such as BOOKMANAGER_SERVER_THREADS=8, and both are
+ * replaced by a command line flag such as --server-threads=8.
+ * 
+ * Each whole number configuration has a default and limits, kept in one table in
+ * ConfigReader.cpp. getInt() returns the default for a missing or invalid value and
+ * keeps the others within the limits.
+ * 
  * @author  Dean Wilson
  * @version 1.0
  * @date    June 15, 2013
@@ -12,10 +23,16 @@
 #define CONFIGREADER_H
 
 /*---------  System Includes  --------------*/
+#include <array>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace dw {
    
@@ -33,6 +50,9 @@ namespace dw {
  *       // ....
  *    }
  * 
+ * Call startWatching() to reload config.cfg whenever it changes. Classes that
+ * keep a value add a reload listener to pick up the new one.
+ * 
  */
 class ConfigReader
 {
@@ -46,7 +66,52 @@ public:
    {
       NONE,
       LOG_LEVEL,
-      DB_PATH
+      DB_PATH,
+      WRITE_BEHIND_MS,
+      ARCHIVE_PATH,
+      ARCHIVE_MONTHS,
+      STORAGE_BACKEND,
+      DB_SHARDS,
+      BACKUP_DIR,
+      BACKUP_INTERVAL_MINUTES,
+      ADMIN_TOKEN,
+      JOURNAL_PATH,
+      MAINTENANCE_IDLE_REQUESTS,
+      DB_BUSY_TIMEOUT_MS,
+      DB_RETRY_DEADLINE_MS,
+      REQUEST_DEADLINE_MS,
+      ROUTE_DEADLINES_MS,
+      SEARCH_CACHE_MS,
+      SEARCH_CACHE_SESSIONS,
+      LOG_QUEUE_SIZE,
+      LOG_OVERFLOW,
+      LOG_FORMAT,
+      LOG_PATH,
+      LOG_ROTATE_MB,
+      LOG_ROTATE_HOURS,
+      LOG_KEEP_FILES,
+      LOG_COMPRESS,
+      LOG_SAMPLE_PERCENT,
+      LOG_RATE_LIMITS,
+      LOG_BODY_BYTES,
+      SERVER_THREADS,
+      DB_POOL_SIZE,
+      BATCH_MAX_REQUESTS,
+      STATIC_MAX_FILE_KB,
+      STATIC_COMPRESS,
+      STATIC_MAX_AGE,
+      NUM_CONFIGS
+   };
+
+   /**
+    * The default and limits of a whole number configuration.
+    */
+   struct IntSetting
+   {
+      Config config;
+      long defaultValue;
+      long minValue;
+      long maxValue;
    };
    
    /*---------  Public Functions  ---------------*/
@@ -61,6 +126,36 @@ public:
     std::string 
     getConfig(dw::ConfigReader::Config config) const;
 
+   /**
+    * Get the value of a whole number configuration, within its limits.
+    * 
+    * @param config [in] enum value of the configuration value to get.
+    * @return the value, or the configuration's default if it is not set or is not a number.
+    * @throws std::invalid_argument if config is not a whole number configuration.
+    */
+    long getInt(Config config) const;
+
+   /**
+    * Get the value of a whole number configuration whose default is only known when
+    * the program runs, such as the number of CPUs.
+    * 
+    * @param config [in] enum value of the configuration value to get.
+    * @param defaultValue [in] returned if the configuration is not set or is not a number.
+    * @return the value, within the configuration's limits.
+    * @throws std::invalid_argument if config is not a whole number configuration.
+    */
+    long getInt(Config config, long defaultValue) const;
+
+   /**
+    * Set a configuration from a command line flag such as --server-threads=8. It
+    * replaces the value in config.cfg and the environment, including after reloads.
+    * An empty value, as in --server-threads=, removes the flag's value.
+    * 
+    * @param flag [in] the command line argument.
+    * @return false if the argument is not a flag naming a configuration.
+    */
+    bool setOverride(const std::string& flag);
+
 
    /**
     * Get an instance of the configuration reader.
@@ -69,13 +164,67 @@ public:
     */
     static ConfigReader& getInstance();
 
+   /**
+    * Returns the number of times the configuration has changed. Use it to
+    * tell when a value read earlier may be out of date.
+    */
+    unsigned long version() const;
+
+   /**
+    * Read config.cfg again. If it has changed the new values replace the old
+    * ones at once and the reload listeners are called.
+    * 
+    * @return true if the configuration changed.
+    */
+    bool reload();
+
+   /**
+    * Add a function called after each reload that changed the configuration.
+    * It is called on the thread that reloaded, and must not call reload().
+    * 
+    * @param listener the function to call.
+    */
+    void addReloadListener(std::function<void()> listener);
+
+   /**
+    * Start a thread that reloads config.cfg whenever it is written or replaced.
+    */
+    void startWatching();
+
+   /**
+    * Stop the thread that watches config.cfg.
+    */
+    void stopWatching();
+
 private:
+   /*---------  Private Types   -----------------*/
+
+   /**
+    * The values of every configuration at one time. Never changed once published.
+    */
+    struct Snapshot
+    {
+       std::array<std::string, (std::size_t)Config::NUM_CONFIGS> values;
+       std::array<bool, (std::size_t)Config::NUM_CONFIGS> isSet{};
+       unsigned long version = 0;
+    };
+
    /*---------  Private Data    -----------------*/
    
     std::string mLogLevel;
     static ConfigReader mInstance;
-    std::map<std::string, std::string> mConfigCache;
-    std::map<Config, std::string> mConfigCache1;
+    std::atomic<const Snapshot*> mSnapshot{nullptr};
+
+    // Readers may still hold an old snapshot, and reloads are rare, so they are kept.
+    std::vector<std::unique_ptr<const Snapshot>> mSnapshots;
+    std::map<Config, std::string> mOverrides;
+    std::mutex mReloadMutex;
+
+    std::vector<std::function<void()>> mListeners;
+    std::mutex mListenerMutex;
+
+    std::thread mWatcher;
+    std::atomic<bool> mIsWatching{false};
 
 
    /*---------  Private Functions ---------------*/
@@ -95,6 +244,15 @@ private:
     */
    std::string configEnumToString(Config config) const;
 
+   /**
+    * Find the default and limits of a whole number configuration.
+    * 
+    * @param config [in] The configuration.
+    * @return The setting.
+    * @throws std::invalid_argument if config is not a whole number configuration.
+    */
+   static const IntSetting& intSetting(Config config);
+
    
   /**
    * Converts the passed in string to its enum representation. If the string does not match
@@ -114,17 +272,24 @@ private:
    * # This is a comment.
    * 
    * @param configLine A string in the form config=value or #comment
+   * @param snapshot The snapshot to store the value in.
    * @return void
    */
-   void storeConfig(const std::string& configLine);
+   void storeConfig(const std::string& configLine, Snapshot& snapshot) const;
    
    
    /**
-    * Read in all configurations and cache the values.
+    * Read in all configurations, then apply the environment and the command line flags.
     * 
-    * @return void
+    * @return The values read.
+    * @throws std::invalid_argument if the file cannot be opened.
+    */
+   std::unique_ptr<Snapshot> readInConfigs() const;
+
+   /**
+    * The watcher thread. Reloads when config.cfg is written or replaced.
     */
-   void readInConfigs();
+   void watch();
 };
 
 } // End Namespace
@@ -0,0 +1,403 @@
+
+/*---------  Program Includes  ---------------*/
+#include "LogFile.h"
+
+/*---------  System Includes  --------------*/
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace dw {
+
+// Char arrays, so they are set before the logger opens its files at startup.
+const char COMPRESSED_SUFFIX[] = ".gz";
+const char PARTIAL_SUFFIX[] = ".tmp";
+
+// The amount of a retired file read at a time while compressing it.
+const size_t COMPRESS_CHUNK_SIZE = 64 * 1024;
+
+// The nice value of the compressor thread, the lowest priority.
+const int COMPRESSOR_NICE = 19;
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: endsWith
+// Description: Returns true if text ends with suffix.
+///////////////////////////////////////////////////////////////////////////////
+
+static bool endsWith(const string& text, const char* suffix)
+{
+	size_t length = strlen(suffix);
+	return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: isFile
+// Description: Returns true if something exists at the path.
+///////////////////////////////////////////////////////////////////////////////
+
+static bool isFile(const string& path)
+{
+	struct stat info;
+	return stat(path.c_str(), &info) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: retiredOrder
+// Description: Orders retired files by the time in their names, whether or
+//              not they have been compressed.
+///////////////////////////////////////////////////////////////////////////////
+
+static bool retiredOrder(const string& a, const string& b)
+{
+	size_t length = strlen(COMPRESSED_SUFFIX);
+	string keyA = endsWith(a, COMPRESSED_SUFFIX) ? a.substr(0, a.size() - length) : a;
+	string keyB = endsWith(b, COMPRESSED_SUFFIX) ? b.substr(0, b.size() - length) : b;
+
+	return keyA < keyB;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: Constructor
+// Description: Open the file and start the compressor if the file rotates.
+///////////////////////////////////////////////////////////////////////////////
+
+LogFile::LogFile(const std::string& path, const Rotation& rotation, std::function<std::string()> header)
+	: mPath(path),
+	  mRotation(rotation),
+	  mHeader(header),
+	  mNumBytes(0),
+	  mHeaderSize(0),
+	  mIsCompressing(false),
+	  mIsStopping(false)
+{
+	open();
+
+	if(mRotation.maxBytes > 0 || mRotation.maxAge.count() > 0)
+	{
+		// A file retired just before the last run stopped may not be compressed yet.
+		for(const string& retired : retiredFiles()) {
+			if(!endsWith(retired, COMPRESSED_SUFFIX)) {
+				mRetired.push_back(retired);
+			}
+		}
+
+		mCompressor = thread(&LogFile::run, this);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: Destructor
+// Description: Stop the compressor once it has finished and close the file.
+///////////////////////////////////////////////////////////////////////////////
+
+LogFile::~LogFile()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+		mIsStopping = true;
+	}
+	mChanged.notify_all();
+	if(mCompressor.joinable()) mCompressor.join();
+
+	mStream.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: isOpen
+// Description: Returns true if the file is open.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogFile::isOpen() const
+{
+	return mStream.is_open();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: path
+// Description: Returns the path of the file.
+///////////////////////////////////////////////////////////////////////////////
+
+const std::string& LogFile::path() const
+{
+	return mPath;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: write
+// Description: Write and flush bytes, rotating first if the file is due.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::write(const std::string& bytes)
+{
+	if(bytes.empty() || !isOpen()) {
+		return;
+	}
+
+	if(isDue(bytes.size())) {
+		rotate();
+	}
+
+	mStream << bytes;
+	mStream.flush();
+	mNumBytes += bytes.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: rotate
+// Description: Rename the file and open a new one at the same path.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::rotate()
+{
+	mStream.close();
+
+	string retired = retiredPath();
+	bool isRetired = rename(mPath.c_str(), retired.c_str()) == 0;
+	if(!isRetired) {
+		cerr << "LogFile: cannot rename " << mPath << " to " << retired << "\n";
+	}
+
+	// Keep writing to the same file if it could not be renamed.
+	open();
+
+	if(isRetired) {
+		retire(retired);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: waitForRetired
+// Description: Wait until the compressor has nothing left to do.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::waitForRetired()
+{
+	unique_lock<mutex> lock(mMutex);
+
+	mChanged.wait(lock, [this]() {
+		return (mRetired.empty() && !mIsCompressing) || !mCompressor.joinable();
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: retiredFiles
+// Description: Returns the retired files next to the file, oldest first. Their
+//              names are the file's name, a dot and the time they were retired.
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> LogFile::retiredFiles() const
+{
+	size_t slash = mPath.rfind('/');
+	string directory = slash == string::npos ? "." : mPath.substr(0, slash + 1);
+	string prefix = (slash == string::npos ? mPath : mPath.substr(slash + 1)) + ".";
+
+	vector<string> retired;
+	DIR* dir = opendir(directory.c_str());
+	if(dir == nullptr) {
+		return retired;
+	}
+
+	while(dirent* entry = readdir(dir)) {
+		string name = entry->d_name;
+		if(name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+		   isdigit((unsigned char)name[prefix.size()]) && !endsWith(name, PARTIAL_SUFFIX)) {
+			retired.push_back(slash == string::npos ? name : directory + name);
+		}
+	}
+	closedir(dir);
+
+	sort(retired.begin(), retired.end(), retiredOrder);
+
+	return retired;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: open
+// Description: Open the file for appending and write the header.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::open()
+{
+	mStream.open(mPath, std::ofstream::out | std::ofstream::app | std::ofstream::binary);
+
+	struct stat info;
+	mNumBytes = stat(mPath.c_str(), &info) == 0 ? info.st_size : 0;
+	mOpened = system_clock::now();
+
+	if(mHeader && mStream.good()) {
+		string header = mHeader();
+		mStream << header;
+		mStream.flush();
+		mNumBytes += header.size();
+		mHeaderSize = header.size();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: isDue
+// Description: Returns true if the file is too big or too old for numBytes
+//              more. A file holding nothing but its header is never rotated.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogFile::isDue(std::size_t numBytes) const
+{
+	if(mNumBytes <= mHeaderSize) {
+		return false;
+	}
+
+	bool isFull = mRotation.maxBytes > 0 && mNumBytes + numBytes > mRotation.maxBytes;
+	bool isOld = mRotation.maxAge.count() > 0 && system_clock::now() - mOpened >= mRotation.maxAge;
+
+	return isFull || isOld;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: retiredPath
+// Description: Returns the path followed by the time. A number is added if a
+//              file was already retired in the same second.
+///////////////////////////////////////////////////////////////////////////////
+
+std::string LogFile::retiredPath() const
+{
+	time_t now = system_clock::to_time_t(system_clock::now());
+	tm localNow;
+	char timestamp[32] = {0};
+	localtime_r(&now, &localNow);
+	strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &localNow);
+
+	string base = mPath + "." + timestamp;
+	string retired = base;
+	for(int i = 1; isFile(retired) || isFile(retired + COMPRESSED_SUFFIX); ++i) {
+		retired = base + "-" + to_string(i);
+	}
+
+	return retired;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: retire
+// Description: Hand a retired file to the compressor thread.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::retire(const std::string& retired)
+{
+	if(!mCompressor.joinable()) {
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(mMutex);
+		mRetired.push_back(retired);
+	}
+	mChanged.notify_all();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: removeOldest
+// Description: Remove the oldest retired files beyond the number kept.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::removeOldest()
+{
+	if(mRotation.numKept == 0) {
+		return;
+	}
+
+	vector<string> retired = retiredFiles();
+	for(size_t i = 0; i + mRotation.numKept < retired.size(); ++i) {
+		remove(retired[i].c_str());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: run
+// Description: The compressor thread. Compresses each retired file, then
+//              removes the oldest. Runs at the lowest priority so it does not
+//              take time from requests.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogFile::run()
+{
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), COMPRESSOR_NICE);
+
+	unique_lock<mutex> lock(mMutex);
+	for(;;)
+	{
+		mChanged.wait(lock, [this]() {
+			return !mRetired.empty() || mIsStopping;
+		});
+
+		if(mRetired.empty()) {
+			break;
+		}
+
+		string retired = mRetired.front();
+		mRetired.pop_front();
+		mIsCompressing = true;
+		lock.unlock();
+
+		if(mRotation.isCompressed) {
+			compress(retired);
+		}
+		removeOldest();
+
+		lock.lock();
+		mIsCompressing = false;
+		mChanged.notify_all();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: compress
+// Description: Compress to a partial file, then rename it, so a .gz file is
+//              always whole. The retired file is removed once it is replaced.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogFile::compress(const std::string& path)
+{
+	FILE* in = fopen(path.c_str(), "rb");
+	if(in == nullptr) {
+		return false;
+	}
+
+	string compressed = path + COMPRESSED_SUFFIX;
+	string partial = compressed + PARTIAL_SUFFIX;
+	gzFile out = gzopen(partial.c_str(), "wb");
+	if(out == nullptr) {
+		fclose(in);
+		return false;
+	}
+
+	vector<char> chunk(COMPRESS_CHUNK_SIZE);
+	bool isWritten = true;
+	size_t numRead = 0;
+	while(isWritten && (numRead = fread(chunk.data(), 1, chunk.size(), in)) > 0) {
+		isWritten = gzwrite(out, chunk.data(), (unsigned)numRead) == (int)numRead;
+	}
+	isWritten = isWritten && !ferror(in);
+	fclose(in);
+	isWritten = gzclose(out) == Z_OK && isWritten;
+
+	if(isWritten && rename(partial.c_str(), compressed.c_str()) == 0) {
+		remove(path.c_str());
+		return true;
+	}
+
+	cerr << "LogFile: cannot compress " << path << "\n";
+	remove(partial.c_str());
+	return false;
+}
+
+} // End namespace dw
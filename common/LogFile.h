@@ -0,0 +1,169 @@
+/**
+ * @class LogFile
+ *
+ * A log file that is rotated when it grows past a size or gets older than an age. The
+ * file is renamed to its path followed by the time, such as logfile.log.20261019-143000,
+ * and a new file is started in its place. The rename is atomic, so the path always
+ * names a whole file.
+ *
+ * A background thread at the lowest priority compresses the retired files with gzip and
+ * deletes the oldest once there are more than the number kept. Only one thread may
+ * write to a LogFile. The logger's writer thread does, so log() never waits for a
+ * rotation.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+
+#ifndef LOGFILE_H
+#define LOGFILE_H
+
+/*---------  System Includes  --------------*/
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dw {
+
+/*---------  Class Declaration -------------*/
+
+class LogFile
+{
+public:
+
+   /*---------  Public Types      ---------------*/
+
+   /**
+    * When the file is rotated and what is kept.
+    */
+   struct Rotation
+   {
+      std::uint64_t maxBytes;         // 0 does not rotate by size.
+      std::chrono::seconds maxAge;    // 0 does not rotate by age.
+      std::size_t numKept;            // Retired files kept. 0 keeps them all.
+      bool isCompressed;              // Compress retired files with gzip.
+   };
+
+   /*---------  Public Methods  ---------------*/
+
+   /**
+    * Open the file for appending. Retired files left uncompressed by the last run are
+    * compressed.
+    *
+    * @param path the path of the file.
+    * @param rotation when to rotate.
+    * @param header returns the bytes written at the start of every new file, or is empty.
+    */
+   LogFile(const std::string& path, const Rotation& rotation,
+           std::function<std::string()> header = std::function<std::string()>());
+
+   /**
+    * Close the file after the retired files waiting have been compressed.
+    */
+   ~LogFile();
+
+   LogFile(const LogFile& other) = delete;
+   void operator=(const LogFile& other) = delete;
+
+   /**
+    * Returns true if the file is open.
+    */
+   bool isOpen() const;
+
+   /**
+    * Returns the path of the file.
+    */
+   const std::string& path() const;
+
+   /**
+    * Write bytes and flush them, rotating the file first if it is due.
+    *
+    * @param bytes the bytes to write.
+    */
+   void write(const std::string& bytes);
+
+   /**
+    * Retire the file and start a new one.
+    */
+   void rotate();
+
+   /**
+    * Wait until the retired files have been compressed and the oldest removed.
+    */
+   void waitForRetired();
+
+   /**
+    * Returns the paths of the retired files, oldest first.
+    */
+   std::vector<std::string> retiredFiles() const;
+
+private:
+
+   /*---------  Private Members    --------------*/
+
+   std::string mPath;
+   Rotation mRotation;
+   std::function<std::string()> mHeader;
+   std::ofstream mStream;
+   std::uint64_t mNumBytes;
+   std::uint64_t mHeaderSize;
+   std::chrono::system_clock::time_point mOpened;
+
+   std::thread mCompressor;
+   std::mutex mMutex;
+   std::condition_variable mChanged;
+   std::deque<std::string> mRetired;
+   bool mIsCompressing;
+   bool mIsStopping;
+
+   /*---------  Private Methods    ---------------*/
+
+   /**
+    * Open the file and write the header.
+    */
+   void open();
+
+   /**
+    * Returns true if writing numBytes more must go in a new file.
+    */
+   bool isDue(std::size_t numBytes) const;
+
+   /**
+    * Returns an unused path to retire the file to.
+    */
+   std::string retiredPath() const;
+
+   /**
+    * Add a retired file for the compressor thread.
+    */
+   void retire(const std::string& retired);
+
+   /**
+    * Remove the oldest retired files beyond the number kept.
+    */
+   void removeOldest();
+
+   /**
+    * The compressor thread.
+    */
+   void run();
+
+   /**
+    * Compress a file to the same path followed by .gz and remove it.
+    *
+    * @return false if it could not be compressed. The file is left as it was.
+    */
+   static bool compress(const std::string& path);
+};
+
+} // End namespace dw
+
+#endif // LOGFILE_H
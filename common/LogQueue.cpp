@@ -0,0 +1,120 @@
+
+/*---------  Program Includes  ---------------*/
+#include "LogQueue.h"
+
+/*---------  System Includes  --------------*/
+#include <utility>
+
+using namespace std;
+
+namespace dw {
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: Constructor
+// Description: Every slot starts free for the writer at its own position.
+///////////////////////////////////////////////////////////////////////////////
+
+LogQueue::LogQueue(std::size_t capacity)
+	: mMask(0),
+	  mPushPos(0),
+	  mPopPos(0)
+{
+	size_t size = 2;
+	while(size < capacity) {
+		size *= 2;
+	}
+
+	mMask = size - 1;
+	mSlots.reset(new Slot[size]);
+	for(size_t i = 0; i < size; ++i) {
+		mSlots[i].sequence.store(i, memory_order_relaxed);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: tryPush
+// Description: Claim the next position and fill its slot.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogQueue::tryPush(Record& record)
+{
+	size_t pos = mPushPos.load(memory_order_relaxed);
+	Slot* slot = nullptr;
+
+	for(;;) {
+		slot = &mSlots[pos & mMask];
+		size_t sequence = slot->sequence.load(memory_order_acquire);
+		long difference = (long)sequence - (long)pos;
+
+		if(difference == 0) {
+			if(mPushPos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if(difference < 0) {
+			// The reader has not taken the record written a lap ago.
+			return false;
+		}
+		else {
+			pos = mPushPos.load(memory_order_relaxed);
+		}
+	}
+
+	slot->record = move(record);
+	slot->sequence.store(pos + 1, memory_order_release);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: tryPop
+// Description: Take the record at the read position once it is filled.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogQueue::tryPop(Record& record)
+{
+	Slot& slot = mSlots[mPopPos & mMask];
+	size_t sequence = slot.sequence.load(memory_order_acquire);
+
+	if(sequence != mPopPos + 1) {
+		return false;
+	}
+
+	record = move(slot.record);
+	slot.sequence.store(mPopPos + mMask + 1, memory_order_release);
+	++mPopPos;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: isEmpty
+// Description: Returns true if the slot at the read position is not filled.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogQueue::isEmpty() const
+{
+	return mSlots[mPopPos & mMask].sequence.load(memory_order_acquire) != mPopPos + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: numPushed
+// Description: Returns the number of records added.
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t LogQueue::numPushed() const
+{
+	return mPushPos.load(memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: capacity
+// Description: Returns the number of records held.
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t LogQueue::capacity() const
+{
+	return mMask + 1;
+}
+
+} // End namespace dw
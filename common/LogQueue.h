@@ -0,0 +1,108 @@
+/**
+ * @class LogQueue
+ *
+ * Bounded queue of log records that many threads add to and one thread, the log writer,
+ * takes from. Adding a record does not take a lock. Each slot has a sequence number that
+ * says whether it is free for the next writer or holds a record for the reader, so
+ * threads only compete for the next position with a compare and swap.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+
+#ifndef LOGQUEUE_H
+#define LOGQUEUE_H
+
+/*---------  System Includes  --------------*/
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace dw {
+
+/*---------  Class Declaration -------------*/
+
+class LogQueue
+{
+public:
+
+   /*---------  Public Types      ---------------*/
+
+   /**
+    * One log message, formatted by the writer.
+    */
+   struct Record
+   {
+      std::chrono::system_clock::time_point time;
+      std::string module;
+      std::string message;
+   };
+
+   /*---------  Public Methods  ---------------*/
+
+   /**
+    * Create a queue.
+    *
+    * @param capacity the number of records held. Rounded up to a power of 2.
+    */
+   explicit LogQueue(std::size_t capacity);
+
+   LogQueue(const LogQueue& other) = delete;
+   void operator=(const LogQueue& other) = delete;
+
+   /**
+    * Add a record. Safe to call from any number of threads.
+    *
+    * @param record the record. Moved from if it is added.
+    * @return false if the queue is full.
+    */
+   bool tryPush(Record& record);
+
+   /**
+    * Take the oldest record. Only the writer thread may call this.
+    *
+    * @param record set to the record taken.
+    * @return false if the queue is empty.
+    */
+   bool tryPop(Record& record);
+
+   /**
+    * Returns true if there is no record for the writer to take. Only the writer thread
+    * may call this.
+    */
+   bool isEmpty() const;
+
+   /**
+    * Returns the number of records that have been added.
+    */
+   std::size_t numPushed() const;
+
+   /**
+    * Returns the number of records held.
+    */
+   std::size_t capacity() const;
+
+private:
+
+   /*---------  Private Types      --------------*/
+
+   struct Slot
+   {
+      std::atomic<std::size_t> sequence;
+      Record record;
+   };
+
+   /*---------  Private Members    --------------*/
+
+   std::size_t mMask;
+   std::unique_ptr<Slot[]> mSlots;
+   std::atomic<std::size_t> mPushPos;
+   std::size_t mPopPos;
+};
+
+} // End namespace dw
+
+#endif // LOGQUEUE_H
@@ -0,0 +1,139 @@
+
+/*---------  Program Includes  ---------------*/
+#include "LogSampler.h"
+
+/*---------  System Includes  --------------*/
+#include <chrono>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace dw {
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: percentile
+// Description: Returns a random number from 0 to 99. Each thread has its own
+//              generator, so no lock is taken.
+///////////////////////////////////////////////////////////////////////////////
+
+static unsigned percentile()
+{
+	static thread_local minstd_rand generator(
+		(unsigned)(hash<thread::id>()(this_thread::get_id()) ^ steady_clock::now().time_since_epoch().count()));
+
+	return generator() % 100;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Function: Constructor
+// Description: None
+///////////////////////////////////////////////////////////////////////////////
+
+LogSampler::LogSampler()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: configure
+// Description: Set the sampling percentage and rate limit of the modules.
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> LogSampler::configure(const std::string& percents, const std::string& perSecond)
+{
+	vector<string> invalid;
+
+	mModules.clear();
+	readLimits(percents, &Module::percent, invalid);
+	readLimits(perSecond, &Module::perSecond, invalid);
+
+	return invalid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: isSampled
+// Description: Keep a message with the module's percentage, then while the
+//              module has written fewer than its limit this second. Two
+//              threads starting a new second at once may let a message or
+//              two more through.
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogSampler::isSampled(const std::string& module)
+{
+	auto found = mModules.find(module);
+	if(found == mModules.end()) {
+		return true;
+	}
+
+	Module& limits = *found->second;
+	bool isSampled = limits.percent >= 100 || percentile() < limits.percent;
+
+	if(isSampled && limits.perSecond > 0) {
+		long now = duration_cast<seconds>(steady_clock::now().time_since_epoch()).count();
+		long second = limits.second.load(memory_order_relaxed);
+		if(second != now && limits.second.compare_exchange_strong(second, now)) {
+			limits.numInSecond = 0;
+		}
+		isSampled = ++limits.numInSecond <= limits.perSecond;
+	}
+
+	if(!isSampled) {
+		limits.numSuppressed.fetch_add(1, memory_order_relaxed);
+	}
+
+	return isSampled;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: takeSuppressed
+// Description: Returns and resets the number of suppressed messages.
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::pair<std::string, unsigned long>> LogSampler::takeSuppressed()
+{
+	vector<pair<string, unsigned long>> suppressed;
+
+	for(auto& module : mModules) {
+		unsigned long numSuppressed = module.second->numSuppressed.exchange(0);
+		if(numSuppressed > 0) {
+			suppressed.push_back(make_pair(module.first, numSuppressed));
+		}
+	}
+
+	return suppressed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: readLimits
+// Description: Read "module=number" entries separated by commas.
+///////////////////////////////////////////////////////////////////////////////
+
+void LogSampler::readLimits(const std::string& config, unsigned Module::*limit, std::vector<std::string>& invalid)
+{
+	istringstream stream(config);
+	string entry;
+
+	while(getline(stream, entry, ',')) {
+		string::size_type separator = entry.find('=');
+		try {
+			if(separator == string::npos || separator == 0) {
+				throw invalid_argument(entry);
+			}
+
+			unsigned long value = stoul(entry.substr(separator + 1));
+			unique_ptr<Module>& module = mModules[entry.substr(0, separator)];
+			if(!module) {
+				module.reset(new Module());
+			}
+			(*module).*limit = (unsigned)value;
+		}
+		catch(exception& e) {
+			invalid.push_back(entry);
+		}
+	}
+}
+
+} // End namespace dw
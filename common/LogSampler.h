@@ -0,0 +1,93 @@
+/**
+ * @class LogSampler
+ *
+ * Decides which of a module's per-request log messages are written. Each module can
+ * keep a percentage of its messages, chosen at random, and be limited to a number of
+ * messages a second. The messages left out are counted so the logger can write how
+ * many were suppressed.
+ *
+ * The modules are set once, before messages are logged. Deciding takes no lock.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+
+#ifndef LOGSAMPLER_H
+#define LOGSAMPLER_H
+
+/*---------  System Includes  --------------*/
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dw {
+
+/*---------  Class Declaration -------------*/
+
+class LogSampler
+{
+public:
+
+   /*---------  Public Methods  ---------------*/
+
+   LogSampler();
+
+   LogSampler(const LogSampler& other) = delete;
+   void operator=(const LogSampler& other) = delete;
+
+   /**
+    * Set the modules' limits. Each is a list such as "WebServer=10,BookController=50".
+    * Entries that are not a module and a number are ignored.
+    *
+    * @param percents the percentage of each module's messages that are written.
+    * @param perSecond the most messages a second written for each module.
+    * @return the invalid entries.
+    */
+   std::vector<std::string> configure(const std::string& percents, const std::string& perSecond);
+
+   /**
+    * Returns true if a message of the module is written. Messages of modules with no
+    * limits always are.
+    *
+    * @param module the module of the message.
+    */
+   bool isSampled(const std::string& module);
+
+   /**
+    * Returns the number of messages of each module suppressed since the last call, for
+    * the modules with any.
+    */
+   std::vector<std::pair<std::string, unsigned long>> takeSuppressed();
+
+private:
+
+   /*---------  Private Types      --------------*/
+
+   struct Module
+   {
+      unsigned percent = 100;
+      unsigned perSecond = 0;
+      std::atomic<long> second{0};
+      std::atomic<unsigned> numInSecond{0};
+      std::atomic<unsigned long> numSuppressed{0};
+   };
+
+   /*---------  Private Members    --------------*/
+
+   std::unordered_map<std::string, std::unique_ptr<Module>> mModules;
+
+   /*---------  Private Methods    ---------------*/
+
+   /**
+    * Read a list of modules and numbers, setting one limit of each module.
+    */
+   void readLimits(const std::string& config, unsigned Module::*limit, std::vector<std::string>& invalid);
+};
+
+} // End namespace dw
+
+#endif // LOGSAMPLER_H
@@ -4,6 +4,7 @@
 #include "ConfigReader.h"
 
 /*---------  System Includes  --------------*/
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
@@ -14,8 +15,46 @@ using namespace std::chrono;
 
 namespace dw {
 
+// The most messages written to the file at once.
+const size_t MAX_BATCH_SIZE = 1024;
+
+// How long the writer sleeps when there is nothing to write, in case a wake up was missed.
+const milliseconds WRITER_IDLE_WAIT(50);
+
+// How long log() waits for room in a full queue when the policy is to block.
+const microseconds BLOCK_WAIT(100);
+
+// The space in each thread's binary buffer for each message the text queue holds.
+const size_t BINARY_BYTES_PER_MESSAGE = 128;
+
+const string DEFAULT_LOG_PATH = "logfile.log";
+
+const size_t TIMESTAMP_SIZE = 181;
+
+// How often the number of messages suppressed by sampling is written.
+const seconds SAMPLING_SUMMARY_INTERVAL(10);
+
+constexpr Logger::LogLevel Logger::MIN_LEVEL;
+
 Logger Logger::mInstance;
 
+///////////////////////////////////////////////////////////////////////////////
+// Function: formatTimestamp
+// Description: Format the time of a message. The time is only formatted
+//              again when the second changes.
+///////////////////////////////////////////////////////////////////////////////
+
+static void formatTimestamp(time_t second, char (&timestamp)[TIMESTAMP_SIZE], time_t& timestampSecond)
+{
+	if(second != timestampSecond)
+	{
+		tm localTimestamp;
+		localtime_r(&second, &localTimestamp);
+		strftime(timestamp, sizeof(timestamp), "%F %T", &localTimestamp);
+		timestampSecond = second;
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Function: Constructor
 // Description: None
@@ -23,13 +62,21 @@ Logger Logger::mInstance;
 
 Logger::Logger()
 {
-	mOutputStream.open("logfile.log", std::ofstream::out | std::ofstream::app);
-	if(mOutputStream.good())
+	string logLevel = "";
+	string path = DEFAULT_LOG_PATH;
+	try {
+		path = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_PATH);
+	}
+	catch(exception& e) {
+		path = DEFAULT_LOG_PATH;
+	}
+
+	mOutputFile.reset(new LogFile(path, configuredRotation()));
+	if(mOutputFile->isOpen())
 	{
 		try {
-			string logLevel = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_LEVEL); 
+			logLevel = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_LEVEL); 
 			mLogLevel = stringToLogLevel(logLevel);
-               log(LogLevel::INFO, "Logger", "Logger initialized at level &.", logLevel);
 		}
 		catch(out_of_range& e) {
 			e.what();
@@ -39,17 +86,38 @@ Logger::Logger()
 		
 		mIsFileOpen = true;
 	}
+
+	configureQueue();
+	configureSampling();
+	mIsRunning = true;
+	mWriter = thread(&Logger::run, this);
+
+	try {
+		ConfigReader::getInstance().addReloadListener([this]() { reloadConfig(); });
+	}
+	catch(exception& e) {
+	}
+
+	log(LogLevel::INFO, "Logger", "Logger initialized at level &.", logLevel);
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // Function: Destructor
-// Description: None
+// Description: Write the queued messages and stop the writer thread.
 ///////////////////////////////////////////////////////////////////////////////
 
 Logger::~Logger()
 {
-	if(mIsFileOpen) mOutputStream.close();
+	mIsRunning = false;
+	{
+		lock_guard<mutex> lock(mWakeMutex);
+	}
+	mWake.notify_one();
+	if(mWriter.joinable()) mWriter.join();
+
+	mBinaryFile.reset();
+	mOutputFile.reset();
 }
 
 
@@ -75,71 +143,65 @@ void Logger::log(Logger::LogLevel level,
                  const std::string& module, 
                  const std::string& message) const
 {
-	const size_t MAX_BUFFER_SIZE = 180;
-	system_clock::time_point today = system_clock::now();
-	time_t temp = system_clock::to_time_t (today);
-	tm* localTimestamp = localtime(&temp);
-   char buffer[MAX_BUFFER_SIZE+1] = {0};
-	//strftime(buffer, sizeof(MAX_BUFFER_SIZE), "%F %T", localTimestamp);
-	//strftime(buffer, sizeof(buffer), "%Y-%m-%D %H:%M:%S", localTimestamp);
-	strftime(buffer, sizeof(buffer), "%F %T", localTimestamp);
-	buffer[MAX_BUFFER_SIZE] = 0;
-	
-	// TODO: Use this when supported
-	//mOutputStream << put_time(localTimestamp, "%F %T") << " [" << module << "] " << message << endl;
+	if(false == isMessageAtLevelToWrite(level))
+	{
+		return;
+	}
 
-	if(true == isMessageAtLevelToWrite(level))
+	// A message that is not a literal is recorded as a parameter of a plain format.
+	if(mFormat == Format::BINARY)
 	{
-		mOutputStream << buffer << " [" << module << "] " << message << endl;
+		string& binary = binaryRecord();
+		BinaryLog::appendLogStart(binary, mTextFormatId, nowNanoseconds(), module, 1);
+		BinaryLog::appendParam(binary, message);
+		writeBinary(binary);
+		return;
 	}
+
+	// The writer formats the time, so the caller only pays for adding to the queue.
+	LogQueue::Record record = {system_clock::now(), module, message};
+
+	while(false == mQueue->tryPush(record))
+	{
+		if(false == mIsRunning || mOverflowPolicy != OverflowPolicy::BLOCK)
+		{
+			++mNumDropped;
+			return;
+		}
+
+		wakeWriter();
+		this_thread::sleep_for(BLOCK_WAIT);
+	}
+
+	wakeWriter();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Private Function: isMessageAtLevelToWrite
-// Description: Determines if the input log level should be printed based on
-//              the currently set log level of the logger.
+// Public Function: flush
+// Description: Wait until the messages logged so far have been written.
 ///////////////////////////////////////////////////////////////////////////////
 
-bool Logger::isMessageAtLevelToWrite(Logger::LogLevel levelIn) const
+void Logger::flush() const
 {
-	bool isCorrectLevel = false;
-	
-	switch(levelIn)
-	{
-		case LogLevel::DEBUG:
-			if(mLogLevel == LogLevel::DEBUG ||
-                     mLogLevel == LogLevel::ERROR)
-                  {
-                     isCorrectLevel = true;
-                  }
-			break;
-			
-		case LogLevel::ERROR:
-			if(mLogLevel != LogLevel::NONE) {
-                     isCorrectLevel = true;
-                  }
-			break;
-			
-		case LogLevel::INFO:
-			if(mLogLevel == LogLevel::ERROR ||
-                     mLogLevel == LogLevel::DEBUG ||
-			   mLogLevel == LogLevel::INFO)
-			{
-				isCorrectLevel = true;
-			}
-			break;
-			
-		case LogLevel::NONE:
-			isCorrectLevel = false;
-			break;
-			
-		default:
-			isCorrectLevel = false;
-			log(LogLevel::ERROR, "Logger", "Invalid log level in isMessageAtLevelToWrite");
-			break;
-	}
-	
-	return isCorrectLevel;
+	size_t numLogged = mQueue->numPushed();
+
+	unique_lock<mutex> lock(mWakeMutex);
+	unsigned long request = ++mFlushRequests;
+	mWake.notify_one();
+
+	mWritten.wait(lock, [this, numLogged, request]() {
+		return (mNumWritten >= numLogged && mFlushedThrough >= request) || false == mIsRunning;
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: numDropped
+// Description: Returns the number of messages discarded when the queue was full.
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned long Logger::numDropped() const
+{
+	return mNumDropped;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -184,29 +246,457 @@ Logger::LogLevel Logger::stringToLogLevel(const std::string& levelIn) const
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// Private Function: splitStringAt
-// Description: 
+// Private Function: configuredRotation
+// Description: Read the rotation size, age and number of files kept.
+///////////////////////////////////////////////////////////////////////////////
+
+LogFile::Rotation Logger::configuredRotation()
+{
+	ConfigReader& config = ConfigReader::getInstance();
+	LogFile::Rotation rotation = {(uint64_t)config.getInt(ConfigReader::Config::LOG_ROTATE_MB) * 1024 * 1024,
+	                              hours(config.getInt(ConfigReader::Config::LOG_ROTATE_HOURS)),
+	                              (size_t)config.getInt(ConfigReader::Config::LOG_KEEP_FILES), true};
+
+	try {
+		rotation.isCompressed = config.getConfig(ConfigReader::Config::LOG_COMPRESS) != "false";
+	}
+	catch(exception& e) {
+	}
+
+	return rotation;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: binaryHeader
+// Description: Format ids start again in each binary file, so every format
+//              known so far is written again after MAGIC.
+///////////////////////////////////////////////////////////////////////////////
+
+std::string Logger::binaryHeader() const
+{
+	string header(BinaryLog::MAGIC, BinaryLog::MAGIC_SIZE);
+
+	lock_guard<mutex> lock(mFormatMutex);
+	for(const pair<const string, uint32_t>& format : mFormatIds) {
+		BinaryLog::appendFormat(header, format.second, format.first);
+	}
+
+	return header;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: configureQueue
+// Description: Create the queue with the configured size and overflow policy.
 ///////////////////////////////////////////////////////////////////////////////
-std::vector< std::string > Logger::splitStringAt(const std::string& stringIn, const char splitTokenIn) const
+
+void Logger::configureQueue()
 {
-	vector<string> tokens;
-	size_t pos      = 0;
-	size_t startPos = 0;
-	string subString;
-	while(pos != string::npos) {
-		pos = stringIn.find(splitTokenIn, startPos);
-		if(pos == 0) {
-			subString = "";
+	size_t queueSize = ConfigReader::getInstance().getInt(ConfigReader::Config::LOG_QUEUE_SIZE);
+	mQueue.reset(new LogQueue(queueSize));
+	mOverflowPolicy = configuredOverflowPolicy();
+
+	mMaxThreadBufferSize = mQueue->capacity() * BINARY_BYTES_PER_MESSAGE;
+
+	string format = "";
+	try {
+		format = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_FORMAT);
+	}
+	catch(exception& e) {
+		format = "";
+	}
+
+	if(format == "binary") {
+		// The text log's path with .bin in place of its extension.
+		string path = mOutputFile->path();
+		size_t extension = path.rfind('.');
+		if(extension == string::npos || path.find('/', extension) != string::npos) {
+			extension = path.size();
 		}
-		else {
-			subString = stringIn.substr(startPos, (pos - startPos));
+		path = path.substr(0, extension) + ".bin";
+
+		mBinaryFile.reset(new LogFile(path, configuredRotation(), [this]() { return binaryHeader(); }));
+		if(mBinaryFile->isOpen()) {
+			mFormat = Format::BINARY;
+			mTextFormatId = formatId("&");
+			mDroppedFormatId = formatId("& messages dropped. The log queue was full.");
 		}
+	}
+}
 
-		tokens.push_back(subString);
-		startPos = pos+1;
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: configuredOverflowPolicy
+// Description: Read LOG_OVERFLOW. Counting dropped messages is the default.
+///////////////////////////////////////////////////////////////////////////////
+
+Logger::OverflowPolicy Logger::configuredOverflowPolicy()
+{
+	string overflow = "";
+	try {
+		overflow = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_OVERFLOW);
 	}
-	
-	return tokens;
+	catch(exception& e) {
+		overflow = "";
+	}
+
+	if(overflow == "block") {
+		return OverflowPolicy::BLOCK;
+	}
+	else if(overflow == "drop") {
+		return OverflowPolicy::DROP;
+	}
+
+	return OverflowPolicy::COUNT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: reloadConfig
+// Description: Apply the settings that can change while the logger runs.
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::reloadConfig()
+{
+	string logLevel = "";
+	try {
+		logLevel = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_LEVEL);
+		mLogLevel = stringToLogLevel(logLevel);
+	}
+	catch(exception& e) {
+		logLevel = "unchanged";
+	}
+
+	mOverflowPolicy = configuredOverflowPolicy();
+
+	mMaxBodySize = ConfigReader::getInstance().getInt(ConfigReader::Config::LOG_BODY_BYTES);
+
+	log(LogLevel::INFO, "Logger", "Configuration reloaded. Level &.", logLevel);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: configureSampling
+// Description: Set the modules' sampling and rate limits, and the size of
+//              request bodies in the log.
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::configureSampling()
+{
+	string percents = "";
+	try {
+		percents = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_SAMPLE_PERCENT);
+	}
+	catch(exception& e) {
+		percents = "";
+	}
+
+	string perSecond = "";
+	try {
+		perSecond = ConfigReader::getInstance().getConfig(ConfigReader::Config::LOG_RATE_LIMITS);
+	}
+	catch(exception& e) {
+		perSecond = "";
+	}
+
+	for(const string& entry : mSampler.configure(percents, perSecond)) {
+		log(LogLevel::ERROR, "Logger", "configureSampling(). ERROR Invalid sampling limit: &.", entry);
+	}
+
+	mMaxBodySize = ConfigReader::getInstance().getInt(ConfigReader::Config::LOG_BODY_BYTES);
+
+	if(mFormat == Format::BINARY) {
+		mSuppressedFormatId = formatId("& messages suppressed by sampling and rate limits.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: literalFormatId
+// Description: Find the id of a format string literal. Each thread caches the
+//              ids by the address of the literal, so no lock is taken after the
+//              first use.
+///////////////////////////////////////////////////////////////////////////////
+
+bool Logger::literalFormatId(const char* format, std::size_t numParams, std::uint32_t& id) const
+{
+	struct Site
+	{
+		uint32_t id;
+		size_t numMarkers;
+	};
+	static thread_local unordered_map<const char*, Site> sites;
+
+	auto site = sites.find(format);
+	if(site == sites.end()) {
+		string text = format;
+		Site newSite = {formatId(text), (size_t)count(text.begin(), text.end(), '&')};
+		site = sites.insert(make_pair(format, newSite)).first;
+	}
+
+	id = site->second.id;
+
+	return site->second.numMarkers == numParams;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: formatId
+// Description: Returns the id of a format string. A new format is added to the
+//              formats for the writer to write.
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint32_t Logger::formatId(const std::string& format) const
+{
+	lock_guard<mutex> lock(mFormatMutex);
+
+	auto found = mFormatIds.find(format);
+	if(found != mFormatIds.end()) {
+		return found->second;
+	}
+
+	uint32_t id = mFormatIds.size();
+	mFormatIds[format] = id;
+	BinaryLog::appendFormat(mPendingFormats, id, format);
+
+	return id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: binaryRecord
+// Description: Returns this thread's buffer for building a record.
+///////////////////////////////////////////////////////////////////////////////
+
+std::string& Logger::binaryRecord()
+{
+	static thread_local string record;
+
+	record.clear();
+	return record;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: nowNanoseconds
+// Description: Returns the time in nanoseconds since the epoch.
+///////////////////////////////////////////////////////////////////////////////
+
+std::int64_t Logger::nowNanoseconds()
+{
+	return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: threadBuffer
+// Description: Returns the calling thread's binary buffer. The logger keeps a
+//              reference, so records left when the thread ends are still written.
+///////////////////////////////////////////////////////////////////////////////
+
+Logger::ThreadBuffer& Logger::threadBuffer() const
+{
+	static thread_local shared_ptr<ThreadBuffer> buffer;
+
+	if(!buffer) {
+		buffer = make_shared<ThreadBuffer>();
+
+		lock_guard<mutex> lock(mFormatMutex);
+		mThreadBuffers.push_back(buffer);
+	}
+
+	return *buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: writeBinary
+// Description: Add a record to this thread's buffer.
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::writeBinary(std::string& record) const
+{
+	ThreadBuffer& buffer = threadBuffer();
+
+	for(;;)
+	{
+		{
+			lock_guard<mutex> lock(buffer.mutex);
+			if(buffer.bytes.size() + record.size() <= mMaxThreadBufferSize) {
+				buffer.bytes += record;
+				break;
+			}
+		}
+
+		if(false == mIsRunning || mOverflowPolicy != OverflowPolicy::BLOCK)
+		{
+			++mNumDropped;
+			break;
+		}
+
+		// Ask the writer to empty the buffers now.
+		++mFlushRequests;
+		mWake.notify_one();
+		this_thread::sleep_for(BLOCK_WAIT);
+	}
+
+	record.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: writeBinaryBuffers
+// Description: Append the new formats and the thread buffers to the file.
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::writeBinaryBuffers(const std::string& records)
+{
+	vector<shared_ptr<ThreadBuffer>> buffers;
+	{
+		lock_guard<mutex> lock(mFormatMutex);
+
+		// Only the logger holds the buffers of threads that have ended.
+		mThreadBuffers.erase(remove_if(mThreadBuffers.begin(), mThreadBuffers.end(), [](const shared_ptr<ThreadBuffer>& buffer) {
+			lock_guard<mutex> bufferLock(buffer->mutex);
+			return buffer.use_count() == 1 && buffer->bytes.empty();
+		}), mThreadBuffers.end());
+
+		buffers = mThreadBuffers;
+	}
+
+	string bytes;
+	for(shared_ptr<ThreadBuffer>& buffer : buffers) {
+		lock_guard<mutex> lock(buffer->mutex);
+		bytes += buffer->bytes;
+		buffer->bytes.clear();
+	}
+
+	// Taken after the buffers, so every format they use is written first.
+	string formats;
+	{
+		lock_guard<mutex> lock(mFormatMutex);
+		formats.swap(mPendingFormats);
+	}
+
+	if(!formats.empty() || !bytes.empty() || !records.empty()) {
+		mBinaryFile->write(formats + bytes + records);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: wakeWriter
+// Description: Wake the writer thread if it is waiting for messages.
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::wakeWriter() const
+{
+	if(mIsWriterWaiting)
+	{
+		mWake.notify_one();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: run
+// Description: The writer thread. Takes all the queued messages, writes them
+//              to the file at once and flushes the file once. In the binary
+//              format the thread buffers are written the same way.
+///////////////////////////////////////////////////////////////////////////////
+
+void Logger::run()
+{
+	char timestamp[TIMESTAMP_SIZE] = {0};
+	time_t timestampSecond = 0;
+	unsigned long numReportedDropped = 0;
+	steady_clock::time_point nextSummary = steady_clock::now() + SAMPLING_SUMMARY_INTERVAL;
+	string batch;
+	string binaryBatch;
+	LogQueue::Record record;
+
+	for(;;)
+	{
+		bool isRunning = mIsRunning;
+		unsigned long flushRequest = mFlushRequests;
+		size_t numTaken = 0;
+
+		while(numTaken < MAX_BATCH_SIZE && mQueue->tryPop(record))
+		{
+			formatTimestamp(system_clock::to_time_t(record.time), timestamp, timestampSecond);
+
+			batch += timestamp;
+			batch += " [" + record.module + "] " + record.message + "\n";
+			++numTaken;
+		}
+
+		unsigned long numDropped = mNumDropped;
+		if(numDropped != numReportedDropped && mOverflowPolicy == OverflowPolicy::COUNT)
+		{
+			if(mFormat == Format::BINARY)
+			{
+				BinaryLog::appendLogStart(binaryBatch, mDroppedFormatId, nowNanoseconds(), "Logger", 1);
+				BinaryLog::appendParam(binaryBatch, numDropped - numReportedDropped);
+			}
+			else
+			{
+				batch += string(timestamp) + " [Logger] " + to_string(numDropped - numReportedDropped) + " messages dropped. The log queue was full.\n";
+			}
+			numReportedDropped = numDropped;
+		}
+
+		// The last counts are written when the logger stops.
+		if(steady_clock::now() >= nextSummary || false == isRunning)
+		{
+			nextSummary = steady_clock::now() + SAMPLING_SUMMARY_INTERVAL;
+			formatTimestamp(system_clock::to_time_t(system_clock::now()), timestamp, timestampSecond);
+
+			for(const pair<string, unsigned long>& suppressed : mSampler.takeSuppressed())
+			{
+				if(mFormat == Format::BINARY)
+				{
+					BinaryLog::appendLogStart(binaryBatch, mSuppressedFormatId, nowNanoseconds(), suppressed.first, 1);
+					BinaryLog::appendParam(binaryBatch, suppressed.second);
+				}
+				else
+				{
+					batch += string(timestamp) + " [" + suppressed.first + "] " + to_string(suppressed.second) + " messages suppressed by sampling and rate limits.\n";
+				}
+			}
+		}
+
+		if(!batch.empty())
+		{
+			mOutputFile->write(batch);
+			batch.clear();
+		}
+
+		if(mFormat == Format::BINARY)
+		{
+			writeBinaryBuffers(binaryBatch);
+			binaryBatch.clear();
+		}
+
+		if(numTaken > 0 || flushRequest != mFlushedThrough)
+		{
+			{
+				lock_guard<mutex> lock(mWakeMutex);
+				mNumWritten += numTaken;
+				mFlushedThrough = flushRequest;
+			}
+			mWritten.notify_all();
+		}
+
+		if(numTaken > 0)
+		{
+			continue;
+		}
+
+		// Everything logged before the logger was stopped has been written.
+		if(false == isRunning)
+		{
+			break;
+		}
+
+		unique_lock<mutex> lock(mWakeMutex);
+		mIsWriterWaiting = true;
+		mWake.wait_for(lock, WRITER_IDLE_WAIT, [this]() {
+			return false == mIsRunning || false == mQueue->isEmpty() || mFlushRequests != mFlushedThrough;
+		});
+		mIsWriterWaiting = false;
+	}
+
+	{
+		lock_guard<mutex> lock(mWakeMutex);
+	}
+	mWritten.notify_all();
 }
 
 
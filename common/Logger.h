@@ -5,6 +5,27 @@
  * 
  *    log(Logger::LogLevel::ERROR, "module", "Message with param1 & and param2 & and param3 &.", "test", 4, 7.5);
  * 
+ * Messages are added to a LogQueue and written to the log file by a background thread,
+ * which writes everything queued at once. The caller only formats the message. The queue
+ * holds LOG_QUEUE_SIZE messages. When it is full LOG_OVERFLOW decides what happens:
+ * block waits for room, drop discards the message, and count discards it and writes the
+ * number discarded to the log once there is room.
+ * 
+ * With LOG_FORMAT=binary messages are not formatted at all. The id of the format string,
+ * the time and the raw parameters are added to a buffer owned by the calling thread, and
+ * the writer thread appends the buffers to logfile.bin. Each thread buffer holds up to
+ * LOG_QUEUE_SIZE * 128 bytes, with the same overflow policy. Decode the file with the
+ * logdecoder tool. See BinaryLog for the file format.
+ * 
+ * The log is written to LOG_PATH, logfile.log by default, and the binary log to the same
+ * path ending in .bin. The writer thread rotates them when they pass LOG_ROTATE_MB or
+ * LOG_ROTATE_HOURS, and LOG_KEEP_FILES retired files are kept. See LogFile.
+ * 
+ * Per-request messages are logged with logSampled(). LOG_SAMPLE_PERCENT keeps a
+ * percentage of a module's messages and LOG_RATE_LIMITS the most a second, such as
+ * "WebServer=10". How many were suppressed is written every 10 seconds. Request bodies
+ * are logged with body(), which cuts them to LOG_BODY_BYTES.
+ * 
  * @author  Dean Wilson
  * @version 1.0
  * @date    June 15, 2013
@@ -13,12 +34,29 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+/*---------  Program Includes  -------------*/
+#include "BinaryLog.h"
+#include "LogFile.h"
+#include "LogQueue.h"
+#include "LogSampler.h"
+
 /*---------  System Includes  --------------*/
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL DEBUG
+#endif
+
 namespace dw {
 
 /*---------  Class Declaration -------------*/
@@ -34,6 +72,24 @@ public:
     */
     enum class LogLevel : char {NONE, ERROR, INFO, DEBUG};
 
+   /**
+    * The most detailed level compiled in, set with -DLOG_MIN_LEVEL=ERROR, INFO or DEBUG.
+    * Messages at a more detailed level are removed from the build.
+    */
+   static constexpr LogLevel MIN_LEVEL = LogLevel::LOG_MIN_LEVEL;
+
+   /**
+    * @enum OverflowPolicy
+    * What log() does when the queue is full.
+    */
+    enum class OverflowPolicy : char {BLOCK, DROP, COUNT};
+
+   /**
+    * @enum Format
+    * How messages are written to the log.
+    */
+    enum class Format : char {TEXT, BINARY};
+
    /*---------  Public Methods  ---------------*/
    
    /**
@@ -58,107 +114,110 @@ public:
 
 
    /**
-    * Log a message with a module name and string message with 1 additional parameters.
-    * Parameters may be standard C++ types such as int, float, char, string. C style strings
-    * may need to be cast to std::string.
+    * Log a message with a module name and a string message with additional parameters.
+    * Each & in the message is replaced by the next parameter. Parameters may be of any
+    * type that can be written to a std::ostream, and are only formatted if the message
+    * is written.
     * Example usage:
-    * log(Logger::LogLevel::ERROR, "module", "Message with param1 &.", "test");
+    * log(Logger::LogLevel::ERROR, "module", "Message with param1 & and param2 &.", "test", 4);
     * 
     * @param level   The log level a which this message is logged. 
     * @param module  The module which this message applies to.
     * @param message The log message.
-    * @param param   An extra parameter to add to the message
+    * @param params  The parameters to add to the message, one for each &.
     * 
     * @return void
     */
-   template <typename T>
+   template <typename... Params>
    void log(LogLevel level, 
             const std::string& module, 
             const std::string& message,
-            const T& param) const
+            const Params&... params) const
    {
-      std::stringstream ss;
-      std::vector<std::string> substrings = splitStringAt(message, '&');
-      int numSubstrings = substrings.size();
+      if(false == isMessageAtLevelToWrite(level)) {
+         return;
+      }
 
-      if(numSubstrings != 2) {
-         log(LogLevel::ERROR, "Logger", "Error - invalid num parameters for log message &.", message);
+      std::ostringstream ss;
+      if(format(ss, message, 0, params...)) {
+         log(level, module, ss.str());
       }
       else {
-         ss << substrings[0] << param << substrings[1];
-         log(level, module, ss.str());
+         log(LogLevel::ERROR, "Logger", "Error - invalid num parameters for log message &.", message);
       }
    }
 
    /**
-    * Log a message with a module name and string message with 2 additional parameters.
-    * Parameters may be standard C++ types such as int, float, char, string. C style strings
-    * may need to be cast to std::string.
-    * Example usage:
-    * log(Logger::LogLevel::ERROR, "module", "Message with param1 & and param2 &.", "test", 4);
-    * 
-    * @param level   The log level a which this message is logged. 
-    * @param module  The module which this message applies to.
-    * @param message The log message.
-    * @param param1   An extra parameter to add to the message
-    * @param param2   An extra parameter to add to the message
-    * 
-    * @return void
+    * Log a message whose format is a string literal. In the binary format only the id of
+    * the literal and the parameters are recorded.
     */
-   template <typename T>
+   template <std::size_t N, typename... Params>
    void log(LogLevel level, 
             const std::string& module, 
-            const std::string& message,
-            const T& param1,
-            const T& param2) const
+            const char (&message)[N],
+            const Params&... params) const
    {
-      std::stringstream ss;
-      std::vector<std::string> substrings = splitStringAt(message, '&');
-      int numSubstrings = substrings.size();
+      if(false == isMessageAtLevelToWrite(level)) {
+         return;
+      }
 
-      if(numSubstrings > 3) {
-         log(LogLevel::ERROR, "Logger", "Error - invalid num parameters for log message &.", message);
+      std::uint32_t id = 0;
+      if(mFormat == Format::BINARY && literalFormatId(message, sizeof...(Params), id)) {
+         std::string& record = binaryRecord();
+         BinaryLog::appendLogStart(record, id, nowNanoseconds(), module, sizeof...(Params));
+         appendParams(record, params...);
+         writeBinary(record);
       }
       else {
-         ss << substrings[0] << param1 << substrings[1] << param2 << substrings[2];
-         log(level, module, ss.str());
+         log(level, module, std::string(message), params...);
       }
    }
 
    /**
-    * Log a message with a module name and string message with 3 additional parameters.
-    * Parameters may be standard C++ types such as int, float, char, string. C style strings
-    * may need to be cast to std::string.
-    * Example usage:
-    * log(Logger::LogLevel::ERROR, "module", "Message with param1 & and param2 & and param3 &.", "test", 4, 7.5);
-    * 
-    * @param level   The log level a which this message is logged. 
-    * @param module  The module which this message applies to.
-    * @param message The log message.
-    * @param param1   An extra parameter to add to the message
-    * @param param2   An extra parameter to add to the message
+    * Log a message that is written for every request. It is subject to the module's
+    * sampling and rate limit as well as the level.
+    */
+   template <std::size_t N, typename... Params>
+   void logSampled(LogLevel level, 
+                   const std::string& module, 
+                   const char (&message)[N],
+                   const Params&... params) const
+   {
+      if(isMessageAtLevelToWrite(level) && mSampler.isSampled(module)) {
+         log(level, module, message, params...);
+      }
+   }
+
+   /**
+    * A request body to log. Only the first LOG_BODY_BYTES bytes are written, followed
+    * by the full size. It is only copied if the message is written.
+    */
+   struct Body
+   {
+      const std::string& text;
+      std::size_t maxSize;
+   };
+
+   /**
+    * Returns a request body to pass as a log parameter.
     * 
-    * @return void
+    * @param text the body. Must outlive the call to log().
     */
-   template <typename T>
-   void log(LogLevel level, 
-            const std::string& module, 
-            const std::string& message,
-            const T& param1,
-            const T& param2,
-            const T& param3) const
+   Body body(const std::string& text) const
    {
-      std::stringstream ss;
-      std::vector<std::string> substrings = splitStringAt(message, '&');
-      int numSubstrings = substrings.size();
+      return Body{text, mMaxBodySize.load(std::memory_order_relaxed)};
+   }
 
-      if(numSubstrings > 4) {
-         log(LogLevel::ERROR, "Logger", "Error - invalid num parameters for log message &.", message);
-      }
-      else {
-         ss << substrings[0] << param1 << substrings[1] << param2 << substrings[2] << param3 << substrings[3];
-         log(level, module, ss.str());
-      }
+   /**
+    * Returns true if messages at the level are written. Use it to skip building an
+    * expensive parameter for a message that would be discarded.
+    * 
+    * @param level The log level to check.
+    * @return bool
+    */
+   bool isEnabled(LogLevel level) const
+   {
+      return isMessageAtLevelToWrite(level);
    }
 
    /**
@@ -174,13 +233,69 @@ public:
       mLogLevel = level;
    }
 
+   /**
+    * Set what happens to messages logged while the queue is full.
+    * 
+    * @param policy the overflow policy.
+    */
+   void setOverflowPolicy(OverflowPolicy policy)
+   {
+      mOverflowPolicy = policy;
+   }
+
+   /**
+    * Wait until every message logged before the call has been written to the log file.
+    */
+   void flush() const;
+
+   /**
+    * Returns the number of messages discarded because the queue was full.
+    */
+   unsigned long numDropped() const;
+
 private:
 
    /*---------  Private Members    --------------*/
    static Logger mInstance;
    bool mIsFileOpen = false;
-   LogLevel mLogLevel = LogLevel::ERROR;
-   mutable std::ofstream mOutputStream;
+   std::atomic<LogLevel> mLogLevel{LogLevel::ERROR};
+   std::atomic<OverflowPolicy> mOverflowPolicy{OverflowPolicy::COUNT};
+   std::unique_ptr<LogFile> mOutputFile;
+
+   std::unique_ptr<LogQueue> mQueue;
+   std::thread mWriter;
+   std::atomic<bool> mIsRunning{false};
+   mutable std::atomic<bool> mIsWriterWaiting{false};
+   mutable std::mutex mWakeMutex;
+   mutable std::condition_variable mWake;
+   mutable std::condition_variable mWritten;
+   std::atomic<std::size_t> mNumWritten{0};
+   mutable std::atomic<unsigned long> mNumDropped{0};
+   mutable std::atomic<unsigned long> mFlushRequests{0};
+   unsigned long mFlushedThrough = 0;
+
+   /**
+    * The binary records added by one thread and not yet written.
+    */
+   struct ThreadBuffer
+   {
+      std::mutex mutex;
+      std::string bytes;
+   };
+
+   Format mFormat = Format::TEXT;
+   std::unique_ptr<LogFile> mBinaryFile;
+   std::size_t mMaxThreadBufferSize = 0;
+   std::uint32_t mTextFormatId = 0;
+   std::uint32_t mDroppedFormatId = 0;
+   mutable std::mutex mFormatMutex;
+   mutable std::unordered_map<std::string, std::uint32_t> mFormatIds;
+   mutable std::string mPendingFormats;
+   mutable std::vector<std::shared_ptr<ThreadBuffer>> mThreadBuffers;
+
+   mutable LogSampler mSampler;
+   std::atomic<std::size_t> mMaxBodySize{0};
+   std::uint32_t mSuppressedFormatId = 0;
 
    /*---------  Private Methods    ---------------*/
    Logger();
@@ -194,18 +309,164 @@ private:
     * INFO  - written if the logger is set to INFO or DEBUG
     * ERROR - written if the logger is set to INFO, DEBUG or ERROR
     * NONE  - newver written
+    * Levels more detailed than LOG_MIN_LEVEL are never written, and calls at a
+    * constant level are removed by the compiler.
     * 
     * @param levelIn the log level to compare with the current logger setting
     * @return bool
     */
-   bool isMessageAtLevelToWrite(LogLevel levelIn) const;
+   bool isMessageAtLevelToWrite(LogLevel levelIn) const
+   {
+      return levelIn <= MIN_LEVEL &&
+             levelIn != LogLevel::NONE &&
+             levelIn <= mLogLevel.load(std::memory_order_relaxed);
+   }
    bool isMessageAtLevelToWrite(const std::string& levelIn) const;
-   
-   std::vector< std::string > splitStringAt(const std::string& stringIn, const char splitTokenIn) const;
+
+   /**
+    * Add the parameters of a binary log record.
+    */
+   void appendParams(std::string&) const
+   {
+   }
+
+   template <typename Param, typename... Params>
+   void appendParams(std::string& record, const Param& param, const Params&... params) const
+   {
+      BinaryLog::appendParam(record, param);
+      appendParams(record, params...);
+   }
+
+   /**
+    * Write the message with each & replaced by the next parameter.
+    * 
+    * @return false if the number of & and parameters differ.
+    */
+   bool format(std::ostream& out, const std::string& message, std::size_t pos) const
+   {
+      if(message.find('&', pos) != std::string::npos) {
+         return false;
+      }
+
+      out.write(message.data() + pos, message.size() - pos);
+      return true;
+   }
+
+   template <typename Param, typename... Params>
+   bool format(std::ostream& out, const std::string& message, std::size_t pos, const Param& param, const Params&... params) const
+   {
+      std::size_t marker = message.find('&', pos);
+      if(marker == std::string::npos) {
+         return false;
+      }
+
+      out.write(message.data() + pos, marker - pos);
+      out << param;
+      return format(out, message, marker + 1, params...);
+   }
    
    LogLevel stringToLogLevel(const std::string& levelIn) const;
+
+   /**
+    * Read when the log files are rotated from the configuration.
+    */
+   static LogFile::Rotation configuredRotation();
+
+   /**
+    * Returns the bytes that start each binary log file: MAGIC and every format.
+    */
+   std::string binaryHeader() const;
+
+   /**
+    * Read the queue size, overflow policy and format from the configuration.
+    */
+   void configureQueue();
+
+   /**
+    * Read the sampling, rate limits and body size from the configuration.
+    */
+   void configureSampling();
+
+   /**
+    * Returns the configured overflow policy.
+    */
+   static OverflowPolicy configuredOverflowPolicy();
+
+   /**
+    * Apply the level, overflow policy and body size of a reloaded configuration.
+    * The queue, format, files and sampling are only read at startup.
+    */
+   void reloadConfig();
+
+   /**
+    * Find the id of a format string literal, adding it to the formats to write if it is
+    * new. The id is cached for each thread by the address of the literal.
+    * 
+    * @param format the string literal.
+    * @param numParams the number of parameters logged with it.
+    * @param id set to the id.
+    * @return false if the number of & in the format is not numParams.
+    */
+   bool literalFormatId(const char* format, std::size_t numParams, std::uint32_t& id) const;
+
+   /**
+    * Returns the id of a format string, adding it to the formats to write if it is new.
+    */
+   std::uint32_t formatId(const std::string& format) const;
+
+   /**
+    * Returns this thread's empty buffer for building a binary record.
+    */
+   static std::string& binaryRecord();
+
+   /**
+    * Returns the current time in nanoseconds since the epoch.
+    */
+   static std::int64_t nowNanoseconds();
+
+   /**
+    * Returns the calling thread's binary buffer, creating it on first use.
+    */
+   ThreadBuffer& threadBuffer() const;
+
+   /**
+    * Add a binary record to this thread's buffer, applying the overflow policy if the
+    * buffer is full. The record is cleared.
+    */
+   void writeBinary(std::string& record) const;
+
+   /**
+    * Append the new formats and every thread's buffer to the binary log. Only the writer
+    * thread may call this.
+    * 
+    * @param records records from the writer to append after them.
+    */
+   void writeBinaryBuffers(const std::string& records);
+
+   /**
+    * Wake the writer thread if it is waiting for messages.
+    */
+   void wakeWriter() const;
+
+   /**
+    * The writer thread. Writes the queued messages until the logger is destroyed.
+    */
+   void run();
 };
 
+/**
+ * Write a request body, cut to its maximum size.
+ */
+inline std::ostream& operator<<(std::ostream& out, const Logger::Body& body)
+{
+   if(body.text.size() <= body.maxSize) {
+      return out << body.text;
+   }
+
+   out.write(body.text.data(), body.maxSize);
+   return out << "... (" << body.text.size() << " bytes)";
+}
+
 } // End namespace dw
 
 #endif // LOGGER_H
@@ -0,0 +1,141 @@
+
+/*---------  Program Includes  ---------------*/
+#include "ResourceLimits.h"
+
+/*---------  System Includes  --------------*/
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sched.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace dw {
+
+const char CGROUP2_CPU_MAX[] = "/sys/fs/cgroup/cpu.max";
+const char CGROUP2_MEMORY_MAX[] = "/sys/fs/cgroup/memory.max";
+const char CGROUP1_CPU_QUOTA[] = "/sys/fs/cgroup/cpu/cpu.cfs_quota_us";
+const char CGROUP1_CPU_PERIOD[] = "/sys/fs/cgroup/cpu/cpu.cfs_period_us";
+const char CGROUP1_MEMORY_LIMIT[] = "/sys/fs/cgroup/memory/memory.limit_in_bytes";
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: numCpus
+// Description: The cgroup quota if there is one, otherwise the CPUs the
+//              process may run on.
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned ResourceLimits::numCpus()
+{
+	unsigned numCpus = 0;
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	if(sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+		numCpus = CPU_COUNT(&cpus);
+	}
+	if(numCpus == 0) {
+		numCpus = thread::hardware_concurrency();
+	}
+
+	unsigned quotaCpus = cpusInQuota(readLine(CGROUP2_CPU_MAX));
+	if(quotaCpus == 0) {
+		quotaCpus = cpusInQuota(readLine(CGROUP1_CPU_QUOTA) + " " + readLine(CGROUP1_CPU_PERIOD));
+	}
+	if(quotaCpus > 0 && (numCpus == 0 || quotaCpus < numCpus)) {
+		numCpus = quotaCpus;
+	}
+
+	return max(1u, numCpus);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: memoryBytes
+// Description: The cgroup limit if there is one below the machine's memory.
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ResourceLimits::memoryBytes()
+{
+	long numPages = sysconf(_SC_PHYS_PAGES);
+	long pageSize = sysconf(_SC_PAGE_SIZE);
+	uint64_t physical = numPages > 0 && pageSize > 0 ? (uint64_t)numPages * pageSize : 0;
+
+	uint64_t limit = bytesInLimit(readLine(CGROUP2_MEMORY_MAX));
+	if(limit == 0) {
+		limit = bytesInLimit(readLine(CGROUP1_MEMORY_LIMIT));
+	}
+
+	// cgroup v1 reports no limit as a number near the largest 64 bit value.
+	if(limit > 0 && (physical == 0 || limit < physical)) {
+		return limit;
+	}
+
+	return physical;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: cpusInQuota
+// Description: Divide the quota by the period. "max" or -1 is no quota.
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned ResourceLimits::cpusInQuota(const std::string& quota)
+{
+	istringstream stream(quota);
+	string quotaText;
+	long period = 0;
+
+	if(!(stream >> quotaText >> period) || quotaText == "max" || period <= 0) {
+		return 0;
+	}
+
+	long quotaMicroseconds = 0;
+	try {
+		quotaMicroseconds = stol(quotaText);
+	}
+	catch(exception& e) {
+		return 0;
+	}
+
+	if(quotaMicroseconds <= 0) {
+		return 0;
+	}
+
+	return (unsigned)((quotaMicroseconds + period - 1) / period);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public Function: bytesInLimit
+// Description: Read a memory limit. "max" is no limit.
+///////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t ResourceLimits::bytesInLimit(const std::string& limit)
+{
+	if(limit.empty() || limit == "max") {
+		return 0;
+	}
+
+	try {
+		return stoull(limit);
+	}
+	catch(exception& e) {
+		return 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private Function: readLine
+// Description: Returns the first line of a file.
+///////////////////////////////////////////////////////////////////////////////
+
+std::string ResourceLimits::readLine(const std::string& path)
+{
+	ifstream file(path);
+	string line;
+
+	getline(file, line);
+
+	return line;
+}
+
+} // End namespace dw
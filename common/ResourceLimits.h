@@ -0,0 +1,69 @@
+/**
+ * @class ResourceLimits
+ *
+ * The CPUs and memory the server may use. In a container these come from its cgroup:
+ * the CPU quota and the memory limit. Outside one they are the CPUs the process may
+ * run on and the machine's memory. Used for the defaults of settings such as the
+ * number of server threads and the database pool size.
+ *
+ * @author  Dean Wilson
+ * @version 1.0
+ * @date    Oct 19, 2026
+ */
+
+#ifndef RESOURCELIMITS_H
+#define RESOURCELIMITS_H
+
+/*---------  System Includes  --------------*/
+#include <cstdint>
+#include <string>
+
+namespace dw {
+
+/*---------  Class Declaration -------------*/
+
+class ResourceLimits
+{
+public:
+
+   /*---------  Public Methods  ---------------*/
+
+   /**
+    * Returns the number of CPUs the process may use, rounding a fractional quota up.
+    * At least 1.
+    */
+   static unsigned numCpus();
+
+   /**
+    * Returns the bytes of memory the process may use.
+    */
+   static std::uint64_t memoryBytes();
+
+   /**
+    * Returns the number of CPUs a cgroup CPU quota allows, or 0 if it has none.
+    *
+    * @param quota the quota: cgroup v2's cpu.max ("max 100000" or "200000 100000"), or
+    *              cgroup v1's cpu.cfs_quota_us and cpu.cfs_period_us separated by a space.
+    */
+   static unsigned cpusInQuota(const std::string& quota);
+
+   /**
+    * Returns the bytes a cgroup memory limit allows, or 0 if it has none.
+    *
+    * @param limit the contents of memory.max or memory.limit_in_bytes.
+    */
+   static std::uint64_t bytesInLimit(const std::string& limit);
+
+private:
+
+   /*---------  Private Methods    ---------------*/
+
+   /**
+    * Returns the first line of a file, or an empty string if it cannot be read.
+    */
+   static std::string readLine(const std::string& path);
+};
+
+} // End namespace dw
+
+#endif // RESOURCELIMITS_H
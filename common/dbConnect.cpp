@@ -2,85 +2,248 @@
 
 #include "ConfigReader.h"
 #include "Logger.h"
+#include "ResourceLimits.h"
 
+#include <atomic>
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+#include <sqlite3.h>
 
 namespace dw {
    
-std::vector<SQLite::Database*> connections;
+std::vector<std::vector<SQLite::Database*>> connections;
+std::map<SQLite::Database*, unsigned int> connectionShards;
+std::mutex connectionsMutex;
+std::function<void(SQLite::Database&, unsigned int)> connectionSetup;
+
+// Every request that reads or writes the database takes a connection, so this is
+// used to measure how busy the server is.
+std::atomic<unsigned long> numConnectionRequests(0);
+
+static unsigned int configuredShards()
+{
+   return (unsigned int)dw::ConfigReader::getInstance().getInt(dw::ConfigReader::Config::DB_SHARDS);
+}
+
+// The most idle connections kept for each shard. Each server thread and each
+// background writer uses one at a time.
+static unsigned int maxPoolSize()
+{
+   static const long defaultSize = ResourceLimits::numCpus() + 2;
+   
+   return (unsigned int)dw::ConfigReader::getInstance().getInt(dw::ConfigReader::Config::DB_POOL_SIZE, defaultSize);
+}
+
+static std::atomic<unsigned int>& numShardsSetting()
+{
+   static std::atomic<unsigned int> numShards(configuredShards());
+   
+   return numShards;
+}
+
+unsigned int db_numShards()
+{
+   return numShardsSetting();
+}
+
+void db_setNumShards(unsigned int numShards)
+{
+   numShardsSetting() = numShards > 0 ? numShards : 1;
+}
+
+unsigned int db_shardForUser(int userId)
+{
+   // User ids are assigned in sequence, so the remainder spreads users evenly.
+   return static_cast<unsigned int>(userId) % db_numShards();
+}
+
+std::string db_shardPath(unsigned int shard)
+{
+   std::string dbPath;
+   
+   try {
+      dbPath = dw::ConfigReader::getInstance().getConfig(dw::ConfigReader::Config::DB_PATH); 
+   }
+   catch(std::out_of_range& e) {
+      dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_shardPath: ERROR Exception: &.", e.what());
+      abort();
+   }
+   
+   if(shard == 0) {
+      return dbPath;
+   }
+   
+   std::string::size_type dirEnd = dbPath.find_last_of('/');
+   std::string::size_type extension = dbPath.find_last_of('.');
+   if(extension == std::string::npos || (dirEnd != std::string::npos && extension < dirEnd)) {
+      return dbPath + "." + std::to_string(shard);
+   }
+   
+   return dbPath.substr(0, extension) + "." + std::to_string(shard) + dbPath.substr(extension);
+}
+
+void db_setConnectionSetup(std::function<void(SQLite::Database&, unsigned int shard)> setup)
+{
+   std::lock_guard<std::mutex> lock(connectionsMutex);
+   connectionSetup = setup;
+}
 
 SQLite::Database* db_getConnection()
 {
-   std::string mDbPath;
+   return db_getConnection(0);
+}
+
+SQLite::Database* db_getConnection(unsigned int shard)
+{
    SQLite::Database* connection = nullptr;
    
-   if(connections.size() == 0) {
-      try {
-         mDbPath = dw::ConfigReader::getInstance().getConfig(dw::ConfigReader::Config::DB_PATH); 
-         dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "dbConnect", "db_getConnection: Database path is &.", mDbPath);
+   ++numConnectionRequests;
+   
+   {
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      
+      if(shard < connections.size() && connections[shard].size() > 0) {
+         connection = connections[shard].back();
+         connections[shard].pop_back();
+      }
+   }
+   
+   if(connection == nullptr) {
+      std::string mDbPath = db_shardPath(shard);
+      dw::Logger::instance().log(dw::Logger::LogLevel::INFO, "dbConnect", "db_getConnection: Database path is &.", mDbPath);
+      
+      std::unique_ptr<SQLite::Database> newConnection(new SQLite::Database(mDbPath, 
+                     SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE));
+      
+      std::function<void(SQLite::Database&, unsigned int)> setup;
+      {
+         std::lock_guard<std::mutex> lock(connectionsMutex);
+         setup = connectionSetup;
       }
-      catch(std::out_of_range& e) {
-         e.what();
-         dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_getConnection: ERROR Exception: &.", e.what());
-         abort();
+      
+      if(setup) {
+         setup(*newConnection, shard);
       }
       
-      connection = new SQLite::Database(mDbPath, 
-                     SQLite::OPEN_READWRITE|SQLite::OPEN_CREATE);
-   } else {
-      connection = connections.back();
-      connections.pop_back();
+      connection = newConnection.release();
+      
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      connectionShards[connection] = shard;
    }
    
-   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_getConnection: LEAVE - Open connections &.", connections.size());
+   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_getConnection: LEAVE - Open connections &.", db_numAvailableConnections());
    
    return connection;
 }
 
 unsigned int db_numAvailableConnections()
 {
-   return connections.size();
+   std::lock_guard<std::mutex> lock(connectionsMutex);
+   
+   unsigned int numConnections = 0;
+   for(auto& shardConnections : connections) {
+      numConnections += shardConnections.size();
+   }
+   
+   return numConnections;
+}
+
+unsigned long db_numConnectionRequests()
+{
+   return numConnectionRequests;
 }
 
 void db_returnConnection(SQLite::Database* connection)
 {
-   bool exists = false;
+   if(connection == nullptr) {
+      return;
+   }
    
-   for(SQLite::Database* storedConnection : connections) {
-      if(connection == storedConnection) {
-            dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_returnConnection: Connection already stored.");
-         exists = true;
-         break;
+   // A connection is never pooled with a transaction open. One that cannot be
+   // rolled back is closed instead.
+   bool isClosed = false;
+   if(!sqlite3_get_autocommit(connection->getHandle())) {
+      dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_returnConnection: Connection returned in a transaction. Rolling back.");
+      try {
+         connection->exec("ROLLBACK");
+      }
+      catch(SQLite::Exception& e) {
+         dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_returnConnection: Rollback failed. Closing the connection: &.", e.what());
+         isClosed = true;
       }
    }
    
-   if(connection != nullptr && exists == false) {
-      connections.push_back(connection);
+   {
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      
+      auto shard = connectionShards.find(connection);
+      if(shard == connectionShards.end()) {
+         dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_returnConnection: Unknown connection.");
+         return;
+      }
+      
+      if(isClosed) {
+         connectionShards.erase(shard);
+         delete connection;
+         return;
+      }
+      
+      if(shard->second >= connections.size()) {
+         connections.resize(shard->second + 1);
+      }
+      
+      std::vector<SQLite::Database*>& pool = connections[shard->second];
+      bool exists = false;
+      
+      for(SQLite::Database* storedConnection : pool) {
+         if(connection == storedConnection) {
+               dw::Logger::instance().log(dw::Logger::LogLevel::ERROR, "dbConnect", "db_returnConnection: Connection already stored.");
+            exists = true;
+            break;
+         }
+      }
+      
+      if(exists == false && pool.size() >= maxPoolSize()) {
+         // A burst of requests opened more connections than the pool keeps.
+         connectionShards.erase(shard);
+         delete connection;
+      }
+      else if(exists == false) {
+         pool.push_back(connection);
+      }
    }
    
-   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_returnConnection: LEAVE - Open connections &.", connections.size());
+   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_returnConnection: LEAVE - Open connections &.", db_numAvailableConnections());
    
    return;
 }
 
 void db_shutdown()
 {
-   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_shutdown: ENTER - Open connections &.", connections.size());
+   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_shutdown: ENTER - Open connections &.", db_numAvailableConnections());
    
-   for(SQLite::Database* connection : connections) {
-      if(connection) {
-         delete connection;
-         connection = nullptr;
+   {
+      std::lock_guard<std::mutex> lock(connectionsMutex);
+      
+      for(auto& pool : connections) {
+         for(SQLite::Database* connection : pool) {
+            if(connection) {
+               connectionShards.erase(connection);
+               delete connection;
+            }
+         }
       }
+      
+      connections.clear();
    }
    
-   connections.clear();
-   
-   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_shutdown: LEAVE - Open connections &.", connections.size());
+   dw::Logger::instance().log(dw::Logger::LogLevel::DEBUG, "dbConnect", "db_shutdown: LEAVE - Open connections &.", db_numAvailableConnections());
 }
 
 } // End namespace dw
@@ -3,13 +3,34 @@
 
 #include <SQLiteCpp/SQLiteCpp.h>
 
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace dw {
    
+   /*
+    * Users' books can be split across DB_SHARDS database files. Shard 0 is DB_PATH and
+    * also holds the users and tokens. Shard n is DB_PATH with ".n" added before the file
+    * extension. Each shard has its own pool of connections.
+    */
+   
    SQLite::Database* db_getConnection();
+   SQLite::Database* db_getConnection(unsigned int shard);
    void db_returnConnection(SQLite::Database* database);
    unsigned int db_numAvailableConnections();
+   unsigned long db_numConnectionRequests();
    void db_shutdown();
+   
+   /*
+    * Set a function that prepares each new pooled connection before it is first used,
+    * such as to attach other databases. Set it before any connection is opened.
+    */
+   void db_setConnectionSetup(std::function<void(SQLite::Database&, unsigned int shard)> setup);
+   
+   unsigned int db_numShards();
+   void db_setNumShards(unsigned int numShards);
+   unsigned int db_shardForUser(int userId);
+   std::string db_shardPath(unsigned int shard);
 }
 #endif